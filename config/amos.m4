@@ -654,7 +654,7 @@ EOF
 
 
     if AC_TRY_EVAL("$CXX $OPENMP_CXXFLAGS -c $CXXFLAGS -o amos_openmp_main.o amos_openmp_main.$ac_ext"); then
-      if AC_TRY_EVAL("$CXX $OPENMP_LDFLAGS $LIBS -o amos_openmp_main amos_openmp_main.o"); then
+      if AC_TRY_EVAL("$CXX $OPENMP_CXXFLAGS $CXXFLAGS -o amos_openmp_main amos_openmp_main.o $OPENMP_LDFLAGS $LIBS"); then
         ac_cv_openmp_test_result="yes"
       fi
     fi
@@ -672,7 +672,7 @@ EOF
   AC_MSG_RESULT([$ac_cv_openmp_test_result])
   rm -f amos_openmp_test.h amos_openmp_main.$ac_ext amos_openmp_main.o amos_openmp_main
 
-  have_openmp_test=$ac_cv_boost_test_result
+  have_openmp_test=$ac_cv_openmp_test_result
 ])
 
 ##-- AMOS_JELLYFISH -------------------------------------------------------------------
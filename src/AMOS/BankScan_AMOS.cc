@@ -0,0 +1,315 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Source for BankScan_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BankScan_AMOS.hh"
+
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
+
+using namespace AMOS;
+using namespace std;
+
+
+
+
+//================================================ BankScan_t ==================
+const Size_t BankScan_t::MIN_BLOCK_SIZE    = 256;
+const Size_t BankScan_t::MAX_BLOCK_SIZE    = 16384;
+const Size_t BankScan_t::BLOCKS_PER_THREAD = 16;
+const Size_t BankScan_t::WINDOW_PER_THREAD = 4;
+
+
+//================================================ State_t =====================
+//! \brief What the worker threads of a run share
+//!
+//! Blocks are handed out in BID order. Ordered, block k is scanned into
+//! slot k % window and a block is only handed out once the block that used
+//! its slot before has been emitted; the thread that completes the oldest
+//! unemitted block emits every ready block in order. Unordered, every
+//! thread has its own slot and emits each block as soon as it is scanned.
+//!
+//==============================================================================
+struct BankScan_t::State_t
+{
+  const BankScan_t & scan;
+  Worker_t & worker;
+  bool ordered;
+  Size_t window;              //!< number of slots
+  Size_t nblocks;             //!< number of blocks
+  Size_t next;                //!< next block to hand out
+  Size_t emitted;             //!< blocks emitted, ordered only
+  Size_t threads;             //!< workers started, gives each a slot
+  vector<char> ready;         //!< slot holds a block to emit, ordered only
+  bool emitting;              //!< a thread is in emit()
+  bool failed;                //!< a thread threw, stop the run
+  string what;                //!< the first error
+  int line;
+  string file;
+
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_t lock;       //!< guards the members above
+  pthread_cond_t cond;        //!< signalled on every emit and failure
+#endif
+
+
+  State_t (const BankScan_t & s, Worker_t & w, bool o, Size_t nslots)
+    : scan (s), worker (w), ordered (o), window (nslots),
+      nblocks (s . blocks_m . size( )), next (0), emitted (0), threads (0),
+      ready (nslots, false), emitting (false), failed (false), line (0)
+  {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init (&lock, NULL);
+    pthread_cond_init (&cond, NULL);
+#endif
+  }
+
+
+  ~State_t ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    pthread_cond_destroy (&cond);
+    pthread_mutex_destroy (&lock);
+#endif
+  }
+
+
+  void acquire ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock (&lock);
+#endif
+  }
+
+
+  void release ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock (&lock);
+#endif
+  }
+
+
+  void wait ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    pthread_cond_wait (&cond, &lock);
+#endif
+  }
+
+
+  void signal ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    pthread_cond_broadcast (&cond);
+#endif
+  }
+
+
+  //-- Records the first error and stops the run, called unlocked
+  void fail (const char * w, int l, const char * f)
+  {
+    acquire( );
+    if ( ! failed )
+      {
+        failed = true;
+        what = w;
+        line = l;
+        file = f;
+      }
+    signal( );
+    release( );
+  }
+};
+
+
+
+
+//----------------------------------------------------- BankScan_t -------------
+BankScan_t::BankScan_t (BankStream_t & bank, Size_t nthreads)
+  : bank_m (bank)
+{
+  if ( ! bank . isOpen( ) )
+    AMOS_THROW_IO ("Cannot scan: bank not open");
+
+  dir_m = bank . getStoreDir( );
+  type_m = bank . getType( );
+  version_m = bank . getVersion( );
+  fixed_store_only_m = bank . getFixedStoreOnly( );
+
+#ifdef HAVE_LIBPTHREAD
+  nthreads_m = nthreads > 1 ? nthreads : 1;
+#else
+  nthreads_m = 1;
+#endif
+
+  //-- Enough blocks for the threads to even out, never across partitions
+  Size_t last = bank . getIndexSize( );
+  Size_t psize = bank . getPartitionSize( );
+  Size_t bsize = last / (nthreads_m * BLOCKS_PER_THREAD);
+  if ( bsize < MIN_BLOCK_SIZE ) bsize = MIN_BLOCK_SIZE;
+  if ( bsize > MAX_BLOCK_SIZE ) bsize = MAX_BLOCK_SIZE;
+
+  Block_t block;
+  for ( ID_t pfirst = 1; pfirst <= last; pfirst += psize )
+    {
+      ID_t plast = pfirst + psize - 1;
+      if ( plast > last ) plast = last;
+
+      for ( block . first = pfirst; block . first <= plast;
+            block . first += bsize )
+        {
+          block . last = block . first + bsize - 1;
+          if ( block . last > plast ) block . last = plast;
+          blocks_m . push_back (block);
+        }
+    }
+}
+
+
+//----------------------------------------------------- openCursor -------------
+void BankScan_t::openCursor (BankStream_t & cursor) const
+{
+  cursor . open (dir_m, B_SPY, version_m);
+  cursor . setFixedStoreOnly (fixed_store_only_m);
+}
+
+
+//----------------------------------------------------- run --------------------
+void BankScan_t::run (Worker_t & worker, bool ordered)
+{
+  if ( blocks_m . empty( ) )
+    return;
+
+  Size_t nslots = ordered ? nthreads_m * WINDOW_PER_THREAD : nthreads_m;
+  State_t state (*this, worker, ordered, nslots);
+  worker . setSlots (nslots);
+
+#ifdef HAVE_LIBPTHREAD
+  //-- The calling thread is a worker too
+  vector<pthread_t> threads (nthreads_m - 1);
+  Size_t started = 0;
+  while ( started < threads . size( )  &&
+          pthread_create (&threads [started], NULL, work, &state) == 0 )
+    ++ started;
+  scanBlocks (state, bank_m);
+  for ( Size_t i = 0; i < started; ++ i )
+    pthread_join (threads [i], NULL);
+#else
+  scanBlocks (state, bank_m);
+#endif
+
+  if ( state . failed )
+    throw Exception_t (state . what, state . line, state . file);
+}
+
+
+//----------------------------------------------------- work -------------------
+void * BankScan_t::work (void * arg)
+{
+  State_t & st = *((State_t *) arg);
+  BankStream_t cursor (st . scan . type_m);
+
+  try
+    {
+      st . scan . openCursor (cursor);
+    }
+  catch (const Exception_t & e)
+    {
+      st . fail (e . what( ), e . line( ), e . file( ));
+      return NULL;
+    }
+
+  scanBlocks (st, cursor);
+
+  return NULL;
+}
+
+
+//----------------------------------------------------- scanBlocks -------------
+void BankScan_t::scanBlocks (State_t & st, BankStream_t & cursor)
+{
+  st . acquire( );
+  Size_t id = st . threads ++;
+  st . release( );
+
+  try
+    {
+      while ( true )
+        {
+          //-- Take the next block, ordered only once its slot is free
+          st . acquire( );
+          while ( ! st . failed  &&  st . next < st . nblocks  &&
+                  st . ordered  &&  st . next >= st . emitted + st . window )
+            st . wait( );
+          if ( st . failed  ||  st . next >= st . nblocks )
+            {
+              st . release( );
+              break;
+            }
+          Size_t k = st . next ++;
+          st . release( );
+
+          Size_t slot = st . ordered ? k % st . window : id;
+          st . worker . scan (cursor, st . scan . blocks_m [k], slot);
+
+          st . acquire( );
+          if ( ! st . ordered )
+            {
+              while ( ! st . failed  &&  st . emitting )
+                st . wait( );
+              if ( st . failed )
+                {
+                  st . release( );
+                  break;
+                }
+              st . emitting = true;
+              st . release( );
+
+              st . worker . emit (slot);
+
+              st . acquire( );
+              st . emitting = false;
+              st . signal( );
+            }
+          else
+            {
+              st . ready [slot] = true;
+              if ( ! st . emitting )
+                {
+                  //-- Emit every block that is next in line, others may
+                  //   finish theirs meanwhile
+                  st . emitting = true;
+                  while ( ! st . failed  &&  st . emitted < st . nblocks  &&
+                          st . ready [st . emitted % st . window] )
+                    {
+                      Size_t s = st . emitted % st . window;
+                      st . release( );
+
+                      st . worker . emit (s);
+
+                      st . acquire( );
+                      st . ready [s] = false;
+                      ++ st . emitted;
+                      st . signal( );
+                    }
+                  st . emitting = false;
+                }
+            }
+          st . release( );
+        }
+    }
+  catch (const Exception_t & e)
+    {
+      st . fail (e . what( ), e . line( ), e . file( ));
+    }
+  catch (const exception & e)
+    {
+      st . fail (e . what( ), __LINE__, __FILE__);
+    }
+}
@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Header for BankScan_t and parallelScan
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BankScan_AMOS_HH
+#define __BankScan_AMOS_HH 1
+
+#include "inttypes_AMOS.hh"
+#include "BankStream_AMOS.hh"
+#include <vector>
+
+
+
+
+namespace AMOS {
+
+//================================================ BankScan_t ==================
+//! \brief Streams the records of a bank on several threads
+//!
+//! The BID space of the bank is cut into blocks of consecutive BIDs that
+//! never cross a partition, and the blocks are handed out to the worker
+//! threads as they ask for work. The calling thread reads through the
+//! scanned stream itself, every other worker has its own BankStream_t on
+//! the bank directory, opened in spy mode, so the workers never share a
+//! read cursor or a file position. The results of a block are delivered on
+//! one thread at a time, in BID order if asked for, in which case the
+//! workers only run a bounded number of blocks ahead of the oldest block
+//! not yet delivered.
+//!
+//! The extra workers read the records as stored on disk, so the scanned
+//! stream should have no unsaved changes, and each loads its own copy of
+//! the bank's ID map. The get pointer of the scanned stream is left
+//! anywhere. Without pthreads the blocks are scanned one after the other
+//! on the calling thread. Most code will want the parallelScan template
+//! rather than this class.
+//!
+//==============================================================================
+class BankScan_t
+{
+
+public:
+
+  //============================================== Block_t =====================
+  //! \brief A run of consecutive BIDs in one partition
+  //!
+  //============================================================================
+  struct Block_t
+  {
+    ID_t first;        //!< first BID of the block
+    ID_t last;         //!< last BID of the block
+  };
+
+
+  //============================================== Worker_t ====================
+  //! \brief The work done on the blocks of a scan
+  //!
+  //! Results are kept in slots: scan() fills a slot with the results of a
+  //! block, and emit() later delivers and empties it. scan() is called
+  //! concurrently on different slots, emit() is never called concurrently.
+  //!
+  //============================================================================
+  class Worker_t
+  {
+  public:
+
+    virtual ~Worker_t ( ) { }
+
+    //-- Called once before the scan with the number of slots in use
+    virtual void setSlots (Size_t nslots) = 0;
+
+    //-- Reads the records of block from cursor into a slot
+    virtual void scan (BankStream_t & cursor, const Block_t & block,
+                       Size_t slot) = 0;
+
+    //-- Delivers and empties a slot
+    virtual void emit (Size_t slot) = 0;
+  };
+
+
+  static const Size_t MIN_BLOCK_SIZE;     //!< fewest BIDs per block
+  static const Size_t MAX_BLOCK_SIZE;     //!< most BIDs per block
+  static const Size_t BLOCKS_PER_THREAD;  //!< blocks per thread, for balance
+  static const Size_t WINDOW_PER_THREAD;  //!< ordered blocks ahead per thread
+
+
+  //---------------------------------------------- BankScan_t ------------------
+  //! \brief Prepares a scan of an open bank
+  //!
+  //! \param bank The bank to scan
+  //! \param nthreads Number of worker threads, 0 or 1 for a serial scan
+  //! \pre The bank is open for reading
+  //! \throws IOException_t
+  //!
+  BankScan_t (BankStream_t & bank, Size_t nthreads);
+
+
+  //---------------------------------------------- run -------------------------
+  //! \brief Scans every block of the bank with a worker
+  //!
+  //! Returns once every block has been scanned and emitted. If scan() or
+  //! emit() throws, the remaining blocks are dropped and the first error is
+  //! rethrown on the calling thread once the workers have stopped.
+  //!
+  //! \param worker The work to do on every block
+  //! \param ordered Emit the blocks in BID order
+  //! \throws Exception_t
+  //! \return void
+  //!
+  void run (Worker_t & worker, bool ordered);
+
+
+  //---------------------------------------------- getBlocks -------------------
+  //! \brief Get the blocks the bank was cut into
+  //!
+  //! \return The blocks, in BID order
+  //!
+  const std::vector<Block_t> & getBlocks ( ) const
+  {
+    return blocks_m;
+  }
+
+
+  //---------------------------------------------- getThreads ------------------
+  //! \brief Get the number of worker threads
+  //!
+  //! \return The number of threads, 1 for a serial scan
+  //!
+  Size_t getThreads ( ) const
+  {
+    return nthreads_m;
+  }
+
+
+private:
+
+  struct State_t;
+
+  //-- Opens a worker's read cursor on the scanned bank
+  void openCursor (BankStream_t & cursor) const;
+
+  //-- Worker thread body
+  static void * work (void * state);
+
+  //-- Scans and emits blocks until none are left
+  static void scanBlocks (State_t & state, BankStream_t & cursor);
+
+  BankStream_t & bank_m;              //!< the scanned stream
+  std::string dir_m;                  //!< bank directory
+  NCode_t type_m;                     //!< bank type
+  Size_t version_m;                   //!< bank version
+  bool fixed_store_only_m;            //!< scan the fixed store only
+  Size_t nthreads_m;                  //!< worker threads
+  std::vector<Block_t> blocks_m;      //!< blocks, in BID order
+};
+
+
+
+
+//================================================ BankScanWorker_t ============
+//! \brief The Worker_t of parallelScan
+//!
+//! Every slot holds the results of one block in BID order. Each scan()
+//! works on its own copy of the prototype object.
+//!
+//==============================================================================
+template <class Object, class Functor, class Sink>
+class BankScanWorker_t : public BankScan_t::Worker_t
+{
+
+public:
+
+  typedef typename Functor::result_type Result_t;
+
+
+  BankScanWorker_t (Functor & f, Sink & sink, const Object & prototype)
+    : f_m (f), sink_m (sink), prototype_m (prototype)
+  { }
+
+
+  void setSlots (Size_t nslots)
+  {
+    slots_m . clear( );
+    slots_m . resize (nslots);
+  }
+
+
+  void scan (BankStream_t & cursor, const BankScan_t::Block_t & block,
+             Size_t slot)
+  {
+    std::vector<Result_t> & results = slots_m [slot];
+    Object obj (prototype_m);
+    Result_t result;
+
+    cursor . seekg (block . first);
+    while ( ! cursor . eof( )  &&  cursor . tellg( ) <= block . last  &&
+            cursor >> obj )
+      {
+        //-- removed records are skipped, so a read may land past the block
+        if ( cursor . tellg( ) - 1 > block . last )
+          break;
+        if ( f_m (obj, result) )
+          results . push_back (result);
+      }
+  }
+
+
+  void emit (Size_t slot)
+  {
+    std::vector<Result_t> & results = slots_m [slot];
+    for ( typename std::vector<Result_t>::const_iterator
+            i = results . begin( ); i != results . end( ); ++ i )
+      sink_m (*i);
+    results . clear( );
+  }
+
+
+private:
+
+  Functor & f_m;
+  Sink & sink_m;
+  const Object & prototype_m;
+  std::vector< std::vector<Result_t> > slots_m;
+};
+
+
+
+
+//--------------------------------------------------- parallelScan -------------
+//! \brief Applies a functor to every record of a bank on several threads
+//!
+//! Replaces a 'while ( bank >> obj )' loop whose work on a record does not
+//! depend on the other records. The functor is called concurrently on
+//! different records, each thread with its own object, and must not touch
+//! shared state without locking; it defines the type of its results as
+//! result_type and has the form 'bool operator() (Object & obj,
+//! result_type & result)', returning true to deliver the result. The sink
+//! is called on one thread at a time, as 'sink (const result_type &)', in
+//! BID order when ordered is true, so it may print or collect freely.
+//!
+//! With ordered true the results are delivered as the serial loop would
+//! deliver them.
+//!
+//! \code
+//! struct Length_t
+//! {
+//!   typedef std::pair<ID_t, Size_t> result_type;
+//!   bool operator() (Read_t & red, result_type & r)
+//!   { r = std::make_pair (red.getIID( ), red.getLength( )); return true; }
+//! };
+//!
+//! parallelScan<Read_t> (red_bank, 4, length, printer);
+//! \endcode
+//!
+//! \param bank The bank to scan, open for reading
+//! \param nthreads Number of worker threads, 0 or 1 for a serial scan
+//! \param f The functor applied to every record
+//! \param sink Receives the results of the functor
+//! \param ordered Deliver the results in BID order
+//! \param prototype Copied to make the object of each block
+//! \throws Exception_t
+//! \return void
+//!
+template <class Object, class Functor, class Sink>
+void parallelScan (BankStream_t & bank, Size_t nthreads,
+                   Functor & f, Sink & sink, bool ordered = true,
+                   const Object & prototype = Object( ))
+{
+  BankScanWorker_t<Object, Functor, Sink> worker (f, sink, prototype);
+  BankScan_t scan (bank, nthreads);
+  scan . run (worker, ordered);
+}
+
+} // namespace AMOS
+
+#endif // #ifndef __BankScan_AMOS_HH
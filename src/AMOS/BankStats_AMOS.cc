@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Source for BankStats_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "BankStats_AMOS.hh"
+#include "utility_AMOS.hh"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace AMOS;
+using namespace std;
+
+
+//-- Writes s as a JSON string
+static void writeString (ostream & out, const string & s)
+{
+  out << '"';
+  for ( string::const_iterator c = s . begin( ); c != s . end( ); ++ c )
+    {
+      if ( *c == '"'  ||  *c == '\\' )
+        out << '\\' << *c;
+      else if ( (unsigned char) *c < 0x20 )
+        {
+          char buf [8];
+          sprintf (buf, "\\u%04x", (unsigned char) *c);
+          out << buf;
+        }
+      else
+        out << *c;
+    }
+  out << '"';
+}
+
+
+//-- Writes the non-empty buckets of a histogram as a JSON object
+static void writeHistogram (ostream & out, const vector<uint64_t> & hist)
+{
+  bool first = true;
+  out << '{';
+  for ( int k = 0; k < (int) hist . size( ); ++ k )
+    {
+      if ( hist [k] == 0 )
+        continue;
+      if ( ! first )
+        out << ',';
+      first = false;
+      if ( k == (int) hist . size( ) - 1 )
+        out << "\"inf\":";
+      else
+        out << "\"" << ((uint64_t) 1 << k) << "\":";
+      out << hist [k];
+    }
+  out << '}';
+}
+
+
+
+
+//================================================ BankStats_t =================
+const int BankStats_t::LATENCY_BUCKETS = 32;
+
+//-- A plain string, so banks constructed during static initialization can
+//   read it before any std::string has been constructed
+const char * const BankStats_t::ENV_VARIABLE = "AMOS_BANK_STATS";
+
+
+//----------------------------------------------------- BankStats_t ------------
+BankStats_t::BankStats_t ( )
+{
+  clear( );
+}
+
+
+//----------------------------------------------------- clear ------------------
+void BankStats_t::clear ( )
+{
+  fetches = appends = replaces = removes = 0;
+  stream_reads = stream_appends = 0;
+  lookups = seeks = 0;
+  partition_opens = partition_evictions = 0;
+  fix_read = fix_written = var_read = var_written = 0;
+  fetch_latency . assign (LATENCY_BUCKETS, 0);
+  stream_latency . assign (LATENCY_BUCKETS, 0);
+}
+
+
+//----------------------------------------------------- empty ------------------
+bool BankStats_t::empty ( ) const
+{
+  return fetches == 0  &&  appends == 0  &&  replaces == 0  &&
+    removes == 0  &&  stream_reads == 0  &&  stream_appends == 0  &&
+    lookups == 0  &&  seeks == 0  &&  partition_opens == 0;
+}
+
+
+//----------------------------------------------------- isEnabled --------------
+bool BankStats_t::isEnabled ( )
+{
+  static int enabled = -1;
+
+  if ( enabled < 0 )
+    {
+      const char * env = getenv (ENV_VARIABLE);
+      enabled = env != NULL  &&  *env != '\0'  &&  strcmp (env, "0") != 0;
+    }
+
+  return enabled;
+}
+
+
+//----------------------------------------------------- now --------------------
+double BankStats_t::now ( )
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv . tv_sec * 1e6 + tv . tv_usec;
+}
+
+
+//----------------------------------------------------- addLatency -------------
+void BankStats_t::addLatency (vector<uint64_t> & hist, double start)
+{
+  double usecs = now( ) - start;
+  int k = 0;
+  while ( k < LATENCY_BUCKETS - 1  &&  usecs >= (double) ((uint64_t) 1 << k) )
+    ++ k;
+  ++ hist [k];
+}
+
+
+//----------------------------------------------------- report -----------------
+void BankStats_t::report (const string & bank, NCode_t type) const
+{
+  const char * env = getenv (ENV_VARIABLE);
+
+  if ( env == NULL  ||  strcmp (env, "1") == 0  ||
+       strcmp (env, "stderr") == 0 )
+    {
+      writeJSON (cerr, bank, type);
+      return;
+    }
+
+  //-- One write per line so lines of concurrent processes stay whole
+  ostringstream line;
+  writeJSON (line, bank, type);
+  ofstream out (env, ios::out | ios::app);
+  if ( out . is_open( ) )
+    {
+      string s = line . str( );
+      out . write (s . data( ), s . size( ));
+    }
+}
+
+
+//----------------------------------------------------- writeJSON --------------
+void BankStats_t::writeJSON (ostream & out,
+                             const string & bank, NCode_t type) const
+{
+  out << "{\"bank\":";
+  writeString (out, bank);
+  out << ",\"type\":";
+  writeString (out, Decode (type));
+  out
+    << ",\"pid\":" << getpid( )
+    << ",\"fetch\":" << fetches
+    << ",\"append\":" << appends
+    << ",\"replace\":" << replaces
+    << ",\"remove\":" << removes
+    << ",\"stream_read\":" << stream_reads
+    << ",\"stream_append\":" << stream_appends
+    << ",\"lookup\":" << lookups
+    << ",\"seek\":" << seeks
+    << ",\"partition_open\":" << partition_opens
+    << ",\"partition_evict\":" << partition_evictions
+    << ",\"fix\":{\"read\":" << fix_read
+    << ",\"written\":" << fix_written << '}'
+    << ",\"var\":{\"read\":" << var_read
+    << ",\"written\":" << var_written << '}'
+    << ",\"fetch_latency_us\":";
+  writeHistogram (out, fetch_latency);
+  out << ",\"stream_latency_us\":";
+  writeHistogram (out, stream_latency);
+  out << "}\n";
+  out . flush( );
+}
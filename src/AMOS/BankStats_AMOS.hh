@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Header for BankStats_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BankStats_AMOS_HH
+#define __BankStats_AMOS_HH 1
+
+#include "inttypes_AMOS.hh"
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+
+
+namespace AMOS {
+
+//================================================ BankStats_t =================
+//! \brief I/O counters of an open bank
+//!
+//! A bank keeps these counters only when profiling is turned on, either with
+//! the AMOS_BANK_STATS environment variable or with Bank_t::setStats, and
+//! writes them out as one line of JSON when it is closed. AMOS_BANK_STATS
+//! set to 1 or "stderr" sends the lines to stderr, any other value except 0
+//! names a file the lines are appended to, so every tool that uses a bank
+//! can be profiled without changes.
+//!
+//! Bytes are counted per record as the bank reads or writes them in its
+//! fixed and variable length stores, whether or not the stream buffers or
+//! the read-ahead had to go to disk for them. Seeks are the repositionings
+//! of the store streams on the record paths: fetch, append, replace,
+//! remove and streaming. Latencies are kept in histograms of power of two
+//! buckets of microseconds, bucket k counting the operations that took less
+//! than 2^k microseconds.
+//!
+//! The counters are plain integers that a profiled bank updates even from
+//! its const members. Threads that share an unprofiled bank may call
+//! lookupBID at the same time, on a profiled bank they need a lock.
+//!
+//==============================================================================
+class BankStats_t
+{
+
+public:
+
+  static const int LATENCY_BUCKETS;     //!< histogram buckets, the last open
+  static const char * const ENV_VARIABLE;  //!< turns the counters on
+
+
+  uint64_t fetches;             //!< random access fetches
+  uint64_t appends;             //!< random access appends
+  uint64_t replaces;            //!< replaces
+  uint64_t removes;             //!< removes
+  uint64_t stream_reads;        //!< records read by a BankStream_t
+  uint64_t stream_appends;      //!< records appended by a BankStream_t
+  uint64_t lookups;             //!< IID and EID to BID lookups
+  uint64_t seeks;               //!< store stream repositionings
+  uint64_t partition_opens;     //!< partitions opened
+  uint64_t partition_evictions; //!< partitions closed to make room
+  uint64_t fix_read;            //!< bytes read from the fixed stores
+  uint64_t fix_written;         //!< bytes written to the fixed stores
+  uint64_t var_read;            //!< bytes read from the variable stores
+  uint64_t var_written;         //!< bytes written to the variable stores
+
+  std::vector<uint64_t> fetch_latency;   //!< fetch latency histogram
+  std::vector<uint64_t> stream_latency;  //!< stream read latency histogram
+
+
+  //--------------------------------------------------- BankStats_t ------------
+  //! \brief Constructs zeroed counters
+  //!
+  BankStats_t ( );
+
+
+  //--------------------------------------------------- clear ------------------
+  //! \brief Zeroes every counter
+  //!
+  //! \return void
+  //!
+  void clear ( );
+
+
+  //--------------------------------------------------- empty ------------------
+  //! \brief Returns true if nothing has been counted
+  //!
+  bool empty ( ) const;
+
+
+  //--------------------------------------------------- isEnabled --------------
+  //! \brief Returns true if AMOS_BANK_STATS turns the counters on
+  //!
+  //! The environment is read once, by the first bank constructed.
+  //!
+  static bool isEnabled ( );
+
+
+  //--------------------------------------------------- now --------------------
+  //! \brief Returns a clock in microseconds, to time an operation with
+  //!
+  static double now ( );
+
+
+  //--------------------------------------------------- addLatency -------------
+  //! \brief Adds the time since start to a latency histogram
+  //!
+  //! \param hist The histogram, fetch_latency or stream_latency
+  //! \param start The time the operation started, from now()
+  //! \return void
+  //!
+  static void addLatency (std::vector<uint64_t> & hist, double start);
+
+
+  //--------------------------------------------------- report -----------------
+  //! \brief Writes the counters where AMOS_BANK_STATS says
+  //!
+  //! Appends a line of JSON to the file named by AMOS_BANK_STATS, or to
+  //! stderr if it is unset or asks for stderr. Failing to open the file is
+  //! not an error, the line is then lost.
+  //!
+  //! \param bank The bank directory
+  //! \param type The bank type
+  //! \return void
+  //!
+  void report (const std::string & bank, NCode_t type) const;
+
+
+  //--------------------------------------------------- writeJSON --------------
+  //! \brief Writes the counters as one line of JSON
+  //!
+  //! Histograms list their non-empty buckets, keyed by the bucket's upper
+  //! bound in microseconds.
+  //!
+  //! \param out The stream to write to
+  //! \param bank The bank directory
+  //! \param type The bank type
+  //! \return void
+  //!
+  void writeJSON (std::ostream & out,
+                  const std::string & bank, NCode_t type) const;
+};
+
+} // namespace AMOS
+
+#endif // #ifndef __BankStats_AMOS_HH
@@ -8,15 +8,472 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "BankStream_AMOS.hh"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
+
 using namespace AMOS;
 using namespace std;
 
 
 
 
+//================================================ MemoryBuf_t =================
+//! \brief Read-only stream buffer over a block of memory
+//!
+//! Lets readRecord decode a record straight out of a read-ahead chunk,
+//! including the relative seeks some records use to skip sections.
+//!
+//==============================================================================
+namespace {
+
+class MemoryBuf_t : public std::streambuf
+{
+
+public:
+
+  void set (const char * p, size_t n)
+  {
+    setg ((char *) p, (char *) p, (char *) p + n);
+  }
+
+
+protected:
+
+  pos_type seekoff (off_type off, ios::seekdir dir, ios::openmode which)
+  {
+    char * p;
+    switch ( dir )
+      {
+      case ios::beg: p = eback() + off; break;
+      case ios::cur: p = gptr() + off; break;
+      default:       p = egptr() + off; break;
+      }
+
+    if ( ! (which & ios::in)  ||  p < eback()  ||  p > egptr() )
+      return pos_type (off_type (-1));
+
+    setg (eback(), p, egptr());
+    return pos_type (off_type (p - eback()));
+  }
+
+
+  pos_type seekpos (pos_type pos, ios::openmode which)
+  {
+    return seekoff (off_type (pos), ios::beg, which);
+  }
+};
+
+} // namespace
+
+
+
+
+//================================================ ReadAhead_t =================
+//! \brief Reads the records of a BankStream_t ahead of operator>>
+//!
+//! A chunk holds the fix records of a run of BIDs in one partition and the
+//! var data of the records in use, each read with as few reads as the
+//! layout of the var store allows. With pthreads, a producer thread fills a
+//! ring of chunks starting at a given BID while the stream decodes them;
+//! otherwise each chunk is read when the stream reaches it. The producer
+//! has its own file descriptors and only reads bank members that do not
+//! change while the bank is not open for writing.
+//!
+//==============================================================================
+struct BankStream_t::ReadAhead_t
+{
+  struct Chunk_t
+  {
+    ID_t first;               //!< first BID in the chunk
+    ID_t last;                //!< last BID in the chunk
+    bool fixonly;             //!< var data was not read
+    vector<char> fix;         //!< fix records of the BIDs
+    vector<char> var;         //!< var data of the records in use
+    vector<size_t> varoff;    //!< offset of each record's var data in var
+    vector<size_t> varlen;    //!< size of each record's var data
+    string error;             //!< read error, if any
+  };
+
+  BankStream_t & bank;        //!< the stream read ahead of
+  Size_t chunksize;           //!< bytes of records per chunk
+  vector<Chunk_t> ring;       //!< chunk ring
+  int head;                   //!< chunk being decoded
+  int count;                  //!< number of filled chunks, from head
+  bool holding;               //!< the stream is decoding the head chunk
+  ID_t next;                  //!< first BID of the next chunk to fill
+  bool fixonly;               //!< fill chunks without var data
+  bool done;                  //!< no more chunks will be filled
+
+  int fixfd, varfd;           //!< partition being read
+  ID_t fdpid;                 //!< its partition ID
+  Size_t fdversion;           //!< and version
+
+  MemoryBuf_t fixbuf, varbuf;
+  istream fixin, varin;       //!< streams over the current record
+
+#ifdef HAVE_LIBPTHREAD
+  pthread_t thread;           //!< producer thread
+  pthread_mutex_t lock;       //!< guards head, count, next and stop
+  pthread_cond_t cond;        //!< signalled on every ring change
+  bool stop;                  //!< stream asked the producer to quit
+  bool running;               //!< thread was started
+#endif
+
+
+  ReadAhead_t (BankStream_t & b, Size_t depth, Size_t chunk)
+    : bank (b), chunksize (chunk), ring (depth + 1),
+      head (0), count (0), holding (false), next (1), fixonly (false),
+      done (true), fixfd (-1), varfd (-1), fdpid (0), fdversion (0),
+      fixin (&fixbuf), varin (&varbuf)
+  {
+#ifdef HAVE_LIBPTHREAD
+    stop = false;
+    running = false;
+    pthread_mutex_init (&lock, NULL);
+    pthread_cond_init (&cond, NULL);
+#endif
+  }
+
+
+  ~ReadAhead_t ( )
+  {
+    halt();
+#ifdef HAVE_LIBPTHREAD
+    pthread_cond_destroy (&cond);
+    pthread_mutex_destroy (&lock);
+#endif
+    closeFiles();
+  }
+
+
+  void closeFiles ( )
+  {
+    if ( fixfd >= 0 )
+      ::close (fixfd);
+    if ( varfd >= 0 )
+      ::close (varfd);
+    fixfd = varfd = -1;
+  }
+
+
+  //-- Read n bytes at off, false on a short read or error
+  static bool readAt (int fd, char * dst, size_t n, off_t off)
+  {
+    while ( n > 0 )
+      {
+        ssize_t got = ::pread (fd, dst, n, off);
+        if ( got < 0  &&  errno == EINTR )
+          continue;
+        if ( got <= 0 )
+          return false;
+        dst += got;
+        n -= got;
+        off += got;
+      }
+    return true;
+  }
+
+
+  //-- Fill c with the records from bid on
+  void fill (Chunk_t & c, ID_t bid, bool fixonly)
+  {
+    Size_t fsize = bank.fix_size_m;
+    ID_t psize = bank.partition_size_m;
+    ID_t lastbid = bank.last_bid_m [bank.version_m];
+
+    c.first = bid;
+    c.fixonly = fixonly;
+    c.error.erase();
+
+    //-- A run of BIDs stored in the same partition of the same version
+    Size_t version = bank.localizeVersionBID (bid);
+    ID_t pid = (bid - 1) / psize;
+    ID_t lid = (bid - 1) - pid * psize;
+
+    ID_t end = (pid + 1) * psize;
+    if ( end > lastbid )
+      end = lastbid;
+    ID_t maxrecs = chunksize / fsize > 0 ? chunksize / fsize : 1;
+    if ( end - bid >= maxrecs )
+      end = bid + maxrecs - 1;
+    c.last = bid;
+    while ( c.last < end  &&  bank.localizeVersionBID (c.last + 1) == version )
+      ++ c.last;
+
+    if ( fixfd < 0  ||  pid != fdpid  ||  version != fdversion )
+      {
+        closeFiles();
+        BankPartition_t * partition = (*bank.partitions_m [pid]) [version];
+        fixfd = ::open (partition->fix_name.c_str(), O_RDONLY);
+        varfd = ::open (partition->var_name.c_str(), O_RDONLY);
+        fdpid = pid;
+        fdversion = version;
+        if ( fixfd < 0  ||  varfd < 0 )
+          {
+            closeFiles();
+            c.error = "Could not open bank partition, " + partition->fix_name;
+            return;
+          }
+      }
+
+    size_t nrecs = c.last - c.first + 1;
+    c.fix.resize (nrecs * fsize);
+    if ( ! readAt (fixfd, &c.fix [0], nrecs * fsize, (off_t) lid * fsize) )
+      {
+        c.error = "Unknown file read error in fixed stream read-ahead, bank corrupted";
+        return;
+      }
+
+    c.var.clear();
+    c.varoff.assign (nrecs, 0);
+    c.varlen.assign (nrecs, 0);
+    if ( fixonly )
+      return;
+
+    //-- Find the var data of the records in use, ending the chunk once it
+    //   holds chunksize bytes
+    bankstreamoff vbegin = 0, vend = 0;
+    size_t vtotal = 0;
+    vector<bankstreamoff> vpos (nrecs, -1);
+    for ( size_t i = 0; i < nrecs; ++ i )
+      {
+        const char * rec = &c.fix [i * fsize];
+        bankstreamoff off;
+        BankFlags_t flags;
+        Size_t vsize;
+        memcpy (&off, rec, sizeof (off));
+        memcpy (&flags, rec + sizeof (off), sizeof (flags));
+        memcpy (&vsize, rec + fsize - sizeof (vsize), sizeof (vsize));
+        off = ltoh64 (off);
+        vsize = ltoh32 (vsize);
+
+        if ( flags.is_removed  ||  vsize <= 0 )
+          continue;
+
+        if ( vtotal > 0  &&  vtotal + vsize > (size_t) chunksize )
+          {
+            nrecs = i;
+            c.last = c.first + nrecs - 1;
+            c.fix.resize (nrecs * fsize);
+            c.varoff.resize (nrecs);
+            c.varlen.resize (nrecs);
+            vpos.resize (nrecs);
+            break;
+          }
+
+        if ( vtotal == 0  ||  off < vbegin )
+          vbegin = off;
+        if ( vtotal == 0  ||  off + vsize > vend )
+          vend = off + vsize;
+        vtotal += vsize;
+        vpos [i] = off;
+        c.varlen [i] = vsize;
+      }
+
+    if ( vtotal == 0 )
+      return;
+
+    //-- One read if the records are about contiguous, as written by a
+    //   stream append, otherwise one read per record
+    if ( (size_t) (vend - vbegin) <= 2 * vtotal + 65536 )
+      {
+        c.var.resize (vend - vbegin);
+        for ( size_t i = 0; i < nrecs; ++ i )
+          c.varoff [i] = vpos [i] - vbegin;
+        if ( ! readAt (varfd, &c.var [0], vend - vbegin, (off_t) vbegin) )
+          c.error = "Unknown file read error in variable stream read-ahead, bank corrupted";
+      }
+    else
+      {
+        c.var.resize (vtotal);
+        size_t pos = 0;
+        for ( size_t i = 0; i < nrecs  &&  c.error.empty(); ++ i )
+          {
+            if ( vpos [i] < 0 )
+              continue;
+            c.varoff [i] = pos;
+            if ( ! readAt (varfd, &c.var [pos], c.varlen [i], (off_t) vpos [i]) )
+              c.error = "Unknown file read error in variable stream read-ahead, bank corrupted";
+            pos += c.varlen [i];
+          }
+      }
+  }
+
+
+#ifdef HAVE_LIBPTHREAD
+  //-- Producer thread body, fills free ring slots until done or stopped
+  static void * run (void * arg)
+  {
+    ReadAhead_t * self = (ReadAhead_t *) arg;
+    int nslots = self->ring.size();
+
+    for ( ;; )
+      {
+        pthread_mutex_lock (&self->lock);
+        while ( self->count == nslots && ! self->stop )
+          pthread_cond_wait (&self->cond, &self->lock);
+        int slot = (self->head + self->count) % nslots;
+        ID_t bid = self->next;
+        bool stop = self->stop;
+        pthread_mutex_unlock (&self->lock);
+        if ( stop )
+          break;
+
+        Chunk_t & c = self->ring [slot];
+        self->fill (c, bid, self->fixonly);
+
+        pthread_mutex_lock (&self->lock);
+        self->count ++;
+        self->next = c.last + 1;
+        if ( ! c.error.empty()  ||
+             self->next > self->bank.last_bid_m [self->bank.version_m] )
+          self->done = true;
+        pthread_cond_broadcast (&self->cond);
+        bool done = self->done;
+        pthread_mutex_unlock (&self->lock);
+        if ( done )
+          break;
+      }
+
+    return NULL;
+  }
+#endif
+
+
+  //-- Stop the producer and drop the filled chunks
+  void halt ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    if ( running )
+      {
+        pthread_mutex_lock (&lock);
+        stop = true;
+        pthread_cond_broadcast (&cond);
+        pthread_mutex_unlock (&lock);
+        pthread_join (thread, NULL);
+        running = false;
+        stop = false;
+      }
+#endif
+    head = count = 0;
+    holding = false;
+    done = true;
+  }
+
+
+  //-- Restart reading at bid
+  void restart (ID_t bid, bool fixonly)
+  {
+    halt();
+    next = bid;
+    this->fixonly = fixonly;
+    done = false;
+#ifdef HAVE_LIBPTHREAD
+    if ( pthread_create (&thread, NULL, ReadAhead_t::run, this) == 0 )
+      running = true;
+#endif
+  }
+
+
+  //-- The chunk holding bid, with var data unless fixonly
+  Chunk_t & getChunk (ID_t bid, bool fixonly)
+  {
+    if ( holding )
+      {
+        Chunk_t & c = ring [head];
+        if ( c.first <= bid  &&  bid <= c.last  &&  (fixonly || ! c.fixonly) )
+          return c;
+      }
+
+#ifdef HAVE_LIBPTHREAD
+    for ( int attempt = 0; attempt < 2; ++ attempt )
+      {
+        //-- start over at bid if the producer is elsewhere
+        if ( attempt > 0  ||  ! running )
+          {
+            restart (bid, fixonly);
+            if ( ! running )
+              break;
+          }
+
+        pthread_mutex_lock (&lock);
+        if ( holding )
+          {
+            //-- release the decoded chunk back to the producer
+            head = (head + 1) % ring.size();
+            count --;
+            holding = false;
+            pthread_cond_broadcast (&cond);
+          }
+        while ( count == 0 && ! done )
+          pthread_cond_wait (&cond, &lock);
+        bool found = ( count > 0  &&  ring [head].first == bid  &&
+                       (fixonly || ! ring [head].fixonly) );
+        pthread_mutex_unlock (&lock);
+
+        if ( found )
+          {
+            holding = true;
+            return checked (ring [head]);
+          }
+      }
+#endif
+
+    //-- Without a producer, read the chunk here
+    halt();
+    fill (ring [0], bid, fixonly);
+    holding = true;
+    return checked (ring [0]);
+  }
+
+
+  Chunk_t & checked (Chunk_t & c)
+  {
+    if ( ! c.error.empty() )
+      {
+        string error = c.error;
+        halt();
+        AMOS_THROW_IO (error);
+      }
+    return c;
+  }
+
+
+  //-- Stream over the fix record of bid
+  istream & fixStream (ID_t bid, bool fixonly)
+  {
+    Chunk_t & c = getChunk (bid, fixonly);
+    Size_t fsize = bank.fix_size_m;
+    fixbuf.set (&c.fix [(bid - c.first) * fsize], fsize);
+    fixin.clear();
+    return fixin;
+  }
+
+
+  //-- Stream over the var data of bid, after fixStream for the same bid
+  istream & varStream (ID_t bid)
+  {
+    Chunk_t & c = ring [head];
+    size_t i = bid - c.first;
+    varbuf.set (c.var.empty() ? NULL : &c.var [c.varoff [i]], c.varlen [i]);
+    varin.clear();
+    return varin;
+  }
+};
+
+
+
+
 //================================================ BankStream_t ================
 const Size_t BankStream_t::DEFAULT_BUFFER_SIZE = 1024;
 const Size_t BankStream_t::MAX_OPEN_PARTITIONS = 2;
+const Size_t BankStream_t::DEFAULT_READAHEAD_CHUNK = 4 * 1024 * 1024;
 
 
 //----------------------------------------------------- assignEID --------------
@@ -95,6 +552,8 @@ BankStream_t & BankStream_t::ignore (bankstreamoff n)
   BankFlags_t bf;
   bankstreamoff off;
   BankPartition_t * partition;
+  BankPartition_t * last = NULL;
+  bankstreamoff next = 0;
   Size_t skip = fix_size_m - sizeof (bankstreamoff) - sizeof (BankFlags_t);
 
   while ( n > 0  &&  inrange() )
@@ -103,12 +562,24 @@ BankStream_t & BankStream_t::ignore (bankstreamoff n)
       partition = localizeBID (lid);
       off = lid * fix_size_m;
 
-      partition->fix.seekg (off);
- 
+      //-- Consecutive records of a partition need no seek
+      if ( partition != last  ||  off != next )
+        {
+          partition->fix.seekg (off);
+          if ( stats_m != NULL )
+            ++ stats_m->seeks;
+        }
+
       partition->fix.ignore (sizeof (bankstreamoff));
       readLE (partition->fix, &bf);
       partition->fix.ignore (skip);
 
+      if ( stats_m != NULL )
+        stats_m->fix_read += fix_size_m;
+
+      last = partition;
+      next = off + fix_size_m;
+
       if ( ! bf.is_removed )
 	-- n;
       ++ curr_bid_m;
@@ -150,9 +621,16 @@ BankStream_t & BankStream_t::operator>> (IBankable_t & obj)
   BankFlags_t flags;
   bankstreamoff off;
   bankstreamoff vpos;
-  BankPartition_t * partition;
+  BankPartition_t * partition = NULL;
+  istream * fix;
+  istream * var;
   Size_t skip = fix_size_m - sizeof (bankstreamoff) - sizeof (BankFlags_t);
 
+  if ( readahead_depth_m > 0  &&  readahead_m == NULL  &&  ! (mode_m & B_WRITE) )
+    readahead_m = new ReadAhead_t (*this, readahead_depth_m, readahead_chunk_m);
+
+  double start = stats_m != NULL ? BankStats_t::now() : 0;
+
   //-- Seek to the record and read the data
   flags.is_removed = true;
   while ( flags.is_removed )
@@ -163,22 +641,35 @@ BankStream_t & BankStream_t::operator>> (IBankable_t & obj)
 	  return *this;
 	}
 
-      lid = curr_bid_m;
-      partition = localizeBID (lid);
-
-      if (partition != oldPartition_m)
-      {
-        off = lid * fix_size_m;
-        partition->fix.seekg (off);
-        oldPartition_m = partition;
-      }
-
-      readLE (partition->fix, &vpos);
-      readLE (partition->fix, &flags);
+      if ( readahead_m != NULL )
+        {
+          fix = &(readahead_m->fixStream (curr_bid_m, fixed_store_only_m));
+        }
+      else
+        {
+          lid = curr_bid_m;
+          partition = localizeBID (lid);
+
+          if (partition != oldPartition_m)
+          {
+            off = lid * fix_size_m;
+            partition->fix.seekg (off);
+            oldPartition_m = partition;
+            if ( stats_m != NULL )
+              ++ stats_m->seeks;
+          }
+
+          fix = &(partition->fix);
+        }
+
+      readLE (*fix, &vpos);
+      readLE (*fix, &flags);
       if ( flags.is_removed )
-	partition->fix.ignore (skip);
+	fix->ignore (skip);
 
       ++ curr_bid_m;
+      if ( stats_m != NULL )
+        stats_m->fix_read += fix_size_m;
     }
 
 
@@ -198,22 +689,42 @@ BankStream_t & BankStream_t::operator>> (IBankable_t & obj)
 
   if (fixed_store_only_m)
   {
-    obj.readRecordFix (partition->fix);
+    obj.readRecordFix (*fix);
   }
   else
   {
-    partition->var.seekg (vpos);
-    obj.readRecord (partition->fix, partition->var);
+    if ( readahead_m != NULL )
+      {
+        var = &(readahead_m->varStream (curr_bid_m - 1));
+      }
+    else
+      {
+        partition->var.seekg (vpos);
+        var = &(partition->var);
+        if ( stats_m != NULL )
+          ++ stats_m->seeks;
+      }
 
-    if ( partition->var.fail() )
+    obj.readRecord (*fix, *var);
+
+    if ( var->fail() )
       AMOS_THROW_IO ("Unknown file read error in variable stream fetch, bank corrupted");
   }
 
-  partition->fix.ignore (sizeof (Size_t));
+  Size_t vsize;
+  readLE (*fix, &vsize);
 
-  if ( partition->fix.fail() )
+  if ( fix->fail() )
     AMOS_THROW_IO ("Unknown file read error in fixed stream fetch, bank corrupted");
 
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->stream_reads;
+      if ( ! fixed_store_only_m )
+        stats_m->var_read += vsize;
+      BankStats_t::addLatency (stats_m->stream_latency, start);
+    }
+
   return *this;
 }
 
@@ -227,6 +738,7 @@ BankStream_t & BankStream_t::operator<< (IBankable_t & obj)
     AMOS_THROW_IO ("Cannot stream append: bank not open for writing");
   if ( banktype_m != obj.getNCode() )
     AMOS_THROW_ARGUMENT ("Cannot stream append: incompatible object type");
+  obj.checkWritable( );
 
   //-- Insert the ID triple into the map (may throw exception)
   triples_m.push_back
@@ -237,7 +749,8 @@ BankStream_t & BankStream_t::operator<< (IBankable_t & obj)
     if ( last_bid_m [version_m] == max_bid_m )
       addPartition (true);
 
-    BankPartition_t * partition = getLastPartition(localizeVersionBID(last_bid_m [version_m] + 1));
+    ID_t lid = last_bid_m [version_m] + 1;
+    BankPartition_t * partition = localizeWritableBID (lid, false);
 
     //-- Prepare the object for append
     obj.flags_m.is_removed  = false;
@@ -245,9 +758,11 @@ BankStream_t & BankStream_t::operator<< (IBankable_t & obj)
 
     if ( !ate_m )
       {
-        partition->fix.seekp (0, ios::end);
+        partition->fix.seekp (lid * fix_size_m);
         partition->var.seekp (0, ios::end);
         ate_m = true;
+        if ( stats_m != NULL )
+          stats_m->seeks += 2;
       }
 
     //-- data is written in the following order to the FIX and VAR streams
@@ -260,6 +775,7 @@ BankStream_t & BankStream_t::operator<< (IBankable_t & obj)
     obj.writeRecord (partition->fix, partition->var);
     Size_t vsize = (std::streamoff)partition->var.tellp() - vpos;
     writeLE (partition->fix, &vsize);
+    partition->account (vsize, 0);
 
     //-- If fix_size is not yet known, calculate it
     Size_t fsize = (std::streamoff)partition->fix.tellp() - fpos;
@@ -272,6 +788,13 @@ BankStream_t & BankStream_t::operator<< (IBankable_t & obj)
       AMOS_THROW_IO
 	("Unknown file write error in stream append, bank corrupted");
 
+    if ( stats_m != NULL )
+      {
+        ++ stats_m->stream_appends;
+        stats_m->fix_written += fsize;
+        stats_m->var_written += vsize;
+      }
+
     ++ nbids_m [version_m];
     ++ last_bid_m [version_m];
   }
@@ -286,6 +809,30 @@ BankStream_t & BankStream_t::operator<< (IBankable_t & obj)
 }
 
 
+//----------------------------------------------------- setReadAhead -----------
+void BankStream_t::setReadAhead (Size_t depth, Size_t chunk)
+{
+  if ( depth < 0  ||  chunk <= 0 )
+    AMOS_THROW_ARGUMENT ("Invalid read-ahead depth or chunk size");
+
+  stopReadAhead();
+  readahead_depth_m = depth;
+  readahead_chunk_m = chunk;
+}
+
+
+//----------------------------------------------------- stopReadAhead ----------
+void BankStream_t::stopReadAhead()
+{
+  if ( readahead_m != NULL )
+    {
+      delete readahead_m;
+      readahead_m = NULL;
+      oldPartition_m = NULL;
+    }
+}
+
+
 //----------------------------------------------------- replace ----------------
 void BankStream_t::replace (ID_t iid, IBankable_t & obj)
 {
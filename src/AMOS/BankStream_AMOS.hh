@@ -42,12 +42,19 @@ protected:
   static const Size_t MAX_OPEN_PARTITIONS;
   //!< Allowable simultaneously open partitions (one for >>, one for <<)
 
+  static const Size_t DEFAULT_READAHEAD_CHUNK;
+  //!< Bytes of records per read-ahead chunk
+
+  struct ReadAhead_t;
+  friend struct ReadAhead_t;
+
 
   //--------------------------------------------------- init -------------------
   //! \brief Initializes the stream variables
   //!
   void init()
   {
+    stopReadAhead();
     oldPartition_m = NULL;
     fixed_store_only_m = false;
     eof_m = false;
@@ -62,7 +69,13 @@ protected:
   {
     return ( curr_bid_m > 0  &&  curr_bid_m <= last_bid_m [version_m] );
   }
-  
+
+
+  //--------------------------------------------------- stopReadAhead ----------
+  //! \brief Stops the read-ahead thread and frees its buffers
+  //!
+  void stopReadAhead();
+
 
   bool fixed_store_only_m;            //!< Just fetch from fixed store
   bool eof_m;                         //!< eof error flag
@@ -72,6 +85,10 @@ protected:
 
   BankPartition_t * oldPartition_m;
 
+  ReadAhead_t * readahead_m;          //!< read-ahead buffers, NULL if off
+  Size_t readahead_depth_m;           //!< chunks buffered ahead, 0 if off
+  Size_t readahead_chunk_m;           //!< bytes of records per chunk
+
 public:
 
   enum bankseekdir
@@ -101,6 +118,9 @@ public:
   BankStream_t (NCode_t type )
     : Bank_t (type)
   {
+    readahead_m = NULL;
+    readahead_depth_m = 0;
+    readahead_chunk_m = DEFAULT_READAHEAD_CHUNK;
     init();
     triples_m [NULL_ID] = NULL;
     buffer_size_m = DEFAULT_BUFFER_SIZE;
@@ -112,6 +132,9 @@ public:
   BankStream_t (const std::string & type)
     : Bank_t (type)
   {
+    readahead_m = NULL;
+    readahead_depth_m = 0;
+    readahead_chunk_m = DEFAULT_READAHEAD_CHUNK;
     init();
     triples_m [NULL_ID] = NULL;
     buffer_size_m = DEFAULT_BUFFER_SIZE;
@@ -124,6 +147,7 @@ public:
   {
     if ( is_open_m )
       close();
+    stopReadAhead();
   }
 
 
@@ -165,6 +189,17 @@ public:
   }
 
 
+  //--------------------------------------------------- compact ----------------
+  //! \post Invalidates all bankstreamoff's, BID's are kept
+  //!
+  Size_t compact (float threshold = DEFAULT_GARBAGE_RATIO)
+  {
+    ate_m = false;
+    oldPartition_m = NULL;
+    return Bank_t::compact (threshold);
+  }
+
+
   //--------------------------------------------------- concat -----------------
   //! \post Invalidates all source bankstreamoff's and BID's
   //!
@@ -233,6 +268,17 @@ public:
 
 
 
+  //--------------------------------------------------- getFixedStoreOnly ------
+  //! \brief Checks if operator>> reads the fixed store only
+  //!
+  //! \return true if only the fixed store is read, false otherwise
+  //!
+  bool getFixedStoreOnly() const
+  {
+    return fixed_store_only_m;
+  }
+
+
   //--------------------------------------------------- ignore -----------------
   //! \brief Ignores the next n stream objects
   //!
@@ -336,6 +382,30 @@ public:
   }
 
 
+  //--------------------------------------------------- setReadAhead -----------
+  //! \brief Reads the bank ahead of operator>> on a background thread
+  //!
+  //! While on, a thread reads the fix and var stores of the records after
+  //! the get pointer in large sequential chunks, moving on to the next
+  //! partition when one is done, and operator>> decodes the records from
+  //! memory. Chunks hold about chunk bytes of records each, up to depth of
+  //! them are read ahead of the one operator>> is decoding, so at most
+  //! depth + 1 chunks are buffered. Seeking away from the buffered records drops them and
+  //! restarts the reading at the new position, so read-ahead only pays off
+  //! for long sequential scans. Without pthreads the chunks are read when
+  //! operator>> needs them, still in large sequential reads.
+  //!
+  //! Read-ahead is off while the bank is open for writing, since the
+  //! buffered records could go out of date. The setting is kept when the
+  //! bank is closed and opened again.
+  //!
+  //! \param depth Number of chunks buffered, 0 to turn read-ahead off
+  //! \param chunk Bytes of records per chunk
+  //! \return void
+  //!
+  void setReadAhead (Size_t depth, Size_t chunk = DEFAULT_READAHEAD_CHUNK);
+
+
   //--------------------------------------------------- seekg ------------------
   //! \brief Seeks to a different position in the BankStream
   //!
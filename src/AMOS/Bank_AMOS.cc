@@ -20,6 +20,7 @@
 #include <cstring>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 using namespace AMOS;
 using namespace std;
 
@@ -38,12 +39,36 @@ using namespace std;
 
 
 
+//================================================ BankRecord_t ================
+//----------------------------------------------------- serialize --------------
+void BankRecord_t::serialize (const IBankable_t & obj)
+{
+  ostringstream fix, var;
+
+  obj.checkWritable( );
+  ncode_m = obj.getNCode( );
+  iid_m = obj.iid_m;
+  eid_m = obj.eid_m;
+  flags_m = obj.flags_m;
+  obj.writeRecord (fix, var);
+  fix_m = fix.str( );
+  var_m = var.str( );
+}
+
+
+
+
 //================================================ Bank_t ======================
 const Size_t Bank_t::DEFAULT_BUFFER_SIZE    = 1024;
 const Size_t Bank_t::DEFAULT_PARTITION_SIZE = 1000000;
 const Size_t Bank_t::MAX_OPEN_PARTITIONS    = 20;
+const float  Bank_t::DEFAULT_GARBAGE_RATIO  = 0.5;
 
-const string Bank_t::BANK_VERSION     =  "3.0";
+//-- 3.1 added the live and dead byte counts to the IFO, which 3.0 readers
+//   would take for locks, and the overlay versions, which 3.0 readers would
+//   take for whole versions and read wrong records from without an error
+const string Bank_t::BANK_VERSION     =  "3.1";
+const string Bank_t::BANK_VERSION_3_0 =  "3.0";
 
 const string Bank_t::FIX_STORE_SUFFIX = ".fix";
 const string Bank_t::IFO_STORE_SUFFIX = ".ifo";
@@ -51,36 +76,57 @@ const string Bank_t::LCK_STORE_SUFFIX = ".lck";
 const string Bank_t::VAR_STORE_SUFFIX = ".var";
 const string Bank_t::MAP_STORE_SUFFIX = ".map";
 const string Bank_t::TMP_STORE_SUFFIX = ".tmp";
+const string Bank_t::OVL_STORE_SUFFIX = ".ovl";
 
 const char Bank_t::WRITE_LOCK_CHAR    = 'w';
 const char Bank_t::READ_LOCK_CHAR     = 'r';
 
 const int32_t Bank_t::OPEN_LATEST_VERSION = -1;
 
-void Bank_t::copyFile(fstream &in, ofstream &out) {
-   in.seekg(0, std::ios::beg);
-   out << in.rdbuf();
-   out.flush();
-   return;
-
-   in.seekg(0, std::ios::beg);
-
-   char buf[1000];
-   while ( in ) {
-      in.read(buf, 1000);
-      out << buf;
-    } 
-    if ( in.bad() )
-       AMOS_THROW_IO ("Cannot create version, error copying existing data");
+//----------------------------------------------------- measurePartition -----
+void Bank_t::measurePartition (ID_t id)
+{
+  BankPartition_t * partition = getPartition (id, version_m);
+  const vector<uint8_t> * owned = overlays_m [version_m];
+
+  ID_t first = id * partition_size_m;
+  ID_t nslots = std::min ((ID_t) partition_size_m, last_bid_m [version_m] - first);
+  Size_t vsize;
+  BankFlags_t flags;
+  int64_t live = 0;
+
+  //-- Whatever the held records do not point at is dead
+  for ( ID_t lid = 0; lid < nslots; ++ lid )
+    {
+      if ( owned != NULL  &&  ! isOwnedBID (*owned, first + lid + 1) )
+        continue;
+
+      partition->fix.seekg (lid * fix_size_m + sizeof (bankstreamoff));
+      readLE (partition->fix, &flags);
+      partition->fix.seekg ((lid + 1) * fix_size_m - sizeof (Size_t));
+      readLE (partition->fix, &vsize);
+      if ( ! flags.is_removed )
+        live += vsize;
+    }
+
+  partition->var.seekg (0, ios::end);
+  int64_t total = (std::streamoff)partition->var.tellg();
+
+  if ( partition->fix.fail()  ||  partition->var.fail() )
+    AMOS_THROW_IO ("Unknown file read error in compact, bank corrupted");
+
+  partition->live_bytes = live;
+  partition->dead_bytes = total - live;
 }
 
+
 //----------------------------------------------------- nextVersion ------------
 void Bank_t::nextVersion ( )
 {
   if ( ! is_open_m  ||  ! (mode_m & B_WRITE) )
     AMOS_THROW_IO ("Cannot create version, bank not open for writing");
 
-   // copy all partitons and map to the next version
+   // copy the map to the next version, the records stay where they are
    version_m++;
    nversions_m = version_m + 1;
    // copy size information
@@ -104,18 +150,35 @@ void Bank_t::nextVersion ( )
    idmap_m.write(new_map);
    new_map.close();
 
-   // now finally copy all partitions and initialize them
+   // the new version starts out owning no records
+   for (Size_t i = version_m; i < (Size_t)overlays_m.size(); i++) {
+      delete overlays_m[i];
+   }
+   overlays_m.resize (nversions_m, NULL);
+   overlays_m[version_m] = new vector<uint8_t>();
+   writeOverlay();
+
+   // now create the empty partitions of the overlay
    for (ID_t i = 0; i != npartitions_m; i++) {
-      copyPartition(i);
+      overlayPartition(i);
    }
 }
 
-void Bank_t::copyPartition(ID_t &id) {
-   if (id > npartitions_m) {
-      AMOS_THROW_IO("Invalid partition specified for copy");
+//----------------------------------------------------- overlayPartition -------
+void Bank_t::overlayPartition (ID_t id) {
+   if (id >= npartitions_m) {
+      AMOS_THROW_IO("Invalid partition specified for overlay");
    }
 
+   //-- Drop any stale partition left by a version being overwritten
    vector<BankPartition_t *>* partitions = partitions_m[id];
+   while ((Size_t)partitions->size() > version_m) {
+      opened_m.erase (std::remove (opened_m.begin(), opened_m.end(),
+                                   partitions->back()), opened_m.end());
+      delete partitions->back();
+      partitions->pop_back();
+   }
+
    BankPartition_t * partition = new BankPartition_t (buffer_size_m);
    partitions->push_back (partition);
 
@@ -129,20 +192,8 @@ void Bank_t::copyPartition(ID_t &id) {
    partition->var_name = ss.str();
    ss.str (NULL_STRING);
 
-   BankPartition_t * prevVersion = getPartition(id, version_m - 1);    
-   touchFile (prevVersion->fix_name, FILE_MODE, false);
-   touchFile (prevVersion->fix_name, FILE_MODE, false);
-
-   ios::openmode mode = ios::binary | ios::trunc | ios::in; 
    touchFile (partition->fix_name, FILE_MODE, true);
-   ofstream output (partition->fix_name.c_str(), (mode | ios::out));
-   copyFile(prevVersion->fix, output);
-   output.close();
-
    touchFile (partition->var_name, FILE_MODE, true);
-   output.open(partition->var_name.c_str(), (mode | ios::out));
-   copyFile(prevVersion->var, output);
-   output.close(); 
 }
 
 //----------------------------------------------------- addPartition -----------
@@ -204,6 +255,22 @@ void Bank_t::append (IBankable_t & obj)
   }
 }
 
+//----------------------------------------------------- append -----------------
+void Bank_t::append (const BankRecord_t & rec)
+{
+  //-- Insert the ID triple into the map (may throw exception)
+  idmap_m.insert (rec.iid_m, rec.eid_m, last_bid_m [version_m] + 1);
+
+  try {
+    appendBID (rec);
+  }
+  catch (Exception_t) {
+    idmap_m.remove (rec.iid_m);
+    idmap_m.remove (rec.eid_m);
+    throw;
+  }
+}
+
 //----------------------------------------------------- appendBID --------------
 void Bank_t::appendBID (IBankable_t & obj)
 {
@@ -211,12 +278,14 @@ void Bank_t::appendBID (IBankable_t & obj)
     AMOS_THROW_IO ("Cannot append, bank not open for writing");
   if ( banktype_m != obj.getNCode() )
     AMOS_THROW_ARGUMENT ("Cannot append, incompatible object type");
+  obj.checkWritable( );
 
   //-- Add another partition if necessary
   if ( last_bid_m [version_m] == max_bid_m )
     addPartition (true);
 
-  BankPartition_t * partition = getLastPartition(localizeVersionBID(last_bid_m [version_m] + 1));
+  ID_t lid = last_bid_m [version_m] + 1;
+  BankPartition_t * partition = localizeWritableBID (lid, false);
 
   //-- Prepare the object for append
   obj.flags_m.is_removed  = false;
@@ -225,7 +294,7 @@ void Bank_t::appendBID (IBankable_t & obj)
   //-- data is written in the following order to the FIX and VAR streams
   //   FIX = [VAR streampos] [BankableFlags] [OBJECT FIX] [VAR size]
   //   VAR = [OBJECT VAR]
-  partition->fix.seekp (0, ios::end);
+  partition->fix.seekp (lid * fix_size_m);
   partition->var.seekp (0, ios::end);
   bankstreamoff fpos = partition->fix.tellp();
   bankstreamoff vpos = partition->var.tellp();
@@ -234,6 +303,61 @@ void Bank_t::appendBID (IBankable_t & obj)
   obj.writeRecord (partition->fix, partition->var);
   Size_t vsize = (std::streamoff)partition->var.tellp() - vpos;
   writeLE (partition->fix, &vsize);
+  partition->account (vsize, 0);
+
+  //-- If fix_size is not yet known, calculate it
+  Size_t fsize = (std::streamoff)partition->fix.tellp() - fpos;
+  if ( fix_size_m == 0 )
+    fix_size_m = fsize;
+
+  if ( fix_size_m != fsize  ||
+       partition->fix.fail()  ||
+       partition->var.fail() )
+    AMOS_THROW_IO ("Unknown file write error in append, bank corrupted");
+
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->appends;
+      stats_m->seeks += 2;
+      stats_m->fix_written += fsize;
+      stats_m->var_written += vsize;
+    }
+
+  ++ nbids_m [version_m];
+  ++ last_bid_m [version_m];
+}
+
+//----------------------------------------------------- appendBID --------------
+void Bank_t::appendBID (const BankRecord_t & rec)
+{
+  if ( ! is_open_m  ||  ! (mode_m & B_WRITE) )
+    AMOS_THROW_IO ("Cannot append, bank not open for writing");
+  if ( banktype_m != rec.ncode_m )
+    AMOS_THROW_ARGUMENT ("Cannot append, incompatible object type");
+
+  //-- Add another partition if necessary
+  if ( last_bid_m [version_m] == max_bid_m )
+    addPartition (true);
+
+  ID_t lid = last_bid_m [version_m] + 1;
+  BankPartition_t * partition = localizeWritableBID (lid, false);
+
+  //-- Same layout as appendBID (IBankable_t &), with fresh flags
+  BankFlags_t flags = rec.flags_m;
+  flags.is_removed  = false;
+  flags.is_modified = false;
+
+  partition->fix.seekp (lid * fix_size_m);
+  partition->var.seekp (0, ios::end);
+  bankstreamoff fpos = partition->fix.tellp();
+  bankstreamoff vpos = partition->var.tellp();
+  writeLE (partition->fix, &vpos);
+  writeLE (partition->fix, &flags);
+  partition->fix.write (rec.fix_m.data(), rec.fix_m.size());
+  partition->var.write (rec.var_m.data(), rec.var_m.size());
+  Size_t vsize = rec.var_m.size();
+  writeLE (partition->fix, &vsize);
+  partition->account (vsize, 0);
 
   //-- If fix_size is not yet known, calculate it
   Size_t fsize = (std::streamoff)partition->fix.tellp() - fpos;
@@ -245,6 +369,14 @@ void Bank_t::appendBID (IBankable_t & obj)
        partition->var.fail() )
     AMOS_THROW_IO ("Unknown file write error in append, bank corrupted");
 
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->appends;
+      stats_m->seeks += 2;
+      stats_m->fix_written += fsize;
+      stats_m->var_written += vsize;
+    }
+
   ++ nbids_m [version_m];
   ++ last_bid_m [version_m];
 }
@@ -300,8 +432,11 @@ void Bank_t::clean()
     tmpbnk.create (tname);
     tmpbnk.concat (*this);
 
-    //-- Reset this bank
+    //-- Reset this bank, dropping any earlier versions
+    for ( Size_t i = 1; i < nversions_m; ++ i )
+      unlink (getMapPath (i).c_str());
     clear();
+    version_m        = 0;
     fix_size_m       = tmpbnk.fix_size_m;
     partition_size_m = tmpbnk.partition_size_m;
     delete[] last_bid_m;
@@ -328,6 +463,9 @@ void Bank_t::clean()
 	        link ((*tmpbnk.partitions_m [i]) [version]->var_name.c_str(),
 		            (* partitions_m [i]) [version]->var_name.c_str()) )
 	     AMOS_THROW_IO ("Unknown file link error in clean, bank corrupted");
+	   (*partitions_m [i]) [version]->live_bytes =
+	     (*tmpbnk.partitions_m [i]) [version]->live_bytes;
+	   (*partitions_m [i]) [version]->dead_bytes = 0;
         }
      }
   }
@@ -351,6 +489,13 @@ void Bank_t::clear () {
   {
       delete (partitions_m[i]);
   }
+  for ( Size_t i = 0; i != (Size_t)overlays_m.size(); ++ i )
+  {
+      if ( overlays_m[i] != NULL )
+        unlink (getOverlayPath(i).c_str());
+      delete (overlays_m[i]);
+  }
+  overlays_m.assign (1, NULL);
 
   delete[] last_bid_m;
   delete[] nbids_m;
@@ -375,6 +520,10 @@ void Bank_t::clearVersion (Size_t &version, bool recreate)
   if ( ! (mode_m & B_WRITE) )
     AMOS_THROW_IO ("Cannot clear, bank not open for writing");
 
+  //-- An emptied overlay no longer owns any records
+  if ( recreate  &&  overlays_m [version] != NULL )
+    overlays_m [version]->clear();
+
   //-- Close, unlink and free the partition files
   for ( Size_t i = 0; i != npartitions_m; ++ i )
      {
@@ -428,8 +577,14 @@ void Bank_t::close()
       if ( map_stream.fail() )
 	AMOS_THROW_IO ("Unknown file write error in close, bank corrupted");
       map_stream.close();
+
+      //-- Flush OVL partition
+      writeOverlay();
     }
   
+  //-- Sync the IFO partition, while the byte counts are still around
+  syncIFO (I_CLOSE);
+
   //-- Close/free the partitions
   for ( Size_t i = 0; i != npartitions_m; i ++ ) {
     for (Size_t version = 0; version != nversions_m; version++) { 
@@ -438,14 +593,123 @@ void Bank_t::close()
     delete partitions_m[i];
   }
 
-  //-- Sync the IFO partition
-  syncIFO (I_CLOSE);
+  reportStats();
 
   //-- Reset
   init();
 }
 
 
+//----------------------------------------------------- compact ----------------
+Size_t Bank_t::compact (float threshold)
+{
+  if ( ! is_open_m  ||  ! (mode_m & B_READ  &&  mode_m & B_WRITE) )
+    AMOS_THROW_IO ("Cannot compact, bank not open for reading and writing");
+
+  Size_t ncompacted = 0;
+
+  //-- One partition at a time, only where enough of the var store is dead
+  for ( ID_t i = 0; i != npartitions_m; ++ i )
+    {
+      BankPartition_t * partition = (*partitions_m [i]) [version_m];
+      if ( partition->live_bytes < 0 )
+        measurePartition (i);
+
+      int64_t total = partition->live_bytes + partition->dead_bytes;
+      if ( partition->dead_bytes > 0  &&
+           partition->dead_bytes >= threshold * total )
+        {
+          compactPartition (i);
+          ++ ncompacted;
+        }
+    }
+
+  return ncompacted;
+}
+
+
+//----------------------------------------------------- compactPartition -------
+void Bank_t::compactPartition (ID_t id)
+{
+  BankPartition_t * partition = getPartition (id, version_m);
+  const vector<uint8_t> * owned = overlays_m [version_m];
+
+  ID_t first = id * partition_size_m;
+  ID_t nslots = std::min ((ID_t) partition_size_m, last_bid_m [version_m] - first);
+  Size_t size = fix_size_m - sizeof (bankstreamoff) - sizeof (BankFlags_t)
+    - sizeof (Size_t);
+  Size_t vsize;
+  BankFlags_t flags;
+  bankstreamoff vpos;
+  int64_t live = 0;
+  string fix, var;
+
+  string fix_tmp (partition->fix_name + TMP_STORE_SUFFIX);
+  string var_tmp (partition->var_name + TMP_STORE_SUFFIX);
+  ofstream tfix (fix_tmp.c_str(), ios::binary | ios::trunc);
+  ofstream tvar (var_tmp.c_str(), ios::binary | ios::trunc);
+  if ( ! tfix.is_open()  ||  ! tvar.is_open() )
+    AMOS_THROW_IO ("Could not open temporary partition in compact");
+
+  //-- Copy the records this version holds, inherited slots stay holes
+  fix.resize (size);
+  for ( ID_t lid = 0; lid < nslots; ++ lid )
+    {
+      if ( owned != NULL  &&  ! isOwnedBID (*owned, first + lid + 1) )
+        continue;
+
+      partition->fix.seekg (lid * fix_size_m);
+      readLE (partition->fix, &vpos);
+      readLE (partition->fix, &flags);
+      partition->fix.read (&fix[0], size);
+      readLE (partition->fix, &vsize);
+
+      //-- Removed records keep their slot but not their var data
+      if ( flags.is_removed )
+        vsize = 0;
+      var.resize (vsize);
+      if ( vsize > 0 )
+        {
+          partition->var.seekg (vpos);
+          partition->var.read (&var[0], vsize);
+        }
+
+      if ( partition->fix.fail()  ||  partition->var.fail() )
+        AMOS_THROW_IO ("Unknown file read error in compact, bank corrupted");
+
+      vpos = (std::streamoff)tvar.tellp();
+      tfix.seekp (lid * fix_size_m);
+      writeLE (tfix, &vpos);
+      writeLE (tfix, &flags);
+      tfix.write (fix.data(), size);
+      writeLE (tfix, &vsize);
+      tvar.write (var.data(), vsize);
+      live += vsize;
+    }
+
+  tfix.close();
+  tvar.close();
+  if ( tfix.fail()  ||  tvar.fail() )
+    {
+      unlink (fix_tmp.c_str());
+      unlink (var_tmp.c_str());
+      AMOS_THROW_IO ("Unknown file write error in compact, bank unchanged");
+    }
+
+  //-- Swap the compacted files in, they are reopened on the next access
+  partition->fix.close();
+  partition->var.close();
+  opened_m.erase (std::remove (opened_m.begin(), opened_m.end(), partition),
+                  opened_m.end());
+  if ( rename (fix_tmp.c_str(), partition->fix_name.c_str())  ||
+       rename (var_tmp.c_str(), partition->var_name.c_str()) )
+    AMOS_THROW_IO ("Unknown file rename error in compact, bank corrupted");
+
+  partition->live_bytes = live;
+  partition->dead_bytes = 0;
+}
+
+
 //----------------------------------------------------- concat -----------------
 void Bank_t::concat (Bank_t & s)
 {
@@ -463,8 +727,10 @@ void Bank_t::concat (Bank_t & s)
   Size_t buffer_size = s.fix_size_m;
   char * buffer = (char *) SafeMalloc (buffer_size);
 
+  ID_t lid;
   bankstreamoff vpos;
   BankPartition_t * sp;
+  BankPartition_t * osp = NULL;
   BankPartition_t * tp = getLastPartition(version_m);
 
   //-- Set up the BID lookup table
@@ -475,88 +741,88 @@ void Bank_t::concat (Bank_t & s)
     striples [idmi->bid] = idmi;
 
   //-- Seek to the end of current bank
-  tp->fix.seekp (0, ios::end);
+  lid = last_bid_m [version_m] - (npartitions_m - 1) * partition_size_m;
+  tp->fix.seekp (lid * fix_size_m);
   tp->var.seekp (0, ios::end);
 
-  //-- For each source partition
-  ID_t sbid = 0;
-  for ( Size_t i = 0; i != s.npartitions_m; ++ i )
+  //-- For each source record, wherever its version stores it
+  for ( ID_t sbid = 1; sbid <= s.last_bid_m [s.version_m]; ++ sbid )
     {
-      //-- Seek to the beginning of source partition
-      sp = s.getPartition (i, s.version_m);
+      //-- Seek to the record unless reading on from the last one
+      lid = sbid;
+      sp = s.localizeBID (lid);
+      if ( sp != osp )
+	{
+	  sp->fix.seekg (lid * s.fix_size_m);
+	  osp = sp;
+	}
 
-      sp->fix.seekg (0);
+      //-- Read vpos and Bankable flags
+      readLE (sp->fix, &vpos);
+      readLE (sp->fix, &flags);
 
-      while ( true )
+      //-- Ignore record if deleted flag is set
+      if ( flags.is_removed )
 	{
-	  //-- Read vpos and Bankable flags, break on EOF
-	  readLE (sp->fix, &vpos);
-	  readLE (sp->fix, &flags);
-	  if ( sp->fix.eof() )
-	    break;
-	  ++ sbid;
+	  sp->fix.ignore (tail);
+	  continue;
+	}
+      //-- Skip to the data
+      sp->var.seekg (vpos);
 
-	  //-- Ignore record if deleted flag is set
-	  if ( flags.is_removed )
-	    {
-	      sp->fix.ignore (tail);
-	      continue;
-	    }
-	  //-- Skip to the data
-	  sp->var.seekg (vpos);
-
-	  //-- Get the source triple and add it to the new bank
-	  if ( (stp = striples [sbid]) != NULL )
-	    idmap_m.insert (stp->iid, stp->eid, last_bid_m [version_m] + 1);
-
-	  //-- Add new partition if necessary
-	  if ( last_bid_m [version_m] == max_bid_m )
-	    {
-	      try {
-		addPartition (true);
-		tp = getLastPartition(version_m);
-	      }
-	      catch (Exception_t) {
-		if ( stp != NULL )
-		  {
-		    idmap_m.remove (stp->iid);
-		    idmap_m.remove (stp->eid);
-		  }
-		throw;
-	      }
-	    }
+      //-- Get the source triple and add it to the new bank
+      if ( (stp = striples [sbid]) != NULL )
+	idmap_m.insert (stp->iid, stp->eid, last_bid_m [version_m] + 1);
 
-	  //-- Write new vpos and copy Bankable flags
-	  vpos = (std::streamoff)tp->var.tellp();
-	  writeLE (tp->fix, &vpos);
-	  writeLE (tp->fix, &flags);
-
-	  //-- Copy object FIX data
-	  sp->fix.read (buffer, tail - sizeof (Size_t));
-	  readLE (sp->fix, &size);
-	  tp->fix.write (buffer, tail - sizeof (Size_t));
-	  writeLE (tp->fix, &size);
-
-	  //-- Make sure buffer is big enough for VAR data, realloc if needed
-	  while ( size > buffer_size )
-	    {
-	      buffer_size <<= 1;
-	      buffer = (char *) SafeRealloc (buffer, buffer_size);
-	    }
+      //-- Add new partition if necessary
+      if ( last_bid_m [version_m] == max_bid_m )
+	{
+	  try {
+	    addPartition (true);
+	    tp = getLastPartition(version_m);
+	  }
+	  catch (Exception_t) {
+	    if ( stp != NULL )
+	      {
+		idmap_m.remove (stp->iid);
+		idmap_m.remove (stp->eid);
+	      }
+	    throw;
+	  }
+	}
 
-	  //-- Copy object VAR data
-	  sp->var.read (buffer, size);
-	  tp->var.write (buffer, size);
+      //-- Write new vpos and copy Bankable flags
+      ownBID (last_bid_m [version_m] + 1);
+      vpos = (std::streamoff)tp->var.tellp();
+      writeLE (tp->fix, &vpos);
+      writeLE (tp->fix, &flags);
 
-	  //-- Check the streams
-	  if ( sp->fix.fail()  ||  sp->var.fail() )
-	    AMOS_THROW_IO("Unknown file read error in concat, bank corrupted");
-	  if ( tp->fix.fail()  ||  tp->var.fail() )
-	    AMOS_THROW_IO("Unknown file write error in concat, bank corrupted");
+      //-- Copy object FIX data
+      sp->fix.read (buffer, tail - sizeof (Size_t));
+      readLE (sp->fix, &size);
+      tp->fix.write (buffer, tail - sizeof (Size_t));
+      writeLE (tp->fix, &size);
 
-	  ++ nbids_m [version_m];
-	  ++ last_bid_m [version_m];
+      //-- Make sure buffer is big enough for VAR data, realloc if needed
+      while ( size > buffer_size )
+	{
+	  buffer_size <<= 1;
+	  buffer = (char *) SafeRealloc (buffer, buffer_size);
 	}
+
+      //-- Copy object VAR data
+      sp->var.read (buffer, size);
+      tp->var.write (buffer, size);
+      tp->account (size, 0);
+
+      //-- Check the streams
+      if ( sp->fix.fail()  ||  sp->var.fail() )
+	AMOS_THROW_IO("Unknown file read error in concat, bank corrupted");
+      if ( tp->fix.fail()  ||  tp->var.fail() )
+	AMOS_THROW_IO("Unknown file write error in concat, bank corrupted");
+
+      ++ nbids_m [version_m];
+      ++ last_bid_m [version_m];
     }
 
   //-- Update fix_size if needed and flush new bank info
@@ -567,6 +833,56 @@ void Bank_t::concat (Bank_t & s)
 }
 
 
+//----------------------------------------------------- copyRecord -----------
+void Bank_t::copyRecord (ID_t bid)
+{
+  ID_t lid = bid;
+  ID_t pid = (bid - 1) / partition_size_m;
+  Size_t size = fix_size_m - sizeof (bankstreamoff) - sizeof (BankFlags_t)
+    - sizeof (Size_t);
+  Size_t vsize;
+  BankFlags_t flags;
+  bankstreamoff vpos;
+  string fix, var;
+
+  //-- Read the record from the version holding it
+  BankPartition_t * partition = localizeBID (lid);
+  partition->fix.seekg (lid * fix_size_m);
+  readLE (partition->fix, &vpos);
+  readLE (partition->fix, &flags);
+  fix.resize (size);
+  partition->fix.read (&fix[0], size);
+  readLE (partition->fix, &vsize);
+  var.resize (vsize);
+  partition->var.seekg (vpos);
+  if ( vsize > 0 )
+    partition->var.read (&var[0], vsize);
+
+  if ( partition->fix.fail()  ||  partition->var.fail() )
+    AMOS_THROW_IO ("Unknown file read error in copy, bank corrupted");
+
+  //-- Write it to the same place in the open version
+  partition = getPartition (pid, version_m);
+  partition->fix.seekp (lid * fix_size_m);
+  partition->var.seekp (0, ios::end);
+  vpos = partition->var.tellp();
+  writeLE (partition->fix, &vpos);
+  writeLE (partition->fix, &flags);
+  partition->fix.write (fix.data(), size);
+  partition->var.write (var.data(), vsize);
+  writeLE (partition->fix, &vsize);
+  if ( flags.is_removed )
+    partition->account (0, vsize);
+  else
+    partition->account (vsize, 0);
+
+  if ( partition->fix.fail()  ||  partition->var.fail() )
+    AMOS_THROW_IO ("Unknown file write error in copy, bank corrupted");
+
+  ownBID (bid);
+}
+
+
 //----------------------------------------------------- create -----------------
 void Bank_t::create (const string & dir, BankMode_t mode)
 {
@@ -634,6 +950,7 @@ void Bank_t::destroy()
   //-- Remove the dir if empty
   rmdir (store_dir_m.c_str());
 
+  reportStats();
   init();
 }
 
@@ -670,20 +987,32 @@ void Bank_t::fetchBID (ID_t bid, IBankable_t & obj)
   if (banktype_m != obj.getNCode())
     AMOS_THROW_ARGUMENT ("Cannot fetch, incompatible object type");
 
+  double start = stats_m != NULL ? BankStats_t::now() : 0;
+
   //-- Seek to the record and read the data
   BankPartition_t * partition = localizeBID (bid);
 
   bankstreamoff vpos;
+  Size_t vsize;
   bankstreamoff off = bid * fix_size_m;
   partition->fix.seekg (off);
   readLE (partition->fix, &vpos);
   readLE (partition->fix, &(obj.flags_m));
   partition->var.seekg (vpos);
   obj.readRecord (partition->fix, partition->var);
-  partition->fix.ignore (sizeof (Size_t));
+  readLE (partition->fix, &vsize);
 
   if ( partition->fix.fail()  ||  partition->var.fail() )
     AMOS_THROW_IO ("Unknown file read error in fetch, bank corrupted");
+
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->fetches;
+      stats_m->seeks += 2;
+      stats_m->fix_read += fix_size_m;
+      stats_m->var_read += vsize;
+      BankStats_t::addLatency (stats_m->fetch_latency, start);
+    }
 }
 
 
@@ -694,6 +1023,8 @@ void Bank_t::fetchBIDFix(ID_t bid, IBankable_t & obj)
   if (banktype_m != obj.getNCode())
     AMOS_THROW_ARGUMENT ("Cannot fetch, incompatible object type");
 
+  double start = stats_m != NULL ? BankStats_t::now() : 0;
+
   //-- Seek to the record and read the data
   BankPartition_t * partition = localizeBID (bid);
 
@@ -707,6 +1038,37 @@ void Bank_t::fetchBIDFix(ID_t bid, IBankable_t & obj)
 
   if ( partition->fix.fail())
     AMOS_THROW_IO ("Unknown file read error in fetch, bank corrupted");
+
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->fetches;
+      ++ stats_m->seeks;
+      stats_m->fix_read += fix_size_m;
+      BankStats_t::addLatency (stats_m->fetch_latency, start);
+    }
+}
+
+
+//----------------------------------------------------- flatten ----------------
+void Bank_t::flatten ( )
+{
+  if ( ! is_open_m  ||  ! (mode_m & B_READ  &&  mode_m & B_WRITE) )
+    AMOS_THROW_IO ("Cannot flatten, bank not open for reading and writing");
+  if ( version_m != nversions_m - 1 )
+    AMOS_THROW_IO ("Can only flatten latest version");
+
+  if ( overlays_m [version_m] == NULL )
+    return;
+
+  //-- Pull every inherited record up into the open version
+  for ( ID_t bid = 1; bid <= last_bid_m [version_m]; ++ bid )
+    if ( localizeVersionBID (bid) != version_m )
+      copyRecord (bid);
+
+  //-- The open version is now self-contained
+  delete overlays_m [version_m];
+  overlays_m [version_m] = NULL;
+  unlink (getOverlayPath (version_m).c_str());
 }
 
 
@@ -738,6 +1100,9 @@ ID_t Bank_t::getMaxBID() const
 //----------------------------------------------------- lookupBID --------------
 ID_t Bank_t::lookupBID (const string & eid) const
 {
+  if ( stats_m != NULL )
+    ++ stats_m->lookups;
+
   ID_t bid = idmap_m.lookupBID (eid);
   if ( bid == NULL_ID || bid > last_bid_m [version_m] )
       AMOS_THROW_ARGUMENT ((string) "ERROR: lookupBID EID not found: " + eid);
@@ -748,6 +1113,9 @@ ID_t Bank_t::lookupBID (const string & eid) const
 //----------------------------------------------------- lookupBID --------------
 ID_t Bank_t::lookupBID (ID_t iid) const
 {
+  if ( stats_m != NULL )
+    ++ stats_m->lookups;
+
   ID_t bid = idmap_m.lookupBID (iid);
   if ( bid == NULL_ID || bid > last_bid_m [version_m] )
     {
@@ -768,6 +1136,9 @@ void Bank_t::init()
   if (nbids_m != NULL) {
      delete[] nbids_m;
   }
+  for (Size_t i = 0; i != (Size_t)overlays_m.size(); i++) {
+     delete overlays_m[i];
+  }
 
   fix_size_m       = 0;
   is_open_m        = false;
@@ -782,6 +1153,7 @@ void Bank_t::init()
   partition_size_m = 0;
   opened_m    .clear();
   partitions_m.clear();
+  overlays_m  .assign (1, NULL);
   store_dir_m .erase();
   store_pfx_m .erase();
   idmap_m     .clear();
@@ -835,6 +1207,9 @@ void Bank_t::open (const string & dir, BankMode_t mode, Size_t version, bool inP
        AMOS_THROW_IO("Invalid version for bank, specified version does not exist");
     }
     version_m = version;
+
+    //-- Read the OVL partitions
+    readOverlays();
  
     //-- Read the MAP partition
     string map_path = getMapPath();
@@ -895,13 +1270,58 @@ Bank_t::BankPartition_t * Bank_t::openPartition (ID_t id, Size_t version)
       opened_m.front()->fix.close();
       opened_m.front()->var.close();
       opened_m.pop_front();
+      if ( stats_m != NULL )
+        ++ stats_m->partition_evictions;
     }
   opened_m.push_back (partition);
 
+  if ( stats_m != NULL )
+    ++ stats_m->partition_opens;
+
   return partition;
 }
 
 
+//----------------------------------------------------- readOverlays ---------
+void Bank_t::readOverlays ( )
+{
+  for ( Size_t i = 0; i != (Size_t)overlays_m.size(); ++ i )
+    delete overlays_m [i];
+  overlays_m.assign (nversions_m, NULL);
+
+  //-- Version 0 and versions without an OVL partition are self-contained
+  for ( Size_t i = 1; i < nversions_m; ++ i )
+    {
+      string ovl_path = getOverlayPath (i);
+      ifstream ovl_stream (ovl_path.c_str(), ios::binary);
+      if ( ! ovl_stream.is_open() )
+        continue;
+
+      ovl_stream.seekg (0, ios::end);
+      streamoff size = ovl_stream.tellg();
+      ovl_stream.seekg (0);
+
+      overlays_m [i] = new vector<uint8_t> (size, 0);
+      if ( size > 0 )
+        ovl_stream.read ((char *) &(*overlays_m [i])[0], size);
+
+      if ( ovl_stream.fail() )
+        AMOS_THROW_IO ("Unknown file read error in open, bank corrupted");
+    }
+}
+
+
+//----------------------------------------------------- reportStats ------------
+void Bank_t::reportStats()
+{
+  if ( stats_m == NULL  ||  stats_m->empty() )
+    return;
+
+  stats_m->report (store_dir_m, banktype_m);
+  stats_m->clear();
+}
+
+
 //----------------------------------------------------- removeBID --------------
 void Bank_t::removeBID (ID_t bid)
 {
@@ -909,12 +1329,18 @@ void Bank_t::removeBID (ID_t bid)
     AMOS_THROW_IO ("Cannot remove, bank not open for reading and writing");
 
   //-- Seek to FIX record and rewrite
-  BankPartition_t * partition = localizeBID (bid);
+  BankPartition_t * partition = localizeWritableBID (bid);
 
   BankFlags_t flags;
+  Size_t vsize;
   bankstreamoff off = bid * fix_size_m + sizeof (bankstreamoff);
+  partition->fix.seekg (off + fix_size_m - sizeof (bankstreamoff)
+                        - sizeof (Size_t));
+  readLE (partition->fix, &vsize);
   partition->fix.seekg (off);
   readLE (partition->fix, &flags);
+  if ( ! flags.is_removed )
+    partition->account (- (int64_t) vsize, vsize);
   flags.is_removed = true;
   partition->fix.seekp (off);
   writeLE (partition->fix, &flags);
@@ -922,6 +1348,14 @@ void Bank_t::removeBID (ID_t bid)
   if ( partition->fix.fail()  ||  partition->var.fail() )
     AMOS_THROW_IO ("Unknown file error in remove, bank corrupted");
 
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->removes;
+      stats_m->seeks += 3;
+      stats_m->fix_read += sizeof (Size_t) + sizeof (BankFlags_t);
+      stats_m->fix_written += sizeof (BankFlags_t);
+    }
+
   -- nbids_m [version_m];
 }
 
@@ -985,15 +1419,30 @@ void Bank_t::replaceBID (ID_t bid, IBankable_t & obj)
     AMOS_THROW_IO ("Cannot replace, bank not open for reading and writing");
   if ( banktype_m != obj.getNCode() )
     AMOS_THROW_ARGUMENT ("Cannot replace, incompatible object type");
+  obj.checkWritable( );
 
   //-- Set the modified flag
   obj.flags_m.is_removed = false;
   obj.flags_m.is_modified = true;
 
-  //-- Seek to and write new record
-  BankPartition_t * partition = localizeBID (bid);
+  //-- A record already held by the open version leaves dead bytes behind
+  bool held = localizeVersionBID (bid) == version_m;
+
+  //-- Seek to and write new record, always in the open version
+  BankPartition_t * partition = localizeWritableBID (bid, false);
 
   bankstreamoff off = bid * fix_size_m;
+  if ( held )
+    {
+      BankFlags_t flags;
+      Size_t osize;
+      partition->fix.seekg (off + sizeof (bankstreamoff));
+      readLE (partition->fix, &flags);
+      partition->fix.seekg (off + fix_size_m - sizeof (Size_t));
+      readLE (partition->fix, &osize);
+      if ( ! flags.is_removed )
+        partition->account (- (int64_t) osize, osize);
+    }
   partition->fix.seekp (off);
   partition->var.seekp (0, ios::end);
   bankstreamoff vpos = partition->var.tellp();
@@ -1002,9 +1451,20 @@ void Bank_t::replaceBID (ID_t bid, IBankable_t & obj)
   obj.writeRecord (partition->fix, partition->var);
   Size_t vsize = (std::streamoff)partition->var.tellp() - vpos;
   writeLE (partition->fix, &vsize);
+  partition->account (vsize, 0);
 
   if ( partition->fix.fail()  ||  partition->var.fail() )
     AMOS_THROW_IO ("Unknown file error in replace, bank corrupted");
+
+  if ( stats_m != NULL )
+    {
+      ++ stats_m->replaces;
+      stats_m->seeks += held ? 4 : 2;
+      if ( held )
+        stats_m->fix_read += sizeof (BankFlags_t) + sizeof (Size_t);
+      stats_m->fix_written += fix_size_m;
+      stats_m->var_written += vsize;
+    }
 }
 
 
@@ -1028,6 +1488,8 @@ void Bank_t::syncIFO (IFOMode_t mode)
   ID_t* nbids_byVersion = NULL;
   ID_t* last_bid_byVersion = NULL;
   Size_t fix_size, npartitions, partition_size, nversions;
+  string live_bytes, dead_bytes;
+  string version (BANK_VERSION);
   vector<string> locks;
   vector<string>::iterator vi;
 
@@ -1045,11 +1507,11 @@ void Bank_t::syncIFO (IFOMode_t mode)
 	  AMOS_THROW_IO ("Could not open bank partition, " + ifo_path);
 
 	getline (ifo_stream, line, '=');
-	ifo_stream >> line;                // bank version
-	if ( line != BANK_VERSION )
+	ifo_stream >> version;             // bank version
+	if ( version != BANK_VERSION  &&  version != BANK_VERSION_3_0 )
 	  AMOS_THROW_IO
-	    ("Could not read bank, expected version: "
-             + BANK_VERSION + ", saw version: " + line);
+	    ("Could not read bank, expected version: " + BANK_VERSION
+             + " or " + BANK_VERSION_3_0 + ", saw version: " + version);
 	getline (ifo_stream, line, '=');
 	ifo_stream >> banktype;            // bank type
 	if ( banktype != banktype_m )
@@ -1074,7 +1536,14 @@ void Bank_t::syncIFO (IFOMode_t mode)
 	ifo_stream >> npartitions;         // number of partitions
 	getline (ifo_stream, line, '=');
 	ifo_stream >> partition_size;      // partition size (in indices)
-	getline (ifo_stream, line, '=');   // "locks ="
+	getline (ifo_stream, line, '=');   // "live bytes =" or "locks ="
+        if ( line.find ("live bytes") != string::npos )
+          {
+            getline (ifo_stream, live_bytes);  // var bytes in use
+            getline (ifo_stream, line, '=');
+            getline (ifo_stream, dead_bytes);  // var bytes no longer in use
+            getline (ifo_stream, line, '=');   // "locks ="
+          }
         getline (ifo_stream, line);
 
 	if ( ifo_stream.fail() )
@@ -1093,6 +1562,14 @@ void Bank_t::syncIFO (IFOMode_t mode)
           }
         ifo_stream.close();
 
+	//-- Overlays are only written by 3.1 code, which labels the bank 3.1
+	if ( mode == I_OPEN  &&  version == BANK_VERSION_3_0 )
+	  for ( Size_t i = 1; i < nversions; ++ i )
+	    if ( ! access (getOverlayPath (i).c_str(), F_OK) )
+	      AMOS_THROW_IO
+		("Overlay version in a " + BANK_VERSION_3_0
+		 + " bank, bank corrupted");
+
 	//-- If seeing this for the first time
 	if ( mode == I_OPEN )
 	  {
@@ -1123,6 +1600,17 @@ void Bank_t::syncIFO (IFOMode_t mode)
               npartitions_m = 0;
 	      throw;
 	    }
+
+            //-- Banks from before the byte counts were kept must recount
+            istringstream live_ss (live_bytes), dead_ss (dead_bytes);
+            for (Size_t j = 0; j != nversions; j++)
+              for ( Size_t i = 0; i != npartitions_m; ++ i )
+                {
+                  BankPartition_t * partition = (*partitions_m [i]) [j];
+                  if ( ! (live_ss >> partition->live_bytes)  ||
+                       ! (dead_ss >> partition->dead_bytes) )
+                    partition->live_bytes = partition->dead_bytes = -1;
+                }
 	  }
       }
 
@@ -1190,6 +1678,22 @@ void Bank_t::syncIFO (IFOMode_t mode)
 	npartitions = npartitions_m;
 	partition_size = partition_size_m;
         nversions = nversions_m;
+
+        ostringstream live_ss, dead_ss;
+        live_ss << ' ';
+        dead_ss << ' ';
+        for (Size_t j = 0; j != nversions_m; j++)
+          for ( Size_t i = 0; i != npartitions_m; ++ i )
+            {
+              live_ss << (*partitions_m [i]) [j]->live_bytes << "\t";
+              dead_ss << (*partitions_m [i]) [j]->dead_bytes << "\t";
+            }
+        live_bytes = live_ss.str();
+        dead_bytes = dead_ss.str();
+
+        //-- A reader leaves a 3.0 bank readable by 3.0 code, a writer
+        //   upgrades it along with the byte counts
+        version = BANK_VERSION;
       }
 
 
@@ -1201,7 +1705,7 @@ void Bank_t::syncIFO (IFOMode_t mode)
 
     ifo_stream
       << "____" << Decode (banktype_m) << " BANK INFORMATION____" << endl
-      << "bank version = "      << BANK_VERSION         << endl
+      << "bank version = "      << version              << endl
       << "bank type = "         << banktype_m           << endl
       << "versions = "          << nversions            << endl
       << "objects = ";
@@ -1216,7 +1720,12 @@ void Bank_t::syncIFO (IFOMode_t mode)
       ifo_stream                                        << endl
       << "bytes/index = "       << fix_size             << endl
       << "partitions = "        << npartitions          << endl
-      << "indices/partition = " << partition_size       << endl
+      << "indices/partition = " << partition_size       << endl;
+    if ( ! live_bytes.empty() )
+      ifo_stream
+        << "live bytes ="       << live_bytes           << endl
+        << "dead bytes ="       << dead_bytes           << endl;
+    ifo_stream
       << "locks = " << endl;
 
     //-- Write updated locks
@@ -1284,6 +1793,27 @@ void Bank_t::unlockIFO()
 }
 
 
+//----------------------------------------------------- writeOverlay -----------
+void Bank_t::writeOverlay()
+{
+  vector<uint8_t> * owned = overlays_m [version_m];
+  if ( owned == NULL )
+    return;
+
+  string ovl_path = getOverlayPath (version_m);
+  ofstream ovl_stream (ovl_path.c_str(), ios::binary | ios::trunc);
+  if ( ! ovl_stream.is_open() )
+    AMOS_THROW_IO ("Could not open bank partition, " + ovl_path);
+
+  if ( ! owned->empty() )
+    ovl_stream.write ((const char *) &(*owned)[0], owned->size());
+
+  if ( ovl_stream.fail() )
+    AMOS_THROW_IO ("Unknown file write error in close, bank corrupted");
+  ovl_stream.close();
+}
+
+
 //--------------------------------------------------- BankExists ---------------
 bool AMOS::BankExists (NCode_t ncode, const string & dir)
 {
@@ -1306,6 +1836,7 @@ void AMOS::PrintBankVersion (const char * s)
 //================================================ BankPartition_t =============
 //----------------------------------------------------- BankPartition_t --------
 Bank_t::BankPartition_t::BankPartition_t (Size_t buffer_size)
+  : live_bytes (0), dead_bytes (0)
 {
   fix_buff = (char *) SafeMalloc (buffer_size);
   var_buff = (char *) SafeMalloc (buffer_size);
@@ -21,6 +21,7 @@
 
 #include "utility_AMOS.hh"
 #include "IDMap_AMOS.hh"
+#include "BankStats_AMOS.hh"
 #include <cstdlib>
 #include <string>
 #include <fstream>
@@ -56,6 +57,7 @@ class IBankable_t
 {
   friend class Bank_t;       //!< so the bank class can use the read/writes
   friend class BankStream_t; //!< so the bank class can use the read/writes
+  friend class BankRecord_t; //!< so records can be serialized ahead of time
 
 
 protected:
@@ -123,6 +125,19 @@ protected:
   virtual void writeRecord (std::ostream & fix, std::ostream & var) const = 0;
 
 
+  //--------------------------------------------------- checkWritable ----------
+  //! \brief Refuses to commit an object that cannot be stored as it is
+  //!
+  //! Called by the bank before it writes any part of the record, so a
+  //! refused object leaves the bank as it was. Does nothing by default.
+  //!
+  //! \throws ArgumentException_t
+  //! \return void
+  //!
+  virtual void checkWritable ( ) const
+  { }
+
+
 public:
 
   //--------------------------------------------------- IBankable_t ------------
@@ -306,6 +321,97 @@ public:
 
 
 
+//================================================ BankRecord_t ================
+//! \brief An IBankable_t object serialized ahead of its append to a bank
+//!
+//! Holds the IDs, flags and biserial record of an object so that the costly
+//! serialization can be done away from the bank, e.g. on a worker thread,
+//! leaving only a copy of the bytes for Bank_t::append. A BankRecord_t does
+//! not refer back to the object it was made from.
+//!
+//==============================================================================
+class BankRecord_t
+{
+  friend class Bank_t;
+
+
+private:
+
+  NCode_t ncode_m;           //!< NCode of the serialized object
+  ID_t iid_m;                //!< internal ID of the serialized object
+  std::string eid_m;         //!< external ID of the serialized object
+  BankFlags_t flags_m;       //!< bank flags of the serialized object
+  std::string fix_m;         //!< the fixed length part of the record
+  std::string var_m;         //!< the variable length part of the record
+
+
+public:
+
+  //--------------------------------------------------- BankRecord_t -----------
+  //! \brief Constructs an empty BankRecord_t
+  //!
+  BankRecord_t ( )
+  {
+    clear( );
+  }
+
+
+  //--------------------------------------------------- clear ------------------
+  //! \brief Clears the record
+  //!
+  void clear ( )
+  {
+    ncode_m = NULL_NCODE;
+    iid_m = NULL_ID;
+    eid_m . erase( );
+    flags_m . clear( );
+    fix_m . erase( );
+    var_m . erase( );
+  }
+
+
+  //--------------------------------------------------- getEID -----------------
+  //! \brief Get the external ID of the serialized object
+  //!
+  const std::string & getEID ( ) const
+  {
+    return eid_m;
+  }
+
+
+  //--------------------------------------------------- getIID -----------------
+  //! \brief Get the internal ID of the serialized object
+  //!
+  ID_t getIID ( ) const
+  {
+    return iid_m;
+  }
+
+
+  //--------------------------------------------------- getNCode ---------------
+  //! \brief Get the NCode of the serialized object
+  //!
+  NCode_t getNCode ( ) const
+  {
+    return ncode_m;
+  }
+
+
+  //--------------------------------------------------- serialize --------------
+  //! \brief Serializes an object into this record
+  //!
+  //! Only reads from obj, so distinct records may be filled concurrently.
+  //!
+  //! \param obj The object to serialize
+  //! \return void
+  //!
+  void serialize (const IBankable_t & obj);
+
+};
+
+
+
+
 //================================================ Bank_t ======================
 //! \brief An AMOS data bank for efficiently storing Bankable data types
 //!
@@ -337,6 +443,7 @@ protected:
   static const Size_t DEFAULT_BUFFER_SIZE;     //!< IO buffer size
   static const Size_t DEFAULT_PARTITION_SIZE;  //!< records per partition
   static const Size_t MAX_OPEN_PARTITIONS;     //!< open partitions
+  static const float  DEFAULT_GARBAGE_RATIO;   //!< dead var fraction to compact
 
   enum IFOMode_t
     {
@@ -366,6 +473,8 @@ protected:
     std::string var_name;    //!< The name of the variable len file
     std::fstream fix;  //!< The fstream for this partition's fix len store
     std::fstream var;  //!< The fstream for this partition's var len store
+    int64_t live_bytes;  //!< var bytes of the records in use, -1 if unknown
+    int64_t dead_bytes;  //!< var bytes no longer in use, -1 if unknown
 
     //------------------------------------------------- BankPartition_t --------
     //! \brief Allocates stream buffers for fix and var streams
@@ -373,6 +482,18 @@ protected:
     BankPartition_t (Size_t buffer_size);
 
 
+    //------------------------------------------------- account ----------------
+    //! \brief Adjusts the live and dead byte counts, unless they are unknown
+    //!
+    void account (int64_t live, int64_t dead)
+    {
+      if ( live_bytes < 0 )
+        return;
+      live_bytes += live;
+      dead_bytes += dead;
+    }
+
+
     //------------------------------------------------- BankPartition_t --------
     //! \brief Closes fix and var streams and frees buffer memory
     //!
@@ -387,6 +508,12 @@ protected:
   //! Create datastructured for the next version of this store.
   //! throw an exception if unable to create/open version 
   //!
+  //! The new version is an overlay: its partitions start out empty and only
+  //! receive the records written while it is current, every other record
+  //! is read from the version it was last written in.
+  //! Readers of bank version 3.0 do not know overlays, so a bank with one is
+  //! always labelled with the current BANK_VERSION, which they refuse.
+  //!
   //! \pre There are adequate permissions in the bank directory
   //! \post npartitions_m and max_iid_m reflect new partitioning
   //! \throws IOException_t
@@ -394,10 +521,52 @@ protected:
   //!
   void nextVersion ();
 
-  Size_t localizeVersionBID (ID_t bid) {
-     return version_m;
+
+  //--------------------------------------------------- localizeVersionBID ----
+  //! \brief Gets the version holding the current record for a BID
+  //!
+  //! Walks down from the open version through the overlays that do not
+  //! hold the record, stopping at the first self-contained version.
+  //!
+  //! \param bid The BID to look up (1 based index)
+  //! \return The version whose partitions store the record
+  //!
+  Size_t localizeVersionBID (ID_t bid) const
+  {
+    Size_t version = version_m;
+    while ( version > 0  &&  overlays_m [version] != NULL  &&
+            ! isOwnedBID (*overlays_m [version], bid) )
+      -- version;
+    return version;
+  }
+
+
+  //--------------------------------------------------- isOwnedBID ------------
+  //! \brief Checks an overlay ownership bitmap for a BID
+  //!
+  static bool isOwnedBID (const std::vector<uint8_t> & owned, ID_t bid)
+  {
+    return ( (bid >> 3) < owned . size( )  &&
+             (owned [bid >> 3] & (1 << (bid & 7))) );
+  }
+
+
+  //--------------------------------------------------- ownBID ----------------
+  //! \brief Records that the open version holds the record for a BID
+  //!
+  //! Has no effect on a self-contained version.
+  //!
+  void ownBID (ID_t bid)
+  {
+    std::vector<uint8_t> * owned = overlays_m [version_m];
+    if ( owned == NULL )
+      return;
+    if ( (bid >> 3) >= owned -> size( ) )
+      owned -> resize ((bid >> 3) + 1, 0);
+    (*owned) [bid >> 3] |= (1 << (bid & 7));
   }
 
+
   std::string getMapPath(Size_t version) {
      std::ostringstream ss;
      ss << store_pfx_m << '.' << version << MAP_STORE_SUFFIX;
@@ -408,11 +577,95 @@ protected:
      return getMapPath(version_m);
   }
 
+  std::string getOverlayPath (Size_t version) {
+     std::ostringstream ss;
+     ss << store_pfx_m << '.' << version << OVL_STORE_SUFFIX;
+     return ss.str();
+  }
+
   void clearVersion (Size_t &version, bool recreate );
 
-  void copyPartition(ID_t &id); 
 
-  void copyFile(std::fstream &in, std::ofstream &out); 
+  //--------------------------------------------------- copyRecord ------------
+  //! \brief Copies a record from the version holding it to the open version
+  //!
+  //! \param bid The BID of the record to copy (1 based index)
+  //! \pre The record is not held by the open version
+  //! \post The open version holds the record
+  //! \throws IOException_t
+  //! \return void
+  //!
+  void copyRecord (ID_t bid);
+
+
+  //--------------------------------------------------- localizeWritableBID ---
+  //! \brief Same as localizeBID, but in the open version
+  //!
+  //! A record inherited from an earlier version is first copied into the
+  //! open version, so it can be modified without touching its original.
+  //! Pass inherit as false if the whole record is about to be rewritten.
+  //!
+  //! \param bid Lookup the location of this BID (1 based index))
+  //! \param inherit Copy an inherited record into the open version
+  //! \post bid will be adjusted to reference the returned partition
+  //! \post The open version holds the record
+  //! \return The opened bank partition of the open version
+  //!
+  BankPartition_t * localizeWritableBID (ID_t & bid, bool inherit = true)
+  {
+    if ( localizeVersionBID (bid) != version_m )
+      {
+        if ( inherit )
+          copyRecord (bid);
+        else
+          ownBID (bid);
+      }
+    ID_t pid = (-- bid) / partition_size_m;
+    bid -= pid * partition_size_m;
+    return getPartition (pid, version_m);
+  }
+
+
+  //--------------------------------------------------- compactPartition ------
+  //! \brief Rewrites a partition of the open version without its dead bytes
+  //!
+  //! The fix and var stores are copied to temporary files holding only the
+  //! var data of the records in use, then moved over the originals. BIDs do
+  //! not change, removed records keep their slot but lose their var data.
+  //!
+  //! \param id The ID of the partition to compact
+  //! \throws IOException_t
+  //! \return void
+  //!
+  void compactPartition (ID_t id);
+
+
+  //--------------------------------------------------- measurePartition ------
+  //! \brief Recounts the live and dead bytes of a partition of the open version
+  //!
+  //! Needed for partitions of banks written before the counts were kept.
+  //!
+  void measurePartition (ID_t id);
+
+
+  //--------------------------------------------------- overlayPartition ------
+  //! \brief Creates the empty partition files of a new overlay version
+  //!
+  void overlayPartition (ID_t id);
+
+
+  //--------------------------------------------------- readOverlays ----------
+  //! \brief Loads the ownership bitmaps of all overlay versions
+  //!
+  //! A version without an OVL store is self-contained.
+  //!
+  void readOverlays ( );
+
+
+  //--------------------------------------------------- writeOverlay ----------
+  //! \brief Flushes the ownership bitmap of the open version, if any
+  //!
+  void writeOverlay ( );
 
   //--------------------------------------------------- addPartition -----------
   //! \brief Adds a new partition to the partition list
@@ -437,6 +690,12 @@ protected:
   void appendBID (IBankable_t & obj);
 
 
+  //--------------------------------------------------- appendBID --------------
+  //! \brief Append a pre-serialized object, thus assigning it the last BID
+  //!
+  void appendBID (const BankRecord_t & rec);
+
+
   //--------------------------------------------------- fetchBID ---------------
   //! \brief Fetch an object by BID
   //!
@@ -527,6 +786,12 @@ protected:
   BankPartition_t * openPartition (ID_t id, Size_t version);
 
 
+  //--------------------------------------------------- reportStats ------------
+  //! \brief Writes and zeroes the I/O counters, if any were kept
+  //!
+  void reportStats ( );
+
+
   //--------------------------------------------------- removeBID --------------
   //! \brief Remove an object by BID
   //!
@@ -644,11 +909,16 @@ protected:
   Size_t version_m;          //!<The version we're currently working on
   Size_t nversions_m;        //!<The number of store versions operating
   bool   is_inplace_m;       //!< Whether edits go to the current version or a subsequent one 
+  std::vector<std::vector<uint8_t> *> overlays_m;
+  //!< per version BID ownership bits, NULL if the version is self-contained
+
+  BankStats_t * stats_m;     //!< I/O counters, NULL unless profiling
 public:
 
   typedef int64_t bankstreamoff;  //!< 64-bit stream offset for largefiles
 
   static const std::string BANK_VERSION;      //!< current bank version
+  static const std::string BANK_VERSION_3_0;  //!< older version still read
 
   static const std::string IFO_STORE_SUFFIX;  //!< the informational store
   static const std::string MAP_STORE_SUFFIX;  //!< the ID map store
@@ -658,6 +928,7 @@ public:
   static const std::string VAR_STORE_SUFFIX;  //!< the variable length stores
 
   static const std::string TMP_STORE_SUFFIX;  //!< the temporary store
+  static const std::string OVL_STORE_SUFFIX;  //!< the version overlay store
 
   static const char WRITE_LOCK_CHAR;          //!< write lock char
   static const char READ_LOCK_CHAR;           //!< read lock char
@@ -680,7 +951,8 @@ public:
   //! \param type The type of bank to construct
   //!
   Bank_t (NCode_t type)
-    : banktype_m (type), last_bid_m(NULL), nbids_m(NULL)
+    : banktype_m (type), last_bid_m(NULL), nbids_m(NULL),
+      stats_m (BankStats_t::isEnabled( ) ? new BankStats_t : NULL)
   {
     init( );
     status_m = 0;
@@ -692,7 +964,8 @@ public:
 
   //--------------------------------------------------- Bank_t -----------------
   Bank_t (const std::string & type)
-    : banktype_m (Encode(type)), last_bid_m(NULL), nbids_m(NULL)
+    : banktype_m (Encode(type)), last_bid_m(NULL), nbids_m(NULL),
+      stats_m (BankStats_t::isEnabled( ) ? new BankStats_t : NULL)
   {
     init( );
     status_m = 0;
@@ -711,6 +984,7 @@ public:
   {
     if ( is_open_m )
       close( );
+    delete stats_m;
   }
 
 
@@ -737,6 +1011,24 @@ public:
   void append (IBankable_t & obj);
 
 
+  //--------------------------------------------------- append -----------------
+  //! \brief Appends a pre-serialized object to the bank
+  //!
+  //! Writes exactly what append(IBankable_t &) would have written for the
+  //! object rec was serialized from, but without serializing it again.
+  //!
+  //! \param rec The serialized object to append
+  //! \pre The bank is open for writing
+  //! \pre rec was serialized from an object of the current NCode bank type
+  //! \pre There is no IID/EID of the record already in the bank
+  //! \post rec IID/EID and assigned BID are added to the IDMap
+  //! \throws IOException_t
+  //! \throws ArgumentException_t
+  //! \return void
+  //!
+  void append (const BankRecord_t & rec);
+
+
   //--------------------------------------------------- assignEID --------------
   //! \brief Assigns an EID to an existing object
   //!
@@ -781,6 +1073,7 @@ public:
   //! Removes all objects waiting for deletion from disk. Also cleans up
   //! rubbish data left over from past replace operations. This is a costly
   //! operation, as it requires the entire bank be copied to a temporary store.
+  //! Only the open version is kept, all other versions are discarded.
   //!
   //! \pre The bank is open for read/writing
   //! \throws IOException_t
@@ -833,6 +1126,24 @@ public:
   void close ( );
 
 
+  //--------------------------------------------------- compact ----------------
+  //! \brief Reclaims the dead space of the most wasteful partitions
+  //!
+  //! Replaced and removed records leave their old var data behind. The bank
+  //! keeps count of the live and dead var bytes of each partition, and this
+  //! method rewrites, one at a time, only those partitions of the open
+  //! version whose dead fraction has reached the threshold. Unlike clean,
+  //! BIDs are kept and no temporary copy of the whole bank is made, so it is
+  //! cheap enough to call after each round of edits.
+  //!
+  //! \param threshold Minimum dead fraction of a partition's var bytes
+  //! \pre The bank is open for read/writing
+  //! \throws IOException_t
+  //! \return The number of partitions rewritten
+  //!
+  Size_t compact (float threshold = DEFAULT_GARBAGE_RATIO);
+
+
   //--------------------------------------------------- concat -----------------
   //! \brief Concatenates another bank to the end of this bank
   //!
@@ -987,6 +1298,24 @@ public:
   }
 
 
+  //--------------------------------------------------- flatten ----------------
+  //! \brief Makes the open version independent of the versions before it
+  //!
+  //! A version created by opening a bank with inPlace set to false stores
+  //! only the records written since, and reads every other record from the
+  //! version it was last written in. Flattening copies those inherited
+  //! records into the open version so that it no longer depends on its
+  //! predecessors. Unlike clean, earlier versions stay intact and deleted
+  //! records are kept. Has no effect on a self-contained version.
+  //!
+  //! \pre The bank is open for read/writing
+  //! \pre The open version is the latest version
+  //! \throws IOException_t
+  //! \return void
+  //!
+  void flatten ( );
+
+
   //--------------------------------------------------- getIDMap ---------------
   //! \brief Get the current (IID <-> EID) -> BID map for the bank
   //!
@@ -1059,6 +1388,19 @@ public:
   ID_t getMaxBID ( ) const;
 
 
+  //--------------------------------------------------- getPartitionSize -------
+  //! \brief Get the number of records per disk store partition
+  //!
+  //! BIDs (p*size, (p+1)*size] are stored in partition p.
+  //!
+  //! \return The number of records per partition
+  //!
+  Size_t getPartitionSize ( ) const
+  {
+    return partition_size_m;
+  }
+
+
 
 
   //--------------------------------------------------- getSize ----------------
@@ -1075,6 +1417,20 @@ public:
   }
 
 
+  //--------------------------------------------------- getStats ---------------
+  //! \brief Get the I/O counters of the bank
+  //!
+  //! The counters cover the bank since it was opened, or since they were
+  //! last written out. See BankStats_t.
+  //!
+  //! \return The counters, or NULL if the bank is not profiled
+  //!
+  const BankStats_t * getStats ( ) const
+  {
+    return stats_m;
+  }
+
+
   //--------------------------------------------------- getStatus --------------
   //! \brief Get the bank status
   //!
@@ -1090,6 +1446,17 @@ public:
   }
 
 
+  //--------------------------------------------------- getStoreDir ------------
+  //! \brief Get the directory of the open bank
+  //!
+  //! \return The bank directory, or empty if the bank is closed
+  //!
+  const std::string & getStoreDir ( ) const
+  {
+    return store_dir_m;
+  }
+
+
   //--------------------------------------------------- getType ----------------
   //! \brief Get the unique bank type identifier
   //!
@@ -1103,6 +1470,17 @@ public:
   }
 
 
+  //--------------------------------------------------- getVersion -------------
+  //! \brief Get the bank version being worked on
+  //!
+  //! \return The version of the open bank
+  //!
+  Size_t getVersion ( ) const
+  {
+    return version_m;
+  }
+
+
   //--------------------------------------------------- isOpen -----------------
   //! \brief Check the bank's open status
   //!
@@ -1117,6 +1495,9 @@ public:
   //--------------------------------------------------- lookupBID --------------
   //! \brief Converts an IID to a BID, throw exception on failure
   //!
+  //! Counts the lookup while the bank is profiled, so threads that share a
+  //! profiled bank must not call it concurrently, see BankStats_t.
+  //!
   //! \throws ArgumentException_t
   //! \return The BID of the specified IID
   //!
@@ -1126,6 +1507,8 @@ public:
   //--------------------------------------------------- lookupBID --------------
   //! \brief Converts an EID to a BID, throw exception on failure
   //!
+  //! Counts the lookup while the bank is profiled, like lookupBID (ID_t).
+  //!
   //! \throws ArgumentException_t
   //! \return The BID of the specified EID
   //!
@@ -1164,8 +1547,14 @@ public:
   //! activated, only read access to the banks is required, otherwise both
   //! read and write access is required.
   //!
+  //! Opening for writing with inPlace set to false starts a new version on
+  //! top of the one requested. The new version only stores the records
+  //! modified or appended through it, see flatten.
+  //!
   //! \param dir The resident directory of the bank
   //! \param mode The mode of the bank (B_READ | B_WRITE | B_SPY)
+  //! \param version The version to open, the latest if OPEN_LATEST_VERSION
+  //! \param inPlace Edit the opened version rather than a new one
   //! \pre At least one of the modes is specified
   //! \pre The specified directory contains a bank of this type
   //! \pre sufficient read/write/exe permissions for dir and bank files
@@ -1241,6 +1630,28 @@ public:
   void replace (const std::string & eid, IBankable_t & obj);
 
 
+  //--------------------------------------------------- setStats ---------------
+  //! \brief Turns the I/O counters on or off
+  //!
+  //! Profiles the bank whether or not AMOS_BANK_STATS is set. The counters
+  //! are written out when the bank is closed, where AMOS_BANK_STATS says or
+  //! to stderr if it is unset. Turning them off drops what was counted.
+  //!
+  //! \param on Keep the counters
+  //! \return void
+  //!
+  void setStats (bool on)
+  {
+    if ( on  &&  stats_m == NULL )
+      stats_m = new BankStats_t;
+    else if ( ! on )
+      {
+        delete stats_m;
+        stats_m = NULL;
+      }
+  }
+
+
   //--------------------------------------------------- setStatus --------------
   //! \brief Set the bank status
   //!
@@ -1254,6 +1665,21 @@ public:
     status_m = status;
   }
 
+
+  //--------------------------------------------------- writeStats -------------
+  //! \brief Writes the I/O counters as one line of JSON
+  //!
+  //! Writes nothing if the bank is not profiled. The counters are kept.
+  //!
+  //! \param out The stream to write to
+  //! \return void
+  //!
+  void writeStats (std::ostream & out) const
+  {
+    if ( stats_m != NULL )
+      stats_m -> writeJSON (out, store_dir_m, banktype_m);
+  }
+
 };
 
 
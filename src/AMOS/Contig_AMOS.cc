@@ -78,24 +78,27 @@ Size_t Contig_t::ungap2gap (Pos_t ungap)
 }
 
 
-//----------------------------------------------------- getSpan ----------------
-Size_t Contig_t::getSpan ( ) const
+//----------------------------------------------------- getTilingSpan ----------
+//! \brief The span of a vector of Tile_t or a TileArray_t, see getSpan
+//!
+template <class Tiling>
+static Size_t getTilingSpan (const Tiling & tiling)
 {
   Pos_t hi,lo;
 
 
-  if ( reads_m . empty( ) )
+  if ( tiling . empty( ) )
     {
       lo = hi = 0;
     }
   else
     {
-      vector<Tile_t>::const_iterator ti = reads_m . begin( );
+      typename Tiling::const_iterator ti = tiling . begin( );
 
       lo = ti -> offset;
       hi = ti -> offset + ti -> range . getLength( );
 
-      for ( ++ ti; ti != reads_m . end( ); ++ ti )
+      for ( ++ ti; ti != tiling . end( ); ++ ti )
         {
           if ( ti -> offset < lo )
             lo = ti -> offset;
@@ -108,6 +111,15 @@ Size_t Contig_t::getSpan ( ) const
 }
 
 
+//----------------------------------------------------- getSpan ----------------
+Size_t Contig_t::getSpan ( ) const
+{
+  if ( ispacked_m )
+    return getTilingSpan (packed_m);
+  return getTilingSpan (reads_m);
+}
+
+
 //----------------------------------------------------- getUngappedLength ------
 Size_t Contig_t::getUngappedLength( ) const
 {
@@ -184,6 +196,7 @@ double Contig_t::getFoldCov ( ) const
 {
   double cov = 0.0;
   int contiglen = getLength();
+  unpackTiling( );
   if ( (!reads_m.empty()) && (contiglen!=0) )
   {
     int totreadlen = 0;
@@ -204,7 +217,8 @@ double Contig_t::getCovStat(const double globalArrivalRate) const
   const float ln2=0.69314718055994530941723212145818;
 
   assert(globalArrivalRate != -1);
-  return (getAvgRho() * (globalArrivalRate)) - (ln2 * (reads_m.size() -1));
+  Size_t nreads = ispacked_m ? packed_m . size( ) : reads_m . size( );
+  return (getAvgRho() * (globalArrivalRate)) - (ln2 * (nreads -1));
 }
 
 
@@ -215,6 +229,7 @@ double Contig_t::getAvgRho( ) const
   Pos_t  lo, hi;
   Size_t lenLo, lenHi;
 
+  unpackTiling( );
   if ( !reads_m . empty( ) )
   {
     vector<Tile_t>::const_iterator ti = reads_m . begin( );
@@ -262,6 +277,7 @@ void Contig_t::insertGapColumn (Pos_t gindex)
   setSequence(seq, qual);
 
   // Adjust the reads
+  unpackTiling( );
   vector<Tile_t>::iterator i;
   for (i =  reads_m.begin();
        i != reads_m.end();
@@ -358,15 +374,67 @@ void Contig_t::readMessage (const Message_t & msg)
 void Contig_t::readRecord (istream & fix, istream & var)
 {
   gapsvalid_m = false;
-  Sequence_t::readRecord (fix, var);
+
+  if ( load_m & LOAD_SEQ )
+    Sequence_t::readRecord (fix, var);
+  else
+    {
+      //-- Sequence_t::readRecord, skipping the consensus
+      Universal_t::readRecord (fix, var);
+      readLE (fix, &length_m);
+
+      free (seq_m);
+      free (qual_m);
+      seq_m = qual_m = NULL;
+      var . seekg (isCompressed( ) ? length_m : 2 * length_m, ios::cur);
+    }
 
   readLE (fix, &scf_m);
   Size_t sizet;
   readLE (fix, &sizet);
 
+  packed_m . clear( );
+  ispacked_m = false;
+
+  //-- The tiling is the last section of the record, leave it unread
+  if ( !(load_m & LOAD_TILING) )
+    {
+      reads_m . clear( );
+      reads_m . resize (sizet);
+      return;
+    }
+
+  if ( (load_m & LOAD_PACKED)  &&  (load_m & LOAD_TILE_GAPS) )
+    {
+      reads_m . clear( );
+      packed_m . readRecord (var, sizet);
+      ispacked_m = true;
+      return;
+    }
+
   reads_m . resize (sizet);
-  for ( Pos_t i = 0; i < sizet; i ++ )
-    reads_m [i] . readRecord (var);
+  if ( load_m & LOAD_TILE_GAPS )
+    {
+      for ( Pos_t i = 0; i < sizet; i ++ )
+        reads_m [i] . readRecord (var);
+    }
+  else
+    {
+      //-- Tile_t::readRecord, skipping the gaps
+      Size_t size;
+      for ( Pos_t i = 0; i < sizet; i ++ )
+        {
+          Tile_t & tile = reads_m [i];
+          readLE (var, &size);
+          var . seekg (size * sizeof (Pos_t), ios::cur);
+          tile . gaps . clear( );
+          readLE (var, &(tile . source));
+          readLE (var, &(tile . source_type));
+          readLE (var, &(tile . offset));
+          readLE (var, &(tile . range . begin));
+          readLE (var, &(tile . range . end));
+        }
+    }
 }
 
 
@@ -382,6 +450,8 @@ void Contig_t::readRecordFix (istream & fix)
 
   reads_m.clear();
   reads_m . resize (sizet);
+  packed_m . clear( );
+  ispacked_m = false;
 }
 
 
@@ -456,6 +526,7 @@ void Contig_t::reverseComplement()
   setSequence(seq, qual);
 
   // Flip the orientation of the reads
+  unpackTiling( );
   vector<Tile_t>::iterator i;
   for (i =  reads_m.begin();
        i != reads_m.end();
@@ -482,6 +553,7 @@ void Contig_t::reverseComplement()
 //----------------------------------------------------- writeMessage -----------
 void Contig_t::writeMessage (Message_t & msg) const
 {
+  unpackTiling( );
   Sequence_t::writeMessage (msg);
   try {
     ostringstream ss;
@@ -512,12 +584,28 @@ void Contig_t::writeMessage (Message_t & msg) const
 }
 
 
+//----------------------------------------------------- checkWritable ----------
+void Contig_t::checkWritable ( ) const
+{
+  if ( (load_m & LOAD_ALL) != LOAD_ALL )
+    AMOS_THROW_ARGUMENT ("Cannot write a partially loaded contig");
+}
+
+
 //----------------------------------------------------- writeRecord ------------
 void Contig_t::writeRecord (ostream & fix, ostream & var) const
 {
   Sequence_t::writeRecord (fix, var);
   writeLE (fix, &scf_m);
 
+  if ( ispacked_m )
+    {
+      Size_t sizet = packed_m . size( );
+      writeLE (fix, &sizet);
+      packed_m . writeRecord (var);
+      return;
+    }
+
   Size_t sizet = reads_m . size( );
   writeLE (fix, &sizet);
 
@@ -531,6 +619,7 @@ void Contig_t::writeUMD (ostream & out) const
 {
   vector<Tile_t>::const_iterator ti;
 
+  unpackTiling( );
   out << "C " << getEID( ) << endl;
 
   for ( ti = reads_m . begin( ); ti != reads_m . end( ); ti ++ )
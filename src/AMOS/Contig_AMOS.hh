@@ -12,6 +12,7 @@
 
 #include "Sequence_AMOS.hh"
 #include "Layout_AMOS.hh"
+#include "TileArray_AMOS.hh"
 #include <vector>
 
 
@@ -31,6 +32,13 @@ namespace AMOS {
 //! accepted. The compress and uncompress methods inherited from Sequence_t
 //! are made private because they would corrupt the gap characters.
 //!
+//! The read tiling is held either as a vector of Tile_t or as a TileArray_t,
+//! and getReadTiling and getPackedTiling convert between the two in place,
+//! even on a const contig. They are therefore not thread-safe: a contig
+//! shared between threads, even read-only, must have its tiling fetched in
+//! the form the threads will use before it is shared, or each thread must
+//! work on a copy of its own as parallelScan does.
+//!
 //==============================================================================
 class Contig_t : public Sequence_t
 {
@@ -38,8 +46,11 @@ class Contig_t : public Sequence_t
 private:
   bool gapsvalid_m;                   //<! indicates if gaps_m is up to date
   std::vector<Pos_t> gaps_m;          //!< consensus gaps
-  std::vector<Tile_t> reads_m;        //!< read tiling
+  mutable std::vector<Tile_t> reads_m; //!< read tiling
+  mutable TileArray_t packed_m;       //!< compact read tiling
+  mutable bool ispacked_m;            //!< packed_m holds the read tiling
   ID_t scf_m;                         //!< the IID of the parent scaffold 
+  uint8_t load_m;                     //!< sections loaded by readRecord
 
   //--------------------------------------------------- compress ---------------
   //! \brief Reimplemented from Sequence_t as private to prohibit use
@@ -58,6 +69,20 @@ private:
   //!
   void indexGaps();
 
+
+  //--------------------------------------------------- unpackTiling -----------
+  //! \brief Moves a compact read tiling to reads_m
+  //!
+  void unpackTiling ( ) const
+  {
+    if ( ispacked_m )
+      {
+        packed_m . getTiling (reads_m);
+        packed_m . clear( );
+        ispacked_m = false;
+      }
+  }
+
 protected:
 
   //--------------------------------------------------- readRecord -------------
@@ -72,17 +97,27 @@ protected:
   virtual void writeRecord (std::ostream & fix, std::ostream & var) const;
 
 
+  //--------------------------------------------------- checkWritable ----------
+  virtual void checkWritable ( ) const;
+
+
 public:
 
   static const NCode_t NCODE;
   //!< The NCode type identifier for this object
 
+  static const uint8_t LOAD_SEQ       = 0x1;  //!< load consensus and qualities
+  static const uint8_t LOAD_TILING    = 0x2;  //!< load the read tiling
+  static const uint8_t LOAD_TILE_GAPS = 0x4;  //!< load the gaps of the tiles
+  static const uint8_t LOAD_ALL       = 0x7;  //!< load the complete record
+  static const uint8_t LOAD_PACKED    = 0x8;  //!< load the tiling compactly
+
 
   //--------------------------------------------------- Contig_t ---------------
   //! \brief Constructs an empty Contig_t object
   //!
   Contig_t ( )
-   : gapsvalid_m(false), scf_m(NULL_ID)
+   : gapsvalid_m(false), ispacked_m(false), scf_m(NULL_ID), load_m(LOAD_ALL)
   {
 
   }
@@ -112,6 +147,8 @@ public:
     Sequence_t::clear( );
     gaps_m . clear( );
     reads_m . clear( );
+    packed_m . clear( );
+    ispacked_m = false;
     gapsvalid_m = false;
     scf_m = NULL_ID;
   }
@@ -124,6 +161,45 @@ public:
      return scf_m;
   }
 
+
+  //--------------------------------------------------- getLoadSections --------
+  //! \brief Get the sections of the record loaded when fetched from a bank
+  //!
+  //! \return The LOAD_% bits of the sections that are loaded
+  //!
+  uint8_t getLoadSections ( ) const
+  {
+    return load_m;
+  }
+
+
+  //--------------------------------------------------- setLoadSections --------
+  //! \brief Set the sections of the record loaded when fetched from a bank
+  //!
+  //! Applies to every following fetch or stream read into this object. The
+  //! header, length, scaffold and number of tiles are always loaded, the
+  //! sections left out are skipped over in the bank instead of being read.
+  //! Without LOAD_SEQ there is no consensus, like after Bank_t::fetchFix.
+  //! Without LOAD_TILING the tiling holds empty tiles, and without
+  //! LOAD_TILE_GAPS the tiles have no gaps, so their gapped lengths and right
+  //! offsets are understated. A contig that loads only part of the record
+  //! cannot be stored back to a bank, writing it throws an
+  //! ArgumentException_t until LOAD_ALL is set again. The default is
+  //! LOAD_ALL, and the setting is kept by clear( ) and copied with the
+  //! object.
+  //!
+  //! With LOAD_PACKED added to LOAD_TILING and LOAD_TILE_GAPS the tiling is
+  //! loaded into a TileArray_t, see getPackedTiling, instead of one Tile_t
+  //! per read. It is unpacked the first time getReadTiling is called.
+  //!
+  //! \param sections The LOAD_% bits of the sections to load
+  //! \return void
+  //!
+  void setLoadSections (uint8_t sections)
+  {
+    load_m = sections;
+  }
+
   //--------------------------------------------------- gap2ungap --------------
   //! \brief Translates a 0-based gapped position (offset) to a 1-based ungapped position (sequence coordinate)
   //!
@@ -205,13 +281,36 @@ public:
   }
 
 
+  //--------------------------------------------------- getPackedTiling --------
+  //! \brief Get the tiling of underlying reads in compact form
+  //!
+  //! Constant time if the contig was loaded with LOAD_PACKED or set from a
+  //! TileArray_t and the tiling has not been unpacked since, otherwise the
+  //! compact copy is rebuilt from the vector of reads. The returned tiling is
+  //! valid until the contig is changed or getReadTiling is called. Not
+  //! thread-safe, as it may rebuild the compact copy, see Contig_t.
+  //!
+  //! \return The compact tiling of underlying reads
+  //!
+  const TileArray_t & getPackedTiling ( ) const
+  {
+    if ( !ispacked_m )
+      packed_m . assign (reads_m);
+    return packed_m;
+  }
+
+
   //--------------------------------------------------- getReadTiling ----------
   //! \brief Get the tiling of underlying reads
   //!
+  //! If the tiling is held in compact form, it is unpacked first. Not
+  //! thread-safe, as it may unpack the tiling, see Contig_t.
+  //!
   //! \return The vector of underlying reads
   //!
   const std::vector<Tile_t> & getReadTiling ( ) const
   {
+    unpackTiling( );
     return reads_m;
   }
 
@@ -219,6 +318,7 @@ public:
   //--------------------------------------------------- getReadTiling ----------
   std::vector<Tile_t> & getReadTiling ( )
   {
+    unpackTiling( );
     return reads_m;
   }
 
@@ -388,6 +488,22 @@ public:
   void setReadTiling (const std::vector<Tile_t> & reads)
   {
     reads_m = reads;
+    packed_m . clear( );
+    ispacked_m = false;
+  }
+
+
+  //--------------------------------------------------- setReadTiling ----------
+  //! \brief Set the tiling of underlying reads from a compact tiling
+  //!
+  //! \param reads The new compact tiling of underlying reads
+  //! \return void
+  //!
+  void setReadTiling (const TileArray_t & reads)
+  {
+    packed_m = reads;
+    reads_m . clear( );
+    ispacked_m = true;
   }
 
 
@@ -399,7 +515,7 @@ public:
   //!
   void setReadTiling (const Layout_t & layout)
   {
-    reads_m = layout . getTiling( );
+    setReadTiling (layout . getTiling( ));
   }
 
   //--------------------------------------------------- setSequence -----------
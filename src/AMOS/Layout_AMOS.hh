@@ -11,6 +11,7 @@
 #define __Layout_AMOS_HH 1
 
 #include "Universal_AMOS.hh"
+#include "TileArray_AMOS.hh"
 #include <vector>
 
 
@@ -145,6 +146,18 @@ public:
   }
 
 
+  //--------------------------------------------------- setTiling --------------
+  //! \brief Set the sequence tiling from a compact tiling
+  //!
+  //! \param tiles The new compact tiling of underlying sequences
+  //! \return void
+  //!
+  void setTiling (const TileArray_t & tiles)
+  {
+    tiles . getTiling (tiles_m);
+  }
+
+
   //--------------------------------------------------- writeMessage -----------
   virtual void writeMessage (Message_t & msg) const;
 
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Source for TileArray_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "TileArray_AMOS.hh"
+using namespace AMOS;
+using namespace std;
+
+
+
+
+//================================================ TileArray_t =================
+//----------------------------------------------------- assign -----------------
+void TileArray_t::assign (const vector<Tile_t> & tiles)
+{
+  Size_t ngaps = 0;
+  vector<Tile_t>::const_iterator ti;
+  for ( ti = tiles . begin( ); ti != tiles . end( ); ++ ti )
+    ngaps += ti -> gaps . size( );
+
+  clear( );
+  reserve (tiles . size( ), ngaps);
+  for ( ti = tiles . begin( ); ti != tiles . end( ); ++ ti )
+    push_back (*ti);
+}
+
+
+//----------------------------------------------------- getTile ----------------
+void TileArray_t::getTile (Size_t i, Tile_t & tile) const
+{
+  const Entry_t & e = tiles_m [i];
+
+  tile . source = e . source;
+  tile . source_type = e . source_type;
+  tile . offset = e . offset;
+  tile . range = e . range;
+  tile . gaps . assign (gaps_m . begin( ) + e . gapsoff,
+                        gaps_m . begin( ) + e . gapsoff + e . gapslen);
+}
+
+
+//----------------------------------------------------- getTiling --------------
+void TileArray_t::getTiling (vector<Tile_t> & tiles) const
+{
+  tiles . resize (tiles_m . size( ));
+  for ( Size_t i = 0; i < (Size_t)tiles_m . size( ); i ++ )
+    getTile (i, tiles [i]);
+}
+
+
+//----------------------------------------------------- push_back --------------
+void TileArray_t::push_back (const Tile_t & tile)
+{
+  Entry_t e;
+  e . source = tile . source;
+  e . source_type = tile . source_type;
+  e . offset = tile . offset;
+  e . range = tile . range;
+  e . gapsoff = gaps_m . size( );
+  e . gapslen = tile . gaps . size( );
+
+  gaps_m . insert (gaps_m . end( ), tile . gaps . begin( ), tile . gaps . end( ));
+  tiles_m . push_back (e);
+}
+
+
+//----------------------------------------------------- readRecord -------------
+void TileArray_t::readRecord (istream & in, Size_t n)
+{
+  Entry_t e;
+
+  tiles_m . reserve (tiles_m . size( ) + n);
+  for ( Size_t i = 0; i < n; i ++ )
+    {
+      readLE (in, &(e . gapslen));
+      e . gapsoff = gaps_m . size( );
+
+      if ( e . gapslen > 0 )
+        {
+          gaps_m . resize (e . gapsoff + e . gapslen);
+          Pos_t * gp = &(gaps_m [e . gapsoff]);
+          in . read ((char *)gp, e . gapslen * sizeof (Pos_t));
+          for ( Size_t j = 0; j < e . gapslen; j ++ )
+            gp [j] = ltoh32 (gp [j]);
+        }
+
+      readLE (in, &(e . source));
+      readLE (in, &(e . source_type));
+      readLE (in, &(e . offset));
+      readLE (in, &(e . range . begin));
+      readLE (in, &(e . range . end));
+      tiles_m . push_back (e);
+    }
+}
+
+
+//----------------------------------------------------- writeRecord ------------
+void TileArray_t::writeRecord (ostream & out) const
+{
+  vector<Entry_t>::const_iterator ti;
+  for ( ti = tiles_m . begin( ); ti != tiles_m . end( ); ++ ti )
+    {
+      writeLE (out, &(ti -> gapslen));
+      for ( Size_t j = 0; j < ti -> gapslen; j ++ )
+        writeLE (out, &(gaps_m [ti -> gapsoff + j]));
+      writeLE (out, &(ti -> source));
+      writeLE (out, &(ti -> source_type));
+      writeLE (out, &(ti -> offset));
+      writeLE (out, &(ti -> range . begin));
+      writeLE (out, &(ti -> range . end));
+    }
+}
@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Header for TileArray_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TileArray_AMOS_HH
+#define __TileArray_AMOS_HH 1
+
+#include "datatypes_AMOS.hh"
+#include <vector>
+
+
+
+
+namespace AMOS {
+
+//================================================ TileArray_t =================
+//! \brief A compact tiling of sequences
+//!
+//! Holds the same information as a std::vector<Tile_t>, but the tiles are
+//! kept in one contiguous array and the gaps of all the tiles in one shared
+//! pool, each tile referencing its gaps by offset and count. Loading, copying
+//! or destroying a tiling of n tiles therefore costs two allocations instead
+//! of n + 1. Tile_t objects can be taken out with getTile for code written
+//! against the vector interface.
+//!
+//! Tiles are appended only, the gaps of a tile cannot be changed once it has
+//! been added. Use a std::vector<Tile_t> for a tiling that is being edited.
+//!
+//==============================================================================
+class TileArray_t
+{
+
+public:
+
+  //============================================== Entry_t =====================
+  //! \brief One tile of the array, Tile_t without its gaps
+  //!
+  //============================================================================
+  struct Entry_t
+  {
+    ID_t source;          //!< source of the tile
+    NCode_t source_type;  //!< the type of tile source
+    Pos_t offset;         //!< the offset of the tile
+    Range_t range;        //!< the usable range of the tile
+    Size_t gapsoff;       //!< position of the first gap in the gap pool
+    Size_t gapslen;       //!< number of gaps
+
+    //------------------------------------------------ getGappedLength -------
+    //! \brief See Tile_t::getGappedLength
+    //!
+    Size_t getGappedLength ( ) const
+    {
+      return range . getLength( ) + gapslen;
+    }
+
+    //------------------------------------------------ getRightOffset --------
+    //! \brief See Tile_t::getRightOffset
+    //!
+    Pos_t getRightOffset ( ) const
+    {
+      return offset + range . getLength( ) + gapslen - 1;
+    }
+  };
+
+
+  typedef std::vector<Entry_t>::const_iterator const_iterator;
+
+
+  //--------------------------------------------------- TileArray_t ------------
+  //! \brief Constructs an empty TileArray_t
+  //!
+  TileArray_t ( )
+  {
+
+  }
+
+
+  //--------------------------------------------------- TileArray_t ------------
+  //! \brief Constructs a TileArray_t from a vector of tiles
+  //!
+  //! \param tiles The tiles to copy
+  //!
+  explicit TileArray_t (const std::vector<Tile_t> & tiles)
+  {
+    assign (tiles);
+  }
+
+
+  //--------------------------------------------------- assign -----------------
+  //! \brief Replaces the contents with a copy of a vector of tiles
+  //!
+  //! \param tiles The tiles to copy
+  //! \return void
+  //!
+  void assign (const std::vector<Tile_t> & tiles);
+
+
+  //--------------------------------------------------- begin ------------------
+  const_iterator begin ( ) const
+  {
+    return tiles_m . begin( );
+  }
+
+
+  //--------------------------------------------------- clear ------------------
+  //! \brief Removes all tiles and gaps
+  //!
+  //! \return void
+  //!
+  void clear ( )
+  {
+    tiles_m . clear( );
+    gaps_m . clear( );
+  }
+
+
+  //--------------------------------------------------- empty ------------------
+  bool empty ( ) const
+  {
+    return tiles_m . empty( );
+  }
+
+
+  //--------------------------------------------------- end --------------------
+  const_iterator end ( ) const
+  {
+    return tiles_m . end( );
+  }
+
+
+  //--------------------------------------------------- getGaps ----------------
+  //! \brief Get the gaps of a tile
+  //!
+  //! The gaps are valid until the next tile is added.
+  //!
+  //! \param i The index of the tile
+  //! \pre i < size( )
+  //! \return Pointer to the getGapCount(i) gaps of the tile, NULL if none
+  //!
+  const Pos_t * getGaps (Size_t i) const
+  {
+    const Entry_t & e = tiles_m [i];
+    return e . gapslen ? &(gaps_m [e . gapsoff]) : NULL;
+  }
+
+
+  //--------------------------------------------------- getGapCount ------------
+  Size_t getGapCount (Size_t i) const
+  {
+    return tiles_m [i] . gapslen;
+  }
+
+
+  //--------------------------------------------------- getTile ----------------
+  //! \brief Copies a tile out of the array
+  //!
+  //! \param i The index of the tile
+  //! \param tile Set to the tile, gaps included
+  //! \pre i < size( )
+  //! \return void
+  //!
+  void getTile (Size_t i, Tile_t & tile) const;
+
+
+  //--------------------------------------------------- getTile ----------------
+  Tile_t getTile (Size_t i) const
+  {
+    Tile_t tile;
+    getTile (i, tile);
+    return tile;
+  }
+
+
+  //--------------------------------------------------- getTiling --------------
+  //! \brief Copies all the tiles out of the array
+  //!
+  //! \param tiles Set to the tiles, gaps included
+  //! \return void
+  //!
+  void getTiling (std::vector<Tile_t> & tiles) const;
+
+
+  //--------------------------------------------------- operator[] -------------
+  const Entry_t & operator[] (Size_t i) const
+  {
+    return tiles_m [i];
+  }
+
+
+  //--------------------------------------------------- operator[] -------------
+  //! \brief Access a tile, only its gaps are read only
+  //!
+  Entry_t & operator[] (Size_t i)
+  {
+    return tiles_m [i];
+  }
+
+
+  //--------------------------------------------------- push_back --------------
+  //! \brief Appends a copy of a tile
+  //!
+  //! \param tile The tile to append
+  //! \return void
+  //!
+  void push_back (const Tile_t & tile);
+
+
+  //--------------------------------------------------- readRecord -------------
+  //! \brief Appends tiles from a binary record
+  //!
+  //! Reads the same layout as n consecutive Tile_t::readRecord calls.
+  //!
+  //! \param in The stream to read from
+  //! \param n The number of tiles to read
+  //! \return void
+  //!
+  void readRecord (std::istream & in, Size_t n);
+
+
+  //--------------------------------------------------- reserve ----------------
+  //! \brief Reserves space for tiles and gaps
+  //!
+  //! \param ntiles The expected number of tiles
+  //! \param ngaps The expected total number of gaps
+  //! \return void
+  //!
+  void reserve (Size_t ntiles, Size_t ngaps = 0)
+  {
+    tiles_m . reserve (ntiles);
+    gaps_m . reserve (ngaps);
+  }
+
+
+  //--------------------------------------------------- size -------------------
+  Size_t size ( ) const
+  {
+    return tiles_m . size( );
+  }
+
+
+  //--------------------------------------------------- writeRecord ------------
+  //! \brief Writes all tiles as a binary record
+  //!
+  //! Writes the same layout as a Tile_t::writeRecord call for each tile.
+  //!
+  //! \param out The stream to write to
+  //! \return void
+  //!
+  void writeRecord (std::ostream & out) const;
+
+
+private:
+
+  std::vector<Entry_t> tiles_m;    //!< the tiles, in order
+  std::vector<Pos_t> gaps_m;       //!< the gaps of all the tiles
+};
+
+} // namespace AMOS
+
+#endif // #ifndef __TileArray_AMOS_HH
@@ -0,0 +1,518 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Source for TilingIndex_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "TilingIndex_AMOS.hh"
+#include "Contig_AMOS.hh"
+#include "Scaffold_AMOS.hh"
+#include "BankStream_AMOS.hh"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace AMOS;
+using namespace std;
+
+namespace {
+
+  const char TIX_MAGIC[4] = { 'T', 'I', 'X', '1' };
+
+  //-- On-disk layout, all fields little-endian 32 or 64-bit ints:
+  //   header   magic, ncode, objects, spans, stamp hash (64), stamp size (64)
+  //   spans    begin, end, max end of the subtree, source, ordinal
+  //   objects  iid, size, offset, root
+  const size_t HEADER_SIZE = 32;
+  const size_t SPAN_SIZE   = 20;
+  const size_t OBJECT_SIZE = 16;
+
+  //-- An in-memory span with the max end of its subtree
+  struct TreeSpan_t
+  {
+    Pos_t begin, end, max;
+    ID_t source;
+    uint32_t ordinal;
+
+    bool operator< (const TreeSpan_t & o) const
+    {
+      return begin < o.begin || (begin == o.begin && ordinal < o.ordinal);
+    }
+  };
+
+  //-- Reads field i of the span at p
+  inline int32_t spanField (const char * p, int i)
+  {
+    uint32_t v;
+    memcpy (&v, p + i * sizeof (uint32_t), sizeof (uint32_t));
+    return (int32_t) ltoh32 (v);
+  }
+
+  //-- Fills in the max ends of spans sorted by begin, laid out as an implicit
+  //   binary tree where the nodes of level k have their k lowest bits set.
+  //   Returns the level of the root, -1 for no spans.
+  int32_t indexSpans (vector<TreeSpan_t> & a)
+  {
+    int64_t n = a.size( );
+    int64_t i, last_i = 0;
+    Pos_t last = 0;
+    int32_t k;
+
+    if (n == 0)
+      return -1;
+
+    for (i = 0; i < n; i += 2)
+      {
+        last_i = i;
+        last = a[i].max = a[i].end;
+      }
+
+    for (k = 1; (int64_t)1 << k <= n; ++k)
+      {
+        int64_t x = (int64_t)1 << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+
+        for (i = i0; i < n; i += step)
+          {
+            Pos_t el = a[i - x].max;
+            Pos_t er = i + x < n ? a[i + x].max : last;
+            Pos_t e = a[i].end;
+            if (el > e) e = el;
+            if (er > e) e = er;
+            a[i].max = e;
+          }
+
+        // move last_i up to its parent and carry its max along
+        last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+        if (last_i < n && a[last_i].max > last)
+          last = a[last_i].max;
+      }
+
+    return k - 1;
+  }
+
+  void writeSpan (ostream & out, const TreeSpan_t & s)
+  {
+    writeLE (out, &(s.begin));
+    writeLE (out, &(s.end));
+    writeLE (out, &(s.max));
+    writeLE (out, &(s.source));
+    writeLE (out, &(s.ordinal));
+  }
+
+  //-- Adds the spans of a tiling, splitting tiles that wrap around the
+  //   origin of a circular object of length len
+  template <class Tiling>
+  void addSpans (const Tiling & tiling, Size_t len,
+                 vector<TreeSpan_t> & spans)
+  {
+    TreeSpan_t s;
+    typename Tiling::const_iterator ti;
+
+    s.ordinal = 0;
+    for ( ti = tiling.begin( ); ti != tiling.end( ); ++ ti, ++ s.ordinal )
+      {
+        s.source = ti->source;
+        s.begin = ti->offset;
+        s.end = ti->getRightOffset( );
+
+        if ( s.begin < 0 && len > 0 )
+          {
+            TreeSpan_t w = s;
+            w.begin = len + s.begin;
+            w.end = len - 1;
+            spans.push_back (w);
+            s.begin = 0;
+          }
+        if ( s.end >= s.begin )
+          spans.push_back (s);
+      }
+  }
+}
+
+
+//================================================ TilingIndex_t ===============
+const string TilingIndex_t::TIX_STORE_SUFFIX = ".tix";
+
+
+//----------------------------------------------------- TilingIndex_t ----------
+TilingIndex_t::TilingIndex_t ( )
+  : base_m (NULL), length_m (0), spans_m (NULL)
+{ }
+
+
+//----------------------------------------------------- ~TilingIndex_t ---------
+TilingIndex_t::~TilingIndex_t ( )
+{
+  close( );
+}
+
+
+//----------------------------------------------------- getIndexName -----------
+string TilingIndex_t::getIndexName (const string & bank, NCode_t type)
+{
+  return bank + '/' + Decode (type) + TIX_STORE_SUFFIX;
+}
+
+
+//----------------------------------------------------- getStamp ---------------
+bool TilingIndex_t::getStamp (const string & bank, NCode_t type,
+                              int64_t & hash, int64_t & size)
+{
+  //-- Every change to the bank is reflected in its IFO store, but so are the
+  //   read locks, so only the part before the lock list is hashed
+  string store = bank + '/' + Decode (type);
+  ifstream ifo ((store + Bank_t::IFO_STORE_SUFFIX) . c_str( ));
+  if ( ! ifo . is_open( ) )
+    return false;
+
+  uint64_t h = 14695981039346656037ULL;
+  string line;
+  int versions = 0, partitions = 0;
+
+  size = 0;
+  while ( getline (ifo, line) && line . compare (0, 5, "locks") != 0 )
+    {
+      for ( string::size_type i = 0; i < line . size( ); ++ i )
+        h = (h ^ (unsigned char) line [i]) * 1099511628211ULL;
+      h = (h ^ '\n') * 1099511628211ULL;
+      size += line . size( ) + 1;
+
+      sscanf (line . c_str( ), "versions = %d", &versions);
+      sscanf (line . c_str( ), "partitions = %d", &partitions);
+    }
+
+  //-- The IFO is only rewritten when a writer opens or closes the store,
+  //   not as records are written, so the sizes and modification times of
+  //   the partition files of every version are folded in too
+  for ( int v = 0; v < versions; ++ v )
+    for ( int p = 0; p < partitions; ++ p )
+      for ( int k = 0; k < 2; ++ k )
+        {
+          ostringstream ss;
+          ss << store << '.' << v << '.' << p
+             << (k == 0 ? Bank_t::FIX_STORE_SUFFIX : Bank_t::VAR_STORE_SUFFIX);
+
+          struct stat st;
+          if ( stat (ss . str( ) . c_str( ), &st) != 0 )
+            continue;
+          h = (h ^ (uint64_t) st . st_size) * 1099511628211ULL;
+          h = (h ^ (uint64_t) st . st_mtime) * 1099511628211ULL;
+          size += st . st_size;
+        }
+
+  hash = (int64_t) h;
+  return true;
+}
+
+
+//----------------------------------------------------- build ------------------
+Size_t TilingIndex_t::build (const string & bank, NCode_t type)
+{
+  if ( type != Contig_t::NCODE  &&  type != Scaffold_t::NCODE )
+    AMOS_THROW_ARGUMENT ("Only contig and scaffold tilings can be indexed");
+
+  int64_t hash, size;
+  if ( ! getStamp (bank, type, hash, size) )
+    AMOS_THROW_IO ("No " + Decode (type) + " account found in bank " + bank);
+
+  BankStream_t stream (type);
+  stream . open (bank, B_READ);
+
+  string name (getIndexName (bank, type));
+  string tname (name + Bank_t::TMP_STORE_SUFFIX);
+  ofstream out (tname . c_str( ), ios::out | ios::binary | ios::trunc);
+  if ( ! out . is_open( ) )
+    AMOS_THROW_IO ("Could not open tiling index " + tname);
+
+  //-- Header is rewritten with the counts once the spans are known
+  char header [HEADER_SIZE];
+  memset (header, 0, HEADER_SIZE);
+  out . write (header, HEADER_SIZE);
+
+  vector<Object_t> objects;
+  vector<TreeSpan_t> spans;
+  uint32_t nspans = 0;
+  Contig_t ctg;
+  Scaffold_t scf;
+  ctg . setLoadSections (Contig_t::LOAD_TILING | Contig_t::LOAD_TILE_GAPS |
+                         Contig_t::LOAD_PACKED);
+
+  while ( true )
+    {
+      Object_t obj;
+      spans . clear( );
+
+      if ( type == Contig_t::NCODE )
+        {
+          if ( ! (stream >> ctg) ) break;
+          obj . iid = ctg . getIID( );
+          addSpans (ctg . getPackedTiling( ), ctg . getLength( ), spans);
+        }
+      else
+        {
+          if ( ! (stream >> scf) ) break;
+          obj . iid = scf . getIID( );
+          addSpans (scf . getContigTiling( ), scf . getSpan( ), spans);
+        }
+
+      sort (spans . begin( ), spans . end( ));
+      obj . root = indexSpans (spans);
+      obj . size = spans . size( );
+      obj . offset = nspans;
+      nspans += obj . size;
+      objects . push_back (obj);
+
+      for ( vector<TreeSpan_t>::iterator si = spans . begin( );
+            si != spans . end( ); ++ si )
+        writeSpan (out, *si);
+    }
+  stream . close( );
+
+  sort (objects . begin( ), objects . end( ));
+  for ( vector<Object_t>::iterator oi = objects . begin( );
+        oi != objects . end( ); ++ oi )
+    {
+      writeLE (out, &(oi -> iid));
+      writeLE (out, &(oi -> size));
+      writeLE (out, &(oi -> offset));
+      writeLE (out, &(oi -> root));
+    }
+
+  uint32_t ncode = type;
+  uint32_t nobjects = objects . size( );
+  out . seekp (0);
+  out . write (TIX_MAGIC, sizeof (TIX_MAGIC));
+  writeLE (out, &ncode);
+  writeLE (out, &nobjects);
+  writeLE (out, &nspans);
+  writeLE (out, &hash);
+  writeLE (out, &size);
+  out . close( );
+
+  if ( out . fail( ) )
+    {
+      unlink (tname . c_str( ));
+      AMOS_THROW_IO ("Could not write tiling index " + tname);
+    }
+  if ( rename (tname . c_str( ), name . c_str( )) != 0 )
+    {
+      unlink (tname . c_str( ));
+      AMOS_THROW_IO ("Could not rename tiling index " + tname);
+    }
+
+  return nobjects;
+}
+
+
+//----------------------------------------------------- isCurrent --------------
+bool TilingIndex_t::isCurrent (const string & bank, NCode_t type)
+{
+  int64_t hash, size, ihash, isize;
+  char magic [sizeof (TIX_MAGIC)];
+  uint32_t ncode, nobjects, nspans;
+
+  if ( ! getStamp (bank, type, hash, size) )
+    return false;
+
+  ifstream in (getIndexName (bank, type) . c_str( ), ios::in | ios::binary);
+  if ( ! in . is_open( ) )
+    return false;
+
+  in . read (magic, sizeof (magic));
+  readLE (in, &ncode);
+  readLE (in, &nobjects);
+  readLE (in, &nspans);
+  readLE (in, &ihash);
+  readLE (in, &isize);
+
+  return in . good( ) &&
+    memcmp (magic, TIX_MAGIC, sizeof (magic)) == 0 &&
+    ncode == type && ihash == hash && isize == size;
+}
+
+
+//----------------------------------------------------- open -------------------
+void TilingIndex_t::open (const string & bank, NCode_t type)
+{
+  close( );
+
+  string name (getIndexName (bank, type));
+  if ( ! isCurrent (bank, type) )
+    AMOS_THROW_IO ("Missing or out of date tiling index " + name);
+
+  int fd = ::open (name . c_str( ), O_RDONLY);
+  if ( fd < 0 )
+    AMOS_THROW_IO ("Could not open tiling index " + name);
+
+  struct stat st;
+  if ( fstat (fd, &st) != 0 || (size_t) st.st_size < HEADER_SIZE )
+    {
+      ::close (fd);
+      AMOS_THROW_IO ("Damaged tiling index " + name);
+    }
+
+  void * p = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close (fd);
+  if ( p == MAP_FAILED )
+    AMOS_THROW_IO ("Could not map tiling index " + name);
+
+  base_m = (const char *) p;
+  length_m = st.st_size;
+
+  uint32_t nobjects = spanField (base_m, 2);
+  uint32_t nspans = spanField (base_m, 3);
+  size_t dir = HEADER_SIZE + (size_t) nspans * SPAN_SIZE;
+  if ( dir + (size_t) nobjects * OBJECT_SIZE != length_m )
+    {
+      close( );
+      AMOS_THROW_IO ("Damaged tiling index " + name);
+    }
+
+  spans_m = base_m + HEADER_SIZE;
+  objects_m . resize (nobjects);
+  for ( uint32_t i = 0; i < nobjects; ++ i )
+    {
+      const char * q = base_m + dir + i * OBJECT_SIZE;
+      objects_m [i] . iid = spanField (q, 0);
+      objects_m [i] . size = spanField (q, 1);
+      objects_m [i] . offset = spanField (q, 2);
+      objects_m [i] . root = spanField (q, 3);
+
+      if ( (uint64_t) objects_m [i] . offset + objects_m [i] . size > nspans )
+        {
+          close( );
+          AMOS_THROW_IO ("Damaged tiling index " + name);
+        }
+    }
+}
+
+
+//----------------------------------------------------- close ------------------
+void TilingIndex_t::close ( )
+{
+  if ( base_m != NULL )
+    munmap ((void *) base_m, length_m);
+
+  base_m = spans_m = NULL;
+  length_m = 0;
+  objects_m . clear( );
+}
+
+
+//----------------------------------------------------- findObject -------------
+const TilingIndex_t::Object_t * TilingIndex_t::findObject (ID_t iid) const
+{
+  Object_t key;
+  key . iid = iid;
+
+  vector<Object_t>::const_iterator oi = lower_bound
+    (objects_m . begin( ), objects_m . end( ), key);
+
+  if ( oi == objects_m . end( )  ||  oi -> iid != iid )
+    return NULL;
+  return &(*oi);
+}
+
+
+//----------------------------------------------------- getSize ----------------
+Size_t TilingIndex_t::getSize (ID_t iid) const
+{
+  const Object_t * obj = findObject (iid);
+  return obj == NULL ? 0 : obj -> size;
+}
+
+
+//----------------------------------------------------- getOverlapping ---------
+Size_t TilingIndex_t::getOverlapping (ID_t iid, Pos_t begin, Pos_t end,
+                                      vector<Span_t> & spans) const
+{
+  spans . clear( );
+
+  const Object_t * obj = findObject (iid);
+  if ( obj == NULL  ||  obj -> size == 0 )
+    return 0;
+
+  const char * a = spans_m + (size_t) obj -> offset * SPAN_SIZE;
+  int64_t n = obj -> size;
+
+  //-- Depth first through the implicit tree, left child before the node
+  //   itself before the right child. Subtrees whose max end is left of the
+  //   region are skipped, as is everything starting right of it.
+  struct { int64_t x; int32_t k, w; } stack [64];
+  int t = 0;
+  Span_t s;
+
+  stack [t] . k = obj -> root;
+  stack [t] . x = ((int64_t)1 << obj -> root) - 1;
+  stack [t ++] . w = 0;
+
+  while ( t > 0 )
+    {
+      -- t;
+      int32_t k = stack [t] . k, w = stack [t] . w;
+      int64_t x = stack [t] . x;
+
+      if ( k <= 3 )
+        {
+          //-- Small subtree, scan it in order
+          int64_t i = x >> k << k;
+          int64_t i1 = i + ((int64_t)1 << (k + 1)) - 1;
+          if ( i1 > n ) i1 = n;
+
+          for ( ; i < i1; ++ i )
+            {
+              const char * p = a + i * SPAN_SIZE;
+              if ( spanField (p, 0) > end ) break;
+              if ( spanField (p, 1) >= begin )
+                {
+                  s . begin = spanField (p, 0);
+                  s . end = spanField (p, 1);
+                  s . source = spanField (p, 3);
+                  s . ordinal = spanField (p, 4);
+                  spans . push_back (s);
+                }
+            }
+        }
+      else if ( w == 0 )
+        {
+          //-- Come back for the node once its left child is done
+          int64_t y = x - ((int64_t)1 << (k - 1));
+          stack [t] . k = k;
+          stack [t] . x = x;
+          stack [t ++] . w = 1;
+
+          if ( y >= n  ||  spanField (a + y * SPAN_SIZE, 2) >= begin )
+            {
+              stack [t] . k = k - 1;
+              stack [t] . x = y;
+              stack [t ++] . w = 0;
+            }
+        }
+      else if ( x < n  &&  spanField (a + x * SPAN_SIZE, 0) <= end )
+        {
+          const char * p = a + x * SPAN_SIZE;
+          if ( spanField (p, 1) >= begin )
+            {
+              s . begin = spanField (p, 0);
+              s . end = spanField (p, 1);
+              s . source = spanField (p, 3);
+              s . ordinal = spanField (p, 4);
+              spans . push_back (s);
+            }
+
+          stack [t] . k = k - 1;
+          stack [t] . x = x + ((int64_t)1 << (k - 1));
+          stack [t ++] . w = 0;
+        }
+    }
+
+  return spans . size( );
+}
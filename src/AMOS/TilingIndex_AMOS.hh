@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Header for TilingIndex_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TilingIndex_AMOS_HH
+#define __TilingIndex_AMOS_HH 1
+
+#include "inttypes_AMOS.hh"
+#include "databanks_AMOS.hh"
+#include <string>
+#include <vector>
+
+
+
+
+namespace AMOS {
+
+//================================================ TilingIndex_t ===============
+//! \brief Persistent interval index of the tiles of the contigs or scaffolds
+//! in a bank
+//!
+//! The index is stored in the bank directory next to the object's own store,
+//! e.g. CTG.tix for the read tilings of the contigs or SCF.tix for the contig
+//! tilings of the scaffolds. For every object it holds the tile spans sorted
+//! by their left offset and laid out as an implicit interval tree, so the
+//! tiles overlapping a region are found in logarithmic time. The file is
+//! memory mapped and only the tree nodes that are visited are read, so no
+//! Contig_t or Scaffold_t record has to be loaded to answer a query.
+//!
+//! The index is a snapshot: once the bank is modified the index is out of
+//! date and must be rebuilt before it can be opened again.
+//!
+//==============================================================================
+class TilingIndex_t
+{
+
+public:
+
+  //============================================== Span_t ======================
+  //! \brief The extent of one tile within its contig or scaffold
+  //!
+  //============================================================================
+  struct Span_t
+  {
+    Pos_t begin;       //!< exact left offset of the tile
+    Pos_t end;         //!< exact right offset of the tile
+    ID_t source;       //!< IID of the tiled read or contig
+    uint32_t ordinal;  //!< position of the tile in the object's tiling
+  };
+
+  static const std::string TIX_STORE_SUFFIX;  //!< the tiling index store
+
+
+  //---------------------------------------------- TilingIndex_t ---------------
+  //! \brief Constructs a closed TilingIndex_t
+  //!
+  TilingIndex_t ( );
+
+
+  //---------------------------------------------- ~TilingIndex_t --------------
+  //! \brief Closes the index
+  //!
+  ~TilingIndex_t ( );
+
+
+  //---------------------------------------------- build -----------------------
+  //! \brief Builds or rebuilds the index of a bank
+  //!
+  //! Streams through every object once. Tiles with a negative offset wrap
+  //! around the end of a circular contig and are indexed as two spans with
+  //! the same ordinal.
+  //!
+  //! \param bank The bank directory
+  //! \param type Contig_t::NCODE or Scaffold_t::NCODE
+  //! \exception IOException_t If the bank could not be read or the index
+  //! could not be written
+  //! \exception ArgumentException_t If type is not a contig or scaffold
+  //! \return The number of objects indexed
+  //!
+  static Size_t build (const std::string & bank, NCode_t type);
+
+
+  //---------------------------------------------- getStamp --------------------
+  //! \brief Fingerprints the current contents of a bank store
+  //!
+  //! Hashes the part of the store's IFO file before its lock list, which
+  //! does not change with readers, along with the sizes and modification
+  //! times of the store's FIX and VAR partition files, which change as a
+  //! writer works even before it closes the store and syncs the IFO.
+  //!
+  //! \param bank The bank directory
+  //! \param type The NCode of the store
+  //! \param hash Set to the hash of the IFO file and partition files
+  //! \param size Set to the bytes of IFO hashed plus the partition file sizes
+  //! \return false if the bank has no such store
+  //!
+  static bool getStamp (const std::string & bank, NCode_t type,
+                        int64_t & hash, int64_t & size);
+
+
+  //---------------------------------------------- isCurrent -------------------
+  //! \brief Checks if a bank has an index matching its current contents
+  //!
+  //! \param bank The bank directory
+  //! \param type Contig_t::NCODE or Scaffold_t::NCODE
+  //! \return true if the index exists and the bank has not changed since
+  //!
+  static bool isCurrent (const std::string & bank, NCode_t type);
+
+
+  //---------------------------------------------- open ------------------------
+  //! \brief Opens the index of a bank
+  //!
+  //! \param bank The bank directory
+  //! \param type Contig_t::NCODE or Scaffold_t::NCODE
+  //! \exception IOException_t If the index is missing, damaged or out of date
+  //! \return void
+  //!
+  void open (const std::string & bank, NCode_t type);
+
+
+  //---------------------------------------------- close -----------------------
+  //! \brief Closes the index
+  //!
+  void close ( );
+
+
+  //---------------------------------------------- isOpen ----------------------
+  //! \brief Checks if the index is open
+  //!
+  bool isOpen ( ) const
+  {
+    return base_m != NULL;
+  }
+
+
+  //---------------------------------------------- getSize ---------------------
+  //! \brief Returns the number of spans indexed for an object
+  //!
+  //! \param iid The IID of the contig or scaffold
+  //! \return The number of spans, 0 if the object is not indexed
+  //!
+  Size_t getSize (ID_t iid) const;
+
+
+  //---------------------------------------------- getOverlapping --------------
+  //! \brief Finds the tiles overlapping a region of an object
+  //!
+  //! Spans are returned in no particular order, sort them by ordinal to get
+  //! the order of the object's tiling.
+  //!
+  //! \param iid The IID of the contig or scaffold
+  //! \param begin Exact left offset of the region
+  //! \param end Exact right offset of the region
+  //! \param spans Cleared, then filled with the overlapping spans
+  //! \pre The index is open
+  //! \return The number of spans found
+  //!
+  Size_t getOverlapping (ID_t iid, Pos_t begin, Pos_t end,
+                         std::vector<Span_t> & spans) const;
+
+
+private:
+
+  struct Object_t
+  {
+    ID_t iid;          //!< object IID
+    uint32_t size;     //!< number of spans
+    uint32_t offset;   //!< first span in the span store
+    int32_t root;      //!< level of the tree root
+
+    bool operator< (const Object_t & o) const
+    {
+      return iid < o.iid;
+    }
+  };
+
+  static std::string getIndexName (const std::string & bank, NCode_t type);
+
+  TilingIndex_t (const TilingIndex_t &);
+  TilingIndex_t & operator= (const TilingIndex_t &);
+
+  const Object_t * findObject (ID_t iid) const;
+
+  std::vector<Object_t> objects_m;  //!< directory, sorted by IID
+  const char * base_m;              //!< mapped index file
+  size_t length_m;                  //!< length of the mapping
+  const char * spans_m;             //!< start of the span store
+};
+
+} // namespace AMOS
+
+#endif // #ifndef __TilingIndex_AMOS_HH
@@ -3,12 +3,179 @@
 #include <cstdlib>
 #include <ctime>
 #include <sstream>
+#include <fstream>
 #include <iostream>
+#include <algorithm>
 using namespace std;
 using namespace AMOS;
 
 const string BANK_STORE_DIR = "_bank_";
 const string STREAM_STORE_DIR = "_stream_";
+const string SMALL_STORE_DIR = "_small_";
+const Size_t SMALL_PARTITION_SIZE = 7;
+
+
+//-- Lists the records a scan of the bank returns, with read-ahead if depth
+//   is not 0. The scan skips records with ignore and jumps with seekg along
+//   the way, and starts over from the beginning once.
+string scanBank (const string & dir, Size_t depth, Size_t chunk,
+		 bool fixedonly)
+{
+  BankStream_t stream (Read_t::NCODE);
+  Read_t read;
+  ostringstream out;
+  bool restarted = false;
+
+  stream . open (dir, B_READ);
+  stream . setFixedStoreOnly (fixedonly);
+  if ( depth > 0 )
+    stream . setReadAhead (depth, chunk);
+
+  for ( ID_t i = 1; ; i ++ )
+    {
+      if ( i % 13 == 0 )
+	stream . ignore (i % 3 + 1);
+      else if ( i % 17 == 0 )
+	stream . seekg (stream . tellg( ) + 5);
+      else if ( i == 40  &&  ! restarted )
+	{
+	  stream . seekg (0, BankStream_t::BEGIN);
+	  restarted = true;
+	}
+
+      if ( stream . eof( )  ||  ! (stream >> read) )
+	break;
+
+      out << stream . tellg( ) << ' ' << read . getIID( )
+	  << ' ' << read . getEID( ) << ' ' << read . getComment( )
+	  << ' ' << read . getLength( ) << '\n';
+    }
+
+  stream . close( );
+  return out . str( );
+}
+
+
+//-- Compares scans with read-ahead to the plain scan, false if one differs
+bool compareScans (const string & dir)
+{
+  const Size_t depths [] = { 1, 3 };
+  const Size_t chunks [] = { 1, 4096, 1 << 20 };
+
+  for ( int f = 0; f < 2; f ++ )
+    {
+      bool fixedonly = (f == 1);
+      string plain = scanBank (dir, 0, 0, fixedonly);
+
+      for ( int d = 0; d < 2; d ++ )
+	for ( int c = 0; c < 3; c ++ )
+	  if ( scanBank (dir, depths [d], chunks [c], fixedonly) != plain )
+	    {
+	      cerr << "READAHEAD scan of " << dir << " differs, depth "
+		   << depths [d] << " chunk " << chunks [c]
+		   << (fixedonly ? " fixed store only" : "") << endl;
+	      return false;
+	    }
+    }
+
+  return true;
+}
+
+
+//-- The record parallelScan passes on, as scanBank lists it
+struct ListRead_t
+{
+  typedef string result_type;
+  bool operator() (Read_t & read, result_type & line)
+  {
+    ostringstream out;
+    out << read . getIID( ) << ' ' << read . getEID( )
+	<< ' ' << read . getComment( ) << ' ' << read . getLength( );
+    line = out . str( );
+    return true;
+  }
+};
+
+
+//-- Collects the lines parallelScan delivers
+struct CollectLines_t
+{
+  vector<string> lines;
+  void operator() (const string & line)
+  {
+    lines . push_back (line);
+  }
+};
+
+
+//-- Compares parallelScan, ordered and not, to the serial loop, false if
+//   one differs
+bool compareParallelScans (const string & dir)
+{
+  BankStream_t stream (Read_t::NCODE);
+  Read_t read;
+  ListRead_t list;
+  vector<string> serial;
+  string line;
+
+  stream . open (dir, B_READ);
+  while ( stream >> read )
+    {
+      list (read, line);
+      serial . push_back (line);
+    }
+
+  for ( int ordered = 1; ordered >= 0; ordered -- )
+    {
+      CollectLines_t collect;
+      stream . seekg (1);
+      parallelScan<Read_t> (stream, 4, list, collect, ordered == 1);
+
+      if ( ! ordered )
+	{
+	  sort (serial . begin( ), serial . end( ));
+	  sort (collect . lines . begin( ), collect . lines . end( ));
+	}
+      if ( collect . lines != serial )
+	{
+	  cerr << "PARALLELSCAN of " << dir << " differs from the serial loop"
+	       << (ordered ? "" : " unordered") << endl;
+	  return false;
+	}
+    }
+
+  stream . close( );
+  return true;
+}
+
+
+//-- Creates an empty bank with partitions of size records
+void createSmallBank (const string & dir, Size_t size)
+{
+  Bank_t bank (Read_t::NCODE);
+  bank . create (dir);
+  bank . close( );
+
+  //-- The partition size is only set from the IFO, before the first partition
+  string ifo = dir + "/RED.ifo";
+  ifstream in (ifo . c_str( ));
+  ostringstream text;
+  text << in . rdbuf( );
+  in . close( );
+
+  string s = text . str( );
+  string key = "indices/partition = ";
+  string::size_type pos = s . find (key);
+  if ( pos == string::npos )
+    AMOS_THROW_IO ("No partition size in " + ifo);
+  pos += key . size( );
+  ostringstream ss;
+  ss << size;
+  s . replace (pos, s . find ('\n', pos) - pos, ss . str( ));
+
+  ofstream ofs (ifo . c_str( ));
+  ofs << s;
+}
 
 int main (int argc, char ** argv)
 {
@@ -16,7 +183,7 @@ int main (int argc, char ** argv)
 
   try {
 
-    ID_t N, i , j, step;
+    ID_t N, i , j, k, step;
     Bank_t readbank (Read_t::NCODE);
     BankStream_t readstream (Read_t::NCODE);
     Read_t read;
@@ -167,6 +334,42 @@ int main (int argc, char ** argv)
     readstream . close( );
 
 
+    cerr << "READAHEAD scans of the bank with removed reads\n"
+	 << Date( ) << endl << "begin...";
+    if ( ! compareScans (BANK_STORE_DIR) )
+      return -1;
+    cerr << "done.\n" << Date( ) << endl << endl;
+
+
+    cerr << "READAHEAD scans of partitions of " << SMALL_PARTITION_SIZE
+	 << " reads\n" << Date( ) << endl << "begin...";
+    createSmallBank (SMALL_STORE_DIR, SMALL_PARTITION_SIZE);
+    readbank . open (SMALL_STORE_DIR);
+    for ( i = 1; i <= N  &&  i <= 500; i ++ )
+      {
+ 	ss . str (NULL_STRING);
+ 	ss << 's' << i;
+ 	read . setIID (i);
+ 	read . setEID (ss . str( ));
+ 	read . setComment (ss . str( ) + 'c');
+ 	readbank . append (read);
+      }
+    for ( k = 1; k < i; k += 1 + k % 4 )
+      readbank . remove (k);
+    readbank . close( );
+    if ( ! compareScans (SMALL_STORE_DIR) )
+      return -1;
+    cerr << "done.\n" << Date( ) << endl << endl;
+
+
+    cerr << "PARALLELSCAN ordered and unordered\n"
+	 << Date( ) << endl << "begin...";
+    if ( ! compareParallelScans (BANK_STORE_DIR)  ||
+	 ! compareParallelScans (SMALL_STORE_DIR) )
+      return -1;
+    cerr << "done.\n" << Date( ) << endl << endl;
+
+
     readstream . open (BANK_STORE_DIR);
     cerr << "SFETCH " << readstream . getSize( )
 	 << " consecutive reads\n" << Date( ) << endl << "begin";
@@ -12,5 +12,6 @@
 
 #include "Bank_AMOS.hh"
 #include "BankStream_AMOS.hh"
+#include "BankScan_AMOS.hh"
 
 #endif // #ifndef __databanks_AMOS_HH
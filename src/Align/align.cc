@@ -201,6 +201,112 @@ int  Errors_Score_Entry_t :: Get_Errors
 
 
 
+// ###  Align_Scratch_t  methods  ###
+
+
+void  Align_Scratch_t :: Finish_Matrix
+    (void)
+
+//  Mark the end of the alignment begun by  Start_Matrix  and count
+//  the allocation if  delta  had to grow for it.
+
+  {
+   if  ((int) delta . capacity () > delta_cap)
+       alloc_ct ++;
+   busy = false;
+
+   return;
+  }
+
+
+
+vector <Align_Score_Entry_t> &  Align_Scratch_t :: New_Row
+    (int cols)
+
+//  Return the next row of the current matrix, emptied but with
+//  room for at least  cols  entries.
+
+  {
+   assert (busy);
+
+   if  (rows == (int) matrix . size ())
+       {
+        // More rows than promised to  Start_Matrix .
+        // Note that this copies every existing row.
+        matrix . push_back (vector <Align_Score_Entry_t> ());
+        alloc_ct ++;
+       }
+
+   vector <Align_Score_Entry_t> &  row = matrix [rows ++];
+
+   row . clear ();
+   if  ((int) row . capacity () < cols)
+       {
+        row . reserve (cols);
+        alloc_ct ++;
+       }
+
+   return  row;
+  }
+
+
+
+void  Align_Scratch_t :: Release
+    (void)
+
+//  Free the memory held by this scratch space.
+
+  {
+   assert (! busy);
+
+   vector < vector <Align_Score_Entry_t> > ().swap (matrix);
+   vector <int> ().swap (delta);
+   rows = delta_cap = 0;
+
+   return;
+  }
+
+
+
+vector < vector <Align_Score_Entry_t> > &  Align_Scratch_t :: Start_Matrix
+    (int max_rows)
+
+//  Begin a new alignment of at most  max_rows  rows and return its
+//  (empty) matrix.  Rows must be added with  New_Row  and the
+//  alignment ended with  Finish_Matrix .  Rows are reused from
+//  earlier alignments, so once the scratch space has seen an
+//  alignment of a given size, another one of that size makes no
+//  heap allocations.  Only one alignment can use the scratch space
+//  at a time.
+
+  {
+   assert (! busy);
+   busy = true;
+   use_ct ++;
+
+   if  ((int) matrix . size () < max_rows)
+       {
+        vector < vector <Align_Score_Entry_t> >  bigger (max_rows);
+        int  i, n;
+
+        // move the old rows over instead of copying them
+        n = matrix . size ();
+        for  (i = 0;  i < n;  i ++)
+          bigger [i] . swap (matrix [i]);
+        matrix . swap (bigger);
+        alloc_ct ++;
+       }
+
+   rows = 0;
+   delta . clear ();
+   delta_cap = delta . capacity ();
+
+   return  matrix;
+  }
+
+
+
+
 // ###  Distinguishing_Column_t  methods  ###
 
 
@@ -4940,9 +5046,10 @@ void  Complete_Align_Full_Matrix
 //  Use a full matrix for the computation.
 
   {
-   vector < vector <Align_Score_Entry_t> > a;  // the alignment array
-   vector <Align_Score_Entry_t>  empty_vector;
-   vector <int>  delta;
+   Align_Scratch_t  & scratch = Get_Align_Scratch ();
+   vector < vector <Align_Score_Entry_t> > & a
+       = scratch . Start_Matrix (t_hi - t_lo + 1);  // the alignment array
+   vector <int>  & delta = scratch . delta;
    Align_Score_Entry_t  entry;
    unsigned int  mxf;
    int  mxs, s_len, t_len, error_ct, row_limit;
@@ -4962,7 +5069,7 @@ void  Complete_Align_Full_Matrix
    t_len = t_hi - t_lo;
 
    // Do first row
-   a . push_back (empty_vector);
+   scratch . New_Row (s_len + 1);
    if  (first_entry != NULL)
        entry = * first_entry;
      else
@@ -4992,7 +5099,7 @@ void  Complete_Align_Full_Matrix
       r ++;
 
       // First column in row
-      a . push_back (empty_vector);
+      scratch . New_Row (s_len + 1);
       entry . diag_score = entry . left_score = NEG_INFTY_SCORE;
       if  (i < t_slip - 1)
           {
@@ -5058,6 +5165,7 @@ void  Complete_Align_Full_Matrix
        }
 
    align . setDelta (delta);
+   scratch . Finish_Matrix ();
 
    return;
   }
@@ -5274,6 +5382,26 @@ int  Gapped_Equivalent
 
 
 
+// Scratch space of the calling thread, see  Get_Align_Scratch
+static __thread Align_Scratch_t  * Thread_Scratch = NULL;
+
+
+Align_Scratch_t &  Get_Align_Scratch
+    (void)
+
+//  Return the alignment scratch space of the calling thread,
+//  creating it the first time.  It is kept for the life of
+//  the thread.
+
+  {
+   if  (Thread_Scratch == NULL)
+       Thread_Scratch = new Align_Scratch_t;
+
+   return  * Thread_Scratch;
+  }
+
+
+
 void  Global_Align
     (const char * s, int s_len, const char * t, int t_lo, int t_hi,
      int match_score, int mismatch_score, int indel_score,
@@ -5290,9 +5418,10 @@ void  Global_Align
 //  and  gap_score  the extra penalty for starting a gap (negative).
 
   {
-   vector < vector <Align_Score_Entry_t> > a;  // the alignment array
-   vector <Align_Score_Entry_t>  empty_vector;
-   vector <int>  delta;
+   Align_Scratch_t  & scratch = Get_Align_Scratch ();
+   vector < vector <Align_Score_Entry_t> > & a
+       = scratch . Start_Matrix (t_hi - t_lo + 1);  // the alignment array
+   vector <int>  & delta = scratch . delta;
    Align_Score_Entry_t  entry;
    int  r, c;    // row and column
    int  max_row, max_score;
@@ -5306,7 +5435,7 @@ void  Global_Align
    assert (0 <= s_len );
 
    // Do first row
-   a . push_back (empty_vector);
+   scratch . New_Row (s_len + 1);
    entry . diag_score = entry . top_score = entry . left_score = 0;
    entry . diag_from = entry . top_from = entry . left_from = FROM_NOWHERE;
    r = 0;
@@ -5332,7 +5461,7 @@ void  Global_Align
       r ++;
 
       // First column in row
-      a . push_back (empty_vector);
+      scratch . New_Row (s_len + 1);
       entry . diag_score = entry . left_score = NEG_INFTY_SCORE;
       entry . top_score = 0;
       entry . diag_from = entry . top_from = entry . left_from = FROM_NOWHERE;
@@ -5480,6 +5609,7 @@ printf ("L = %d:%u  D = %d:%u  T = %d:%u\n", entry . left_score, entry . left_fr
           printf ("delta [%d] = %d\n", i, delta [i]);
 
    align . setDelta (delta);
+   scratch . Finish_Matrix ();
 
    return;
   }
@@ -5774,9 +5904,10 @@ void  Overlap_Align_Full_Matrix
 //  Use a full matrix for the computation.
 
   {
-   vector < vector <Align_Score_Entry_t> > a;  // the alignment array
-   vector <Align_Score_Entry_t>  empty_vector;
-   vector <int>  delta;
+   Align_Scratch_t  & scratch = Get_Align_Scratch ();
+   vector < vector <Align_Score_Entry_t> > & a
+       = scratch . Start_Matrix (t_len - t_lo + 1);  // the alignment array
+   vector <int>  & delta = scratch . delta;
    Align_Score_Entry_t  entry;
    int  r, c;    // row and column
    unsigned int  max_from, mxf;
@@ -5789,7 +5920,7 @@ void  Overlap_Align_Full_Matrix
    if  (Verbose > 0)
        fprintf (stderr, "Overlap_Align_Full_Matrix:\n");
 
-   a . push_back (empty_vector);
+   scratch . New_Row (s_len + 1);
    entry . diag_score = entry . top_score = entry . left_score = 0;
    entry . diag_from = entry . top_from = entry . left_from = FROM_NOWHERE;
    r = 0;
@@ -5815,7 +5946,7 @@ void  Overlap_Align_Full_Matrix
       r ++;
 
       // First column in row
-      a . push_back (empty_vector);
+      scratch . New_Row (s_len + 1);
       entry . diag_score = entry . left_score = NEG_INFTY_SCORE;
       if  (i < t_hi - 1)
           {
@@ -5900,6 +6031,7 @@ void  Overlap_Align_Full_Matrix
        }
 
    align . setDelta (delta);
+   scratch . Finish_Matrix ();
 
    return;
   }
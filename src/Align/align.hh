@@ -140,6 +140,44 @@ class  Errors_Score_Entry_t  :  public Augmented_Score_Entry_t
   };
 
 
+class  Align_Scratch_t
+  {
+  private:
+   vector < vector <Align_Score_Entry_t> >  matrix;
+        // rows of the alignment array, kept with their capacity
+   int  rows;
+        // number of rows of  matrix  in use
+   bool  busy;
+        // true while an alignment is using the matrix
+   int  delta_cap;
+        // capacity of  delta  when the alignment started
+
+  public:
+   vector <int>  delta;
+        // delta list of the current alignment
+   long int  use_ct;
+        // number of alignments that have used this scratch space
+   long int  alloc_ct;
+        // number of heap allocations made for those alignments
+
+   Align_Scratch_t
+       ()
+     {
+      rows = delta_cap = 0;
+      busy = false;
+      use_ct = alloc_ct = 0;
+     }
+   void  Finish_Matrix
+       (void);
+   vector <Align_Score_Entry_t> &  New_Row
+       (int cols);
+   void  Release
+       (void);
+   vector < vector <Align_Score_Entry_t> > &  Start_Matrix
+       (int max_rows);
+  };
+
+
 class Phase_Entry_t
   {
   public:
@@ -643,6 +681,8 @@ int  Exact_Prefix_Match
     (const char * s, const char * t, int max_len);
 int  Gapped_Equivalent
     (int pos, const string & s);
+Align_Scratch_t &  Get_Align_Scratch
+    (void);
 void  Global_Align
     (const char * s, int s_len, const char * t, int t_lo, int t_hi,
      int match_score, int mismatch_score, int indel_score,
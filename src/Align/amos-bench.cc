@@ -0,0 +1,612 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Times the hot paths of libAMOS, libAlign and libSlice on a
+//!        simulated shotgun read set
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "foundation_AMOS.hh"
+#include "delcher.hh"
+#include "fasta.hh"
+#include "align.hh"
+#include "Slice.h"
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace std;
+using namespace AMOS;
+
+
+//=============================================================== Globals ====//
+long   OPT_GenomeLen   = 200000;   // simulated genome length
+double OPT_Depth       = 10.0;    // depth of coverage
+int    OPT_ReadLen     = 500;     // mean read length
+double OPT_ReadStdDev  = 0.0;     // standard deviation of read length
+double OPT_Error       = 0.01;    // per base error rate of the reads
+long   OPT_Seed        = 1;       // random seed
+int    OPT_Rounds      = 3;       // runs per benchmark, the fastest is kept
+int    OPT_MaxPairs    = 250;     // most read pairs for overlap-align
+string OPT_Dir;                   // scratch directory for the bank
+string OPT_Only;                  // run only the benchmarks with this prefix
+
+const int  MIN_OLAP_LEN = 40;     // least overlap for a pair of reads
+const int  GROUP_SIZE = 50;       // most reads in one multialignment
+const int  IDMAP_PASSES = 50;     // lookups of every read in idmap-lookup
+
+static const char  Alphabet [] = "acgt";
+
+//-- A simulated read, lo .. hi on the forward strand of the genome
+struct SimRead_t
+{
+  int lo, hi;
+  bool rc;                        // stored reverse complemented
+  string fwd;                     // the read on the forward strand, lower
+                                  // case as libAlign wants it
+
+  bool operator< (const SimRead_t & r) const
+  {
+    return lo < r . lo  ||  (lo == r . lo  &&  hi > r . hi);
+  }
+};
+
+string Genome;                    // simulated genome
+vector<SimRead_t> Sims;           // simulated reads, sorted by lo
+vector<Read_t> Reads;             // the reads as stored, IID is index + 1
+
+volatile long Sink;               // keeps the timed work from being dropped
+
+
+//========================================================== Fuction Decs ====//
+void ParseArgs (int argc, char ** argv);
+void PrintHelp (const char * s);
+void PrintUsage (const char * s);
+
+
+//-- Wall clock seconds
+static double Now ( )
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv . tv_sec + tv . tv_usec / 1e6;
+}
+
+
+//-- Prints one line of results
+static void Report (const char * name, long items, double secs)
+{
+  printf ("%s\t%ld\t%.6f\t%.1f\n",
+          name, items, secs, secs > 0 ? items / secs : 0.0);
+  fflush (stdout);
+}
+
+
+//-- True if the benchmark was asked for
+static bool Selected (const char * name)
+{
+  return OPT_Only . empty( )  ||
+    strncmp (name, OPT_Only . c_str( ), OPT_Only . size( )) == 0;
+}
+
+
+//-- Copies ref into a with substitutions, deletions and insertions at rate
+//   error, the error model of maligntest
+static void Copy_With_Errors (const char * ref, int len, double error,
+                              string & a)
+{
+  a . erase( );
+  for ( int j = 0; j < len; )
+    {
+      if ( drand48( ) >= error )
+        a . push_back (ref [j ++]);
+      else
+        {
+          double p = drand48( );
+          if ( p < 0.333 )
+            {
+              int q = lrand48( ) % 4;
+              if ( Alphabet [q] == ref [j] )
+                q = (q + 1 + lrand48( ) % 3) % 4;
+              a . push_back (Alphabet [q]);
+              j ++;
+            }
+          else if ( p < 0.667 )
+            j ++;
+          else
+            a . push_back (Alphabet [lrand48( ) % 4]);
+        }
+    }
+}
+
+
+//-- Simulates a uniform random shotgun of a random genome, sampling reads the
+//   way sim-shotgun and shotgunSim do but from a seeded drand48 stream, so a
+//   seed always gives the same reads
+static void Simulate ( )
+{
+  srand48 (OPT_Seed);
+
+  Genome . resize (OPT_GenomeLen);
+  for ( long i = 0; i < OPT_GenomeLen; i ++ )
+    Genome [i] = Alphabet [lrand48( ) % 4];
+
+  long num_reads = long ((OPT_Depth * OPT_GenomeLen) / OPT_ReadLen);
+  Sims . resize (num_reads);
+  for ( long i = 0; i < num_reads; i ++ )
+    {
+      SimRead_t & sim = Sims [i];
+      int len = int (0.5 + OPT_ReadLen + Pseudo_Normal( ) * OPT_ReadStdDev);
+      if ( len < MIN_OLAP_LEN ) len = MIN_OLAP_LEN;
+      if ( len > OPT_GenomeLen ) len = OPT_GenomeLen;
+
+      sim . lo = int (drand48( ) * (OPT_GenomeLen - len));
+      sim . hi = sim . lo + len;
+      sim . rc = drand48( ) < 0.5;
+      Copy_With_Errors (Genome . data( ) + sim . lo, len, OPT_Error, sim . fwd);
+    }
+  sort (Sims . begin( ), Sims . end( ));
+
+  //-- Reads are numbered in genome order but stored with their strand
+  Reads . resize (num_reads);
+  string seq, qual;
+  char eid [32];
+  for ( long i = 0; i < num_reads; i ++ )
+    {
+      seq = Sims [i] . fwd;
+      for ( string::iterator c = seq . begin( ); c != seq . end( ); ++ c )
+        *c = toupper (*c);
+      if ( Sims [i] . rc )
+        Reverse_Complement (seq);
+      qual . resize (seq . size( ));
+      for ( string::size_type j = 0; j < qual . size( ); j ++ )
+        qual [j] = MIN_QUALITY + 20 + lrand48( ) % 21;
+
+      sprintf (eid, "read%ld", i + 1);
+      Reads [i] . setIID (i + 1);
+      Reads [i] . setEID (eid);
+      Reads [i] . setSequence (seq, qual);
+      Reads [i] . setClearRange (Range_t (0, seq . size( )));
+    }
+}
+
+
+//-- A random order of the read IIDs
+static void Shuffle (vector<ID_t> & iids)
+{
+  iids . resize (Reads . size( ));
+  for ( Size_t i = 0; i < (Size_t) iids . size( ); i ++ )
+    iids [i] = i + 1;
+  for ( Size_t i = iids . size( ); i > 1; i -- )
+    swap (iids [i - 1], iids [lrand48( ) % i]);
+}
+
+
+//------------------------------------------------------ bank benchmarks ----//
+static void BenchBank (const string & bnk)
+{
+  double best;
+  vector<ID_t> order;
+  srand48 (OPT_Seed);
+  Shuffle (order);
+
+  if ( Selected ("bank-append") )
+    {
+      best = -1;
+      for ( int r = 0; r < OPT_Rounds; r ++ )
+        {
+          Bank_t bank (Read_t::NCODE);
+          double t = Now( );
+          bank . create (bnk);
+          for ( vector<Read_t>::iterator i = Reads . begin( );
+                i != Reads . end( ); ++ i )
+            bank . append (*i);
+          bank . close( );
+          t = Now( ) - t;
+          if ( best < 0 || t < best ) best = t;
+        }
+      Report ("bank-append", Reads . size( ), best);
+    }
+  else
+    {
+      Bank_t bank (Read_t::NCODE);
+      bank . create (bnk);
+      for ( vector<Read_t>::iterator i = Reads . begin( );
+            i != Reads . end( ); ++ i )
+        bank . append (*i);
+      bank . close( );
+    }
+
+  if ( Selected ("bank-fetch") )
+    {
+      best = -1;
+      for ( int r = 0; r < OPT_Rounds; r ++ )
+        {
+          Bank_t bank (Read_t::NCODE);
+          Read_t red;
+          bank . open (bnk, B_READ);
+          double t = Now( );
+          for ( vector<ID_t>::iterator i = order . begin( );
+                i != order . end( ); ++ i )
+            {
+              bank . fetch (*i, red);
+              Sink += red . getLength( );
+            }
+          t = Now( ) - t;
+          bank . close( );
+          if ( best < 0 || t < best ) best = t;
+        }
+      Report ("bank-fetch", order . size( ), best);
+    }
+
+  if ( Selected ("bank-stream") )
+    {
+      best = -1;
+      long n = 0;
+      for ( int r = 0; r < OPT_Rounds; r ++ )
+        {
+          BankStream_t bank (Read_t::NCODE);
+          Read_t red;
+          bank . open (bnk, B_READ);
+          n = 0;
+          double t = Now( );
+          while ( bank >> red )
+            {
+              Sink += red . getLength( );
+              n ++;
+            }
+          t = Now( ) - t;
+          bank . close( );
+          if ( best < 0 || t < best ) best = t;
+        }
+      Report ("bank-stream", n, best);
+    }
+
+  Bank_t bank (Read_t::NCODE);
+  bank . open (bnk, B_READ | B_WRITE);
+  bank . destroy( );
+}
+
+
+//------------------------------------------------------ message-read -------//
+static void BenchMessage ( )
+{
+  if ( ! Selected ("message-read") )
+    return;
+
+  ostringstream out;
+  Message_t msg;
+  for ( vector<Read_t>::iterator i = Reads . begin( );
+        i != Reads . end( ); ++ i )
+    {
+      i -> writeMessage (msg);
+      msg . write (out);
+    }
+  string text = out . str( );
+
+  double best = -1;
+  long n = 0;
+  for ( int r = 0; r < OPT_Rounds; r ++ )
+    {
+      istringstream in (text);
+      n = 0;
+      double t = Now( );
+      while ( msg . read (in) )
+        n ++;
+      t = Now( ) - t;
+      if ( best < 0 || t < best ) best = t;
+    }
+  Report ("message-read", n, best);
+}
+
+
+//------------------------------------------------------ idmap-lookup -------//
+static void BenchIDMap ( )
+{
+  if ( ! Selected ("idmap-lookup") )
+    return;
+
+  IDMap_t map (Read_t::NCODE);
+  for ( vector<Read_t>::iterator i = Reads . begin( );
+        i != Reads . end( ); ++ i )
+    map . insert (i -> getIID( ), i -> getEID( ), i -> getIID( ));
+
+  vector<ID_t> order;
+  vector<string> eids;
+  srand48 (OPT_Seed);
+  Shuffle (order);
+  for ( vector<ID_t>::iterator i = order . begin( ); i != order . end( ); ++ i )
+    eids . push_back (Reads [*i - 1] . getEID( ));
+
+  double best = -1;
+  for ( int r = 0; r < OPT_Rounds; r ++ )
+    {
+      double t = Now( );
+      for ( int k = 0; k < IDMAP_PASSES; k ++ )
+        for ( Size_t i = 0; i < (Size_t) order . size( ); i ++ )
+          {
+            Sink += map . lookupBID (order [i]);
+            Sink += map . lookupBID (eids [i]);
+          }
+      t = Now( ) - t;
+      if ( best < 0 || t < best ) best = t;
+    }
+  Report ("idmap-lookup", 2 * IDMAP_PASSES * order . size( ), best);
+}
+
+
+//------------------------------------------------------ overlap-align ------//
+static void BenchOverlap ( )
+{
+  if ( ! Selected ("overlap-align") )
+    return;
+
+  //-- Reads against the next one in genome order if they overlap
+  int slop = int (10 + OPT_ReadLen * 2.0 * OPT_Error);
+  vector< pair<int, int> > pairs;
+  for ( int i = 0; i + 1 < (int) Sims . size( )  &&
+          (int) pairs . size( ) < OPT_MaxPairs; i ++ )
+    if ( Sims [i] . hi - Sims [i + 1] . lo >= MIN_OLAP_LEN )
+      pairs . push_back (make_pair (i, i + 1));
+
+  double best = -1;
+  Alignment_t ali;
+  for ( int r = 0; r < OPT_Rounds; r ++ )
+    {
+      double t = Now( );
+      for ( vector< pair<int, int> >::iterator p = pairs . begin( );
+            p != pairs . end( ); ++ p )
+        {
+          const string & a = Sims [p -> second] . fwd;
+          const string & b = Sims [p -> first] . fwd;
+          int off = Sims [p -> second] . lo - Sims [p -> first] . lo;
+          int lo = Max (0, off - slop);
+          int hi = Min (int (b . size( )), off + slop);
+          Overlap_Align (a . c_str( ), a . size( ), b . c_str( ), lo, hi,
+                         b . size( ), 1, -3, -2, -2, ali);
+          Sink += ali . b_lo;
+        }
+      t = Now( ) - t;
+      if ( best < 0 || t < best ) best = t;
+    }
+  Report ("overlap-align", pairs . size( ), best);
+}
+
+
+//------------------------------------------------------ multi-align --------//
+static void BenchMultiAlign ( )
+{
+  if ( ! Selected ("multi-align") )
+    return;
+
+  //-- Runs of up to GROUP_SIZE consecutive overlapping reads
+  vector< pair<int, int> > groups;
+  for ( int i = 0; i < (int) Sims . size( ); )
+    {
+      int j = i + 1;
+      while ( j < (int) Sims . size( )  &&  j - i < GROUP_SIZE  &&
+              Sims [j - 1] . hi - Sims [j] . lo >= MIN_OLAP_LEN )
+        j ++;
+      if ( j - i > 1 )
+        groups . push_back (make_pair (i, j));
+      i = j;
+    }
+
+  int delta = int (10 + OPT_ReadLen * 2.0 * OPT_Error);
+  double erate = Max (0.04, 3.0 * OPT_Error);
+  double best = -1;
+  long n = 0;
+  for ( int r = 0; r < OPT_Rounds; r ++ )
+    {
+      double t = 0;
+      n = 0;
+      for ( vector< pair<int, int> >::iterator g = groups . begin( );
+            g != groups . end( ); ++ g )
+        {
+          Gapped_Multi_Alignment_t gma;
+          vector<char *> s;
+          vector<int> offset;
+          for ( int i = g -> first; i < g -> second; i ++ )
+            {
+              s . push_back (strdup (Sims [i] . fwd . c_str( )));
+              offset . push_back (i == g -> first ? 0 :
+                                  Sims [i] . lo - Sims [i - 1] . lo);
+            }
+
+          double t0 = Now( );
+          Multi_Align ("bench", s, offset, delta, erate, MIN_OLAP_LEN, gma);
+          t += Now( ) - t0;
+          n += s . size( );
+          Sink += gma . Ungapped_Consensus_Len( );
+
+          for ( vector<char *>::iterator i = s . begin( ); i != s . end( ); ++ i )
+            free (*i);
+        }
+      if ( best < 0 || t < best ) best = t;
+    }
+  Report ("multi-align", n, best);
+}
+
+
+//------------------------------------------------------ slice-consensus ----//
+static void BenchSlice ( )
+{
+  if ( ! Selected ("slice-consensus") )
+    return;
+
+  //-- A column for every genome position with the bases of the reads that
+  //   cover it, substitution errors only so the columns stay in register
+  srand48 (OPT_Seed);
+  vector<string> bc (OPT_GenomeLen), qv (OPT_GenomeLen), rc (OPT_GenomeLen);
+  for ( vector<SimRead_t>::iterator i = Sims . begin( ); i != Sims . end( ); ++ i )
+    for ( int p = i -> lo; p < i -> hi; p ++ )
+      {
+        if ( bc [p] . size( ) >= 0xffff )
+          continue;
+        char c = Genome [p];
+        if ( drand48( ) < OPT_Error )
+          c = Alphabet [(strchr (Alphabet, c) - Alphabet + 1 + lrand48( ) % 3) % 4];
+        bc [p] . push_back (toupper (c));
+        qv [p] . push_back (char (20 + lrand48( ) % 21));
+        rc [p] . push_back (char (i -> rc ? 1 : 0));
+      }
+
+  vector<libSlice_Slice> slices (OPT_GenomeLen);
+  for ( long p = 0; p < OPT_GenomeLen; p ++ )
+    {
+      slices [p] . bc = (char *) bc [p] . c_str( );
+      slices [p] . qv = (char *) qv [p] . c_str( );
+      slices [p] . rc = (char *) rc [p] . c_str( );
+      slices [p] . c = toupper (Genome [p]);
+      slices [p] . dcov = bc [p] . size( );
+    }
+
+  vector<libSlice_Consensus> cns (OPT_GenomeLen);
+  double best = -1;
+  for ( int r = 0; r < OPT_Rounds; r ++ )
+    {
+      double t = Now( );
+      libSlice_getConsensusRangeWithAmbiguity
+        (&slices [0], &cns [0], slices . size( ), NULL, 0);
+      t = Now( ) - t;
+      Sink += cns [0] . qvConsensus;
+      if ( best < 0 || t < best ) best = t;
+    }
+  Report ("slice-consensus", slices . size( ), best);
+}
+
+
+//========================================================= Function Defs ====//
+int main (int argc, char ** argv)
+{
+  int exitcode = EXIT_SUCCESS;
+  string dir;
+
+  ParseArgs (argc, argv);
+
+  try
+    {
+      dir = OPT_Dir;
+      if ( dir . empty( ) )
+        {
+          const char * tmp = getenv ("TMPDIR");
+          string templ = string (tmp ? tmp : "/tmp") + "/amos-bench.XXXXXX";
+          vector<char> buf (templ . begin( ), templ . end( ));
+          buf . push_back ('\0');
+          if ( mkdtemp (&buf [0]) == NULL )
+            AMOS_THROW_IO ("Could not make a scratch directory " + templ);
+          dir = &buf [0];
+        }
+
+      Simulate( );
+      cerr << "genome " << OPT_GenomeLen << ", depth " << OPT_Depth
+           << ", reads " << Reads . size( ) << " of " << OPT_ReadLen
+           << " bp, error " << OPT_Error << ", seed " << OPT_Seed << endl;
+
+      printf ("benchmark\titems\tseconds\titems_per_sec\n");
+      BenchBank (dir + "/bench.bnk");
+      BenchMessage( );
+      BenchIDMap( );
+      BenchOverlap( );
+      BenchMultiAlign( );
+      BenchSlice( );
+    }
+  catch (const Exception_t & e)
+    {
+      cerr << "FATAL: " << e . what( ) << endl
+           << "  there has been a fatal error, abort" << endl;
+      exitcode = EXIT_FAILURE;
+    }
+
+  if ( OPT_Dir . empty( )  &&  ! dir . empty( ) )
+    rmdir (dir . c_str( ));
+
+  return exitcode;
+}
+
+
+//------------------------------------------------------------- ParseArgs ----//
+void ParseArgs (int argc, char ** argv)
+{
+  int ch, errflg = 0;
+  optarg = NULL;
+
+  while ( !errflg && ((ch = getopt (argc, argv, "a:b:c:d:e:g:hl:r:s:v:")) != EOF) )
+    switch (ch)
+      {
+      case 'a': OPT_MaxPairs = atoi (optarg); break;
+      case 'b': OPT_Only = optarg; break;
+      case 'c': OPT_Depth = atof (optarg); break;
+      case 'd': OPT_Dir = optarg; break;
+      case 'e': OPT_Error = atof (optarg); break;
+      case 'g': OPT_GenomeLen = atol (optarg); break;
+      case 'l': OPT_ReadLen = atoi (optarg); break;
+      case 'r': OPT_Rounds = atoi (optarg); break;
+      case 's': OPT_Seed = atol (optarg); break;
+      case 'v': OPT_ReadStdDev = atof (optarg); break;
+      case 'h':
+        PrintHelp (argv[0]);
+        exit (EXIT_SUCCESS);
+        break;
+      default:
+        errflg ++;
+      }
+
+  if ( OPT_GenomeLen <= 0 || OPT_Depth <= 0 || OPT_ReadLen < MIN_OLAP_LEN ||
+       OPT_ReadLen > OPT_GenomeLen || OPT_Error < 0 || OPT_Error >= 1 ||
+       OPT_Rounds < 1 || OPT_MaxPairs < 0 )
+    {
+      cerr << "ERROR: Invalid simulation parameters\n";
+      errflg ++;
+    }
+
+  if ( errflg > 0 || optind != argc )
+    {
+      PrintUsage (argv[0]);
+      cerr << "Try '" << argv[0] << " -h' for more information.\n";
+      exit (EXIT_FAILURE);
+    }
+}
+
+
+//------------------------------------------------------------- PrintHelp ----//
+void PrintHelp (const char * s)
+{
+  PrintUsage (s);
+  cerr
+    << "-g n          Genome length, default 200000\n"
+    << "-c f          Depth of coverage, default 10\n"
+    << "-l n          Mean read length, default 500\n"
+    << "-v f          Standard deviation of read length, default 0\n"
+    << "-e f          Per base error rate of the reads, default 0.01\n"
+    << "-s n          Random seed, default 1\n"
+    << "-r n          Runs per benchmark, the fastest is reported, default 3\n"
+    << "-a n          Most read pairs for overlap-align, default 250\n"
+    << "-b name       Run only the benchmarks whose name starts with name\n"
+    << "-d dir        Scratch directory for the bank, default a new one in\n"
+    << "              $TMPDIR\n"
+    << "-h            Display help information\n\n";
+
+  cerr
+    << "Simulates a shotgun read set of a random genome and times the bank,\n"
+    << "message, ID map, alignment and consensus code on it: bank-append,\n"
+    << "bank-fetch (by IID in random order), bank-stream, message-read,\n"
+    << "idmap-lookup (by IID and EID), overlap-align (reads against the next\n"
+    << "one they overlap, -a pairs), multi-align (runs of up to 50 reads) and\n"
+    << "slice-consensus (every genome column). Prints a tab separated table\n"
+    << "of benchmark, items, seconds and items per second on stdout, one\n"
+    << "line per benchmark in a fixed order. The reads depend on the seed\n"
+    << "alone, so tables of two builds with the same options compare.\n\n";
+}
+
+
+//------------------------------------------------------------ PrintUsage ----//
+void PrintUsage (const char * s)
+{
+  cerr
+    << "\nUSAGE: " << s << "  [options]\n\n";
+}
@@ -43,9 +43,6 @@ static void MerToAscii(Mer_t mer, string & s);
 static void CountMers (const string & s, const string & q, MerTable_t & mer_table);
 static void PrintMers(const MerTable_t & mer_table, int min_count);
 
-// mine
-static bool Fastq_Read(FILE * fp, string & s, string & hdr, string & q);
-
 
 int  main (int argc, char * argv [])
 {
@@ -150,26 +147,18 @@ int  main (int argc, char * argv [])
     }
     */
 
-    FILE * fp;
-    if(fastqfile == "-")
-      fp = stdin;
-    else {
-      fp = fopen(fastqfile.c_str(), "r");
-      if (!fp)
-      {
-        cerr << "Couldn't open " << fastqfile << endl;
-        exit(1);
-      }
-    }
+    SeqReader_t fp(fastqfile);
+    SeqRecord_t rec;
 
     cerr << "Processing sequences..." << endl;
 
-    string s, q, tag;
+    string s, q;
     unsigned long mb_limit = (unsigned long)(1024.0*gb_limit);
     unsigned long kmer_limit = mb_limit * 1048576UL / (unsigned long)bytes_per_kmer;
 
-    //while(Fasta_Read(stdin, s, tag))
-    while(Fastq_Read(fp, s, tag, q)) {
+    while(fp.next(rec)) {
+      s.assign(rec.seq, rec.seq_len);
+      q.assign(rec.qual, rec.qual_len);
       CountMers(s, q, mer_table);
       if(gb_limit > 0 && mer_table.size() > kmer_limit) {
 	// print table
@@ -492,53 +481,3 @@ void PrintMers(const MerTable_t & mer_table, int min_count)
   cerr << printed << " mers occur at least " << min_count << " times" << endl;
   cerr << "Skipped " << skip << endl;
 }
-
-bool Fastq_Read(FILE * fp, string & s, string & hdr, string & q)
-{
-  int ch;
-
-  s.erase();
-  hdr.erase();
-  q.erase();
-
-  // skip till next '@' if necessary
-  while  ((ch = fgetc (fp)) != EOF && ch != '@')
-    ;
-
-  if(ch == EOF)
-    return false;
-
-  // skip spaces if any
-  while  ((ch = fgetc (fp)) != EOF && ch == ' ')
-    ;
-  if  (ch == EOF)
-    return  false;
-  ungetc (ch, fp);
-
-  // put rest of line into  hdr
-  while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-    hdr . push_back (char (ch));
-
-  // put everything up till next '\n' into  s
-  while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-  {
-    if  (! isspace (ch))
-      s . push_back (char (ch));
-  }
-
-  // skep next line
-  while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-    ;
-
-  // put everything up till next '\n' into  q
-  while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-  {
-    if  (! isspace (ch))
-      q . push_back (char (ch));
-  }
-  
-  if  (ch == '@')
-    ungetc (ch, fp);
-  
-  return  true;
-}
@@ -8,6 +8,7 @@
 #include <ctime>
 #include <sys/time.h>
 #include <unistd.h>
+#include "fasta.hh"
 using namespace std;
 
 const int OFFSET_TABLE_SIZE = 100;
@@ -73,52 +74,6 @@ private:
 
 
 
-bool  Fasta_Read (FILE * fp, string & s, string & hdr)
-
-//  Read next fasta-format string from file  fp  (which must
-//  already be open) into string  s .  Put the faster
-//  header line (without the '>' and trailing spaces) into
-//  string  hdr .  Return  true  if a string is successfully,
-//  read; false, otherwise.
-
-  {
-   int  ch;
-
-   s . erase ();
-   hdr . erase ();
-
-   // skip till next '>' if necessary
-   while  ((ch = fgetc (fp)) != EOF && ch != '>')
-     ;
-
-   if  (ch == EOF)
-       return  false;
-
-   // skip spaces if any
-   while  ((ch = fgetc (fp)) != EOF && ch == ' ')
-     ;
-   if  (ch == EOF)
-       return  false;
-   ungetc (ch, fp);
-
-   // put rest of line into  hdr
-   while  ((ch = fgetc (fp)) != EOF && ch != '\n')
-     hdr . push_back (char (ch));
-
-   // put everything up till next '>' into  s
-   while  ((ch = fgetc (fp)) != EOF && ch != '>')
-     {
-      if  (! isspace (ch))
-          s . push_back (char (ch));
-     }
-
-   if  (ch == '>')
-       ungetc (ch, fp);
-
-   return  true;
-  }
-
-
 void findTandems(const string & seq, const string & tag)
 {
   cout << ">" << tag << " len=" << seq.length() << endl;
@@ -285,13 +240,8 @@ helptext <<
 
   cerr << "Processing sequences in " << FASTA_FILE << "..." << endl;
 
-  FILE * fp = fopen(FASTA_FILE.c_str(), "r");
-
-  if (!fp)
-  {
-    cerr << "Couldn't open " << FASTA_FILE << endl;
-    exit(1);
-  }
+  SeqReader_t fp;
+  Seq_File_Open(fp, FASTA_FILE.c_str());
 
   EventTime_t timer;
 
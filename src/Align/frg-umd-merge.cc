@@ -48,7 +48,8 @@ int  main
 
   {
    Celera_Message_t  msg;
-   FILE  * frg_fp, * seq_fp, * qual_fp;
+   FILE  * frg_fp;
+   SeqReader_t  seq_fp, qual_fp;
    string  new_seq, new_qual;
    string  seq_hdr, qual_hdr;
    string  frg_comment;
@@ -66,8 +67,8 @@ int  main
       Parse_Command_Line (argc, argv);
 
       frg_fp = File_Open (Frg_File_Name, "r");
-      seq_fp = File_Open (Seq_File_Name, "r");
-      qual_fp = File_Open (Qual_File_Name, "r");
+      Seq_File_Open (seq_fp, Seq_File_Name);
+      Seq_File_Open (qual_fp, Qual_File_Name);
 
       while  (msg . read (frg_fp))
         {
@@ -199,12 +199,10 @@ static void gc_content_plot_seq(const string &seq, RangeIterator &range_iterator
         putchar('\n');
 }
 
-static void gc_content_plot_file(FILE *in, const char *filename)
+static void gc_content_plot_file(SeqReader_t &in, const char *filename)
 {
-    int c = getc(in);
-    ungetc(c, in);
-    switch (c) {
-    case '>': {
+    switch (in.getFormat()) {
+    case SeqReader_t::FASTA_FORMAT: {
             string s, tag;
             while (Fasta_Read(in, s, tag)) {
                 if (OPT_display_tags) {
@@ -217,9 +215,9 @@ static void gc_content_plot_file(FILE *in, const char *filename)
             }
             break;
         }
-    case '@': {
-            string s, hdr, q, qualHdr;
-            while (Fastq_Read(in, s, hdr, q, qualHdr)) {
+    case SeqReader_t::FASTQ_FORMAT: {
+            string s, hdr, q;
+            while (Fastq_Read(in, s, hdr, q)) {
                 if (OPT_display_tags) {
                     putchar('@');
                     fputs(hdr.c_str(), stdout);
@@ -292,21 +290,22 @@ int main(int argc, char *argv[])
     argc -= optind;
     argv += optind;
     init_tables();
+    SeqReader_t in;
     if (argc == 0) {
-        gc_content_plot_file(stdin, "stdin");
+        in.open(stdin);
+        gc_content_plot_file(in, "stdin");
     } else {
         for (int i = 0; i < argc; i++) {
-            FILE *fp;
             const char *filename;
             if (strcmp(argv[i], "-") == 0) {
-                fp = stdin;
+                in.open(stdin);
                 filename = "stdin";
             } else {
                 filename = argv[i];
-                fp = File_Open(filename, "r", __FILE__, __LINE__);
+                Seq_File_Open(in, filename, __FILE__, __LINE__);
             }
-            gc_content_plot_file(fp, filename);
-            fclose(fp);
+            gc_content_plot_file(in, filename);
+            in.close();
         }
     }
     return 0;
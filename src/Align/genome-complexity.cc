@@ -517,13 +517,7 @@ int main(int argc, char ** argv)
 
     cerr << "Processing sequences in " << fastafile << "..." << endl;
 
-    FILE * fp = fopen(fastafile.c_str(), "r");
-
-    if (!fp)
-    {
-      cerr << "Couldn't open " << fastafile << endl;
-      exit(1);
-    }
+    SeqReader_t fp(fastafile);
 
     string s, tag;
 
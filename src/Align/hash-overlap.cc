@@ -1090,10 +1090,10 @@ static void  Read_Fasta_Strings
 //  into  s  and their tags into  tag_list .
 
   {
-   FILE  * fp;
+   SeqReader_t  fp;
    std :: string  seq, hdr;
 
-   fp = File_Open (fn . c_str (), "r", __FILE__, __LINE__);
+   Seq_File_Open (fp, fn . c_str (), __FILE__, __LINE__);
    s . clear ();
    id_list . clear();
    tag_list . clear ();
@@ -53,7 +53,9 @@ int  main
 
    is_palindrome = (strcmp (Kmer, rev_kmer) == 0);
 
-   while  (Fasta_Read (stdin, s, tag))
+   SeqReader_t  in ("-");
+
+   while  (Fasta_Read (in, s, tag))
      {
       const char  * p, * sp;
       int  n = s . length ();
@@ -335,7 +335,8 @@ public:
 void mer_table_t::read_kmers(const char *kmer_file_name)
 {
     string s, tag;
-    FILE *fp = File_Open(kmer_file_name, "r", __FILE__, __LINE__);
+    SeqReader_t fp;
+    Seq_File_Open(fp, kmer_file_name, __FILE__, __LINE__);
     char *p;
     unsigned long mer_count;
     while (Fasta_Read(fp, s, tag)) {
@@ -356,7 +357,6 @@ void mer_table_t::read_kmers(const char *kmer_file_name)
         }
         this->insert(mer, mer_count);
     }
-    fclose(fp);
 }
 
 typedef HASHMAP::hash_map <mer_t, unsigned long, HASHMAP::hash <unsigned long> >
@@ -564,12 +564,11 @@ int main(int argc, char *argv[])
     }
     forward_mask = ((mer_t)1 << (2 * kmer_len - 2)) - 1;
 
-    int c = getchar();
-    switch (c) {
-    case '>': {
+    SeqReader_t in("-");
+    switch (in.getFormat()) {
+    case SeqReader_t::FASTA_FORMAT: {
             string s, tag;
-            ungetc(c, stdin);
-            while (Fasta_Read(stdin, s, tag)) {
+            while (Fasta_Read(in, s, tag)) {
                 if (OPT_display_tags) {
                     putchar('>');
                     fputs(tag.c_str(), stdout);
@@ -580,10 +579,9 @@ int main(int argc, char *argv[])
             }
             break;
         }
-    case '@': {
-            string s, hdr, q, qualHdr;
-            ungetc(c, stdin);
-            while (Fastq_Read(stdin, s, hdr, q, qualHdr)) {
+    case SeqReader_t::FASTQ_FORMAT: {
+            string s, hdr, q;
+            while (Fastq_Read(in, s, hdr, q)) {
                 if (OPT_display_tags) {
                     putchar('@');
                     fputs(hdr.c_str(), stdout);
@@ -127,7 +127,9 @@ int  main
         unsure_fp = File_Open ("unsure.cov.fasta", "w", __FILE__, __LINE__);
        }
 
-   while  (Fasta_Read (stdin, s, tag))
+   SeqReader_t  in ("-");
+
+   while  (Fasta_Read (in, s, tag))
      {
       FILE  * fp;
       double  percent_covered;
@@ -471,11 +473,11 @@ static void  Read_Mers
 //  ACGT's
 
   {
-   FILE  * fp;
+   SeqReader_t  fp;
    string  s, tag;
    Mer_t  mer;
 
-   fp = File_Open (fname, "r", __FILE__, __LINE__);
+   Seq_File_Open (fp, fname, __FILE__, __LINE__);
 
    mer_list . clear ();
 
@@ -548,6 +548,13 @@ int main (int argc, char *argv[])
       fclose (Expel_fp);
 
     read_bank.close ();
+
+    if (Verbose > 0)
+    {
+      Align_Scratch_t & scratch = Get_Align_Scratch ();
+      cerr << "Full-matrix alignments: " << scratch.use_ct
+           << "  scratch allocations: " << scratch.alloc_ct << endl;
+    }
   }
   catch (Exception_t & e)
   {
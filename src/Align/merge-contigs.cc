@@ -733,12 +733,12 @@ static void  Load_Unitigs
 //  Load unitigs from the file named  fn  and store them in  uni .
 
   {
-   FILE  * fp;
+   SeqReader_t  fp;
    string  s, tag;
    Unitig_Ref_t  u;
 
    uni_list . clear ();
-   fp = File_Open (fn, "r");
+   Seq_File_Open (fp, fn);
    while  (Fasta_Read (fp, s, tag))
      {
       u . uid = int (strtol (tag . c_str (), NULL, 10));
@@ -753,7 +753,7 @@ static void  Load_Unitigs
       uni_list . push_back (u);
      }
 
-   fclose (fp);
+   fp . close ();
 
    return;
   }
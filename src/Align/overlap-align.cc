@@ -333,11 +333,9 @@ int main(int argc, char ** argv)
     exit(1);
   }
 
-  FILE * f1 = fopen(argv[1], "r");
-  FILE * f2 = fopen(argv[2], "r");
-
-  if (!f1) { fprintf(stderr, "ERROR: Couldn't open %s\n", argv[1]); exit(1); }
-  if (!f2) { fprintf(stderr, "ERROR: Couldn't open %s\n", argv[2]); exit(1); }
+  SeqReader_t f1, f2;
+  Seq_File_Open(f1, argv[1]);
+  Seq_File_Open(f2, argv[2]);
 
   string S, S_header;
   string T, T_header;
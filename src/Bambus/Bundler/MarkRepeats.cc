@@ -11,6 +11,7 @@
 #include <set>
 #include <queue>
 #include <iterator>
+#include <algorithm>
 #include <iostream>
 
 #include <sys/time.h>
@@ -56,7 +57,7 @@ using namespace AMOS;
 using namespace Bundler;
 
 // constants for repeat resolution
-static const uint32_t MIN_PARALLEL_SIZE  = 500000000;
+static const uint32_t MIN_PARALLEL_SIZE  =    1000;
 static const uint32_t PARALLEL_SCALING   = 100;
 static const int32_t  MAX_REPEAT_SIZE    =   10000;
 static const int32_t  MAX_REPEAT_STDEV   =       3;
@@ -196,20 +197,184 @@ bool GetOptions(int argc, char ** argv) {
    return true;
 } // GetOptions
 
-double inline W (uint32_t k, uint32_t d, uint32_t w, uint32_t** sigma) {
+double inline W (uint32_t k, uint32_t d, uint32_t w, const uint32_t* sigma, uint32_t stride) {
    if (k == 0) {
-      return pow(sigma[0][w], d);
+      return pow(sigma[w], d);
    } else {
       uint32_t sum = 0;
       uint32_t i = 0;
       for (i = 1; i <=k; i++) {
-         sum = sum - sigma[i][w] * W(k - i, d - 1, w, sigma);
+         sum = sum - sigma[i * stride + w] * W(k - i, d - 1, w, sigma, stride);
       }
       return sum;
    }
 }
 
 #ifdef AMOS_HAVE_BOOST
+// scratch space for the k-bounded path counts from a single source
+// each thread owns one and reuses it for every source it processes
+// the per-vertex tables are flat K x numVertices arrays indexed by k * numVertices + v
+// children of v are stored from edgeStart[v] in a flat K x numEdges array
+struct PathScratch {
+   uint32_t   K;
+   uint32_t   numVertices;
+   uint32_t   numEdges;
+   uint32_t * sigma;
+   double *   delta;
+   uint32_t * sigmaSums;
+   uint32_t * dist;
+   uint32_t * order;       // vertices reached from the source in BFS order
+   uint32_t * phaseStart;  // where each BFS level starts in order
+   uint32_t * childCount;
+   uint32_t * child;
+   uint32_t   numVisited;  // entries of order filled by the last source
+
+   PathScratch(uint32_t k, uint32_t vertices, uint32_t edges) : K(k), numVertices(vertices), numEdges(edges), numVisited(0) {
+      sigma      = new uint32_t[K * numVertices];
+      delta      = new double[K * numVertices];
+      childCount = new uint32_t[K * numVertices];
+      child      = new uint32_t[K * numEdges];
+      sigmaSums  = new uint32_t[numVertices];
+      dist       = new uint32_t[numVertices];
+      order      = new uint32_t[numVertices];
+      phaseStart = new uint32_t[numVertices + 2];
+
+      std::fill(sigma, sigma + K * numVertices, 0);
+      std::fill(delta, delta + K * numVertices, 0);
+      std::fill(childCount, childCount + K * numVertices, 0);
+      std::fill(sigmaSums, sigmaSums + numVertices, 0);
+      std::fill(dist, dist + numVertices, MAX_VALUE);
+   }
+
+   ~PathScratch() {
+      delete[] sigma;
+      delete[] delta;
+      delete[] childCount;
+      delete[] child;
+      delete[] sigmaSums;
+      delete[] dist;
+      delete[] order;
+      delete[] phaseStart;
+   }
+
+   // only the vertices reached by the last source were touched
+   void reset() {
+      for (uint32_t i = 0; i < numVisited; i++) {
+         uint32_t v = order[i];
+         dist[v] = MAX_VALUE;
+         sigmaSums[v] = 0;
+         for (uint32_t k = 0; k < K; k++) {
+            sigma[k * numVertices + v] = 0;
+            delta[k * numVertices + v] = 0;
+            childCount[k * numVertices + v] = 0;
+         }
+      }
+      numVisited = 0;
+   }
+};
+
+// add the contribution of all k-bounded shortest paths starting at s to B
+void accumulatePathsFromSource(uint32_t s, const uint32_t *edgeStart, const uint32_t *edgeTarget, PathScratch &ps, double *B) {
+  const uint32_t K = ps.K;
+  const uint32_t V = ps.numVertices;
+  const uint32_t E = ps.numEdges;
+  uint32_t *sigma = ps.sigma;
+  double *delta = ps.delta;
+  uint32_t *childCount = ps.childCount;
+  uint32_t *child = ps.child;
+  uint32_t *dist = ps.dist;
+  uint32_t *order = ps.order;
+  uint32_t *phaseStart = ps.phaseStart;
+
+  uint32_t v, w, deltaW;
+  uint32_t j, d, di, dj;
+
+  ps.reset();
+
+  // count the shortest and the up to K-1 longer paths level by level
+  uint32_t phase = 0;
+  uint32_t next = 1;
+  sigma[s] = 1;
+  dist[s] = 0;
+  order[0] = s;
+  phaseStart[0] = 0;
+  phaseStart[1] = 1;
+
+  while (phaseStart[phase+1] > phaseStart[phase]) {
+     for (uint32_t i = phaseStart[phase]; i < phaseStart[phase+1]; i++) {
+        v = order[i];
+        for (uint32_t e = edgeStart[v]; e < edgeStart[v+1]; e++) {
+           w = edgeTarget[e];
+           if (dist[w] == MAX_VALUE) {
+              dist[w] = phase + 1;
+              order[next++] = w;
+           }
+           deltaW = dist[v] - dist[w] + 1;
+           if (deltaW < K) {
+              child[deltaW * E + edgeStart[v] + childCount[deltaW * V + v]++] = w;
+           }
+           if (deltaW <= min(K-1, (uint32_t)1)) {
+              sigma[deltaW * V + w] += sigma[v];
+           }
+        }
+     }
+     phaseStart[phase+2] = next;
+     phase = phase + 1;
+  }
+  ps.numVisited = next;
+
+  for (uint32_t k = 1; k < K; k++) {
+     for (uint32_t i = 0; i < next; i++) {
+        v = order[i];
+        for (d = 0; d < childCount[v]; d++) {
+           w = child[edgeStart[v] + d];
+           sigma[k * V + w] += sigma[k * V + v];
+        }
+        if (k < (K-1)) {
+           for (dj = 1; dj <= k+1; dj++) {
+              for (d = 0; d < childCount[dj * V + v]; d++) {
+                 w = child[dj * E + edgeStart[v] + d];
+                 sigma[(k+1) * V + w] += sigma[(k+1-dj) * V + v];
+              }
+           }
+        }
+     }
+  }
+
+  for (uint32_t i = 0; i < next; i++) {
+     v = order[i];
+     for (uint32_t k = 0; k < K; k++) {
+        ps.sigmaSums[v] += sigma[k * V + v];
+     }
+  }
+
+  // walk back from the deepest level accumulating dependencies, the source itself is skipped
+  phase = phase - 1;
+  for (uint32_t k = 0; k < K; k++) {
+     for (uint32_t p = phase; p > 0; p--) {
+        for (uint32_t i = phaseStart[p]; i < phaseStart[p+1]; i++) {
+           v = order[i];
+           double &deltaV = delta[k * V + v];
+           for (d = 0; d <= k; d++) {
+              for (j = 0; j < childCount[d * V + v]; j++) {
+                 w = child[d * E + edgeStart[v] + j];
+                 for (di = 0; di <= (k-d); di++) {
+                    uint32_t sum = 0;
+                    uint32_t e = k - d - di;
+                    for (dj = 0; dj <= e; dj++) {
+                       sum += W(e - dj, e, w, sigma, V) * sigma[dj * V + v];
+                    }
+                    deltaV += (sigma[w] == 0 ? 0 : (sum * (delta[di * V + w] / pow(sigma[w], e+1))));
+                 }
+                 deltaV += (ps.sigmaSums[w] == 0 ? 0 : (double)sigma[(k - d) * V + v] / ((double)ps.sigmaSums[w]));
+              }
+           }
+           B[v] += deltaV;
+        }
+     }
+  }
+}
+
 double* findShortestPathRepeatsParallel(Graph &g, int K) {
   if (K > MAX_K) {
      cerr << "Error: Maximum allowed k-max path is " << MAX_K << endl;
@@ -219,176 +384,69 @@ double* findShortestPathRepeatsParallel(Graph &g, int K) {
 
   int32_t      numVertices = boost::num_vertices(g);
   int32_t      numEdges = boost::num_edges(g);
-  double *       B     = new double[numVertices];
-  double **      delta = new double*[K];
-  uint32_t **    sigma = new uint32_t*[K];
-  uint32_t *     sigmaSums = new uint32_t[numVertices];
-  uint32_t *     dist  = new uint32_t[numVertices];
-  uint32_t **    S     = new uint32_t*[numVertices];
-  uint32_t *     S_count = new uint32_t[numVertices];
-  uint32_t **    child_count = new uint32_t*[K];
-  uint32_t ***   child   = new uint32_t**[K];
-
-  for (int k = 0; k < K; k++) {
-     child_count[k] = new uint32_t[numVertices];
-     child[k] = new uint32_t*[numVertices];
-     sigma[k] = new uint32_t[numVertices];
-     delta[k] = new double[numVertices];
-  }
+  double *     B = new double[numVertices];
+  std::fill(B, B + numVertices, 0);
 
-  Vertex v,w;
+  // flatten the out edges so the threads share a compact read-only copy of the graph
+  uint32_t *   edgeStart = new uint32_t[numVertices + 1];
+  uint32_t *   edgeTarget = new uint32_t[numEdges];
   EdgeIterator out_i, out_end;
-  uint32_t sw, distW, deltaW, p;
-  int j, d, di, dj;
-  double dsw;
-
-  #pragma omp parallel for private(j) schedule(static) collapse(2)
-  for (int k = 0; k < K; k++) {
-     for (j = 0; j < numVertices; j++) {
-        child[k][j] = new uint32_t[numEdges];
-        if (k == 0) {
-           B[j] = 0;
-           S[j] = new uint32_t[numVertices];
-        }
+  edgeStart[0] = 0;
+  for (int32_t v = 0; v < numVertices; v++) {
+     uint32_t e = edgeStart[v];
+     for (tie(out_i, out_end) = boost::out_edges(v, g); out_i != out_end; ++out_i) {
+        edgeTarget[e++] = boost::target(*out_i, g);
      }
+     edgeStart[v+1] = e;
   }
 
+  int numThreads = 1;
+#ifdef AMOS_HAVE_OPENMP
+  numThreads = omp_get_max_threads();
+  if (numThreads > numVertices) { numThreads = (numVertices > 0 ? numVertices : 1); }
+#endif
+  vector<double *> partialB(numThreads, (double *)NULL);
+
   timeval start;
   timeval end;
   gettimeofday(&start, 0);
 
-  for (int s = 0; s < numVertices; s++) {
-     #pragma omp parallel for private(j) schedule(static) collapse(2)
-     for (int k = 0; k < K; k++) {
-        for (int j = 0; j < numVertices; j++) {
-           child_count[k][j] = 0;
-           sigma[k][j] = delta[k][j] = 0;
-
-           if (k == 0) {
-              dist[j] = MAX_VALUE;
-              sigmaSums[j] = 0;
-              S_count[j] = 0;
-           }
-        }
-     }
-     uint32_t phase = 0;
-     sigma[0][s] = 1;
-     dist[s] = 0;
-     S[phase][0] = s;
-     S_count[phase] = 1;
-     uint32_t count = 1;
-
-     while (count > 0) {
-        S_count[phase+1] = count = 0;
-        #pragma omp parallel for private (v, w, distW, deltaW, p, out_i, out_end) schedule(dynamic)
-        for (int i = 0; i < S_count[phase]; i++) { // parallel
-           v = S[phase][i];
-           for (tie(out_i, out_end) = boost::out_edges(v, g); out_i != out_end; ++out_i) { // parallel
-              w = boost::target(*out_i, g);
-              distW = BOOST_ATOMIC_CAS(&dist[w], phase+1, MAX_VALUE);
-              deltaW = dist[v] - distW + 1;
-              if (distW == MAX_VALUE) {
-                 p = BOOST_ATOMIC_ADD(&S_count[phase+1], 1);
-                 BOOST_ATOMIC_ADD(&count, 1);
-                 assert(p < numVertices);
-                 assert(phase < numVertices - 1);
-                 S[phase+1][p] = w;
-                 distW = phase + 1;
-                 deltaW = dist[v] - distW + 1;
-              } 
-              if (deltaW  < K) {
-                 p = BOOST_ATOMIC_ADD(&child_count[deltaW][v], 1);
-                 assert(p < numEdges);
-                 assert(v < numVertices);
-                 assert(deltaW < K);
-                 child[deltaW][v][p] = w;
-              }
-              if (deltaW <= min(K-1, 1)) {
-                 BOOST_ATOMIC_ADD(&sigma[deltaW][w], sigma[0][v]);
-              }
-           }
-        } 
-        phase = phase + 1;
-     }
-
-     for (int k = 1; k < K; k++) {
-        for (int i = 0; i < phase; i++) {
-           #pragma omp parallel for private(v, w, j, d, dj) schedule(dynamic)
-           for (j = 0; j < S_count[i]; j++) { //parallel
-              v = S[i][j];
-              for (d = 0; d < child_count[0][v]; d++) { //parallel
-                 w = child[0][v][d];
-                 BOOST_ATOMIC_ADD(&sigma[k][w], sigma[k][v]);
-              }
-              if (k < (K-1)) {
-                 for (dj = 1; dj <= k+1; dj++) { //parallel
-                    for (d = 0; d < child_count[dj][v]; d++) { //parallel
-                       w = child[dj][v][d];
-                       BOOST_ATOMIC_ADD(&sigma[k+1][w], sigma[k+1-dj][v]);
-                    }
-                 }
-              }
-           }
-        }
+  // every thread accumulates its sources into a private B, the first one directly into the result
+  // sources are dealt out round-robin so the sums do not depend on thread timing
+  #pragma omp parallel num_threads(numThreads)
+  {
+     int tid = 0;
+#ifdef AMOS_HAVE_OPENMP
+     tid = omp_get_thread_num();
+#endif
+     PathScratch ps(K, numVertices, numEdges);
+     double *localB = B;
+     if (tid != 0) {
+        localB = new double[numVertices];
+        std::fill(localB, localB + numVertices, 0);
      }
+     partialB[tid] = localB;
 
-     #pragma omp parallel for private(j) schedule(static) collapse(2)
-     for (int k = 0; k < K; k++) {
-        for (j = 0; j < numVertices; j++) {
-           BOOST_ATOMIC_ADD(&sigmaSums[j], sigma[k][j]);
-        }
+     #pragma omp for schedule(static, 1)
+     for (int32_t s = 0; s < numVertices; s++) {
+        accumulatePathsFromSource(s, edgeStart, edgeTarget, ps, localB);
      }
+  }
 
-     phase = phase - 1;
-     for (int k = 0; k < K; k++) {
-        p = phase;
-        for ( ; p > 0; p--) {
-           #pragma omp parallel for private(v, w, d, j, di, dj) schedule(dynamic)
-           for (int i = 0; i < S_count[p]; i++) { // parallel
-              v = S[p][i];
-              for (d = 0; d <= k; d++) { // parallel
-                 for (j = 0; j < child_count[d][v]; j++) { ///parallel
-                    w = child[d][v][j];
-                    for (di = 0; di <= (k-d); di++) {
-                       uint32_t sum = 0;
-                       uint32_t e = k - d - di;
-                       for (dj = 0; dj <= e; dj++) {
-                          sum += W(e - dj, e, w, sigma) * sigma[dj][v];
-                       }
-                       delta[k][v] += (sigma[0][w] == 0 ? 0 : (sum * (delta[di][w] / pow(sigma[0][w], e+1))));
-                    }
-                    delta[k][v] += (sigmaSums[w] == 0 ? 0 : (double)sigma[k - d][v] / ((double)sigmaSums[w]));
-                 }
-              }
-              B[v] += delta[k][v];
-           }
-        }
+  for (int t = 1; t < numThreads; t++) {
+     if (partialB[t] == NULL) { continue; }
+     for (int32_t v = 0; v < numVertices; v++) {
+        B[v] += partialB[t][v];
      }
+     delete[] partialB[t];
   }
 
   gettimeofday(&end, 0);
   double totaltime = (((double)(end.tv_sec-start.tv_sec)) + ((double)(end.tv_usec-start.tv_usec))*1.0e-6);
   cerr << "Elapsed time threaded is " << totaltime << endl;
 
-  delete[] sigmaSums;
-  delete[] dist;
-  delete[] S_count;
-  #pragma opm parallel for private(j) schedule(static) collapse(2)
-  for (int k = 0; k < K; k++) {
-     for (j = 0; j < numVertices; j++) {
-        if (k == 0) delete[] S[j];
-        delete[] child[k][j];
-     }
-     delete[] child[k];
-     delete[] sigma[k];
-     delete[] delta[k];
-     delete[] child_count[k];
-  }
-  delete[] S;
-  delete[] child;
-  delete[] child_count;
-  delete[] sigma;
-  delete[] delta;
+  delete[] edgeStart;
+  delete[] edgeTarget;
 
   return B;
 }
@@ -573,7 +631,7 @@ void findShortestPathRepeats(Graph &g, Bank_t &contig_bank, set<ID_t> &repeats)
       if (globals.debug > 1) { cerr << "Using linear repeat detection" << endl; }
       numTimesOnPath = computeShortestPaths(g);
    } else {
-      if ((numVertices * numEdges) <= MIN_PARALLEL_SIZE) {
+      if (numVertices <= MIN_PARALLEL_SIZE) {
          if (globals.debug > 1) { cerr << "Using 1 thread" << endl; }
          globals.numThreads = 1;
 #ifdef AMOS_HAVE_OPENMP
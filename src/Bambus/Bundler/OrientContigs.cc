@@ -66,7 +66,6 @@ struct config {
 config globals;
 
 ID_t maxContig = 0;
-HASHMAP::hash_map<AMOS::ID_t, int32_t, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > *Bundler::cte2weight = NULL;
 
 void printHelpText() {
    cerr << 
@@ -219,34 +218,32 @@ void swapContigs(ContigEdge_t & cte, bool isReversed, bool secondOri, int firstL
    }
 }
 
-double getMaxWeightEdge(ID_t nodeID, hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk, Bank_t &edge_bank) {
-   assert(cte2weight);
-   set<ID_t, EdgeWeightCmp>* s = ctg2lnk[nodeID];
-   if (s == NULL || s->size() == 0) {
+double getMaxWeightEdge(ID_t nodeID, EdgeAdjacency &ctg2lnk, EdgeTable &edge_table) {
+   EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(nodeID);
+   if (s.size() == 0) {
       return 0;
    }
    else {
-      for (set<ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
-        if (!isBadEdge(*i, edge_bank)) {
-           return (*cte2weight)[(*i)];
+      for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
+        if (!isBadEdge(*i, edge_table)) {
+           return s.weight(i);
         }
       }
       return 0;
    }
 }
 
-double getTotalWeightEdge(ID_t nodeID, hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk, Bank_t &edge_bank) {
+double getTotalWeightEdge(ID_t nodeID, EdgeAdjacency &ctg2lnk, EdgeTable &edge_table) {
    double total = 0;
-   assert(cte2weight);
 
-   set<ID_t, EdgeWeightCmp>* s = ctg2lnk[nodeID];
-   if (s == NULL || s->size() == 0) {
+   EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(nodeID);
+   if (s.size() == 0) {
       // do nothing, nothing to sum
    }
    else {
-      for (set<ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
-        if (!isBadEdge(*i, edge_bank)) {
-           total += (*cte2weight)[(*i)];
+      for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
+        if (!isBadEdge(*i, edge_table)) {
+           total += s.weight(i);
         }
       }
    }
@@ -303,25 +300,24 @@ LinkAdjacency_t getAdjacency(contigOrientation firstOrient, contigOrientation se
 
 contigOrientation getOrientationByAllEdges(ID_t nodeID, 
                      hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> > &ctg2ort,
-                     hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk, 
-                     Bank_t &edge_bank) {
+                     EdgeAdjacency &ctg2lnk, 
+                     EdgeTable &edge_table) {
                         
-   set<ID_t, EdgeWeightCmp>* s = ctg2lnk[nodeID];
-   ContigEdge_t cte;
+   EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(nodeID);
    double orientWeights[2] = {0, 0};
    double max = 0;
    contigOrientation maxOrient = NONE;
    
-   if (s == NULL || s->size() == 0) {
+   if (s.size() == 0) {
       // do nothing, nothing to sum
    }
    else {
-      for (set<ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
-        edge_bank.fetch(*i, cte);
+      for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
+        const ContigEdge_t &cte = edge_table.get(*i);
         
-        if (!isBadEdge(*i, edge_bank) && ctg2ort[getEdgeDestination(nodeID, cte)] != NONE) {
+        if (!isBadEdge(*i, edge_table) && ctg2ort[getEdgeDestination(nodeID, cte)] != NONE) {
            contigOrientation orient = getOrientation(ctg2ort[getEdgeDestination(nodeID, cte)], cte);
-           orientWeights[orient] += (*cte2weight)[(*i)];
+           orientWeights[orient] += s.weight(i);
            if (orientWeights[orient] > max) {
             max = orientWeights[orient];
             maxOrient = orient;
@@ -409,29 +405,28 @@ edgeStatus isEdgeConsistent(
    return isEdgeConsistent(first, second, cte, ctg2ort, ctg2srt, ctg2scf);
 }
 
-bool verifyEdgeStatus(Contig_t target, set<ID_t, EdgeWeightCmp>* s,
+bool verifyEdgeStatus(Contig_t target, const EdgeAdjacency::EdgeList &s,
               hash_map<ID_t, int32_t, hash<ID_t>, equal_to<ID_t> >& ctg2srt,
               hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> >& ctg2ort,
-              hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk,
-              Bank_t &edge_bank, Bank_t &contig_bank)
+              EdgeAdjacency &ctg2lnk,
+              EdgeTable &edge_table, Bank_t &contig_bank)
 {
-   if (s == NULL || s->size() == 0) {
+   if (s.size() == 0) {
       return true;
    }
 
    bool result = true;
    ID_t myID = target.getIID();
-   ContigEdge_t cte;
    Contig_t first;
 
-   for (set<ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
-      edge_bank.fetch(*i, cte);
+   for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
+      const ContigEdge_t &cte = edge_table.get(*i);
       // only use incoming edges to position ourselves on the second pass
       if (cte.getContigs().second != myID) {
          continue;
       }
 
-      if (!isBadEdge(*i, edge_bank) && ctg2srt[getEdgeDestination(myID, cte)] != UNINITIALIZED) {
+      if (!isBadEdge(*i, edge_table) && ctg2srt[getEdgeDestination(myID, cte)] != UNINITIALIZED) {
          // fetch the other node
          contig_bank.fetch(getEdgeDestination(myID, cte), first);
 
@@ -449,8 +444,8 @@ int32_t computeContigPositions(
       Contig_t &first, Contig_t &second, ContigEdge_t &cte,
       hash_map<ID_t, int32_t, hash<ID_t>, equal_to<ID_t> >& ctg2srt,
       hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> >& ctg2ort,
-      hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk, 
-      Bank_t &edge_bank, double initialSD) {
+      EdgeAdjacency &ctg2lnk, 
+      EdgeTable &edge_table, double initialSD) {
 
    Range_t nullRange(0,0);
    Range_t overlap(10,15);
@@ -494,9 +489,9 @@ int32_t computeContigPositions(
          secondPosition = reconcilePositions(ctg2srt[second.getIID()], secondPosition, weight, cte.getSD());
          */
          // go on its good reconcile it
-         double weight = (double)cte.getContigLinks().size()/getTotalWeightEdge(first.getIID(), ctg2lnk, edge_bank);
+         double weight = (double)cte.getContigLinks().size()/getTotalWeightEdge(first.getIID(), ctg2lnk, edge_table);
          firstPosition = reconcilePositions(ctg2srt[first.getIID()], firstPosition, weight, cte.getSD());
-         weight = (double)cte.getContigLinks().size()/getTotalWeightEdge(second.getIID(), ctg2lnk, edge_bank);
+         weight = (double)cte.getContigLinks().size()/getTotalWeightEdge(second.getIID(), ctg2lnk, edge_table);
          secondPosition = reconcilePositions(ctg2srt[second.getIID()], secondPosition, weight, cte.getSD());
          /*
          The above was meant to better reconcile positions between edges. That is if an edge had a higher weight, it
@@ -559,15 +554,15 @@ int32_t computeContigPositions(
 int32_t computeContigPositionUsingAllEdges(ID_t myID,
 	      hash_map<ID_t, int32_t, hash<ID_t>, equal_to<ID_t> >& ctg2srt,
 	      hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> >& ctg2ort,
-	      hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk,
-	      Bank_t &edge_bank, Bank_t &contig_bank, double initialSD, bool allowBad) {
-   set<ID_t, EdgeWeightCmp>* s = ctg2lnk[myID];
+	      EdgeAdjacency &ctg2lnk,
+	      EdgeTable &edge_table, Bank_t &contig_bank, double initialSD, bool allowBad) {
+   EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(myID);
    ContigEdge_t cte;
    Contig_t first;
    Contig_t second;
 
    contig_bank.fetch(myID, first);
-   if (s == NULL || s->size() == 0) {
+   if (s.size() == 0) {
       // do nothing, nothing to sum
    }
    else {
@@ -579,18 +574,18 @@ int32_t computeContigPositionUsingAllEdges(ID_t myID,
          ctg2srt[myID] = UNINITIALIZED;
       }
  
-      for (set<ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
-         edge_bank.fetch(*i, cte);
+      for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
+         edge_table.fetch(*i, cte);
          // only use incoming edges to position ourselves on the second pass
          if (allowBad == false && cte.getContigs().second != myID) {
             continue;
          }
 
-         if (!isBadEdge(*i, edge_bank) && ctg2srt[getEdgeDestination(myID, cte)] != UNINITIALIZED) {
+         if (!isBadEdge(*i, edge_table) && ctg2srt[getEdgeDestination(myID, cte)] != UNINITIALIZED) {
             // fetch the other node
             contig_bank.fetch(getEdgeDestination(myID, cte), second);
        
-            int32_t result = (myID == cte.getContigs().first ? computeContigPositions(first, second, cte, ctg2srt, ctg2ort, ctg2lnk, edge_bank, initialSD) : computeContigPositions(second, first, cte, ctg2srt, ctg2ort, ctg2lnk, edge_bank, initialSD));
+            int32_t result = (myID == cte.getContigs().first ? computeContigPositions(first, second, cte, ctg2srt, ctg2ort, ctg2lnk, edge_table, initialSD) : computeContigPositions(second, first, cte, ctg2srt, ctg2ort, ctg2lnk, edge_table, initialSD));
  
             if (result == INVALID_EDGE) {
                if (allowBad == false) {
@@ -601,10 +596,10 @@ int32_t computeContigPositionUsingAllEdges(ID_t myID,
        	       // mark edge as bad
                cerr << "BAD DST EDGE: " << cte.getIID() << " between " << cte.getContigs().first << " and " << cte.getContigs().second << " with dist " << cte.getSize() << " and std " << cte.getSD() << " and the orientation is " << cte.getAdjacency() << endl;
                // update the edge in the bank so it is marked bad
-               setEdgeStatus(cte, edge_bank, BAD_DST);
+               setEdgeStatus(cte, edge_table, BAD_DST);
             } else {
                if (allowBad == false) {
-                  if (verifyEdgeStatus(first, s, ctg2srt, ctg2ort, ctg2lnk, edge_bank, contig_bank) == false) {
+                  if (verifyEdgeStatus(first, s, ctg2srt, ctg2ort, ctg2lnk, edge_table, contig_bank) == false) {
                      cerr << "CANT MOVE NODES " << first.getIID() << " AND " << second.getIID() << " ANY CLOSER IT MESSES UP AN EDGE" << endl;
                      ctg2srt[myID] = oldPosition;
                      break;
@@ -612,7 +607,7 @@ int32_t computeContigPositionUsingAllEdges(ID_t myID,
                }
 
                // update the edge in the bank so it is marked good
-               setEdgeStatus(cte, edge_bank, GOOD_EDGE);
+               setEdgeStatus(cte, edge_table, GOOD_EDGE);
             }
          }
       }
@@ -620,6 +615,8 @@ int32_t computeContigPositionUsingAllEdges(ID_t myID,
          ctg2srt[myID] = oldPosition;
       }
    }
+
+   return 0;
 }
 
 void addTile(std::vector<Tile_t> &tiles, ID_t contig, Tile_t &newTile) {
@@ -641,11 +638,9 @@ void addTile(std::vector<Tile_t> &tiles, ID_t contig, Tile_t &newTile) {
    if (insert) { tiles.push_back(newTile); }
 }
 
-bool validateNeighbors(ID_t node, set<ID_t, EdgeWeightCmp>& neighbors, Bank_t &edge_bank, set<ID_t> &mySet, validateNeighborType type, bool validateLowWeight) {
-   ContigEdge_t cte;
-
-   for (set<ID_t>::iterator i = neighbors.begin(); i != neighbors.end(); i++) {
-      edge_bank.fetch(*i, cte);
+bool validateNeighbors(ID_t node, const EdgeAdjacency::EdgeList &neighbors, EdgeTable &edge_table, set<ID_t> &mySet, validateNeighborType type, bool validateLowWeight) {
+   for (EdgeAdjacency::EdgeList::const_iterator i = neighbors.begin(); i != neighbors.end(); i++) {
+      const ContigEdge_t &cte = edge_table.get(*i);
       if (isBadEdge(cte)) {
          if (cte.getStatus() != BAD_SKIP || !validateLowWeight) { 
             continue; 
@@ -667,14 +662,14 @@ bool validateNeighbors(ID_t node, set<ID_t, EdgeWeightCmp>& neighbors, Bank_t &e
    return true;
 }
 
-ID_t findNeighborOfNeighbors(ID_t node, ID_t source, set<ID_t, EdgeWeightCmp>& neighbors, Bank_t &edge_bank, set<ID_t> &lowWeight, bool &validateLowWeight, uint32_t &numNeighbors) {
+ID_t findNeighborOfNeighbors(ID_t node, ID_t source, const EdgeAdjacency::EdgeList &neighbors, EdgeTable &edge_table, set<ID_t> &lowWeight, bool &validateLowWeight, uint32_t &numNeighbors) {
    //uint32_t numNeighbors = 0;
    ID_t sink = 0;
    ContigEdge_t cte;
    uint32_t badEdges = 0;
       
-   for (set<ID_t>::iterator i = neighbors.begin(); i != neighbors.end(); i++) {
-      edge_bank.fetch(*i, cte);
+   for (EdgeAdjacency::EdgeList::const_iterator i = neighbors.begin(); i != neighbors.end(); i++) {
+      edge_table.fetch(*i, cte);
       if (isBadEdge(cte)) {
          if (cte.getStatus() == BAD_SKIP && cte.getContigs().first == node) {
             badEdges++;
@@ -695,8 +690,8 @@ ID_t findNeighborOfNeighbors(ID_t node, ID_t source, set<ID_t, EdgeWeightCmp>& n
 
    if (numNeighbors == 0 && badEdges > 0) {
       // check if our low weight edges can let us restore the connection, if so do it
-      for (set<ID_t>::iterator i = neighbors.begin(); i != neighbors.end(); i++) {
-         edge_bank.fetch(*i, cte);
+      for (EdgeAdjacency::EdgeList::const_iterator i = neighbors.begin(); i != neighbors.end(); i++) {
+         edge_table.fetch(*i, cte);
          if (cte.getStatus() == BAD_SKIP) { 
             // continue by looking at the outgoing edge neighbors
             if (cte.getContigs().first == node) {
@@ -781,9 +776,9 @@ double mergeContigs(ID_t scfIID,
 		  ID_t& maxEdgeIID,
                   set<ID_t> &toMerge, ID_t source, 
                   vector<Tile_t> &tiles, vector<ID_t> &edges, 
-                  Bank_t &edge_bank, /*string comment,*/
+                  EdgeTable &edge_table, /*string comment,*/
                   hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> >& ctg2ort,
-                  hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk,
+                  EdgeAdjacency &ctg2lnk,
                   vector<Motif_t> &motifs,
                   Status_t status) {
    hash_map<Pos_t, uint32_t, hash<Pos_t>, equal_to<Pos_t> > newTileGapIndex;
@@ -914,11 +909,9 @@ double mergeContigs(ID_t scfIID,
    contigOrientation newTileOrient = NONE;
 
    // now update the edges
-   set<ID_t, EdgeWeightCmp>* s = ctg2lnk[newTile.source];
-   if (s == NULL) { s = new set<ID_t, EdgeWeightCmp>();}
    for (vector<ID_t>::iterator i = edges.begin(); i < edges.end(); ) {
       ContigEdge_t cte;
-      edge_bank.fetch(*i, cte);
+      edge_table.fetch(*i, cte);
       bool skipEdge = true;
 
       // while we're at it, orient by the first edge we see to the source contig since they should all be consistent edges
@@ -931,7 +924,7 @@ double mergeContigs(ID_t scfIID,
       stream << maxEdgeIID++;
       oldEdge.setIID(maxEdgeIID);
       oldEdge.setEID(stream.str());
-cerr << "CREATED COPY OF EDGE " << cte.getIID() << " WITH ID " << oldEdge.getIID() << " FROM " << edge_bank.getIDMapSize() << endl;
+cerr << "CREATED COPY OF EDGE " << cte.getIID() << " WITH ID " << oldEdge.getIID() << " FROM " << edge_table.getSize() << endl;
       set<ID_t>::iterator it = toMerge.find(cte.getContigs().first);
       if (it != toMerge.end()) {
          // since we're the first node, adjust the size based on our distance to the end of the new contig
@@ -948,25 +941,24 @@ cerr << "CREATED COPY OF EDGE " << cte.getIID() << " WITH ID " << oldEdge.getIID
       }
 
       if (skipEdge == false) {
-         edge_bank.append(oldEdge);
+         edge_table.append(oldEdge);
          motifEdges.push_back(oldEdge.getIID());
          if (cte.getContigs().first == cte.getContigs().second) {
             if (globals.debug >= 3) { cerr << "REMOVING EDGE " << (*i) << endl; }
-            edge_bank.remove(*i);
+            edge_table.remove(*i);
             i = edges.erase(i);
          } else {
             if (globals.debug >= 3) { cerr << "UPDATING EDGE " << (*i) << endl; }
-            edge_bank.replace(*i, cte);
+            edge_table.replace(*i, cte);
 
             // update edge links for the new node we created
-            s->insert(cte.getIID());
+            ctg2lnk.insert(newTile.source, cte.getIID(), cte.getContigLinks().size());
             i++;
          }
       } else {
          i++;
       }
    }
-   ctg2lnk[newTile.source] = s;
    
    std::ostringstream result;
    result << newIID;
@@ -988,7 +980,7 @@ cerr << "CREATED COPY OF EDGE " << cte.getIID() << " WITH ID " << oldEdge.getIID
    return (double)totalOverlap / newTile.range.getLength();
 }
 
-void validateMotif(set<ID_t> &t, ID_t source, ID_t sink, bool validateLowWeight, Bank_t &edge_bank, hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk) {
+void validateMotif(set<ID_t> &t, ID_t source, ID_t sink, bool validateLowWeight, EdgeTable &edge_table, EdgeAdjacency &ctg2lnk) {
    // double check that all the nodes have no incoming/outgoing edges outside the set
    // note that for the source we can have incoming edges and for outgoing we can have outgoing
    for (set<ID_t>::iterator k = t.begin(); k != t.end(); k++) {
@@ -997,13 +989,13 @@ void validateMotif(set<ID_t> &t, ID_t source, ID_t sink, bool validateLowWeight,
       if (*k != 0) {
          if (*k == source) {
             if (globals.debug >= 3) { cerr << "Validating source " << *k << endl; }
-            validated = validateNeighbors(source, *ctg2lnk[source], edge_bank, t, OUTGOING, validateLowWeight);
+            validated = validateNeighbors(source, ctg2lnk.getEdges(source), edge_table, t, OUTGOING, validateLowWeight);
          } else if (*k == sink) {
             if (globals.debug >= 3) { cerr << "Validating sink " << *k << endl; }
-            validated = validateNeighbors(sink, *ctg2lnk[sink], edge_bank, t, INCOMING, validateLowWeight);
+            validated = validateNeighbors(sink, ctg2lnk.getEdges(sink), edge_table, t, INCOMING, validateLowWeight);
          } else {
             if (globals.debug >= 3) { cerr << "Validating node " << *k << endl; }
-            validated = validateNeighbors(*k, *ctg2lnk[*k], edge_bank, t, ALL, validateLowWeight);
+            validated = validateNeighbors(*k, ctg2lnk.getEdges(*k), edge_table, t, ALL, validateLowWeight);
          }
          if (validated == false) {
             if (globals.debug >= 3) {
@@ -1023,12 +1015,12 @@ void validateMotif(set<ID_t> &t, ID_t source, ID_t sink, bool validateLowWeight,
 
 void reduceGraph(std::vector<Scaffold_t>& scaffs, 
                  Bank_t &contig_bank, 
-                 Bank_t &edge_bank,
+                 EdgeTable &edge_table,
                  hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> >& ctg2ort,
-                 hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk,
+                 EdgeAdjacency &ctg2lnk,
                  vector<Motif_t> &motifs) {
    ID_t maxIID = contig_bank.getMaxIID()+1;
-   ID_t maxEdgeIID = edge_bank.getMaxIID()+1;
+   ID_t maxEdgeIID = edge_table.getMaxIID()+1;
    uint32_t numUpdated = 0;
    uint32_t itNum = 0;
 
@@ -1055,9 +1047,10 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                while (extendPath) {
                   uint32_t numOut = 0;
                   uint32_t numIn = 0;
-                  for (set<ID_t>::iterator j = ctg2lnk[curr]->begin(); j != ctg2lnk[curr]->end(); j++) {
+                  EdgeAdjacency::EdgeList lnk = ctg2lnk.getEdges(curr);
+                  for (EdgeAdjacency::EdgeList::const_iterator j = lnk.begin(); j != lnk.end(); j++) {
                      ContigEdge_t cte;
-                     edge_bank.fetch(*j, cte);
+                     edge_table.fetch(*j, cte);
 
                      if (isBadEdge(cte)) { continue; }
                      if (cte.getContigs().first == curr) {
@@ -1090,10 +1083,10 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                   }
                   cerr << endl;
                }
-               validateMotif(t, i->source, curr, false, edge_bank, ctg2lnk);
+               validateMotif(t, i->source, curr, false, edge_table, ctg2lnk);
                if (t.size() > 1) {
                   if (globals.debug >= 1) { cerr << "COLLAPSING LINEAR PATH : " << endl; }
-                  mergeContigs(s->getIID(), maxIID++, maxEdgeIID, t, i->source, s->getContigTiling(), s->getContigEdges(), edge_bank, ctg2ort, ctg2lnk, motifs, LINEAR_SCAFFOLD);               
+                  mergeContigs(s->getIID(), maxIID++, maxEdgeIID, t, i->source, s->getContigTiling(), s->getContigEdges(), edge_table, ctg2ort, ctg2lnk, motifs, LINEAR_SCAFFOLD);               
                } else {
                   i++;
                }
@@ -1132,9 +1125,10 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                   // see if we can find a motif
                   // the function below is allowed to use low weight edges we eliminated to try to make the motif
                   // if it uses low weight edges, all low weight edges in the set must still be a motif and will be reset to good
-                  for (set<ID_t>::iterator j = ctg2lnk[i->source]->begin(); j != ctg2lnk[i->source]->end(); j++) {
+                  EdgeAdjacency::EdgeList lnk = ctg2lnk.getEdges(i->source);
+                  for (EdgeAdjacency::EdgeList::const_iterator j = lnk.begin(); j != lnk.end(); j++) {
                      ContigEdge_t cte;
-                     edge_bank.fetch(*j, cte);
+                     edge_table.fetch(*j, cte);
    
                      if (isBadEdge(cte)) {
                         if (cte.getStatus() == BAD_SKIP && cte.getContigs().first == i->source) {
@@ -1152,9 +1146,10 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                         // 2-deep motif code
                         ID_t neighbor = 0;
                         
-                        for (set<ID_t>::iterator k = ctg2lnk[cte.getContigs().second]->begin(); k != ctg2lnk[cte.getContigs().second]->end(); k++) {
+                        EdgeAdjacency::EdgeList nextLnk = ctg2lnk.getEdges(cte.getContigs().second);
+                        for (EdgeAdjacency::EdgeList::const_iterator k = nextLnk.begin(); k != nextLnk.end(); k++) {
                            ContigEdge_t nextCte;
-                           edge_bank.fetch(*k, nextCte);
+                           edge_table.fetch(*k, nextCte);
                            if (isBadEdge(nextCte)) {
                               if (nextCte.getStatus() == BAD_SKIP && nextCte.getContigs().first == i->source) {
                                  badEdges++;
@@ -1171,7 +1166,7 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                            if (nextCte.getContigs().first == cte.getContigs().second) {
                               uint32_t numNeighbors = 0;
                               ID_t otherID = getEdgeDestination(cte.getContigs().second, nextCte);
-                              neighbor = findNeighborOfNeighbors(otherID, cte.getContigs().second, *ctg2lnk[otherID], edge_bank, skippedEdges, validateSkippedEdges, numNeighbors);
+                              neighbor = findNeighborOfNeighbors(otherID, cte.getContigs().second, ctg2lnk.getEdges(otherID), edge_table, skippedEdges, validateSkippedEdges, numNeighbors);
 
 // hack to get nodes that dead-end as motifs
                               if (neighbor != 0 || (neighbor == 0 && numNeighbors == 0)) {
@@ -1193,7 +1188,7 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                         /* Original motif code
                         if (globals.debug >= 3) { cerr << "Checking neighbor for edge " << cte.getContigs().first << " to " << cte.getContigs().second << endl; }
                         ID_t otherID = getEdgeDestination(i->source, cte);
-                        ID_t neighbor = findNeighborOfNeighbors(otherID, i->source, *ctg2lnk[otherID], edge_bank, skippedEdges, validateSkippedEdges);
+                        ID_t neighbor = findNeighborOfNeighbors(otherID, i->source, ctg2lnk.getEdges(otherID), edge_table, skippedEdges, validateSkippedEdges);
    
                         if (neighbor != 0) {
                            if (globals.debug >= 3) { cerr << "Found neighbor " << neighbor << " and sink is " << sink << endl; }
@@ -1212,7 +1207,7 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                      }
                   }
                   oss << sink << " ";
-                  validateMotif(t, i->source, sink, validateSkippedEdges, edge_bank, ctg2lnk);
+                  validateMotif(t, i->source, sink, validateSkippedEdges, edge_table, ctg2lnk);
 
                   // try 1-deep motifs 
                   if (t.size() == 0) {
@@ -1225,9 +1220,10 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                      // see if we can find a motif
                      // the function below is allowed to use low weight edges we eliminated to try to make the motif
                      // if it uses low weight edges, all low weight edges in the set must still be a motif and will be reset to good
-                     for (set<ID_t>::iterator j = ctg2lnk[i->source]->begin(); j != ctg2lnk[i->source]->end(); j++) {
+                     EdgeAdjacency::EdgeList lnk = ctg2lnk.getEdges(i->source);
+                     for (EdgeAdjacency::EdgeList::const_iterator j = lnk.begin(); j != lnk.end(); j++) {
                         ContigEdge_t cte;
-                        edge_bank.fetch(*j, cte);
+                        edge_table.fetch(*j, cte);
       
                         if (isBadEdge(cte)) {
                            if (cte.getStatus() == BAD_SKIP && cte.getContigs().first == i->source) {
@@ -1245,7 +1241,7 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                            ID_t otherID = getEdgeDestination(i->source, cte);
                            uint32_t numNeighbors = 0;
                            
-                           neighbor = findNeighborOfNeighbors(otherID, i->source, *ctg2lnk[otherID], edge_bank, skippedEdges, validateSkippedEdges, numNeighbors);
+                           neighbor = findNeighborOfNeighbors(otherID, i->source, ctg2lnk.getEdges(otherID), edge_table, skippedEdges, validateSkippedEdges, numNeighbors);
                            if (neighbor != 0 || (neighbor == 0 && numNeighbors == 0)) {
                               if (neighbor == sink || sink == 0) {
                                  sink = neighbor;
@@ -1263,7 +1259,7 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                      skippedEdges.insert(skippedTwoDeepEdges.begin(), skippedTwoDeepEdges.end());
                   }
                   oss << sink << " ";
-                  validateMotif(t, i->source, sink, validateSkippedEdges, edge_bank, ctg2lnk);
+                  validateMotif(t, i->source, sink, validateSkippedEdges, edge_table, ctg2lnk);
 
                   if (t.size() == 0 && badEdges != 0) {
                      redoWithBadEdges = validateSkippedEdges = true;
@@ -1278,8 +1274,8 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
                   }
                   // merge the contigs, if we were able to rescue low-weight edges, mark them
                   numUpdated++;
-                  if (validateSkippedEdges) { resetEdges(edge_bank, skippedEdges, BAD_SKIP); }
-                  double overlapInMotif = mergeContigs(s->getIID(), maxIID++, maxEdgeIID, t, i->source, s->getContigTiling(), s->getContigEdges(), edge_bank, ctg2ort, ctg2lnk, motifs, MOTIF_SCAFFOLD);
+                  if (validateSkippedEdges) { resetEdges(edge_table, skippedEdges, BAD_SKIP); }
+                  double overlapInMotif = mergeContigs(s->getIID(), maxIID++, maxEdgeIID, t, i->source, s->getContigTiling(), s->getContigEdges(), edge_table, ctg2ort, ctg2lnk, motifs, MOTIF_SCAFFOLD);
 
                   if (globals.debug >= 1) {
                      cerr << " WITH OVERLAP " << overlapInMotif << " HAS BEEN REPLACED WITH SINGLE NODE " << (maxIID-1) << endl;
@@ -1297,7 +1293,7 @@ void reduceGraph(std::vector<Scaffold_t>& scaffs,
 void sortContigs(std::vector<Scaffold_t>& scaffs, 
               hash_map<ID_t, int32_t, hash<ID_t>, equal_to<ID_t> >& ctg2srt,
               hash_map<ID_t, Size_t, hash<ID_t>, equal_to<ID_t> > &ctg2len,
-              Bank_t &contig_bank, Bank_t &edge_bank) {
+              Bank_t &contig_bank, EdgeTable &edge_table) {
    for(vector<Scaffold_t>::iterator s = scaffs.begin(); s < scaffs.end(); s++) {
       Pos_t adjust = UNINITIALIZED;
       hash_map<ID_t, Pos_t, hash<ID_t>, equal_to<ID_t> > locations;
@@ -1323,12 +1319,12 @@ void sortContigs(std::vector<Scaffold_t>& scaffs,
       // here adjust the edges too so they all point from current to next since it is earlier in scaff
       for (vector<ID_t>::iterator i = s->getContigEdges().begin(); i < s->getContigEdges().end(); i++) {
          ContigEdge_t cte;     
-         edge_bank.fetch(*i, cte);
+         edge_table.fetch(*i, cte);
          
          // reverse edge if necessary
          if (locations[cte.getContigs().second] <= locations[cte.getContigs().first]) {
             swapContigs(cte, orientations[cte.getContigs().first], orientations[cte.getContigs().second], ctg2len[cte.getContigs().first], ctg2len[cte.getContigs().second]);
-            edge_bank.replace(*i, cte);
+            edge_table.replace(*i, cte);
          }
       }
    }   
@@ -1338,10 +1334,10 @@ void compressGaps(std::vector<Scaffold_t> &scaffs,
               hash_map<ID_t, int32_t, hash<ID_t>, equal_to<ID_t> >& ctg2srt,
               hash_map<ID_t, Size_t, hash<ID_t>, equal_to<ID_t> > &ctg2len,
               hash_map<ID_t, contigOrientation, hash<ID_t>, equal_to<ID_t> >& ctg2ort,
-              hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > &ctg2lnk,
-              Bank_t &edge_bank, Bank_t &contig_bank) {
+              EdgeAdjacency &ctg2lnk,
+              EdgeTable &edge_table, Bank_t &contig_bank) {
 
-   sortContigs(scaffs, ctg2srt, ctg2len, contig_bank, edge_bank);
+   sortContigs(scaffs, ctg2srt, ctg2len, contig_bank, edge_table);
    for(vector<Scaffold_t>::iterator s = scaffs.begin(); s < scaffs.end(); s++) {
       Pos_t adjust = UNINITIALIZED;
       hash_map<ID_t, Pos_t, hash<ID_t>, equal_to<ID_t> > locations;
@@ -1352,7 +1348,7 @@ void compressGaps(std::vector<Scaffold_t> &scaffs,
          int32_t pos = ctg2srt[i->source];
          double sd = 0;
          while (pos == ctg2srt[i->source] && sd < INITIAL_STDEV) {
-            computeContigPositionUsingAllEdges(i->source, ctg2srt, ctg2ort, ctg2lnk, edge_bank, contig_bank, sd, false);
+            computeContigPositionUsingAllEdges(i->source, ctg2srt, ctg2ort, ctg2lnk, edge_table, contig_bank, sd, false);
             sd++;
          }
          i->offset = (i->range.isReverse() ? ctg2srt[i->source] - i->range.getLength() : ctg2srt[i->source]);
@@ -1392,6 +1388,8 @@ int main(int argc, char *argv[]) {
       edge_bank.close();
       exit(1);
    }
+   EdgeTable edge_table;
+   edge_table.load(edge_bank);
    
    Bank_t contig_bank (Contig_t::NCODE);
    BankStream_t contig_stream (Contig_t::NCODE);
@@ -1459,8 +1457,8 @@ int main(int argc, char *argv[]) {
 
    // initialize edge data structures
    hash_map<ID_t, bool, hash<ID_t>, equal_to<ID_t> > visitedEdges;
-   hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> > ctg2lnk;     // map from contig to edges
-   cte2weight = new hash_map<ID_t, int32_t, hash<ID_t>, equal_to<ID_t> >();
+   EdgeAdjacency ctg2lnk;                                                  // map from contig to edges
+   vector<ID_t> linkedEdges;
 
    uint32_t badCount = 0, goodCount = 0;
    ContigEdge_t cte;
@@ -1469,8 +1467,8 @@ int main(int argc, char *argv[]) {
    double mean = 0;
    double count = 0;
    if (globals.redundancy == 0) {
-      for (AMOS::IDMap_t::const_iterator ci = edge_bank.getIDMap().begin(); ci; ci++) {
-         edge_bank.fetch(ci->iid, cte);
+      for (uint32_t i = 0; i < edge_table.size(); i++) {
+         cte = edge_table.at(i);
 
          if (isBadEdge(cte)) {
             continue;
@@ -1499,8 +1497,8 @@ int main(int argc, char *argv[]) {
    // If we wanted to process edges sequentially, we can insert a loop here
    // However, this requires a merge scaffolds function as we may see a new edge linking two separate scaffolds so all the scaffolds need to be rectified again
    // Therefore, it doesn't seem to be simpler than implementing least squares
-   for (AMOS::IDMap_t::const_iterator ci = edge_bank.getIDMap().begin(); ci; ci++) {
-      edge_bank.fetch(ci->iid, cte);
+   for (uint32_t i = 0; i < edge_table.size(); i++) {
+      cte = edge_table.at(i);
 
       if (isBadEdge(cte)) {
          cerr << "Edge " << cte.getIID() << " ALREADY MARKED BAD, SKIPPING" << endl;
@@ -1512,14 +1510,14 @@ int main(int argc, char *argv[]) {
          if (globals.debug >= 0) {
             cerr << "WARNING: IGNORING EDGE " << cte.getIID() << " between " << cte.getContigs().first << " and " << cte.getContigs().second << " because one was listed as a repeat" << endl;;
          }
-         setEdgeStatus(cte, edge_bank, BAD_RPT, false);
+         setEdgeStatus(cte, edge_table, BAD_RPT);
          continue;
       }
 
 
      if (globals.maxOverlap > 0 && cte.getSize() + globals.maxOverlap < 0 && cte.getSize() < globals.maxOverlap) {
         cerr << "WARNING: IGNORING EDGE " << cte.getIID() << " between " << cte.getContigs().first << " and " << cte.getContigs().second << " because it is below overlap threshold of " << globals.maxOverlap << endl;
-        setEdgeStatus(cte, edge_bank, BAD_THRESH, false);
+        setEdgeStatus(cte, edge_table, BAD_THRESH);
         continue;
       }
 
@@ -1530,7 +1528,7 @@ int main(int argc, char *argv[]) {
          if (globals.debug >= 0) { 
             cerr << "WARNING: link " << cte.getIID() << " (" << cte.getContigs().first << ", " << cte.getContigs().second << ") is too low weight: " << cte.getLinks().size() << " cutoff was: " << globals.redundancy << endl;
          }
-         setEdgeStatus(cte, edge_bank, BAD_THRESH, false);
+         setEdgeStatus(cte, edge_table, BAD_THRESH);
          continue;
       }
       if (cte.getIID() == 0 || cte.getContigs().first == 0 || cte.getContigs().second == 0) {
@@ -1538,21 +1536,13 @@ int main(int argc, char *argv[]) {
          if (globals.debug >= 0) {
             cerr << "WARNING: link " << cte.getIID() << " (" << cte.getContigs().first << ", " << cte.getContigs().second << ") connects to a singleton, it is being ignored" << endl;
          }
-         setEdgeStatus(cte, edge_bank, BAD_THRESH, false);
+         setEdgeStatus(cte, edge_table, BAD_THRESH);
          continue;
       }
-      (*cte2weight)[cte.getIID()] = cte.getContigLinks().size();
-      set<ID_t, EdgeWeightCmp>* s = ctg2lnk[cte.getContigs().first];
-      if (s == NULL) { s = new set<ID_t, EdgeWeightCmp>();}
-      s->insert(cte.getIID());
-      ctg2lnk[cte.getContigs().first] = s;
-
-      s = ctg2lnk[cte.getContigs().second];
-      if (s == NULL) { s = new set<ID_t, EdgeWeightCmp>();};
-      s->insert(cte.getIID());
-      ctg2lnk[cte.getContigs().second] = s;
+      linkedEdges.push_back(cte.getIID());
    }
-   flushEdgeStatus(edge_bank);
+   ctg2lnk.build(edge_table, linkedEdges);
+   linkedEdges.clear();
    
    map<string, LinkAdjacency_t> ctg2edges;                                 // map from pair of contigs to edge type connecting them
                                                                            // need this so we can know that we picked an N edge and not a A edge for two contigs
@@ -1574,18 +1564,13 @@ int main(int argc, char *argv[]) {
    for (vector<ID_t>::iterator iter = contigProcessingOrder.begin(); iter != contigProcessingOrder.end(); iter++) {
       contig_bank.fetch(*iter, ctg);
 
-      // if we see any contigs without any edges, make sure we allocate an empty set of edges for them
-      if (ctg2lnk[ctg.getIID()] == NULL) {
-         ctg2lnk[ctg.getIID()] = new set<ID_t, EdgeWeightCmp>();
-      }
-
       // if we've already processed the node in this iteration, dont do it again
       if (visited[ctg.getIID()] == true) { continue; }
 
       tiles.clear();
       edges.clear();
                         
-      if (ctg2lnk[ctg.getIID()]->size() == 0) {
+      if (ctg2lnk.getEdges(ctg.getIID()).size() == 0) {
          continue;
       }
 
@@ -1609,11 +1594,11 @@ int main(int argc, char *argv[]) {
 
 int max = 0;
          // keep track of max weight edge for this contig, if we drop too low, ignore it
-         set<ID_t, EdgeWeightCmp>* s = ctg2lnk[myID];
-         for (set<ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
+         EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(myID);
+         for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
             //TODO: CA links incorporated as links with ID 0. Should they be skipped since we generate our own?
             checkEdgeID(*i);
-            edge_bank.fetch(*i, cte);
+            edge_table.fetch(*i, cte);
             checkEdge(cte);
             ID_t otherID = getEdgeDestination(myID, cte);
 
@@ -1643,7 +1628,7 @@ if (max < cte.getLinks().size()) { max = cte.getLinks().size(); }
             }
 
             // orient the node
-            contigOrientation orient = getOrientationByAllEdges(otherID, ctg2ort, ctg2lnk, edge_bank);
+            contigOrientation orient = getOrientationByAllEdges(otherID, ctg2ort, ctg2lnk, edge_table);
             // add the edge
             if (visitedEdges[cte.getIID()] == 0) {
                std::stringstream oss;
@@ -1654,14 +1639,14 @@ if (max < cte.getLinks().size()) { max = cte.getLinks().size(); }
                   cerr << "LOOKING AT EDGE BETWEEEN " << cte.getContigs().second << " and " << cte.getContigs().first << endl;
                }
 
-               double maxWeight = (getMaxWeightEdge(myID, ctg2lnk, edge_bank) < getMaxWeightEdge(otherID, ctg2lnk, edge_bank) ? getMaxWeightEdge(otherID, ctg2lnk, edge_bank) : getMaxWeightEdge(myID, ctg2lnk, edge_bank));
+               double maxWeight = (getMaxWeightEdge(myID, ctg2lnk, edge_table) < getMaxWeightEdge(otherID, ctg2lnk, edge_table) ? getMaxWeightEdge(otherID, ctg2lnk, edge_table) : getMaxWeightEdge(myID, ctg2lnk, edge_table));
                if (globals.debug >= 1) {
                   cerr << "PROCESSING EDGE WITH ID " << cte.getIID() << " BETWEEN CONTIGS " << cte.getContigs().first << " AND " << cte.getContigs().second << " WEIGHT " << cte.getLinks().size() << " LAST WEIGHT WAS " << maxWeight << " AND INT VERSION OF LAST IS " << round((double)maxWeight / 4) << endl;
                }
 
                if (globals.skipLowWeightEdges && (double)cte.getLinks().size() / (double)maxWeight <= 0.15) {
                   if (globals.debug >= 1) { cerr << "SKIPPING EDGE " << cte.getIID() << endl; }
-                  setEdgeStatus(cte, edge_bank, BAD_SKIP);
+                  setEdgeStatus(cte, edge_table, BAD_SKIP);
                   badCount++;
                }
                // determine bad edges
@@ -1677,19 +1662,19 @@ if (max < cte.getLinks().size()) { max = cte.getLinks().size(); }
                   badCount++;
                   
                   // update the edge in the bank so it is marked bad
-                  setEdgeStatus(cte, edge_bank, BAD_ORI);
+                  setEdgeStatus(cte, edge_table, BAD_ORI);
                }
                // an edge linking to a node in another scaffold is a bad scaffold edge
                else if (ctg2scf[otherID] != UNINITIALIZED && ctg2scf[otherID] != scfIID) {
-                  setEdgeStatus(cte, edge_bank, BAD_SCF);
+                  setEdgeStatus(cte, edge_table, BAD_SCF);
                   badCount++;
                }
                else {
                   ctg2ort[otherID] = orient;
                   ctg2edges[oss.str()] = cte.getAdjacency();
 
-                  computeContigPositionUsingAllEdges(otherID, ctg2srt, ctg2ort, ctg2lnk, edge_bank, contig_bank, INITIAL_STDEV, true);
-                  if (!isBadEdge(cte.getIID(), edge_bank)) {
+                  computeContigPositionUsingAllEdges(otherID, ctg2srt, ctg2ort, ctg2lnk, edge_table, contig_bank, INITIAL_STDEV, true);
+                  if (!isBadEdge(cte.getIID(), edge_table)) {
                      // add tiling info
                      // offset is always in terms of the lowest position in scaffold of the contig, that is if we have ---> <---- then the offset of the second
                      // contig is computed from the head of the arrow, not the tail
@@ -1794,18 +1779,19 @@ if (max < cte.getLinks().size()) { max = cte.getLinks().size(); }
    }
 
    // compress gap if we can
-   compressGaps(scaffs, ctg2srt, ctg2len, ctg2ort, ctg2lnk, edge_bank, contig_bank);
+   compressGaps(scaffs, ctg2srt, ctg2len, ctg2ort, ctg2lnk, edge_table, contig_bank);
 
    // preform graph simplification
-   sortContigs(scaffs, ctg2srt, ctg2len, contig_bank, edge_bank);
+   sortContigs(scaffs, ctg2srt, ctg2len, contig_bank, edge_table);
 
    if (globals.debug >= 1) { cerr << "BEGIN COMPRESSION" << endl; }
    if (globals.compressMotifs == true) {
-      transitiveEdgeRemoval(scaffs, edge_bank, ctg2lnk, globals.debug);
+      transitiveEdgeRemoval(scaffs, edge_table, ctg2lnk, globals.debug);
       // allow low-weight edges to be rescued
       AMOS::ContigEdge_t cte;
-      for (AMOS::IDMap_t::const_iterator ci = edge_bank.getIDMap().begin(); ci; ci++) {
-         edge_bank.fetch(ci->iid, cte);
+      for (uint32_t i = 0; i < edge_table.size(); i++) {
+         if (edge_table.isRemoved(i)) { continue; }
+         cte = edge_table.at(i);
          
          // TODO: ideally this shouldn't rely on the ctg2srt hash table but instead look it up in the scaffold tiling
          // for that we need to find which scaffold contains the tile
@@ -1817,17 +1803,16 @@ if (max < cte.getLinks().size()) { max = cte.getLinks().size(); }
 
             edgeStatus st = isEdgeConsistent(first, second, cte, ctg2ort, ctg2srt, ctg2scf);
             st = (st == GOOD_EDGE ? BAD_SKIP : st);
-            setEdgeStatus(cte, edge_bank, st, false);
+            setEdgeStatus(cte, edge_table, st);
             if (globals.debug >= 1) { cerr << "FOR SKIPPED EDGE " << cte.getIID() << " SET EDGE STATUS TO BE " << st << endl; }
          }
       }
-      flushEdgeStatus(edge_bank);
-      reduceGraph(scaffs, contig_bank, edge_bank, ctg2ort, ctg2lnk, motifs);
-      sortContigs(scaffs, ctg2srt, ctg2len, contig_bank, edge_bank);
+      reduceGraph(scaffs, contig_bank, edge_table, ctg2ort, ctg2lnk, motifs);
+      sortContigs(scaffs, ctg2srt, ctg2len, contig_bank, edge_table);
    }
    // reset the transitive edges because we may have collapsed nodes so old transitive edges are no longer transitive
-   //resetEdges(edge_bank, BAD_TRNS);
-   //transitiveEdgeRemoval(scaffs, edge_bank, ctg2lnk, globals.debug);
+   //resetEdges(edge_table, BAD_TRNS);
+   //transitiveEdgeRemoval(scaffs, edge_table, ctg2lnk, globals.debug);
    if (globals.debug >= 1) { cerr << "DONE COMPRESSION" << endl; }
 
    // finally output to the bank
@@ -1843,12 +1828,8 @@ if (max < cte.getLinks().size()) { max = cte.getLinks().size(); }
    ctg2scf.clear();
    ctg2srt.clear();
    ctg2ort.clear();
-   // clear the edge lists
-   for (hash_map<ID_t, set<ID_t, EdgeWeightCmp>*, hash<ID_t>, equal_to<ID_t> >::iterator i = ctg2lnk.begin(); i != ctg2lnk.end(); i++) {
-      delete (i->second);
-   }
-   delete(cte2weight);
 
+   edge_table.flush(edge_bank);
    edge_bank.close();
    contig_stream.close();
    contig_bank.close();
@@ -1,5 +1,7 @@
 #include <time.h>
 #include <math.h>
+#include <algorithm>
+#include <functional>
 
 #include "Utilities_Bundler.hh"
 
@@ -18,6 +20,156 @@ using namespace Bundler;
 HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > cte2bad;
 bool cte2badInit = false;
 
+void Bundler::EdgeTable::load(AMOS::Bank_t &edge_bank) {
+   std::vector<std::pair<AMOS::ID_t, uint32_t> > byBID;
+   std::vector<AMOS::ID_t> iids;
+
+   edges_m.clear();
+   state_m.clear();
+   index_m.clear();
+   maxIID_m = 0;
+
+   // keep the IDMap order but read the records in bank order so the partitions are scanned sequentially
+   for (AMOS::IDMap_t::const_iterator ci = edge_bank.getIDMap().begin(); ci; ci++) {
+      index_m[ci->iid] = iids.size();
+      byBID.push_back(std::pair<AMOS::ID_t, uint32_t>(ci->bid, iids.size()));
+      iids.push_back(ci->iid);
+      if (ci->iid > maxIID_m) { maxIID_m = ci->iid; }
+   }
+   std::sort(byBID.begin(), byBID.end());
+
+   edges_m.resize(iids.size());
+   state_m.resize(iids.size(), 0);
+   for (std::vector<std::pair<AMOS::ID_t, uint32_t> >::iterator i = byBID.begin(); i < byBID.end(); i++) {
+      edge_bank.fetch(iids[i->second], edges_m[i->second]);
+   }
+   loaded_m = live_m = edges_m.size();
+}
+
+void Bundler::EdgeTable::flush(AMOS::Bank_t &edge_bank) {
+   for (uint32_t i = 0; i < edges_m.size(); i++) {
+      if (i < loaded_m) {
+         if (state_m[i] & REMOVED) {
+            edge_bank.remove(edges_m[i].getIID());
+         } else if (state_m[i] & DIRTY) {
+            edge_bank.replace(edges_m[i].getIID(), edges_m[i]);
+         }
+      } else if (!(state_m[i] & REMOVED)) {
+         edge_bank.append(edges_m[i]);
+      }
+      state_m[i] &= ~DIRTY;
+   }
+   loaded_m = edges_m.size();
+}
+
+uint32_t Bundler::EdgeTable::lookup(AMOS::ID_t iid) const {
+   HASHMAP::hash_map<AMOS::ID_t, uint32_t, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >::const_iterator i = index_m.find(iid);
+   if (i == index_m.end() || (state_m[i->second] & REMOVED)) {
+      throw AMOS::ArgumentException_t("ID does not exist in the edge table", __LINE__, __FILE__);
+   }
+   return i->second;
+}
+
+const AMOS::ContigEdge_t &Bundler::EdgeTable::get(AMOS::ID_t iid) const {
+   return edges_m[lookup(iid)];
+}
+
+const AMOS::ContigEdge_t *Bundler::EdgeTable::find(AMOS::ID_t iid) const {
+   HASHMAP::hash_map<AMOS::ID_t, uint32_t, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >::const_iterator i = index_m.find(iid);
+   if (i == index_m.end() || (state_m[i->second] & REMOVED)) {
+      return NULL;
+   }
+   return &edges_m[i->second];
+}
+
+void Bundler::EdgeTable::append(const AMOS::ContigEdge_t &cte) {
+   if (index_m.find(cte.getIID()) != index_m.end()) {
+      throw AMOS::ArgumentException_t("ID already exists in the edge table", __LINE__, __FILE__);
+   }
+   index_m[cte.getIID()] = edges_m.size();
+   edges_m.push_back(cte);
+   state_m.push_back(DIRTY);
+   live_m++;
+   if (cte.getIID() > maxIID_m) { maxIID_m = cte.getIID(); }
+}
+
+void Bundler::EdgeTable::replace(AMOS::ID_t iid, const AMOS::ContigEdge_t &cte) {
+   uint32_t i = lookup(iid);
+   edges_m[i] = cte;
+   state_m[i] |= DIRTY;
+}
+
+void Bundler::EdgeTable::remove(AMOS::ID_t iid) {
+   HASHMAP::hash_map<AMOS::ID_t, uint32_t, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >::const_iterator i = index_m.find(iid);
+   if (i == index_m.end()) {
+      throw AMOS::ArgumentException_t("ID does not exist in the edge table", __LINE__, __FILE__);
+   }
+   if (!(state_m[i->second] & REMOVED)) {
+      state_m[i->second] |= REMOVED;
+      live_m--;
+   }
+}
+
+void Bundler::EdgeAdjacency::build(const EdgeTable &edge_table, const std::vector<AMOS::ID_t> &edges) {
+   // (node, weight, order added, edge) sorted so each node's edges come heaviest and newest first
+   std::vector<std::pair<std::pair<AMOS::ID_t, int32_t>, std::pair<int32_t, AMOS::ID_t> > > entries;
+
+   nodes_m.clear();
+   lists_m.clear();
+
+   for (std::vector<AMOS::ID_t>::const_iterator i = edges.begin(); i < edges.end(); i++) {
+      const AMOS::ContigEdge_t &cte = edge_table.get(*i);
+      int32_t weight = cte.getContigLinks().size();
+      int32_t order = entries.size();
+      entries.push_back(std::make_pair(std::make_pair(cte.getContigs().first, -weight), std::make_pair(-order, *i)));
+      entries.push_back(std::make_pair(std::make_pair(cte.getContigs().second, -weight), std::make_pair(-order - 1, *i)));
+   }
+   std::sort(entries.begin(), entries.end());
+
+   edges_m.resize(entries.size());
+   weights_m.resize(entries.size());
+   for (uint32_t i = 0; i < entries.size(); i++) {
+      AMOS::ID_t node = entries[i].first.first;
+      if (i == 0 || node != entries[i-1].first.first) {
+         nodes_m[node].first = i;
+      }
+      nodes_m[node].second = i + 1;
+      edges_m[i] = entries[i].second.second;
+      weights_m[i] = -entries[i].first.second;
+   }
+}
+
+void Bundler::EdgeAdjacency::insert(AMOS::ID_t node, AMOS::ID_t edge, int32_t weight) {
+   List &list = lists_m[node];
+
+   // move the node out of the packed lists the first time it changes
+   HASHMAP::hash_map<AMOS::ID_t, std::pair<uint32_t, uint32_t>, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >::iterator n = nodes_m.find(node);
+   if (n != nodes_m.end()) {
+      list.edges.assign(edges_m.begin() + n->second.first, edges_m.begin() + n->second.second);
+      list.weights.assign(weights_m.begin() + n->second.first, weights_m.begin() + n->second.second);
+      nodes_m.erase(n);
+   }
+
+   // after all heavier edges, ahead of edges of the same weight
+   uint32_t pos = std::lower_bound(list.weights.begin(), list.weights.end(), weight, std::greater<int32_t>()) - list.weights.begin();
+   list.edges.insert(list.edges.begin() + pos, edge);
+   list.weights.insert(list.weights.begin() + pos, weight);
+}
+
+Bundler::EdgeAdjacency::EdgeList Bundler::EdgeAdjacency::getEdges(AMOS::ID_t node) const {
+   HASHMAP::hash_map<AMOS::ID_t, List, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >::const_iterator l = lists_m.find(node);
+   if (l != lists_m.end()) {
+      return EdgeList(&l->second.edges[0], &l->second.weights[0], l->second.edges.size());
+   }
+
+   HASHMAP::hash_map<AMOS::ID_t, std::pair<uint32_t, uint32_t>, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >::const_iterator n = nodes_m.find(node);
+   if (n != nodes_m.end()) {
+      return EdgeList(&edges_m[n->second.first], &weights_m[n->second.first], n->second.second - n->second.first);
+   }
+
+   return EdgeList();
+}
+
 double Bundler::computeArrivalRate(const std::vector<AMOS::Contig_t *> &contigs) {
    double result = 0;
    int32_t numFragments = 0;
@@ -205,6 +357,11 @@ void Bundler::flushEdgeStatus(AMOS::Bank_t &edge_bank) {
    }
 }
 
+void Bundler::setEdgeStatus(AMOS::ContigEdge_t &cte, EdgeTable &edge_table, int status) {
+   cte.setStatus(status);
+   edge_table.replace(cte.getIID(), cte);
+}
+
 bool Bundler::isBadEdge(AMOS::ID_t cteID, AMOS::Bank_t &edge_bank) {
    if (cte2badInit == false) {
       AMOS::ContigEdge_t cte;
@@ -218,6 +375,12 @@ bool Bundler::isBadEdge(AMOS::ID_t cteID, AMOS::Bank_t &edge_bank) {
    return (cte2bad[cteID] != GOOD_EDGE && cte2bad[cteID] != NULL_STATUS);
 }
 
+bool Bundler::isBadEdge(AMOS::ID_t cteID, const EdgeTable &edge_table) {
+   const AMOS::ContigEdge_t *cte = edge_table.find(cteID);
+
+   return (cte != NULL && isBadEdge(*cte));
+}
+
 bool Bundler::isBadEdge(const AMOS::ContigEdge_t &cte) {
    if (cte.getStatus() != GOOD_EDGE && cte.getStatus() != NULL_STATUS) {
       return true;
@@ -226,23 +389,24 @@ bool Bundler::isBadEdge(const AMOS::ContigEdge_t &cte) {
    return false;
 }
 
-void Bundler::resetEdges(AMOS::Bank_t &edge_bank, edgeStatus toChange) {
+void Bundler::resetEdges(EdgeTable &edge_table, edgeStatus toChange) {
    AMOS::ContigEdge_t cte;
-   for (AMOS::IDMap_t::const_iterator ci = edge_bank.getIDMap().begin(); ci != edge_bank.getIDMap().end(); ci++) {
-      edge_bank.fetch(ci->iid, cte);
+   for (uint32_t i = 0; i < edge_table.size(); i++) {
+      if (edge_table.isRemoved(i)) { continue; }
+      cte = edge_table.at(i);
 
       if (cte.getStatus() == toChange) {
-         setEdgeStatus(cte, edge_bank, GOOD_EDGE);
+         setEdgeStatus(cte, edge_table, GOOD_EDGE);
       }
    }
 }
    
-void Bundler::resetEdges(AMOS::Bank_t &edge_bank, std::set<AMOS::ID_t> &edges, edgeStatus toChange) {
+void Bundler::resetEdges(EdgeTable &edge_table, std::set<AMOS::ID_t> &edges, edgeStatus toChange) {
    AMOS::ContigEdge_t cte;
    for (std::set<AMOS::ID_t>::iterator i = edges.begin(); i != edges.end(); i++) {
-      edge_bank.fetch(*i, cte);
+      edge_table.fetch(*i, cte);
       if (cte.getStatus() == toChange) {
-         setEdgeStatus(cte, edge_bank, GOOD_EDGE);
+         setEdgeStatus(cte, edge_table, GOOD_EDGE);
       }
    }
 }
@@ -277,8 +441,8 @@ struct EdgeTopoCmp
 };
 
 bool topoSortRecursive(AMOS::ID_t curr, 
-              AMOS::Bank_t &edge_bank,
-              HASHMAP::hash_map<AMOS::ID_t, std::set<AMOS::ID_t, EdgeWeightCmp>*, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > ctg2lnk,
+              const EdgeTable &edge_table,
+              const EdgeAdjacency &ctg2lnk,
               HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& inProcess,
               HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& visited,
               std::vector<AMOS::ID_t> &sorted,
@@ -289,12 +453,11 @@ bool topoSortRecursive(AMOS::ID_t curr,
    if (visited[curr] != 1) {
       inProcess[curr] = 1;
 
-      std::set<AMOS::ID_t, EdgeWeightCmp>* s = ctg2lnk[curr];
-      if (s != NULL) {      
-         for (std::set<AMOS::ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
+      EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(curr);
+      if (s.size() != 0) {      
+         for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
             checkEdgeID(*i);
-            AMOS::ContigEdge_t *cte = new AMOS::ContigEdge_t();
-            edge_bank.fetch(*i, *cte);
+            const AMOS::ContigEdge_t *cte = &edge_table.get(*i);
             checkEdge(*cte);
 
             if (isBadEdge(*cte)) { continue; }
@@ -306,7 +469,7 @@ bool topoSortRecursive(AMOS::ID_t curr,
                } else if (inProcess[cte->getContigs().second] == 1) {
                   result = false;
                } else {
-                  result &= topoSortRecursive(cte->getContigs().second, edge_bank, ctg2lnk, inProcess, visited, sorted, debugLevel);
+                  result &= topoSortRecursive(cte->getContigs().second, edge_table, ctg2lnk, inProcess, visited, sorted, debugLevel);
                }
             }              
          }
@@ -321,8 +484,8 @@ bool topoSortRecursive(AMOS::ID_t curr,
 
 void transitiveEdgeRecursive(AMOS::ID_t curr, 
                              AMOS::ID_t edge,
-                             AMOS::Bank_t &edge_bank,
-                             HASHMAP::hash_map<AMOS::ID_t, std::set<AMOS::ID_t, EdgeWeightCmp>*, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > ctg2lnk,
+                             EdgeTable &edge_table,
+                             const EdgeAdjacency &ctg2lnk,
                              HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& inProcess,
                              HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& visited,
                              HASHMAP::hash_map<AMOS::ID_t, std::pair<double, double>, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& mean,
@@ -332,15 +495,15 @@ void transitiveEdgeRecursive(AMOS::ID_t curr,
    std::set<AMOS::ContigEdge_t*, EdgeTopoCmp> edges;
    AMOS::ContigEdge_t currEdge;
    inProcess[curr] = 1;
-   if (edge != UNINITIALIZED) { edge_bank.fetch(edge, currEdge); }
+   if (edge != UNINITIALIZED) { edge_table.fetch(edge, currEdge); }
 
    if (debugLevel >= 1)  { std::cerr << "VISITING NODE " << curr << " USING EDGE ID " << edge << " WITH SIZE " << currEdge.getSize() << std::endl; }
-   std::set<AMOS::ID_t, EdgeWeightCmp>* s = ctg2lnk[curr];
-   if (s != NULL) {
-      for (std::set<AMOS::ID_t, EdgeWeightCmp>::iterator i = s->begin(); i != s->end(); i++) {
+   EdgeAdjacency::EdgeList s = ctg2lnk.getEdges(curr);
+   if (s.size() != 0) {
+      for (EdgeAdjacency::EdgeList::const_iterator i = s.begin(); i != s.end(); i++) {
          checkEdgeID(*i);
          AMOS::ContigEdge_t *cte = new AMOS::ContigEdge_t();
-         edge_bank.fetch(*i, *cte);
+         edge_table.fetch(*i, *cte);
          checkEdge(*cte);
 
          if (isBadEdge(*cte)) { continue; }
@@ -369,7 +532,7 @@ void transitiveEdgeRecursive(AMOS::ID_t curr,
                }
                if (fabs(cte->getSize() - distance) <= (cte->getSD() + sd)) {
                   if (debugLevel >= 1) { std::cerr << "DELETING EDGE " << cte->getIID() << " BETWEEN CONTIGS " << cte->getContigs().first << " AND " << cte->getContigs().second << std::endl; }
-                  setEdgeStatus(*cte, edge_bank, BAD_TRNS);
+                  setEdgeStatus(*cte, edge_table, BAD_TRNS);
                }
             }
             delete cte;
@@ -399,7 +562,7 @@ void transitiveEdgeRecursive(AMOS::ID_t curr,
                   i->second.second += cte->getSD();
                }
             }
-            transitiveEdgeRecursive(cte->getContigs().second, cte->getIID(), edge_bank, ctg2lnk, inProcess, visited, mean, size, debugLevel);
+            transitiveEdgeRecursive(cte->getContigs().second, cte->getIID(), edge_table, ctg2lnk, inProcess, visited, mean, size, debugLevel);
 
             // now remove the distance of the edge just finished in the recursive call above
             mean[curr].first = 0;
@@ -420,8 +583,8 @@ void transitiveEdgeRecursive(AMOS::ID_t curr,
 }
 
 void Bundler::transitiveEdgeRemoval(std::vector<AMOS::Scaffold_t> &scaffs, 
-                           AMOS::Bank_t &edge_bank,
-                           HASHMAP::hash_map<AMOS::ID_t, std::set<AMOS::ID_t, EdgeWeightCmp>*, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& ctg2lnk,
+                           EdgeTable &edge_table,
+                           const EdgeAdjacency &ctg2lnk,
                            int32_t debugLevel) {
 
    HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > inProcess;
@@ -441,12 +604,12 @@ void Bundler::transitiveEdgeRemoval(std::vector<AMOS::Scaffold_t> &scaffs,
                HASHMAP::hash_map<AMOS::ID_t, int, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > topoVisited;
                std::vector<AMOS::ID_t> sorted;
 
-               if (topoSortRecursive(tileIt->source, edge_bank, ctg2lnk, inProcess, topoVisited, sorted, debugLevel)) {
+               if (topoSortRecursive(tileIt->source, edge_table, ctg2lnk, inProcess, topoVisited, sorted, debugLevel)) {
                   for (uint32_t i = 0; i < sorted.size(); i++) {
                      (*cte2top)[sorted[i]] = i;
                   }
                   mean.clear();
-                  transitiveEdgeRecursive(tileIt->source, UNINITIALIZED, edge_bank, ctg2lnk, inProcess, visited, mean, size, debugLevel);
+                  transitiveEdgeRecursive(tileIt->source, UNINITIALIZED, edge_table, ctg2lnk, inProcess, visited, mean, size, debugLevel);
                }
             }               
          }
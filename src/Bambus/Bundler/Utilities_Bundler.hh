@@ -3,6 +3,8 @@
 
 #include <set>
 #include <queue>
+#include <deque>
+#include <vector>
 #include <iterator>
 
 #ifdef AMOS_HAVE_BOOST
@@ -91,6 +93,96 @@ namespace Bundler
       }
    };
   
+   // in-memory copy of a contig edge bank
+   // the edges are read once by load(), all lookups and updates are served from memory
+   // and flush() writes the changes back to the bank in a single batch
+   class EdgeTable
+   {
+   public:
+      EdgeTable() : loaded_m(0), live_m(0), maxIID_m(0) {}
+
+      void load(AMOS::Bank_t &edge_bank);
+      void flush(AMOS::Bank_t &edge_bank);
+
+      // edges by position, in bank IDMap order followed by appended edges
+      // removed edges keep their position, check with isRemoved()
+      uint32_t size() const { return edges_m.size(); }
+      const AMOS::ContigEdge_t &at(uint32_t i) const { return edges_m[i]; }
+      bool isRemoved(uint32_t i) const { return state_m[i] & REMOVED; }
+
+      // references stay valid until the table is destroyed
+      // removed edges are gone: get throws and find returns NULL for them,
+      // removing one again does nothing
+      const AMOS::ContigEdge_t &get(AMOS::ID_t iid) const;
+      const AMOS::ContigEdge_t *find(AMOS::ID_t iid) const;
+      void fetch(AMOS::ID_t iid, AMOS::ContigEdge_t &cte) const { cte = get(iid); }
+
+      void append(const AMOS::ContigEdge_t &cte);
+      void replace(AMOS::ID_t iid, const AMOS::ContigEdge_t &cte);
+      void remove(AMOS::ID_t iid);
+
+      AMOS::ID_t getMaxIID() const { return maxIID_m; }
+      AMOS::Size_t getSize() const { return live_m; }
+
+   private:
+      static const uint8_t DIRTY   = 0x1;
+      static const uint8_t REMOVED = 0x2;
+
+      uint32_t lookup(AMOS::ID_t iid) const;
+
+      std::deque<AMOS::ContigEdge_t> edges_m;   // deque so appends do not move edges
+      std::vector<uint8_t> state_m;
+      HASHMAP::hash_map<AMOS::ID_t, uint32_t, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > index_m;
+      uint32_t loaded_m;                        // edges read by load(), the rest are new
+      AMOS::Size_t live_m;
+      AMOS::ID_t maxIID_m;
+   };
+
+   // adjacency lists of the contig graph, each sorted by decreasing edge weight
+   // the lists built at once are packed in CSR form, lists of nodes inserted into
+   // afterwards are kept separately
+   class EdgeAdjacency
+   {
+   public:
+      // view of one adjacency list, invalidated by the next insert() into the same node
+      class EdgeList
+      {
+      public:
+         typedef const AMOS::ID_t * const_iterator;
+
+         EdgeList() : edges_m(NULL), weights_m(NULL), size_m(0) {}
+         EdgeList(const AMOS::ID_t *edges, const int32_t *weights, uint32_t size) : edges_m(edges), weights_m(weights), size_m(size) {}
+
+         const_iterator begin() const { return edges_m; }
+         const_iterator end() const { return edges_m + size_m; }
+         uint32_t size() const { return size_m; }
+         int32_t weight(const_iterator i) const { return weights_m[i - edges_m]; }
+
+      private:
+         const AMOS::ID_t *edges_m;
+         const int32_t *weights_m;
+         uint32_t size_m;
+      };
+
+      // adds each edge, in order, to the lists of both of its contigs
+      // edges of equal weight are listed most recently added first
+      void build(const EdgeTable &edge_table, const std::vector<AMOS::ID_t> &edges);
+      void insert(AMOS::ID_t node, AMOS::ID_t edge, int32_t weight);
+      EdgeList getEdges(AMOS::ID_t node) const;
+
+   private:
+      struct List
+      {
+         std::vector<AMOS::ID_t> edges;
+         std::vector<int32_t> weights;
+      };
+
+      HASHMAP::hash_map<AMOS::ID_t, std::pair<uint32_t, uint32_t>, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > nodes_m;
+      std::vector<AMOS::ID_t> edges_m;
+      std::vector<int32_t> weights_m;
+      HASHMAP::hash_map<AMOS::ID_t, List, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> > lists_m;
+   };
+
    double computeArrivalRate(const std::vector<AMOS::Contig_t *> &contigs);
    void buildGraph(
             Graph &g, 
@@ -103,13 +195,16 @@ namespace Bundler
    void setEdgeStatus(AMOS::ContigEdge_t &cte, AMOS::Bank_t &edge_bank, int status);
    void setEdgeStatus(AMOS::ContigEdge_t &cte, AMOS::Bank_t &edge_bank, int status, bool now);
    void flushEdgeStatus(AMOS::Bank_t &edge_bank);
+   // note: edge statuses in an edge table reach the bank when the table is flushed
+   void setEdgeStatus(AMOS::ContigEdge_t &cte, EdgeTable &edge_table, int status);
 
    bool isBadEdge(AMOS::ID_t cteID, AMOS::Bank_t &edge_bank);
+   bool isBadEdge(AMOS::ID_t cteID, const EdgeTable &edge_table);
    bool isBadEdge(const AMOS::ContigEdge_t &cte);
    void checkEdgeID(const AMOS::ID_t &id);
    void checkEdge(const AMOS::ContigEdge_t &cte);
-   void resetEdges(AMOS::Bank_t &edge_bank, edgeStatus toChange);
-   void resetEdges(AMOS::Bank_t &edge_bank, std::set<AMOS::ID_t> &edges, edgeStatus toChange);
+   void resetEdges(EdgeTable &edge_table, edgeStatus toChange);
+   void resetEdges(EdgeTable &edge_table, std::set<AMOS::ID_t> &edges, edgeStatus toChange);
    
    AMOS::ID_t getEdgeDestination(const AMOS::ID_t &edgeSrc, const AMOS::ContigEdge_t &cte);
    contigOrientation getOrientation(contigOrientation &myOrient, const AMOS::ContigEdge_t &cte);
@@ -122,8 +217,8 @@ namespace Bundler
    AMOS::Size_t getTileOverlap(AMOS::Tile_t tileOne, AMOS::Tile_t tileTwo);
    
    void transitiveEdgeRemoval(std::vector<AMOS::Scaffold_t> &scaffs, 
-                              AMOS::Bank_t &edge_bank,
-                              HASHMAP::hash_map<AMOS::ID_t, std::set<AMOS::ID_t, EdgeWeightCmp>*, HASHMAP::hash<AMOS::ID_t>, HASHMAP::equal_to<AMOS::ID_t> >& ctg2lnk,
+                              EdgeTable &edge_table,
+                              const EdgeAdjacency &ctg2lnk,
                               int32_t debugLevel);
 }
 #endif /*UTILITIES_BUNDLER_HH_*/
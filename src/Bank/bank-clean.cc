@@ -24,6 +24,9 @@ using namespace std;
 //=============================================================== Globals ====//
 string  OPT_BankName;                        // bank name parameter
 bool    OPT_IsCleanCodes = false;            // clean certain codes
+bool    OPT_Flatten = false;                 // flatten instead of clean
+bool    OPT_Compact = false;                 // compact instead of clean
+float   OPT_Garbage = 0.5;                   // dead fraction to compact at
 set<NCode_t> OPT_CleanCodes;                 // NCodes to clean
 
 
@@ -99,7 +102,12 @@ int main (int argc, char ** argv)
           cerr << Decode (ncode) << " ... ";
 
           bi -> open (OPT_BankName);
-          bi -> clean( );
+          if ( OPT_Flatten )
+            bi -> flatten( );
+          else if ( OPT_Compact )
+            cerr << bi -> compact (OPT_Garbage) << " partitions ";
+          else
+            bi -> clean( );
           bi -> close( );
 
           cerr << "done\n";
@@ -149,13 +157,22 @@ void ParseArgs (int argc, char ** argv)
   int ch, errflg = 0;
   optarg = NULL;
 
-  while ( !errflg && ((ch = getopt (argc, argv, "b:hv")) != EOF) )
+  while ( !errflg && ((ch = getopt (argc, argv, "b:c:fhv")) != EOF) )
     switch (ch)
       {
       case 'b':
         OPT_BankName = optarg;
         break;
 
+      case 'c':
+        OPT_Compact = true;
+        OPT_Garbage = atof (optarg);
+        break;
+
+      case 'f':
+        OPT_Flatten = true;
+        break;
+
       case 'h':
         PrintHelp (argv[0]);
         exit (EXIT_SUCCESS);
@@ -211,9 +228,19 @@ void PrintHelp (const char * s)
     << "  command line, all bank types will be cleaned of deleted records.\n"
     << "  Otherwise, only the listed bank types will be cleaned. Cleaning the\n"
     << "  deleted records may dramatically reduce the size of the bank if\n"
-    << "  numerous remove or replace operations have been performed.\n"
+    << "  numerous remove or replace operations have been performed. Cleaning\n"
+    << "  also collapses a versioned bank down to its latest version.\n"
+    << "  With -f, the latest version is instead flattened: the records it\n"
+    << "  still reads from earlier versions are copied into it, so that it no\n"
+    << "  longer depends on them. Earlier versions are left intact.\n"
+    << "  With -c, only the partitions of the latest version whose deleted\n"
+    << "  data makes up at least the given fraction of their size are\n"
+    << "  rewritten, one at a time. Record BIDs and versions are kept.\n"
     << "\n.OPTIONS.\n"
     << "  -b path       The directory path of the bank to clean\n"
+    << "  -c float      Compact partitions with at least this fraction of\n"
+    << "                deleted data instead of cleaning, e.g. 0.5\n"
+    << "  -f            Flatten the latest version instead of cleaning\n"
     << "  -h            Display help information\n"
     << "  -v            Display the compatible bank version\n"
     << "\n.KEYWORDS.\n"
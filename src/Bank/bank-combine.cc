@@ -20,7 +20,7 @@ int main (int argc, char ** argv)
 {
   int exitcode = EXIT_SUCCESS;
 
-  if (argc < 4)
+  if (argc < 3)
   {
     fprintf(stderr, "USAGE: bank-combine outbank in_1 in_2 ... in_n\n");
     exit(1);
@@ -38,6 +38,8 @@ int main (int argc, char ** argv)
 
   BankStream_t ctg_bank (Contig_t::NCODE);
   BankStream_t red_bank (Read_t::NCODE);
+  ctg_bank.setReadAhead(4);
+  red_bank.setReadAhead(4);
 
   int redoffset = 0;
   int ctgoffset = 0;
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Builds and queries the tiling index of a bank
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "foundation_AMOS.hh"
+#include "TilingIndex_AMOS.hh"
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+using namespace std;
+using namespace AMOS;
+
+
+//=============================================================== Globals ====//
+string OPT_BankName;                 // bank name parameter
+bool   OPT_UseScaffolds = false;     // index scaffolds instead of contigs
+bool   OPT_Force = false;            // rebuild even if up to date
+bool   OPT_UseEIDs = false;          // print the EIDs of the tiles
+
+ID_t   objiid = AMOS::NULL_ID;
+string objeid;
+int    rangeStart = -1;
+int    rangeEnd = -1;
+
+
+struct SpanOrdinalCmp
+{
+  bool operator() (const TilingIndex_t::Span_t & a,
+                   const TilingIndex_t::Span_t & b) const
+  {
+    return a.ordinal < b.ordinal || (a.ordinal == b.ordinal && a.begin < b.begin);
+  }
+};
+
+
+
+
+//========================================================== Fuction Decs ====//
+//----------------------------------------------------- ParseArgs --------------
+//! \brief Sets the global OPT_% values from the command line arguments
+//!
+//! \return void
+//!
+void ParseArgs (int argc, char ** argv);
+
+
+//----------------------------------------------------- PrintHelp --------------
+//! \brief Prints help information to cerr
+//!
+//! \param s The program name, i.e. argv[0]
+//! \return void
+//!
+void PrintHelp (const char * s);
+
+
+//----------------------------------------------------- PrintUsage -------------
+//! \brief Prints usage information to cerr
+//!
+//! \param s The program name, i.e. argv[0]
+//! \return void
+//!
+void PrintUsage (const char * s);
+
+
+
+//========================================================= Function Defs ====//
+int main (int argc, char ** argv)
+{
+  int exitcode = EXIT_SUCCESS;
+
+  //-- Parse the command line arguments
+  ParseArgs (argc, argv);
+
+  NCode_t type = OPT_UseScaffolds ? Scaffold_t::NCODE : Contig_t::NCODE;
+  NCode_t tiletype = OPT_UseScaffolds ? Contig_t::NCODE : Read_t::NCODE;
+  bool query = ! objeid . empty( ) || objiid != AMOS::NULL_ID;
+
+  //-- BEGIN: MAIN EXCEPTION CATCH
+  try {
+
+    if ( OPT_Force || ! TilingIndex_t::isCurrent (OPT_BankName, type) )
+      {
+        cerr << "Indexing " << Decode (type) << " tiling of "
+             << OPT_BankName << "... ";
+        Size_t n = TilingIndex_t::build (OPT_BankName, type);
+        cerr << n << " indexed" << endl;
+      }
+
+    if ( query )
+      {
+        TilingIndex_t index;
+        index . open (OPT_BankName, type);
+
+        if ( objiid == AMOS::NULL_ID )
+          {
+            Bank_t obj_bank (type);
+            obj_bank . open (OPT_BankName, B_SPY);
+            objiid = obj_bank . lookupIID (objeid);
+            obj_bank . close( );
+
+            if ( objiid == AMOS::NULL_ID )
+              AMOS_THROW_ARGUMENT ("Unknown " + Decode (type) + " EID " + objeid);
+          }
+
+        Bank_t tile_bank (tiletype);
+        if ( OPT_UseEIDs )
+          tile_bank . open (OPT_BankName, B_SPY);
+
+        if ( rangeEnd < rangeStart )
+          swap (rangeStart, rangeEnd);
+
+        vector<TilingIndex_t::Span_t> spans;
+        index . getOverlapping (objiid, rangeStart, rangeEnd, spans);
+        sort (spans . begin( ), spans . end( ), SpanOrdinalCmp( ));
+
+        for ( vector<TilingIndex_t::Span_t>::iterator si = spans . begin( );
+              si != spans . end( ); ++ si )
+          {
+            cout << si -> source;
+            if ( OPT_UseEIDs )
+              cout << "\t" << tile_bank . lookupEID (si -> source);
+            cout << "\t" << si -> begin << "\t" << si -> end << "\n";
+          }
+      }
+  }
+  catch (const Exception_t & e) {
+    cerr << "FATAL: " << e . what( ) << endl
+         << "  there has been a fatal error, abort" << endl;
+    exitcode = EXIT_FAILURE;
+  }
+  //-- END: MAIN EXCEPTION CATCH
+
+  return exitcode;
+}
+
+
+
+
+//------------------------------------------------------------- ParseArgs ----//
+void ParseArgs (int argc, char ** argv)
+{
+  int ch, errflg = 0;
+  optarg = NULL;
+
+  while ( !errflg && ((ch = getopt (argc, argv, "hvSfeE:I:x:y:")) != EOF) )
+    switch (ch)
+      {
+      case 'h':
+        PrintHelp (argv[0]);
+        exit (EXIT_SUCCESS);
+        break;
+
+      case 'v': PrintBankVersion (argv[0]); exit (EXIT_SUCCESS); break;
+      case 'S': OPT_UseScaffolds = true; break;
+      case 'f': OPT_Force = true; break;
+      case 'e': OPT_UseEIDs = true; break;
+      case 'E': objeid = optarg; break;
+      case 'I': objiid = atoi (optarg); break;
+      case 'x': rangeStart = atoi (optarg); break;
+      case 'y': rangeEnd = atoi (optarg); break;
+
+      default: errflg ++;
+      }
+
+  if (errflg > 0 || optind != argc - 1)
+  {
+    PrintUsage (argv[0]);
+    cerr << "Try '" << argv[0] << " -h' for more information.\n";
+    exit (EXIT_FAILURE);
+  }
+
+  if ((! objeid.empty() || objiid != AMOS::NULL_ID) &&
+      (rangeStart == -1 || rangeEnd == -1))
+  {
+    cerr << "Range coordinates are required with a contig or scaffold id" << endl;
+    exit (EXIT_FAILURE);
+  }
+
+  OPT_BankName = argv [optind ++];
+}
+
+
+
+
+//------------------------------------------------------------- PrintHelp ----//
+void PrintHelp (const char * s)
+{
+  PrintUsage (s);
+
+  cerr << "\n.DESCRIPTION.\n"
+       << "  Builds the index of the read tiling of the contigs in a bank, or of the\n"
+       << "  contig tiling of the scaffolds with -S, unless it is already up to date.\n"
+       << "  Given an object and a range, lists the tiles overlapping the range as\n"
+       << "  IID, begin and end offsets, in tiling order.\n"
+       << "\n.OPTIONS.\n"
+       << "  -h            Display help information\n"
+       << "  -v            Display the compatible bank version\n"
+       << "  -S            Index scaffolds instead of contigs\n"
+       << "  -f            Rebuild the index even if it is up to date\n"
+       << "  -E eid        Contig or scaffold eid of interest\n"
+       << "  -I iid        Contig or scaffold iid of interest\n"
+       << "  -x start      Start of range\n"
+       << "  -y end        End of range\n"
+       << "  -e            Also print the tile eids\n"
+       << "\n.KEYWORDS.\n"
+       << "  amos bank, tiling"
+       << endl;
+
+  return;
+}
+
+
+
+
+//------------------------------------------------------------ PrintUsage ----//
+void PrintUsage (const char * s)
+{
+  cerr << "\n.USAGE.\n" << "  " <<  s << "  [options]  <bank path>\n";
+  return;
+}
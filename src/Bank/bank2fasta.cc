@@ -250,6 +250,7 @@ int main(int argc, char **argv)
     }
     else
     {
+      contig_stream.setReadAhead(4);
       while (contig_stream >> ctg) 
       {
         printFasta(ctg, outqual);
@@ -17,6 +17,7 @@
 #include <functional>
 #include "foundation_AMOS.hh"
 #include <fstream>
+#include <sstream>
 #include <ctype.h>
 
 using namespace std;
@@ -42,6 +43,7 @@ void printHelpText()
        << "  -E file       Dump just the contig eids listed in file\n"
        << "  -I file       Dump just the contig iids listed in file\n"
        << "  -g            Report gapped lengths\n"
+       << "  -j n          Number of threads for a whole bank (default 1)\n"
        << "\n.KEYWORDS.\n"
        << "  AMOS bank, Converters\n"
        << endl;
@@ -60,6 +62,7 @@ bool GetOptions(int argc, char ** argv)
     {"E",         1, 0, 'E'},
     {"I",         1, 0, 'I'},
     {"g",         0, 0, 'g'},
+    {"j",         1, 0, 'j'},
     {0, 0, 0, 0}
   };
   
@@ -90,6 +93,9 @@ bool GetOptions(int argc, char ** argv)
     case 'g':
       globals["gapped"] = "true";
       break;
+    case 'j':
+      globals["threads"] = string(optarg);
+      break;
     case '?':
       return false;
     }
@@ -98,28 +104,59 @@ bool GetOptions(int argc, char ** argv)
   return true;
 } // GetOptions
 
-void printLens(const Contig_t & ctg)
+string lensLine(const Contig_t & ctg, bool eid, bool gapped)
 {
   string seq = ctg.getSeqString();
+  stringstream line;
 
-  if (globals["eid"] == "true") { 
-    cout << ctg.getEID(); 
+  if (eid) { 
+    line << ctg.getEID(); 
   } else { 
-    cout << ctg.getIID(); 
+    line << ctg.getIID(); 
   }
 
   size_t len = seq.length();
-  if (globals["gapped"] != "true") { // get rid of gaps...
+  if (! gapped) { // get rid of gaps...
     size_t found = seq.find_first_of('-'); // find gap
     while (found != string::npos){
       len--;
       found = seq.find_first_of('-', found+1);
     }
   }
-  cout << " " << len << endl;
+  line << " " << len << endl;
+
+  return line.str();
+} // lensLine
 
+void printLens(const Contig_t & ctg)
+{
+  cout << lensLine(ctg, globals["eid"] == "true", globals["gapped"] == "true");
 } // printLens
 
+// lengths of the contigs of a bank scan, without touching globals on the
+// scan threads
+struct LensScan_t
+{
+  typedef string result_type;
+
+  bool eid;
+  bool gapped;
+
+  bool operator() (Contig_t & ctg, string & line)
+  {
+    line = lensLine(ctg, eid, gapped);
+    return true;
+  }
+};
+
+struct PrintLens_t
+{
+  void operator() (const string & line)
+  {
+    cout << line;
+  }
+};
+
 //----------------------------------------------
 int main(int argc, char **argv)
 {
@@ -198,10 +235,13 @@ int main(int argc, char **argv)
     }
     else
     {
-      while (contig_stream >> ctg) 
-      {
-        printLens(ctg);
-      }
+      LensScan_t lens;
+      lens.eid = (globals["eid"] == "true");
+      lens.gapped = (globals["gapped"] == "true");
+      PrintLens_t print;
+
+      parallelScan<Contig_t>(contig_stream, atoi(globals["threads"].c_str()),
+                             lens, print);
     }
 
     contig_stream.close();
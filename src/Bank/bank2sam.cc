@@ -5,7 +5,7 @@
 //  Last Modified:  10 May 2012
 //
 //  This program takes an AMOS bank directory and dumps its reads 
-//  as SAM formatted text to stdout.
+//  as SAM formatted text to stdout, or as a BAM file.
 
 extern "C" {
 #include <getopt.h>
@@ -15,9 +15,19 @@ extern "C" {
 #include "amp.hh"
 #include "fasta.hh"
 #include <map>
+#include <queue>
 #include <sstream>
+#include <cstdio>
+#include <cstring>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 //#include <Contig_AMOS.hh>
 
+#ifdef AMOS_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 
 
 using namespace AMOS;
@@ -27,9 +37,102 @@ struct config {
   string        bank;
   bool			scaffolds;
   bool			use_eids;
+  string		bam;          // BAM file to write instead of SAM text
+  bool			sorted;       // sort the BAM file by coordinate and index it
+  int			threads;
+  size_t		sort_memory;  // bytes of records sorted in memory at once
 };
 config globals;
 
+
+//==============================================================================//
+// BAM encoding
+//==============================================================================//
+static void put16(string & s, uint16_t v)
+{
+  v = htol16(v);
+  s.append((const char *) &v, sizeof(v));
+}
+
+static void put32(string & s, uint32_t v)
+{
+  v = htol32(v);
+  s.append((const char *) &v, sizeof(v));
+}
+
+static void put64(string & s, uint64_t v)
+{
+  v = htol64(v);
+  s.append((const char *) &v, sizeof(v));
+}
+
+static int32_t get32(const char * p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return (int32_t) ltoh32(v);
+}
+
+// The bin of the BAM index holding [beg, end), 0-based, end exclusive
+static int reg2bin(int beg, int end)
+{
+  --end;
+  if (beg >> 14 == end >> 14) return ((1 << 15) - 1) / 7 + (beg >> 14);
+  if (beg >> 17 == end >> 17) return ((1 << 12) - 1) / 7 + (beg >> 17);
+  if (beg >> 20 == end >> 20) return ((1 <<  9) - 1) / 7 + (beg >> 20);
+  if (beg >> 23 == end >> 23) return ((1 <<  6) - 1) / 7 + (beg >> 23);
+  if (beg >> 26 == end >> 26) return ((1 <<  3) - 1) / 7 + (beg >> 26);
+  return 0;
+}
+
+// Converts a CIGAR string to BAM operations, returns the number of reference
+// positions it covers
+static int parseCigar(const string & cigar, vector<uint32_t> & ops)
+{
+  static const char * BAM_OPS = "MIDNSHP=X";
+  int reflen = 0;
+  uint32_t len = 0;
+
+  ops.clear();
+  for (size_t i = 0; i < cigar.size(); i++)
+  {
+    if (isdigit(cigar[i]))
+    {
+      len = len * 10 + (cigar[i] - '0');
+      continue;
+    }
+
+    const char * op = strchr(BAM_OPS, cigar[i]);
+    uint32_t code = op ? op - BAM_OPS : 0;
+    ops.push_back(len << 4 | code);
+    if (code == 0 || code == 2 || code == 3 || code == 7 || code == 8)
+      reflen += len;
+    len = 0;
+  }
+
+  return reflen;
+}
+
+// The last position past a BAM record, from its position and CIGAR
+static int bamEnd(const char * rec)
+{
+  int pos = get32(rec + 8);
+  int namelen = (unsigned char) rec[12];
+  int ncigar = (unsigned char) rec[16] | ((unsigned char) rec[17] << 8);
+  const char * cigar = rec + 36 + namelen;
+  int reflen = 0;
+
+  for (int i = 0; i < ncigar; i++)
+  {
+    uint32_t op = get32(cigar + 4 * i);
+    uint32_t code = op & 0xf;
+    if (code == 0 || code == 2 || code == 3 || code == 7 || code == 8)
+      reflen += op >> 4;
+  }
+
+  return pos + (reflen > 0 ? reflen : 1);
+}
+
 class Sam_entry
 {
 	private:
@@ -56,7 +159,7 @@ class Sam_entry
 		}
 		
 		
-		void setSam(int ctgoffset, Read_t read, Tile_t tile, Contig_t contig, string contigeid, string cons, string rnext, int pnext, int tlen)
+		void setSam(int ctgoffset, const Read_t & read, const Tile_t & tile, Contig_t & contig, const string & contigeid, const string & cons, const string & rnext, int pnext, int tlen)
 		{
 		
 			// Set the entries we can 
@@ -210,6 +313,68 @@ class Sam_entry
 				 
 		}
 		
+		//Appends the content of the SAM entry to rec as a BAM record. refids
+		//holds the index of every reference name in the BAM header.
+		void encodeBam(const map<string, int> & refids, string & rec) const
+		{
+			map<string, int>::const_iterator ri = refids.find(r_name);
+			int refid = (ri == refids.end()) ? -1 : ri->second;
+			int nextid = -1;
+			if (r_next == "=")
+				nextid = refid;
+			else if (r_next != "*")
+			{
+				ri = refids.find(r_next);
+				if (ri != refids.end())
+					nextid = ri->second;
+			}
+
+			vector<uint32_t> ops;
+			int reflen = parseCigar(cigar, ops);
+			int pos = pos_1 - 1;
+			string name = read_id.substr(0, 254);
+
+			size_t start = rec.size();
+			put32(rec, 0); // block size, set at the end
+			put32(rec, refid);
+			put32(rec, pos);
+			rec += (char) (name.size() + 1);
+			rec += (char) mapqual;
+			put16(rec, reg2bin(pos, pos + (reflen > 0 ? reflen : 1)));
+			put16(rec, ops.size());
+			put16(rec, flag);
+			put32(rec, seq.size());
+			put32(rec, nextid);
+			put32(rec, p_next - 1);
+			put32(rec, t_len);
+			rec.append(name.c_str(), name.size() + 1);
+
+			for (size_t i = 0; i < ops.size(); i++)
+				put32(rec, ops[i]);
+
+			static const char * BAM_BASES = "=ACMGRSVTWYHKDBN";
+			for (size_t i = 0; i < seq.size(); i += 2)
+			{
+				int hi = 15, lo = 0;
+				const char * b = strchr(BAM_BASES, toupper(seq[i]));
+				if (b && *b) hi = b - BAM_BASES;
+				if (i + 1 < seq.size())
+				{
+					lo = 15;
+					b = strchr(BAM_BASES, toupper(seq[i+1]));
+					if (b && *b) lo = b - BAM_BASES;
+				}
+				rec += (char) (hi << 4 | lo);
+			}
+
+			for (size_t i = 0; i < seq.size(); i++)
+				rec += (char) (i < qual.size() ? qual[i] - 33 : 0xff);
+
+			uint32_t size = rec.size() - start - 4;
+			size = htol32(size);
+			memcpy(&rec[start], &size, sizeof(size));
+		}
+		
 		//If this read has a mate, this information might not be available at construction
 		//This is used to update these fields. The read_id (QNAME) is set equal to the mate.
 		void updateMate(int f, string qname, string rnext, int pnext, int tlen)
@@ -252,6 +417,459 @@ class Sam_entry
 		
 };
 
+
+#ifdef HAVE_LIBZ
+//==============================================================================//
+// BAM output
+//==============================================================================//
+
+// Writes a BGZF file: a gzip member per block of at most BLOCK_SIZE bytes,
+// with the compressed size in an extra field. Full blocks are queued and
+// compressed a batch at a time on the OpenMP threads, then written in order.
+// The file offset of a block is only known once it is written, so tell()
+// gives the number of the current block and the offset in it, and resolve()
+// turns that into a BGZF virtual offset once the block is out.
+class BgzfWriter
+{
+public:
+  static const size_t BLOCK_SIZE = 0xff00;
+  static const size_t MAX_BLOCK = 0x10000;
+
+  BgzfWriter() : m_out(NULL), m_threads(1), m_written(0) { }
+  ~BgzfWriter() { if (m_out && m_out != stdout) { fclose(m_out); } }
+
+  void open(const string & path, int threads)
+  {
+    m_out = (path == "-") ? stdout : fopen(path.c_str(), "wb");
+    if (m_out == NULL)
+      AMOS_THROW_IO("Could not open BAM file " + path);
+    m_threads = threads > 1 ? threads : 1;
+  }
+
+  void write(const char * data, size_t len)
+  {
+    while (len > 0)
+    {
+      size_t n = min(len, BLOCK_SIZE - m_current.size());
+      m_current.append(data, n);
+      data += n;
+      len -= n;
+
+      if (m_current.size() == BLOCK_SIZE)
+        endBlock();
+    }
+  }
+
+  uint64_t tell() const
+  {
+    return (uint64_t) (m_offsets.size() + m_pending.size()) << 16 | m_current.size();
+  }
+
+  uint64_t resolve(uint64_t pos) const
+  {
+    return m_offsets[pos >> 16] << 16 | (pos & 0xffff);
+  }
+
+  // Writes the last blocks and the end of file marker
+  void close()
+  {
+    static const char BGZF_EOF[28] =
+      { 0x1f, (char) 0x8b, 8, 4, 0, 0, 0, 0, 0, (char) 0xff, 6, 0, 0x42, 0x43,
+        2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    if (!m_current.empty())
+      endBlock();
+    flushPending();
+
+    m_offsets.push_back(m_written);
+    fwrite(BGZF_EOF, 1, sizeof(BGZF_EOF), m_out);
+
+    bool failed = ferror(m_out) || fflush(m_out) != 0;
+    if (m_out != stdout) { failed = (fclose(m_out) != 0) || failed; }
+    m_out = NULL;
+    if (failed)
+      AMOS_THROW_IO("Could not write BAM file");
+  }
+
+private:
+  void endBlock()
+  {
+    m_pending.push_back(string());
+    m_pending.back().swap(m_current);
+    if (m_pending.size() >= (size_t) m_threads * 16)
+      flushPending();
+  }
+
+  void flushPending()
+  {
+    int n = m_pending.size();
+    vector<string> blocks(n);
+    bool failed = false;
+
+#ifdef AMOS_HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(m_threads)
+#endif
+    for (int i = 0; i < n; i++)
+    {
+      if (!compress(m_pending[i], blocks[i]))
+        failed = true;
+    }
+
+    if (failed)
+      AMOS_THROW_IO("Could not compress BAM block");
+
+    for (int i = 0; i < n; i++)
+    {
+      m_offsets.push_back(m_written);
+      fwrite(blocks[i].data(), 1, blocks[i].size(), m_out);
+      m_written += blocks[i].size();
+    }
+    m_pending.clear();
+
+    if (ferror(m_out))
+      AMOS_THROW_IO("Could not write BAM file");
+  }
+
+  // Deflates in after the block header, returns the block size or 0 if the
+  // data does not fit in a block
+  static size_t deflateBlock(const string & in, string & out, int level)
+  {
+    static const int HEADER = 18, FOOTER = 8;
+    size_t size = 0;
+    z_stream zs;
+
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      return 0;
+    zs.next_in = (Bytef *) in.data();
+    zs.avail_in = in.size();
+    zs.next_out = (Bytef *) &out[HEADER];
+    zs.avail_out = MAX_BLOCK - HEADER - FOOTER;
+    if (deflate(&zs, Z_FINISH) == Z_STREAM_END)
+      size = HEADER + zs.total_out + FOOTER;
+    deflateEnd(&zs);
+
+    return size;
+  }
+
+  static bool compress(const string & in, string & out)
+  {
+    // A block that does not shrink is stored, which always fits
+    out.resize(MAX_BLOCK);
+    size_t size = deflateBlock(in, out, Z_DEFAULT_COMPRESSION);
+    if (size == 0)
+      size = deflateBlock(in, out, 0);
+    if (size == 0)
+      return false;
+
+    static const char BGZF_HEADER[16] =
+      { 0x1f, (char) 0x8b, 8, 4, 0, 0, 0, 0, 0, (char) 0xff, 6, 0, 0x42, 0x43, 2, 0 };
+    memcpy(&out[0], BGZF_HEADER, sizeof(BGZF_HEADER));
+    uint16_t bsize = size - 1;
+    bsize = htol16(bsize);
+    memcpy(&out[16], &bsize, sizeof(bsize));
+
+    uint32_t crc = crc32(crc32(0, NULL, 0), (const Bytef *) in.data(), in.size());
+    uint32_t isize = in.size();
+    crc = htol32(crc);
+    isize = htol32(isize);
+    memcpy(&out[size - 8], &crc, sizeof(crc));
+    memcpy(&out[size - 4], &isize, sizeof(isize));
+
+    out.resize(size);
+    return true;
+  }
+
+  FILE * m_out;
+  int m_threads;
+  string m_current;             // block being filled
+  vector<string> m_pending;     // full blocks waiting for compression
+  vector<uint64_t> m_offsets;   // file offset of every written block
+  uint64_t m_written;           // bytes written
+};
+
+const size_t BgzfWriter::BLOCK_SIZE;
+const size_t BgzfWriter::MAX_BLOCK;
+
+
+// The .bai index of a coordinate sorted BAM file. Records are added in file
+// order with their BgzfWriter::tell() positions, which are resolved when the
+// index is written.
+class BaiIndex
+{
+public:
+  BaiIndex(int nrefs) : m_refs(nrefs), m_nocoor(0) { }
+
+  void add(int refid, int beg, int end, uint64_t vbeg, uint64_t vend)
+  {
+    if (refid < 0 || refid >= (int) m_refs.size())
+    {
+      m_nocoor++;
+      return;
+    }
+
+    Ref & ref = m_refs[refid];
+    vector<Chunk> & chunks = ref.m_bins[reg2bin(beg, end)];
+    if (!chunks.empty() && chunks.back().second == vbeg)
+      chunks.back().second = vend;
+    else
+      chunks.push_back(Chunk(vbeg, vend));
+
+    if (beg < 0) { beg = 0; }
+    size_t last = (end - 1) >> 14;
+    if (ref.m_linear.size() <= last)
+      ref.m_linear.resize(last + 1, UNSET);
+    for (size_t w = beg >> 14; w <= last; w++)
+    {
+      if (ref.m_linear[w] == UNSET)
+        ref.m_linear[w] = vbeg;
+    }
+  }
+
+  void write(const string & path, const BgzfWriter & bam) const
+  {
+    string out("BAI\1", 4);
+    put32(out, m_refs.size());
+
+    for (vector<Ref>::const_iterator ri = m_refs.begin(); ri != m_refs.end(); ri++)
+    {
+      put32(out, ri->m_bins.size());
+      map<uint32_t, vector<Chunk> >::const_iterator bi;
+      for (bi = ri->m_bins.begin(); bi != ri->m_bins.end(); bi++)
+      {
+        put32(out, bi->first);
+        put32(out, bi->second.size());
+        for (size_t i = 0; i < bi->second.size(); i++)
+        {
+          put64(out, bam.resolve(bi->second[i].first));
+          put64(out, bam.resolve(bi->second[i].second));
+        }
+      }
+
+      // Windows without a record start at the offset of the window before
+      put32(out, ri->m_linear.size());
+      uint64_t offset = 0;
+      for (size_t w = 0; w < ri->m_linear.size(); w++)
+      {
+        if (ri->m_linear[w] != UNSET)
+          offset = bam.resolve(ri->m_linear[w]);
+        put64(out, offset);
+      }
+    }
+    put64(out, m_nocoor);
+
+    FILE * fp = fopen(path.c_str(), "wb");
+    if (fp == NULL)
+      AMOS_THROW_IO("Could not open BAM index " + path);
+    bool failed = fwrite(out.data(), 1, out.size(), fp) != out.size();
+    failed = (fclose(fp) != 0) || failed;
+    if (failed)
+      AMOS_THROW_IO("Could not write BAM index " + path);
+  }
+
+private:
+  static const uint64_t UNSET = ~(uint64_t) 0;
+
+  typedef pair<uint64_t, uint64_t> Chunk;
+
+  struct Ref
+  {
+    map<uint32_t, vector<Chunk> > m_bins;
+    vector<uint64_t> m_linear;   // first record of every 16kbp window
+  };
+
+  vector<Ref> m_refs;
+  uint64_t m_nocoor;
+};
+
+const uint64_t BaiIndex::UNSET;
+
+
+// Sorts BAM records by reference and position, keeping the order of records
+// with the same position. Records are sorted in memory up to a limit, then
+// spilled to temporary files as sorted runs that are merged at the end.
+class BamSorter
+{
+public:
+  BamSorter(size_t memory) : m_memory(memory) { }
+
+  ~BamSorter()
+  {
+    for (size_t i = 0; i < m_runs.size(); i++)
+      fclose(m_runs[i]);
+  }
+
+  void add(const string & rec)
+  {
+    m_recs.push_back(Rec(key(rec.data()), m_data.size()));
+    m_data.append(rec);
+
+    if (m_data.size() >= m_memory)
+      spill();
+  }
+
+  // Writes every record in order to bam and adds it to the index
+  void finish(BgzfWriter & bam, BaiIndex & index)
+  {
+    if (m_runs.empty())
+    {
+      stable_sort(m_recs.begin(), m_recs.end(), RecCmp());
+      for (size_t i = 0; i < m_recs.size(); i++)
+        put(m_data.data() + m_recs[i].second, bam, index);
+      return;
+    }
+
+    spill();
+
+    // Merge the runs, ties go to the earlier run
+    vector<string> heads(m_runs.size());
+    priority_queue<Rec, vector<Rec>, RunCmp> queue;
+    for (size_t i = 0; i < m_runs.size(); i++)
+    {
+      rewind(m_runs[i]);
+      if (next(i, heads[i]))
+        queue.push(Rec(key(heads[i].data()), i));
+    }
+
+    while (!queue.empty())
+    {
+      size_t run = queue.top().second;
+      queue.pop();
+
+      put(heads[run].data(), bam, index);
+      if (next(run, heads[run]))
+        queue.push(Rec(key(heads[run].data()), run));
+    }
+  }
+
+private:
+  typedef pair<uint64_t, size_t> Rec;   // key, and offset or run
+
+  struct RecCmp
+  {
+    bool operator() (const Rec & a, const Rec & b) const
+    {
+      return a.first < b.first;
+    }
+  };
+
+  struct RunCmp
+  {
+    bool operator() (const Rec & a, const Rec & b) const
+    {
+      return a.first > b.first || (a.first == b.first && a.second > b.second);
+    }
+  };
+
+  // Unplaced records, with reference -1, go last
+  static uint64_t key(const char * rec)
+  {
+    return (uint64_t) (uint32_t) get32(rec + 4) << 32 | (uint32_t) (get32(rec + 8) + 1);
+  }
+
+  static void put(const char * rec, BgzfWriter & bam, BaiIndex & index)
+  {
+    size_t size = get32(rec) + 4;
+    uint64_t vbeg = bam.tell();
+    bam.write(rec, size);
+    index.add(get32(rec + 4), get32(rec + 8), bamEnd(rec), vbeg, bam.tell());
+  }
+
+  void spill()
+  {
+    if (m_recs.empty()) { return; }
+
+    FILE * fp = tmpfile();
+    if (fp == NULL)
+      AMOS_THROW_IO("Could not open a temporary file to sort the BAM records");
+    m_runs.push_back(fp);
+
+    stable_sort(m_recs.begin(), m_recs.end(), RecCmp());
+    for (size_t i = 0; i < m_recs.size(); i++)
+    {
+      const char * rec = m_data.data() + m_recs[i].second;
+      fwrite(rec, 1, get32(rec) + 4, fp);
+    }
+    if (ferror(fp))
+      AMOS_THROW_IO("Could not write the BAM records to a temporary file");
+
+    m_recs.clear();
+    m_data.clear();
+  }
+
+  bool next(size_t run, string & rec)
+  {
+    char size[4];
+    if (fread(size, 1, 4, m_runs[run]) != 4)
+      return false;
+
+    rec.assign(size, 4);
+    rec.resize(get32(size) + 4);
+    if (fread(&rec[4], 1, rec.size() - 4, m_runs[run]) != rec.size() - 4)
+      AMOS_THROW_IO("Could not read the BAM records back from a temporary file");
+    return true;
+  }
+
+  size_t m_memory;
+  string m_data;                // records added since the last spill
+  vector<Rec> m_recs;           // their keys and offsets in m_data
+  vector<FILE *> m_runs;        // sorted runs
+};
+
+
+//Where the SAM entries go when writing BAM, otherwise they are printed
+BgzfWriter * bam_out = NULL;
+BamSorter * bam_sorter = NULL;
+map<string, int> bam_refids;
+#endif // #ifdef HAVE_LIBZ
+
+void output(Sam_entry & sam_e)
+{
+#ifdef HAVE_LIBZ
+  static string rec;
+
+  if (bam_out != NULL)
+  {
+    rec.clear();
+    sam_e.encodeBam(bam_refids, rec);
+    if (bam_sorter)
+      bam_sorter->add(rec);
+    else
+      bam_out->write(rec.data(), rec.size());
+    return;
+  }
+#endif
+
+  sam_e.printSam();
+}
+
+#ifdef HAVE_LIBZ
+
+//Writes the BAM header for the references, in the order of refs
+void writeBamHeader(BgzfWriter & bam, const vector<pair<string, Size_t> > & refs)
+{
+  stringstream text;
+  text << "@HD\tVN:1.4\tSO:" << (globals.sorted ? "coordinate" : "unsorted") << "\n";
+  for (size_t i = 0; i < refs.size(); i++)
+    text << "@SQ\tSN:" << refs[i].first << "\tLN:" << max(refs[i].second, 1) << "\n";
+  text << "@PG\tID:bank2sam\tPN:bank2sam\n";
+
+  string header("BAM\1", 4);
+  put32(header, text.str().size());
+  header.append(text.str());
+  put32(header, refs.size());
+  for (size_t i = 0; i < refs.size(); i++)
+  {
+    put32(header, refs[i].first.size() + 1);
+    header.append(refs[i].first.c_str(), refs[i].first.size() + 1);
+    put32(header, max(refs[i].second, 1));
+  }
+
+  bam.write(header.data(), header.size());
+}
+#endif // #ifdef HAVE_LIBZ
+
+
 //Reads that have a mate, but where some of the information from the
 //mate is missing (like PNEXT, RNEXT), will be saved in this map
 //until the mate is found and that information found.
@@ -268,13 +886,19 @@ void PrintHelp ()
           
   cerr << ".DESCRIPTION.\n"
        << "  This program takes an AMOS bank directory and dumps its reads \n"
-       << "  as SAM formatted text to stdout.\n\n"
+       << "  as SAM formatted text to stdout, or as a BAM file with -o.\n\n"
        << ".OPTIONS.\n"
        << "  -h          Display help information\n"
        << "  -b <bank>   The bank to be operated on. \n"
        << "  -c          Use contigs as reference\n"
        << "  -s          Use scaffolds as reference\n"
        << "  -i          Use IIDs as query template name (EIDs is default.) \n"
+       << "  -o <file>   Write BAM to file instead of SAM text to stdout, - for stdout\n"
+       << "  -S          Sort the BAM file by coordinate and write its index, file.bai\n"
+       << "  -m <MB>     Memory to sort BAM records in before using temporary files\n"
+       << "              (default 768)\n"
+       << "  -j <n>      Number of threads (default 1). Each thread opens the read\n"
+       << "              and fragment banks\n"
        << ".KEYWORDS.\n"
        << "  converters, bank, contigs\n\n"
        << endl;
@@ -295,6 +919,9 @@ bool GetOptions (int argc, char ** argv)
 {
 	globals.scaffolds = false;
 	globals.use_eids = true;
+	globals.sorted = false;
+	globals.threads = 1;
+	globals.sort_memory = 768;
 	
   while (1)
     {
@@ -306,10 +933,14 @@ bool GetOptions (int argc, char ** argv)
         {"scaffold", no_argument,       0, 'c'},
         {"iids", 	no_argument,      	 0, 'i'},
         {"contigs",   no_argument,         0, 's'},
+        {"bam",       required_argument,         0, 'o'},
+        {"sort",      no_argument,               0, 'S'},
+        {"sort-memory", required_argument,       0, 'm'},
+        {"threads",   required_argument,         0, 'j'},
         {0,           0,                         0, 0}
       };
       
-      ch = getopt_long(argc, argv, "hb:cis", long_options, &option_index);
+      ch = getopt_long(argc, argv, "hb:ciso:Sm:j:", long_options, &option_index);
       if (ch == -1)
         break;
 
@@ -334,6 +965,18 @@ bool GetOptions (int argc, char ** argv)
         case 's':
           globals.scaffolds = true;
           break;
+        case 'o':
+          globals.bam = string(optarg);
+          break;
+        case 'S':
+          globals.sorted = true;
+          break;
+        case 'm':
+          globals.sort_memory = atoi(optarg);
+          break;
+        case 'j':
+          globals.threads = atoi(optarg);
+          break;
         case 'h':
           PrintHelp();
           return (EXIT_SUCCESS);
@@ -345,155 +988,222 @@ bool GetOptions (int argc, char ** argv)
     PrintHelp();
     return (EXIT_SUCCESS);
   } 
+#ifndef HAVE_LIBZ
+  if (!globals.bam.empty()){
+    cerr << "Writing BAM needs zlib, which bank2sam was built without" << endl;
+    exit(EXIT_FAILURE);
+  }
+#endif
+  if (globals.sorted && (globals.bam.empty() || globals.bam == "-")){
+    cerr << "Sorting needs a BAM file name, -o <file>" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (globals.threads < 1)
+    globals.threads = 1;
+  globals.sort_memory = (globals.sort_memory > 0 ? globals.sort_memory : 1) << 20;
   return true;
 }
 
-//c_offset is the contig's offset on a scaffold, if we want scaffolds as RNAME
-void printContig(int c_offset, string scaffeid, Contig_t & contig, Bank_t & read_bank, Bank_t & frag_bank)
+//The name of a contig or scaffold as a reference, its EID or else its IID
+string refName(const Universal_t & obj)
+{
+  string name = obj.getEID();
+  if (name.empty())
+  {
+    stringstream out;
+    out << obj.getIID();
+    name = out.str();
+  }
+  return name;
+}
+
+//One tile of a contig, with its read fetched and its SAM entry made
+struct TileEntry
+{
+  ID_t read_id;
+  ID_t mate_id;      // 0 if the read is not paired
+  Sam_entry sam_e;
+};
+
+//A contig to convert. c_offset is the contig's offset on a scaffold, if we
+//want scaffolds as RNAME
+struct ContigJob
+{
+  int c_offset;
+  string scaffeid;
+  Contig_t contig;
+  vector<TileEntry> tiles;
+};
+
+//Fetches the reads and fragments of a contig and makes their SAM entries.
+//Contigs are prepared on several threads, each with banks of its own.
+void prepareContig(ContigJob & job, Bank_t & read_bank, Bank_t & frag_bank)
 {
   Read_t read;
-  ID_t read_id, mate_id = 0;
-  string mate_rname, mate_qname;
   Fragment_t fragment;
-  //bool mate_rc;
+  Contig_t & contig = job.contig;
+  std::vector<Tile_t> & tiling = contig.getReadTiling();
+  sort(tiling.begin(), tiling.end(), TileOrderCmp());
+
+  //If using scaffolds as RNAME
+  string contigeid = globals.scaffolds ? job.scaffeid : refName(contig);
+  const string cons = contig.getSeqString();
+
+  job.tiles.resize(tiling.size());
+  for (size_t i = 0; i < tiling.size(); i++)
+  {
+    TileEntry & te = job.tiles[i];
+    te.read_id = tiling[i].source;
+    te.mate_id = 0;
+
+    read_bank.fetch(te.read_id, read);
+    //If a read has a fragment IID == 0, it's a unitig.
+    if (read.getFragment() != 0)
+    {
+      frag_bank.fetch(read.getFragment(), fragment);
+      if (fragment.getMatePair().first == te.read_id)
+      {
+        te.mate_id = fragment.getMatePair().second;
+      }
+      else if (fragment.getMatePair().second == te.read_id)
+      {
+        te.mate_id = fragment.getMatePair().first;
+      }
+    }
+
+    te.sam_e.setSam(job.c_offset, read, tiling[i], contig, contigeid, cons, "*", 0, 0);
+  }
+}
+
+//Pairs the prepared reads of a contig with their mates and outputs them,
+//in the order of the contigs
+void printContig(ContigJob & job)
+{
+  ID_t read_id, mate_id;
+  string contigeid, mate_rname, mate_qname;
   int mate_pos;
   int tlen = 0;
   int r_flag = 0, m_flag = 0;
   map<ID_t, Sam_entry>::iterator mate_it;
-  std::vector<Tile_t> & tiling = contig.getReadTiling();
-  sort(tiling.begin(), tiling.end(), TileOrderCmp());
 
-	string contigeid;
-	//If using scaffolds as RNAME
-	if (globals.scaffolds)
-		contigeid = scaffeid;
-	else
-	{
-		// get the contig name
-		contigeid = contig.getEID();
-		if (contigeid.empty())
-		{
-			stringstream out;
-			out << contig.getIID();
-			contigeid = out.str();
-		}
-	}
+  vector<TileEntry>::iterator ti;
+  for (ti = job.tiles.begin(); ti != job.tiles.end(); ti++)
+  {
+    read_id = ti->read_id;
+    mate_id = ti->mate_id;
+    Sam_entry & sam_e = ti->sam_e;
+    contigeid = sam_e.getRNAME();
 
+    // Not paired read or unitig, print
+    if (mate_id == 0)
+    {
+      output(sam_e);
+      continue;
+    }
 
-    const string cons = contig.getSeqString();
+    // See if the mate of the read has already been found
+    mate_it = mated_reads.find(mate_id);
 
-    // convert each read in the contig
-    vector<Tile_t>::const_iterator ti;
-    for (ti =  tiling.begin();
-         ti != tiling.end();
-         ti++)
+    // Paired read, save it until the mate is found
+    if (mate_it == mated_reads.end())
     {
-		read_id = ti->source;
-	  	Sam_entry sam_e;
-      
-    	read_bank.fetch(read_id, read);
-    	//If a read has a fragment IID == 0, it's a unitig.
-		if (read.getFragment() != 0) 
-		{
-      			
-			frag_bank.fetch(read.getFragment(), fragment);
-			if (fragment.getMatePair().first == read_id)
-			{
-				mate_id = fragment.getMatePair().second;
-			}
-			else if (fragment.getMatePair().second == read_id)
-			{
-				mate_id = fragment.getMatePair().first; 
-			}
-					
-			// Not paired read, create SAM entry and print
-			if (mate_id == 0)
-			{
-				sam_e.setSam(c_offset, read, *ti, contig, contigeid, cons, "*", 0, 0);
-				sam_e.printSam();
-			}
-			// Mated read
-			else 
-			{
-				// See if the mate of the read has already been found
-				mate_it = mated_reads.find(mate_id);
-			
-				// Found the mate, create SAM entry and update and print both
-				if (mate_it != mated_reads.end()) 
-				{
-					sam_e.setSam(c_offset, read, *ti, contig, contigeid, cons, "*", 0, 0);
-					
-					//need contigeid, if the mate is reversed or not and pos
-					//to calculate tlen if contigeid is the same
-					mate_rname = (*mate_it).second.getRNAME();
-					mate_pos = (*mate_it).second.getPos();
-					mate_qname = (*mate_it).second.getQNAME();
-					// on the same reference
-					if (mate_rname == contigeid) 
-					{
-						// If mate is reversed, I assume it's the second read
-						// of a template, and the furthest from the start
-						// of the contig
-						if ((*mate_it).second.getRC()) 
-						{
-							tlen = (*mate_it).second.getEndPos() - sam_e.getPos();
-							m_flag = 0x1 + 0x2 + 0x10 + 0x80;
-							r_flag = 0x1 + 0x2 + 0x20 + 0x40;
-							//Update the read with the query template name of mate
-							sam_e.updateMate(r_flag, mate_qname, "=", mate_pos, tlen);
-							(*mate_it).second.updateMate(m_flag, mate_qname, "=", sam_e.getPos(), -tlen);
-							sam_e.printSam();
-							(*mate_it).second.printSam();
-						}
-						else 
-						{	
-							//sam_e is the furthest from the start of the contig
-							tlen = sam_e.getEndPos() - mate_pos;
-							r_flag = 0x1 + 0x2 + 0x10 + 0x80;
-							m_flag = 0x1 + 0x2 + 0x20 + 0x40;
-							//Update the read with the query template name of mate
-							sam_e.updateMate(r_flag, mate_qname, "=", mate_pos, -tlen);
-							(*mate_it).second.updateMate(m_flag, mate_qname, "=", sam_e.getPos(), tlen);
-							(*mate_it).second.printSam();
-							sam_e.printSam();
-						}	
-						mated_reads.erase(mate_it);
-					}
-					// not on same reference
-					else
-					{
-						if ((*mate_it).second.getRC()) 
-						{
-							m_flag = 0x1 + 0x2 + 0x10 + 0x80;
-							r_flag = 0x1 + 0x2 + 0x20 + 0x40;
-						}
-						else 
-						{
-							r_flag = 0x1 + 0x2 + 0x10 + 0x80;
-							m_flag = 0x1 + 0x2 + 0x20 + 0x40;
-						}
-						sam_e.updateMate(r_flag, mate_qname, mate_rname, mate_pos, 0);
-						(*mate_it).second.updateMate(m_flag, mate_qname, contigeid, sam_e.getPos(), 0);
-						sam_e.printSam();
-						(*mate_it).second.printSam();
-						mated_reads.erase(mate_it);
-					}
-				}
-				// Paired read, create SAM entry and save
-				else
-				{
-					sam_e.setSam(c_offset, read, *ti, contig, contigeid, cons, "*", 0, 0);
-					mated_reads[read_id] = sam_e;
-				}
-			}
-		}
-		// Adding unitig as read.
-        else
-        {
-        	sam_e.setSam(c_offset, read, *ti, contig, contigeid, cons, "*", 0, 0);
-			sam_e.printSam();
-        }
-    }	
+      mated_reads[read_id] = sam_e;
+      continue;
+    }
+
+    // Found the mate, update and print both
+    //need contigeid, if the mate is reversed or not and pos
+    //to calculate tlen if contigeid is the same
+    mate_rname = (*mate_it).second.getRNAME();
+    mate_pos = (*mate_it).second.getPos();
+    mate_qname = (*mate_it).second.getQNAME();
+    // on the same reference
+    if (mate_rname == contigeid)
+    {
+      // If mate is reversed, I assume it's the second read
+      // of a template, and the furthest from the start
+      // of the contig
+      if ((*mate_it).second.getRC())
+      {
+        tlen = (*mate_it).second.getEndPos() - sam_e.getPos();
+        m_flag = 0x1 + 0x2 + 0x10 + 0x80;
+        r_flag = 0x1 + 0x2 + 0x20 + 0x40;
+        //Update the read with the query template name of mate
+        sam_e.updateMate(r_flag, mate_qname, "=", mate_pos, tlen);
+        (*mate_it).second.updateMate(m_flag, mate_qname, "=", sam_e.getPos(), -tlen);
+        output(sam_e);
+        output((*mate_it).second);
+      }
+      else
+      {
+        //sam_e is the furthest from the start of the contig
+        tlen = sam_e.getEndPos() - mate_pos;
+        r_flag = 0x1 + 0x2 + 0x10 + 0x80;
+        m_flag = 0x1 + 0x2 + 0x20 + 0x40;
+        //Update the read with the query template name of mate
+        sam_e.updateMate(r_flag, mate_qname, "=", mate_pos, -tlen);
+        (*mate_it).second.updateMate(m_flag, mate_qname, "=", sam_e.getPos(), tlen);
+        output((*mate_it).second);
+        output(sam_e);
+      }
+    }
+    // not on same reference
+    else
+    {
+      if ((*mate_it).second.getRC())
+      {
+        m_flag = 0x1 + 0x2 + 0x10 + 0x80;
+        r_flag = 0x1 + 0x2 + 0x20 + 0x40;
+      }
+      else
+      {
+        r_flag = 0x1 + 0x2 + 0x10 + 0x80;
+        m_flag = 0x1 + 0x2 + 0x20 + 0x40;
+      }
+      sam_e.updateMate(r_flag, mate_qname, mate_rname, mate_pos, 0);
+      (*mate_it).second.updateMate(m_flag, mate_qname, contigeid, sam_e.getPos(), 0);
+      output(sam_e);
+      output((*mate_it).second);
+    }
+    mated_reads.erase(mate_it);
+  }
+
+  job.tiles.clear();
+}
+
+//Prepares a batch of contigs on the threads, then outputs them in order
+void printContigs(vector<ContigJob> & batch, int n,
+                  vector<Bank_t *> & read_banks, vector<Bank_t *> & frag_banks)
+{
+  string error;
+
+#ifdef AMOS_HAVE_OPENMP
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(globals.threads)
+#endif
+  for (int i = 0; i < n; i++)
+  {
+    int t = 0;
+#ifdef AMOS_HAVE_OPENMP
+    t = omp_get_thread_num();
+#endif
+    try
+    {
+      prepareContig(batch[i], *read_banks[t], *frag_banks[t]);
+    }
+    catch (const Exception_t & e)
+    {
+#ifdef AMOS_HAVE_OPENMP
+      #pragma omp critical
+#endif
+      error = e.what();
+    }
+  }
+
+  if (!error.empty())
+    AMOS_THROW(error);
+
+  for (int i = 0; i < n; i++)
+    printContig(batch[i]);
 }
 
 int main (int argc, char ** argv)
@@ -506,70 +1216,170 @@ int main (int argc, char ** argv)
   
 	if (globals.bank.length() > 0) {
 		cerr << "Processing " << globals.bank << " at " << Date() << endl;
-  
-		Bank_t read_bank(Read_t::NCODE);
-		Bank_t frag_bank(Fragment_t::NCODE);
-		read_bank.open(globals.bank, B_READ);
-		frag_bank.open(globals.bank, B_READ);
-    	Contig_t contig;
-    	
-    	//Use contigs as reference (RNAME)
-    	if(!globals.scaffolds) 
-    	{
-    		BankStream_t contig_bank(Contig_t::NCODE);
-    		contig_bank.open(globals.bank, B_READ);
-			
-			while (contig_bank >> contig)
-    		{
-    			printContig(0, "", contig, read_bank, frag_bank);
-    		}
-    	}
-    	// Use scaffolds as reference (RNAME)
-    	else
-		{
-			BankStream_t scaffold_bank(Scaffold_t::NCODE);
-			Bank_t contig_bank(Contig_t::NCODE);
-	
-			// Opens the scaffold and contig banks
-			scaffold_bank.open(globals.bank, B_READ);
-			contig_bank.open(globals.bank, B_READ);
-			
-			Scaffold_t scaffold;
-			
-			while (scaffold_bank >> scaffold)
-			{
-				string scaffeid = scaffold.getEID();
-				if (scaffeid.empty())
-				{
-					stringstream out;
-					out << scaffold.getIID();
-					scaffeid = out.str();
-				}
-				// Might run into problems with negative gaps...
-				vector<Tile_t> & contigs = scaffold.getContigTiling();
-  				vector<Tile_t>::const_iterator ci;
-  				sort(contigs.begin(), contigs.end(), TileOrderCmp());
-
-  				for (ci = contigs.begin(); ci != contigs.end(); ci++)
-  				{
-  					contig_bank.fetch(ci->source, contig);
-  					printContig(ci->offset, scaffeid, contig, read_bank, frag_bank);
-  				}
-  			}
-  			scaffold_bank.close();
-  			contig_bank.close();
-		}
-		// Need to check whether all reads have been printed or not
-		while (!mated_reads.empty())
-		{
-			mated_reads.begin()->second.printSam();
-			mated_reads.erase(mated_reads.begin());
-		}
 
-    	read_bank.close();
-    	
-    	frag_bank.close();
+    vector<Bank_t *> read_banks, frag_banks;
+    int status = EXIT_SUCCESS;
+
+    try
+    {
+      //Every thread fetches its reads and fragments through banks of its own
+      for (int t = 0; t < globals.threads; t++)
+      {
+        read_banks.push_back(new Bank_t(Read_t::NCODE));
+        frag_banks.push_back(new Bank_t(Fragment_t::NCODE));
+        read_banks.back()->open(globals.bank, B_READ);
+        frag_banks.back()->open(globals.bank, B_READ);
+      }
+
+      BankStream_t contig_stream(Contig_t::NCODE);
+      BankStream_t scaffold_bank(Scaffold_t::NCODE);
+      Bank_t contig_bank(Contig_t::NCODE);
+
+      if (!globals.scaffolds)
+      {
+        contig_stream.open(globals.bank, B_READ);
+      }
+      else
+      {
+        // Opens the scaffold and contig banks
+        scaffold_bank.open(globals.bank, B_READ);
+        contig_bank.open(globals.bank, B_READ);
+      }
+
+#ifdef HAVE_LIBZ
+      BgzfWriter bam;
+      BamSorter sorter(globals.sort_memory);
+      vector<pair<string, Size_t> > refs;
+
+      if (!globals.bam.empty())
+      {
+        //The header lists the references in bank order, so it takes a pass
+        //over the contigs or scaffolds of its own
+        if (!globals.scaffolds)
+        {
+          Contig_t contig;
+          while (contig_stream >> contig)
+            refs.push_back(make_pair(refName(contig), contig.getUngappedLength()));
+          contig_stream.seekg(1);
+        }
+        else
+        {
+          Scaffold_t scaffold;
+          while (scaffold_bank >> scaffold)
+            refs.push_back(make_pair(refName(scaffold), scaffold.getSpan()));
+          scaffold_bank.seekg(1);
+        }
+
+        for (size_t i = 0; i < refs.size(); i++)
+          bam_refids.insert(make_pair(refs[i].first, (int) i));
+
+        bam.open(globals.bam, globals.threads);
+        writeBamHeader(bam, refs);
+        bam_out = &bam;
+        if (globals.sorted)
+          bam_sorter = &sorter;
+      }
+#endif
+
+      //Contigs are prepared a batch at a time, a batch ends early once it
+      //holds enough reads to keep the threads busy
+      vector<ContigJob> batch(globals.threads * 16);
+      const size_t MAX_TILES = globals.threads * 65536;
+      size_t tiles = 0;
+      int n = 0;
+
+      //Use contigs as reference (RNAME)
+      if (!globals.scaffolds)
+      {
+        while (contig_stream >> batch[n].contig)
+        {
+          batch[n].c_offset = 0;
+          tiles += batch[n].contig.getReadTiling().size();
+
+          if (++n == (int) batch.size() || tiles >= MAX_TILES)
+          {
+            printContigs(batch, n, read_banks, frag_banks);
+            n = 0;
+            tiles = 0;
+          }
+        }
+        contig_stream.close();
+      }
+      // Use scaffolds as reference (RNAME)
+      else
+      {
+        Scaffold_t scaffold;
+
+        while (scaffold_bank >> scaffold)
+        {
+          string scaffeid = refName(scaffold);
+
+          // Might run into problems with negative gaps...
+          vector<Tile_t> & contigs = scaffold.getContigTiling();
+          vector<Tile_t>::const_iterator ci;
+          sort(contigs.begin(), contigs.end(), TileOrderCmp());
+
+          for (ci = contigs.begin(); ci != contigs.end(); ci++)
+          {
+            contig_bank.fetch(ci->source, batch[n].contig);
+            batch[n].c_offset = ci->offset;
+            batch[n].scaffeid = scaffeid;
+            tiles += batch[n].contig.getReadTiling().size();
+
+            if (++n == (int) batch.size() || tiles >= MAX_TILES)
+            {
+              printContigs(batch, n, read_banks, frag_banks);
+              n = 0;
+              tiles = 0;
+            }
+          }
+        }
+        scaffold_bank.close();
+        contig_bank.close();
+      }
+      printContigs(batch, n, read_banks, frag_banks);
+
+      // Need to check whether all reads have been printed or not
+      while (!mated_reads.empty())
+      {
+        output(mated_reads.begin()->second);
+        mated_reads.erase(mated_reads.begin());
+      }
+
+#ifdef HAVE_LIBZ
+      if (bam_sorter)
+      {
+        BaiIndex index(refs.size());
+        sorter.finish(bam, index);
+        bam.close();
+        index.write(globals.bam + ".bai", bam);
+      }
+      else if (bam_out)
+      {
+        bam.close();
+      }
+#endif
+    }
+    catch (const Exception_t & e)
+    {
+      cerr << "FATAL: " << e.what() << endl
+           << "  there has been a fatal error, abort" << endl;
+      status = EXIT_FAILURE;
+    }
+#ifdef HAVE_LIBZ
+    bam_out = NULL;
+    bam_sorter = NULL;
+#endif
+
+    //Deleting a bank closes it
+    for (size_t t = 0; t < read_banks.size(); t++)
+    {
+      delete read_banks[t];
+      delete frag_banks[t];
     }
+    if (status != EXIT_SUCCESS)
+      return status;
+  }
 	
 	cerr << "End: " << Date() << endl;
   	return EXIT_SUCCESS;
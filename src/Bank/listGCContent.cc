@@ -11,6 +11,7 @@ bool   OPT_BankSpy = false;
 bool   OPT_UseEIDs = false;
 bool   OPT_DumpContigs = false;
 bool   OPT_UseRaw = false;
+int    OPT_Threads = 1;
 
 
 string OPT_IIDFile;  // Filename of IIDs to dump
@@ -43,7 +44,22 @@ void PrintHelp (const char * s);
 void PrintUsage (const char * s);
 
 
-void dumpRead(Read_t & red)
+//-- Formats the GC content line of an object
+string formatGC(const string & eid, ID_t iid, double gc)
+{
+  char buffer[64];
+
+  if (OPT_UseEIDs)
+  {
+    snprintf(buffer, sizeof(buffer), "\t%0.06f\n", gc);
+    return eid + buffer;
+  }
+
+  snprintf(buffer, sizeof(buffer), "%d\t%0.06f\n", iid, gc);
+  return buffer;
+}
+
+string readGC(Read_t & red)
 {
   Range_t rng = red.getClearRange();
 
@@ -53,27 +69,50 @@ void dumpRead(Read_t & red)
     rng.end = red.getLength();
   }
 
-  if (OPT_UseEIDs)
-  {
-    printf("%s\t%0.06f\n", red.getEID().c_str(), red.getGCContent(rng));
-  }
-  else
-  {
-    printf("%d\t%0.06f\n", red.getIID(), red.getGCContent(rng));
-  }
+  return formatGC(red.getEID(), red.getIID(), red.getGCContent(rng));
+}
+
+string contigGC(Contig_t & ctg)
+{
+  return formatGC(ctg.getEID(), ctg.getIID(), ctg.getGCContent());
+}
+
+void dumpRead(Read_t & red)
+{
+  fputs(readGC(red).c_str(), stdout);
 }
 
 void dumpContig(Contig_t & ctg)
 {
-  if (OPT_UseEIDs)
+  fputs(contigGC(ctg).c_str(), stdout);
+}
+
+
+//-- The GC content line of every object of a bank scan
+struct GCScan_t
+{
+  typedef string result_type;
+
+  bool operator() (Read_t & red, string & line)
   {
-    printf("%s\t%0.06f\n", ctg.getEID().c_str(), ctg.getGCContent());
+    line = readGC(red);
+    return true;
   }
-  else
+
+  bool operator() (Contig_t & ctg, string & line)
   {
-    printf("%d\t%0.06f\n", ctg.getIID(), ctg.getGCContent());
+    line = contigGC(ctg);
+    return true;
   }
-}
+};
+
+struct Print_t
+{
+  void operator() (const string & line)
+  {
+    fputs(line.c_str(), stdout);
+  }
+};
 
 
 
@@ -161,20 +200,17 @@ int main (int argc, char ** argv)
     }
     else
     {
-      //-- Iterate through each object in the bank
+      //-- Iterate through each object in the bank, in bank order
+      GCScan_t gc;
+      Print_t print;
+
       if (OPT_DumpContigs)
       {
-        while (ctg_bank >> ctg)
-        {
-          dumpContig(ctg);
-        }
+        parallelScan<Contig_t> (ctg_bank, OPT_Threads, gc, print);
       }
       else
       {
-        while (red_bank >> red)
-        {
-          dumpRead(red);
-        }
+        parallelScan<Read_t> (red_bank, OPT_Threads, gc, print);
       }
     }
   }
@@ -197,7 +233,7 @@ void ParseArgs (int argc, char ** argv)
   int ch, errflg = 0;
   optarg = NULL;
 
-  while ( !errflg && ((ch = getopt (argc, argv, "hsverCE:I:")) != EOF) )
+  while ( !errflg && ((ch = getopt (argc, argv, "hsverCE:I:j:")) != EOF) )
     switch (ch)
       {
       case 'e': OPT_UseEIDs = true;     break;
@@ -205,6 +241,7 @@ void ParseArgs (int argc, char ** argv)
       case 'I': OPT_IIDFile = optarg;   break;
       case 'r': OPT_UseRaw = true;      break;
       case 'C': OPT_DumpContigs = true; break;
+      case 'j': OPT_Threads = atoi (optarg); break;
 
       case 'h':
         PrintHelp (argv[0]);
@@ -251,6 +288,7 @@ void PrintHelp (const char * s)
         << "  -C          Dump Contigs instead of reads\n"
         << "  -E file     Dump just the eids listed in file\n"
         << "  -I file     Dump just the iids listed in file\n"
+        << "  -j n        Number of threads for a whole bank (default 1)\n"
         << "\n.KEYWORDS.\n"
         << "  amos bank, GC content\n"
         << endl;
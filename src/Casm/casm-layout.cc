@@ -24,7 +24,11 @@
 #include <sstream>
 #include <iostream>
 #include <cassert>
+#include <cctype>
 #include <unistd.h>
+#ifdef AMOS_HAVE_OPENMP
+#include <omp.h>
+#endif
 using namespace std;
 
 
@@ -48,6 +52,7 @@ int     OPT_MinOverlap       = 10;      // minimum overlap between reads
 int     OPT_MaxTrimLen       = 20;      // maximum ignorable trim length
 int     OPT_MaxGap           = 10000;   // maximum gap in an alignment chain
 int     OPT_Seed             = -1;      // random seed
+int     OPT_Threads          =  1;      // number of worker threads
 
 float   OPT_Majority         = 70.0;    // majority needed to call a conflict
 float   OPT_MinCoverage      = 25.0;    // min coverage to tile
@@ -62,6 +67,8 @@ const char REVERSE_CHAR  = '-';
 
 const int FUZZY      =  10;     // fuzzy equals tolerance
 
+const long int ALIGN_CHUNK_SIZE = 16 * 1024 * 1024;  // alignment bytes per parse
+
 struct ReadMap_t;
 struct Contig_t;
 
@@ -165,9 +172,7 @@ struct ReadMap_t
   ReadMap_t ( ) { place = NULL; exclude = false; }
   ~ReadMap_t ( )
   {
-    vector<ReadAlign_t *>::iterator rapi;
-    for ( rapi = all . begin( ); rapi != all . end( ); ++ rapi )
-      delete (*rapi);
+    // the alignments themselves belong to the mapping's arena
     list<ReadAlignChain_t *>::iterator rcpi;
     for ( rcpi = best . begin( ); rcpi != best . end( ); ++ rcpi )
       delete (*rcpi);
@@ -178,6 +183,7 @@ struct Mapping_t
 {
   map<string, Reference_t> references;  // map of references
   vector<ReadMap_t *> reads;            // vector of reads
+  vector< vector<ReadAlign_t> > aligns; // alignment arena, a block per chunk
 
   ~Mapping_t ( )
   {
@@ -187,6 +193,14 @@ struct Mapping_t
   }
 };
 
+struct AlignRecord_t
+{
+  string idR;                           // reference ID
+  AMOS::ID_t idQ;                       // read ID
+  long int lenR, lenQ;                  // reference and read lengths
+  long int n;                           // number of alignments in the record
+};
+
 struct Tile_t
 {
   ReadMap_t * read;
@@ -251,6 +265,12 @@ struct ConflictCmp_t
   }
 };
 
+struct ConflictPosCmp_t
+{
+  bool operator( ) (const Conflict_t * A, long int pos)
+  { return ( A -> pos < pos ); }
+};
+
 struct ReadAlignCmp_t
 {
   bool operator( ) (const ReadAlign_t * A, const ReadAlign_t * B)
@@ -351,6 +371,8 @@ void Assemble (Mapping_t & mapping, Assembly_t & assembly);
 //----------------------------------------------------------- ChainAligns ----//
 //! \brief Run LAS and store the best alignment chains for each read
 //!
+//! Reads are chained independently, OPT_Threads at a time.
+//!
 //! \param mapping The read mapping
 //! \return void
 //!
@@ -372,6 +394,9 @@ void CleanContigs (Assembly_t & assembly);
 //--------------------------------------------------------- FindConflicts ----//
 //! \brief Find and store conflicts between the reads and the refs
 //!
+//! Each reference only collects conflicts from the reads placed on it, so
+//! the references are processed independently, OPT_Threads at a time.
+//!
 //! \param mapping The read mapping
 //! \return void
 //!
@@ -381,6 +406,10 @@ void FindConflicts (Mapping_t & mapping);
 //------------------------------------------------------------ ParseAlign ----//
 //! \brief Parse, sort and store the alignment input
 //!
+//! The delta file is cut into chunks at record boundaries and the chunks are
+//! parsed OPT_Threads at a time into the mapping's alignment arena. The
+//! records are then merged in file order.
+//!
 //! \param mapping The uninitialized read mapping
 //! \post All reads sorted by read ID
 //! \post All alignments are sorted by lo read coordinate
@@ -390,6 +419,24 @@ void FindConflicts (Mapping_t & mapping);
 void ParseAlign (Mapping_t & mapping);
 
 
+//------------------------------------------------------- ParseAlignChunk ----//
+//! \brief Parse the delta records in a chunk of the alignment input
+//!
+//! Alignment coordinates are stored as read, i.e. loR, hiR, lo and hi hold
+//! the start and end in the reference and read, and ref and ori are unset.
+//!
+//! \param p Start of the chunk, must be the start of a record
+//! \param end End of the chunk
+//! \param promer The alignments are PROMER alignments
+//! \param records The parsed record headers
+//! \param aligns The parsed alignments, in record order
+//! \return false if the chunk could not be parsed, true otherwise
+//!
+bool ParseAlignChunk (const char * p, const char * end, bool promer,
+		      vector<AlignRecord_t> & records,
+		      vector<ReadAlign_t> & aligns);
+
+
 //------------------------------------------------------------ ParseMates ----//
 //! \brief Parse, sort and store the matepair input
 //!
@@ -527,6 +574,43 @@ inline long int lmax (long int a, long int b)
 { return (a < b ? b : a); }
 
 
+//------------------------------------------------------------- ParseLong ----//
+inline bool ParseLong (const char * & p, const char * end, long int & val)
+{
+  bool neg = false;
+  while ( p < end  &&  isspace (*p) )
+    ++ p;
+  if ( p < end  &&  (*p == '-'  ||  *p == '+') )
+    neg = *(p ++) == '-';
+  if ( p == end  ||  !isdigit (*p) )
+    return false;
+  for ( val = 0; p < end  &&  isdigit (*p); ++ p )
+    val = val * 10 + (*p - '0');
+  if ( neg )
+    val = -val;
+  return true;
+}
+
+
+//------------------------------------------------------------ ParseToken ----//
+inline bool ParseToken (const char * & p, const char * end, string & tok)
+{
+  const char * beg;
+  while ( p < end  &&  isspace (*p) )
+    ++ p;
+  for ( beg = p; p < end  &&  !isspace (*p); ++ p );
+  tok . assign (beg, p - beg);
+  return p != beg;
+}
+
+
+//-------------------------------------------------------------- SkipLine ----//
+inline void SkipLine (const char * & p, const char * end)
+{
+  while ( p < end  &&  *(p ++) != '\n' );
+}
+
+
 //---------------------------------------------------------- CallConflict ----//
 inline void CallConflict (Conflict_t * c)
 {
@@ -885,108 +969,121 @@ void ChainAligns (Mapping_t & mapping)
     long int from;
   };
 
-  ScoreLAS * las = NULL;
+  long int r, nreads = mapping . reads . size( );
 
-  bool olapflag;
-  long int i, j, n, best;
-  long int olap1, olap2, olap, len;
+  //-- Chains never span reads, so each thread takes whole reads and keeps
+  //   its own scoring matrix
+#ifdef AMOS_HAVE_OPENMP
+  #pragma omp parallel num_threads(OPT_Threads)
+#endif
+  {
+    ScoreLAS * las = NULL;
 
-  vector<ReadMap_t *>::iterator rmpi;
-  list<ReadAlignChain_t *>::iterator rcpi;
-  ReadAlignChain_t * bestchain, * currchain;
+    bool olapflag;
+    long int i, j, n, best;
+    long int olap1, olap2, olap, len;
 
-  //-- For each read in the mapping
-  for ( rmpi  = mapping . reads . begin( );
-	rmpi != mapping . reads . end( ); ++ rmpi )
-    {
-      //-- Initialize the dynamic programming matrix
-      n = (*rmpi) -> all . size( );
-      las = (ScoreLAS *) AMOS::SafeRealloc (las, sizeof (ScoreLAS) * n);
-      for ( i = 0; i < n; i ++ )
-	{
-	  las [i] . a = (*rmpi) -> all[i];
-	  las [i] . score = las [i] . a -> hi - las [i] . a -> lo + 1;
-	  las [i] . from = -1;
-	}
+    vector<ReadMap_t *>::iterator rmpi;
+    list<ReadAlignChain_t *>::iterator rcpi;
+    ReadAlignChain_t * bestchain, * currchain;
+
+    //-- For each read in the mapping
+#ifdef AMOS_HAVE_OPENMP
+    #pragma omp for schedule(dynamic, 256)
+#endif
+    for ( r = 0; r < nreads; r ++ )
+      {
+	rmpi = mapping . reads . begin( ) + r;
 
-      //-- Isn't it dynamic?
-      for ( i = 0; i < n; i ++ )
-	for ( j = 0; j < i; j ++ )
+	//-- Initialize the dynamic programming matrix
+	n = (*rmpi) -> all . size( );
+	las = (ScoreLAS *) AMOS::SafeRealloc (las, sizeof (ScoreLAS) * n);
+	for ( i = 0; i < n; i ++ )
 	  {
-	    if ( las [i] . a -> ref != las [j] . a -> ref  ||
-		 las [i] . a -> ori != las [j] . a -> ori )
-	      continue;
-
-	    olap1 = las [j] . a -> hiR - las [i] . a -> loR + 1;
-	    if ( OPT_MaxGap >= 0  &&  olap1 < -(OPT_MaxGap) )
-	      continue;
-	    olap = olap1 > 0 ? olap1 : 0;
-
-	    olap2 = las [j] . a -> hi - las [i] . a -> lo + 1;
-	    if ( OPT_MaxGap >= 0  &&  olap2 < -(OPT_MaxGap) )
-	      continue;
-	    olap = olap > olap2 ? olap : olap2;
-
-	    len = las [i] . a -> hi - las [i] . a -> lo + 1;
-	    if ( las [j] . score + len - olap > las [i] . score )
-	      {
-		las [i] . from = j;
-		las [i] . score = las [j] . score + len - olap;
-	      }
+	    las [i] . a = (*rmpi) -> all[i];
+	    las [i] . score = las [i] . a -> hi - las [i] . a -> lo + 1;
+	    las [i] . from = -1;
 	  }
 
-      //-- Store all the non-redundant chains and store sorted by score
-      bestchain = NULL;
-      while (true)
-	{
-	  best = 0;
-	  for ( i = 1; i < n; i ++ )
-	    if ( las [i] . score > las [best] . score )
-	      best = i;
-	  if ( las [best] . score <= 0 )
-	    break;
-
-	  olapflag = false;
-	  for ( i = best; las [i] . from >= 0; i = las [i] . from )
+	//-- Isn't it dynamic?
+	for ( i = 0; i < n; i ++ )
+	  for ( j = 0; j < i; j ++ )
 	    {
-	      if ( las [i] . score == 0 )
-		olapflag = true;
-	      las [i] . score = 0;
-	      las [i] . a -> from = las [las [i] . from] . a;
-	    }
-	  if ( las [i] . score == 0 )
-	    olapflag = true;
-	  las [i] . score = 0;
-	  las [i] . a -> from = NULL;
+	      if ( las [i] . a -> ref != las [j] . a -> ref  ||
+		   las [i] . a -> ori != las [j] . a -> ori )
+		continue;
 
-	  if ( !olapflag )
-	    {
-	      currchain = new ReadAlignChain_t (*rmpi, las [best] . a);
-	      (*rmpi) -> best . push_back (currchain);
-	      if ( bestchain == NULL )
-		bestchain = currchain;
-	      else if ( IsBetterChain (currchain, bestchain, *rmpi) )
-		bestchain = currchain;
-	    }
-	}
+	      olap1 = las [j] . a -> hiR - las [i] . a -> loR + 1;
+	      if ( OPT_MaxGap >= 0  &&  olap1 < -(OPT_MaxGap) )
+		continue;
+	      olap = olap1 > 0 ? olap1 : 0;
 
-      //-- Keep only the 'best' chains, thus best . size > 0 == ambiguity
-      //   i.e. within OPT_MaxCoverageDiff of the longest and within
-      //   OPT_MaxIdentityDiff of the longest (with the higest idy)
-      rcpi = (*rmpi) -> best . begin( );
-      while ( rcpi != (*rmpi) -> best . end( ) )
-	{
-	  if ( IsEqualChain (*rcpi, bestchain, *rmpi) )
-	    ++ rcpi;
-	  else
-	    {
-	      delete (*rcpi);
-	      rcpi = (*rmpi) -> best . erase (rcpi);
+	      olap2 = las [j] . a -> hi - las [i] . a -> lo + 1;
+	      if ( OPT_MaxGap >= 0  &&  olap2 < -(OPT_MaxGap) )
+		continue;
+	      olap = olap > olap2 ? olap : olap2;
+
+	      len = las [i] . a -> hi - las [i] . a -> lo + 1;
+	      if ( las [j] . score + len - olap > las [i] . score )
+		{
+		  las [i] . from = j;
+		  las [i] . score = las [j] . score + len - olap;
+		}
 	    }
-	}
-    }
 
-  free (las);
+	//-- Store all the non-redundant chains and store sorted by score
+	bestchain = NULL;
+	while (true)
+	  {
+	    best = 0;
+	    for ( i = 1; i < n; i ++ )
+	      if ( las [i] . score > las [best] . score )
+		best = i;
+	    if ( las [best] . score <= 0 )
+	      break;
+
+	    olapflag = false;
+	    for ( i = best; las [i] . from >= 0; i = las [i] . from )
+	      {
+		if ( las [i] . score == 0 )
+		  olapflag = true;
+		las [i] . score = 0;
+		las [i] . a -> from = las [las [i] . from] . a;
+	      }
+	    if ( las [i] . score == 0 )
+	      olapflag = true;
+	    las [i] . score = 0;
+	    las [i] . a -> from = NULL;
+
+	    if ( !olapflag )
+	      {
+		currchain = new ReadAlignChain_t (*rmpi, las [best] . a);
+		(*rmpi) -> best . push_back (currchain);
+		if ( bestchain == NULL )
+		  bestchain = currchain;
+		else if ( IsBetterChain (currchain, bestchain, *rmpi) )
+		  bestchain = currchain;
+	      }
+	  }
+
+	//-- Keep only the 'best' chains, thus best . size > 0 == ambiguity
+	//   i.e. within OPT_MaxCoverageDiff of the longest and within
+	//   OPT_MaxIdentityDiff of the longest (with the higest idy)
+	rcpi = (*rmpi) -> best . begin( );
+	while ( rcpi != (*rmpi) -> best . end( ) )
+	  {
+	    if ( IsEqualChain (*rcpi, bestchain, *rmpi) )
+	      ++ rcpi;
+	    else
+	      {
+		delete (*rcpi);
+		rcpi = (*rmpi) -> best . erase (rcpi);
+	      }
+	  }
+      }
+
+    free (las);
+  }
 }
 
 
@@ -1047,69 +1144,88 @@ void CleanContigs (Assembly_t & assembly)
 //--------------------------------------------------------- FindConflicts ----//
 void FindConflicts (Mapping_t & mapping)
 {
-  ReadAlign_t * curraln;
-  ReadMap_t * currmap;
-  pair<long int, long int> gap;
+  long int r, nrefs = mapping . references . size( );
+  vector<Reference_t *> refs;
+  vector< vector<ReadMap_t *> > refreads (nrefs);
+  map<const Reference_t *, long int> refindex;
+  map<string, Reference_t>::iterator rmi;
   vector<ReadMap_t *>::iterator rmpi;
-  set<ReadMap_t *> yay;
-
 
-  //-- For each read
+  //-- Group the placed reads by reference, keeping their order
+  for ( rmi  = mapping . references . begin( );
+	rmi != mapping . references . end( ); ++ rmi )
+    {
+      refindex [&(rmi -> second)] = refs . size( );
+      refs . push_back (&(rmi -> second));
+    }
   for ( rmpi  = mapping . reads . begin( );
 	rmpi != mapping . reads . end( ); ++ rmpi )
+    if ( (*rmpi) -> place != NULL )
+      refreads [refindex [(*rmpi) -> place -> head -> ref]] . push_back (*rmpi);
+
+  //-- A placement chain lies on a single reference, so each reference
+  //   collects and merges its own conflicts
+#ifdef AMOS_HAVE_OPENMP
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(OPT_Threads)
+#endif
+  for ( r = 0; r < nrefs; r ++ )
     {
-      if ( (*rmpi) -> place == NULL )
-	continue;
+      Reference_t * refp = refs [r];
+      ReadAlign_t * curraln;
+      ReadMap_t * currmap;
+      pair<long int, long int> gap;
+      vector<ReadMap_t *>::iterator rrmpi;
+      set<ReadMap_t *> yay;
+
+      //-- For each read placed on the reference
+      for ( rrmpi  = refreads [r] . begin( );
+	    rrmpi != refreads [r] . end( ); ++ rrmpi )
+	{
+	  currmap = *rrmpi;
+	  curraln = currmap -> place -> head;
 
-      currmap = *rmpi;
-      curraln = currmap -> place -> head;
+	  //-- If there is a HIBREAK
+	  if ( currmap -> place -> end - currmap -> place -> tend > OPT_MaxTrimLen )
+	    curraln -> ref -> conflicts . push_back
+	      (new Conflict_t (Conflict_t::HIBREAK, curraln -> hiR, 0, 0, currmap));
 
-      //-- If there is a HIBREAK
-      if ( currmap -> place -> end - currmap -> place -> tend > OPT_MaxTrimLen )
-	curraln -> ref -> conflicts . push_back
-	  (new Conflict_t (Conflict_t::HIBREAK, curraln -> hiR, 0, 0, currmap));
-      
-      for ( ; curraln -> from != NULL; curraln = curraln -> from )
-	{
-	  gap = GapDistance (curraln -> from, curraln);
-	  //-- If there is an INDEL, push it and it's break points
-	  if ( labs (gap . first) > FUZZY  ||  labs (gap . second) > FUZZY )
+	  for ( ; curraln -> from != NULL; curraln = curraln -> from )
 	    {
-	      curraln -> ref -> conflicts . push_back
-		(new Conflict_t (Conflict_t::INDEL,
-				 curraln -> from -> hiR,
-				 gap . first, gap . second, currmap));
-	      curraln -> ref -> conflicts . push_back
-		(new Conflict_t (Conflict_t::HIBREAK,
-				 curraln -> from -> hiR,
-				 0, 0, currmap));
-	      curraln -> ref -> conflicts . push_back
-		(new Conflict_t (Conflict_t::LOBREAK,
-				 curraln -> from -> hiR + gap . first + 1,
-				 0, 0, currmap));
+	      gap = GapDistance (curraln -> from, curraln);
+	      //-- If there is an INDEL, push it and it's break points
+	      if ( labs (gap . first) > FUZZY  ||  labs (gap . second) > FUZZY )
+		{
+		  curraln -> ref -> conflicts . push_back
+		    (new Conflict_t (Conflict_t::INDEL,
+				     curraln -> from -> hiR,
+				     gap . first, gap . second, currmap));
+		  curraln -> ref -> conflicts . push_back
+		    (new Conflict_t (Conflict_t::HIBREAK,
+				     curraln -> from -> hiR,
+				     0, 0, currmap));
+		  curraln -> ref -> conflicts . push_back
+		    (new Conflict_t (Conflict_t::LOBREAK,
+				     curraln -> from -> hiR + gap . first + 1,
+				     0, 0, currmap));
+		}
 	    }
-	}
 
-      //-- If there is a LOBREAK
-      if ( currmap -> place -> tbeg - currmap -> place -> beg > OPT_MaxTrimLen )
-	curraln -> ref -> conflicts . push_back
-	  (new Conflict_t (Conflict_t::LOBREAK, curraln -> loR, 0, 0, currmap));
-    }
+	  //-- If there is a LOBREAK
+	  if ( currmap -> place -> tbeg - currmap -> place -> beg > OPT_MaxTrimLen )
+	    curraln -> ref -> conflicts . push_back
+	      (new Conflict_t (Conflict_t::LOBREAK, curraln -> loR, 0, 0, currmap));
+	}
 
-  //-- For each reference, sort and remove redundant conflicts
-  map<string, Reference_t>::iterator rmi;
-  list<Conflict_t *>::iterator first, last, next, nxtf;
-  for ( rmi  = mapping . references . begin( );
-	rmi != mapping . references . end( ); ++ rmi )
-    {
-      if ( rmi -> second . conflicts . empty( ) )
+      //-- Sort and remove redundant conflicts
+      list<Conflict_t *>::iterator first, last, next, nxtf;
+      if ( refp -> conflicts . empty( ) )
 	continue;
 
-      rmi -> second . conflicts . sort (ConflictCmp_t( ));
+      refp -> conflicts . sort (ConflictCmp_t( ));
 
       //-- Do my own 'unique' method instead of STL, needed for fuzzy equals
-      first = next = rmi -> second . conflicts . begin( );
-      last  = nxtf = rmi -> second . conflicts . end( );
+      first = next = refp -> conflicts . begin( );
+      last  = nxtf = refp -> conflicts . end( );
       while ( ++ next != last )
 	{
 	  if ( IsEqualConflict (*first, *next) )
@@ -1123,7 +1239,7 @@ void FindConflicts (Mapping_t & mapping)
 	      yay . clear( );
 
 	      delete (*next);
-	      rmi -> second . conflicts . erase (next);
+	      refp -> conflicts . erase (next);
 	      next = first;
 	    }
 	  else
@@ -1497,127 +1613,269 @@ void OutputUMD (const Assembly_t & assembly)
 //------------------------------------------------------------ ParseAlign ----//
 void ParseAlign (Mapping_t & mapping)
 {
-  DeltaReader_t dr;
   Reference_t * refp;
   AMOS::ID_t id;
-  stringstream ss;
   ReadMap_t * currmp;
   ReadAlign_t * currap;
-  vector<DeltaAlignment_t>::const_iterator dai;
+  unsigned long int sR, eR, sQ, eQ;
+  long int i, j, n;
+  string refpath, qrypath, type;
+  vector<streamoff> bounds;
+  vector<AlignRecord_t>::const_iterator rci;
   pair<map<string, Reference_t>::iterator, bool> insret;
   map<AMOS::ID_t,ReadMap_t *> id2read;
   map<AMOS::ID_t,ReadMap_t *>::iterator idm;
 
-  dr . open (OPT_AlignName);
-
-  currmp = NULL;
-
-  //-- Process the delta input
-  while ( dr . readNextHeadersOnly( ) )
+  //-- Read the file header
+  ifstream in (OPT_AlignName . c_str( ));
+  in >> refpath >> qrypath >> type;
+  if ( !in  ||  (type != NUCMER_STRING  &&  type != PROMER_STRING) )
     {
-      insret = mapping . references . insert
-	(map<string, Reference_t>::value_type
-	 (dr . getRecord( ) . idR, Reference_t( )));
-      refp = &((insret . first) -> second);
-
-      //-- If a new reference ID
-      if ( insret . second )
+      cerr << "ERROR: Could not parse delta file, " << OPT_AlignName << endl;
+      exit (-1);
+    }
+  while ( in . peek( ) != '>' )
+    if ( in . get( ) == EOF )
+      break;
+  in . clear( );
+  bounds . push_back (in . tellg( ));
+  in . seekg (0, ios::end);
+  streamoff size = in . tellg( );
+
+  //-- Cut the records into chunks, each starting at a '>' line
+  n = lmax (OPT_Threads, (size - bounds . back( )) / ALIGN_CHUNK_SIZE + 1);
+  for ( i = 1; i < n; i ++ )
+    {
+      int c, prev;
+      streamoff pos = bounds . front( ) + (size - bounds . front( )) * i / n;
+      if ( pos <= bounds . back( ) )
+	continue;
+      in . seekg (pos - 1);
+      for ( prev = in . get( ); (c = in . get( )) != EOF; prev = c )
+	if ( prev == '\n'  &&  c == '>' )
+	  break;
+      if ( c == EOF )
+	break;
+      pos = (streamoff)in . tellg( ) - 1;
+      if ( pos > bounds . back( ) )
+	bounds . push_back (pos);
+    }
+  bounds . push_back (size);
+  in . close( );
+
+  //-- Parse the chunks
+  n = bounds . size( ) - 1;
+  vector< vector<AlignRecord_t> > records (n);
+  vector<int> parsed (n, 0);
+  mapping . aligns . resize (n);
+
+#ifdef AMOS_HAVE_OPENMP
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(OPT_Threads)
+#endif
+  for ( i = 0; i < n; i ++ )
+    {
+      streamoff len = bounds [i + 1] - bounds [i];
+      if ( len == 0 )
 	{
-	  refp -> id  = &((insret . first) -> first);
-	  refp -> len = dr . getRecord( ) . lenR;
+	  parsed [i] = 1;
+	  continue;
 	}
-      else
-	assert (refp -> len == (long int)dr . getRecord( ) . lenR);
-
-      ss . str (dr . getRecord( ) . idQ);
-      ss >> id;
-      assert (!ss . fail( ));
-      ss . clear( );
 
-      //-- Find read struct
-      idm = id2read.find(id);
+      vector<char> buff (len);
+      ifstream chunk (OPT_AlignName . c_str( ), ios::binary);
+      chunk . seekg (bounds [i]);
+      chunk . read (&buff [0], len);
+      if ( chunk . gcount( ) == len )
+	parsed [i] = ParseAlignChunk (&buff [0], &buff [0] + len,
+				      type == PROMER_STRING,
+				      records [i], mapping . aligns [i]);
+    }
 
-      //-- If a new read, create it
-      if ( idm == id2read.end() )
+  //-- Process the delta records in file order
+  for ( i = 0; i < n; i ++ )
+    {
+      if ( !parsed [i] )
 	{
-	  mapping . reads . push_back (new ReadMap_t( ));
-	  currmp = mapping . reads . back( );
-	  currmp -> id = id;
-	  currmp -> len = dr . getRecord( ) . lenQ;
-	  currmp -> place = NULL;
-	  currmp -> mate . read = NULL;
-          id2read.insert(make_pair(id,currmp));
+	  cerr << "ERROR: Could not parse delta file, " << OPT_AlignName << endl;
+	  exit (-1);
 	}
-      else
-        {
-          currmp = idm->second;
-        }
 
-      //-- For all the alignments in this record
-      for ( dai  = dr . getRecord( ) . aligns . begin( );
-	    dai != dr . getRecord( ) . aligns . end( ); ++ dai )
+      currap = mapping . aligns [i] . empty( ) ? NULL : &mapping . aligns [i] [0];
+      for ( rci = records [i] . begin( ); rci != records [i] . end( ); ++ rci )
 	{
-	  currmp -> all . push_back (new ReadAlign_t ( ));
-	  currap = currmp -> all . back( );
+	  insret = mapping . references . insert
+	    (map<string, Reference_t>::value_type (rci -> idR, Reference_t( )));
+	  refp = &((insret . first) -> second);
 
-	  currap -> ref = refp;
-	  currap -> idy = dai -> idy;
+	  //-- If a new reference ID
+	  if ( insret . second )
+	    {
+	      refp -> id  = &((insret . first) -> first);
+	      refp -> len = rci -> lenR;
+	    }
+	  else
+	    assert (refp -> len == rci -> lenR);
+
+	  id = rci -> idQ;
 
-	  //-- Force ascending coordinates
-	  if ( dai -> sR < dai -> eR )
+	  //-- Find read struct
+	  idm = id2read.find(id);
+
+	  //-- If a new read, create it
+	  if ( idm == id2read.end() )
 	    {
-	      currap -> loR = dai -> sR;
-	      currap -> hiR = dai -> eR;
+	      mapping . reads . push_back (new ReadMap_t( ));
+	      currmp = mapping . reads . back( );
+	      currmp -> id = id;
+	      currmp -> len = rci -> lenQ;
+	      currmp -> place = NULL;
+	      currmp -> mate . read = NULL;
+	      id2read.insert(make_pair(id,currmp));
 	    }
 	  else
 	    {
-	      currap -> loR = dai -> eR;
-	      currap -> hiR = dai -> sR;
+	      currmp = idm->second;
 	    }
 
-	  if ( (dai -> sR < dai -> eR  &&  dai -> sQ < dai -> eQ)  ||
-	       (dai -> sR > dai -> eR  &&  dai -> sQ > dai -> eQ) )
+	  //-- For all the alignments in this record
+	  for ( j = 0; j < rci -> n; j ++, currap ++ )
 	    {
-	      currap -> ori = FORWARD_CHAR;
-	      if ( dai -> sQ < dai -> eQ )
+	      currmp -> all . push_back (currap);
+
+	      currap -> ref = refp;
+	      sR = currap -> loR;
+	      eR = currap -> hiR;
+	      sQ = currap -> lo;
+	      eQ = currap -> hi;
+
+	      //-- Force ascending coordinates
+	      if ( sR < eR )
 		{
-		  currap -> lo = dai -> sQ;
-		  currap -> hi = dai -> eQ;
+		  currap -> loR = sR;
+		  currap -> hiR = eR;
 		}
 	      else
 		{
-		  currap -> lo = dai -> eQ;
-		  currap -> hi = dai -> sQ;
+		  currap -> loR = eR;
+		  currap -> hiR = sR;
 		}
-	    }
-	  else
-	    {
-	      currap -> ori = REVERSE_CHAR;
-	      if ( dai -> sQ < dai -> eQ )
+
+	      if ( (sR < eR  &&  sQ < eQ)  ||
+		   (sR > eR  &&  sQ > eQ) )
 		{
-		  currap -> lo = RevComp1 (dai -> eQ, currmp -> len);
-		  currap -> hi = RevComp1 (dai -> sQ, currmp -> len);
+		  currap -> ori = FORWARD_CHAR;
+		  if ( sQ < eQ )
+		    {
+		      currap -> lo = sQ;
+		      currap -> hi = eQ;
+		    }
+		  else
+		    {
+		      currap -> lo = eQ;
+		      currap -> hi = sQ;
+		    }
 		}
 	      else
 		{
-		  currap -> lo = RevComp1 (dai -> sQ, currmp -> len);
-		  currap -> hi = RevComp1 (dai -> eQ, currmp -> len);
+		  currap -> ori = REVERSE_CHAR;
+		  if ( sQ < eQ )
+		    {
+		      currap -> lo = RevComp1 (eQ, currmp -> len);
+		      currap -> hi = RevComp1 (sQ, currmp -> len);
+		    }
+		  else
+		    {
+		      currap -> lo = RevComp1 (sQ, currmp -> len);
+		      currap -> hi = RevComp1 (eQ, currmp -> len);
+		    }
 		}
 	    }
+
+	  //-- Sort the alignments by lo read coordinate
+	  sort (currmp -> all.begin( ), currmp -> all.end( ), ReadAlignCmp_t( ));
 	}
 
-      //-- Sort the alignments by lo read coordinate
-      sort (currmp -> all.begin( ), currmp -> all.end( ), ReadAlignCmp_t( ));
+      vector<AlignRecord_t>( ) . swap (records [i]);
     }
 
-  dr . close( );
-
   sort (mapping . reads . begin( ), mapping . reads . end( ), ReadIdCmp_t( ));
 }
 
 
 
 
+//------------------------------------------------------- ParseAlignChunk ----//
+bool ParseAlignChunk (const char * p, const char * end, bool promer,
+		      vector<AlignRecord_t> & records,
+		      vector<ReadAlign_t> & aligns)
+{
+  AlignRecord_t rec;
+  ReadAlign_t align;
+  string idQ;
+  long int sR, eR, sQ, eQ, idyc, simc, stpc, delta;
+  float total;
+  char * idend;
+
+  while ( p < end )
+    {
+      //-- Read the record header
+      if ( *(p ++) != '>' )
+	return false;
+      if ( !ParseToken (p, end, rec . idR)  ||
+	   !ParseToken (p, end, idQ)  ||
+	   !ParseLong (p, end, rec . lenR)  ||
+	   !ParseLong (p, end, rec . lenQ)  ||
+	   rec . lenR <= 0  ||  rec . lenQ <= 0 )
+	return false;
+      rec . idQ = strtoul (idQ . c_str( ), &idend, 10);
+      if ( idend == idQ . c_str( ) )
+	return false;
+      rec . n = 0;
+      SkipLine (p, end);
+
+      //-- For each alignment...
+      while ( p < end  &&  *p != '>' )
+	{
+	  if ( !ParseLong (p, end, sR)  ||  !ParseLong (p, end, eR)  ||
+	       !ParseLong (p, end, sQ)  ||  !ParseLong (p, end, eQ)  ||
+	       !ParseLong (p, end, idyc)  ||  !ParseLong (p, end, simc)  ||
+	       !ParseLong (p, end, stpc)  ||
+	       sR <= 0  ||  eR <= 0  ||  sQ <= 0  ||  eQ <= 0  ||
+	       idyc < 0  ||  simc < 0  ||  stpc < 0 )
+	    return false;
+
+	  total = labs (eR - sR) + 1.0;
+	  if ( promer )
+	    total /= 3.0;
+
+	  //-- Count the indels
+	  do
+	    {
+	      if ( !ParseLong (p, end, delta) )
+		return false;
+	      if ( delta < 0 )
+		total ++;
+	    } while ( delta != 0 );
+	  SkipLine (p, end);
+
+	  align . loR = sR;
+	  align . hiR = eR;
+	  align . lo  = sQ;
+	  align . hi  = eQ;
+	  align . idy = (total - (float)idyc) / total * 100.0;
+	  aligns . push_back (align);
+	  rec . n ++;
+	}
+
+      records . push_back (rec);
+    }
+
+  return true;
+}
+
+
+
+
 //------------------------------------------------------------ ParseMates ----//
 void ParseMates (Mapping_t & mapping)
 {
@@ -1881,7 +2139,7 @@ void RefineConflicts (Mapping_t & mapping)
   Reference_t * rp;
   ReadAlign_t * rap;
 
-  list<Conflict_t *>::iterator cpi, locpi, hicpi, bcpi, ecpi;
+  list<Conflict_t *>::iterator cpi, bcpi, ecpi;
   map<string, Reference_t>::iterator rmi;
   vector<ReadMap_t *>::iterator rmpi, rmpie, ri, rj;
   set<ReadMap_t *>::iterator si;
@@ -1893,6 +2151,13 @@ void RefineConflicts (Mapping_t & mapping)
   vector<ReadMap_t *> heap;
   vector<Conflict_t *> breaks;
   vector<Conflict_t *>::iterator bi;
+  vector<Conflict_t *> cv;
+  Conflict_t * cp, * hip, * lop;
+  long int c, i, nc;
+  vector< pair<long int, long int> > gapped;
+  vector< pair<long int, long int> >::iterator gi;
+  vector<long int> lorank;
+  vector<long int>::iterator li;
   set<ReadMap_t *> readsetA;
   set<ReadMap_t *> readsetB;
 
@@ -1958,125 +2223,151 @@ void RefineConflicts (Mapping_t & mapping)
       heap . clear( );
 
 
+      //-- Index the conflicts by position, and the gapped ones by where
+      //   their reference LOBREAK falls, so an INDEL only visits neighbours
+      cv . assign (bcpi, ecpi);
+      nc = cv . size( );
+      gapped . clear( );
+      for ( c = 0; c < nc; ++ c )
+	if ( cv [c] -> gapR != 0 )
+	  gapped . push_back (make_pair (cv [c] -> pos + cv [c] -> gapR + 1, c));
+      sort (gapped . begin( ), gapped . end( ));
+
       //-- For each *INDEL*, sum yay/nay counts from its break counts
-      for ( cpi = bcpi; cpi != ecpi; ++ cpi )
+      for ( c = 0; c < nc; ++ c )
 	{
-	  if ( (*cpi)->type != Conflict_t::INDEL )
+	  cp = cv [c];
+	  if ( cp->type != Conflict_t::INDEL )
 	    continue;
 
 	  //-- The reference breaks for the gap
-	  beg = (*cpi) -> pos;
-	  end = (*cpi) -> pos + (*cpi) -> gapR + 1;
+	  beg = cp -> pos;
+	  end = cp -> pos + cp -> gapR + 1;
 
 	  //-- Find conflicts corresponding to the reference HIBREAK
-	  for ( hicpi = bcpi; hicpi != ecpi; ++ hicpi )
-	    if ( hicpi != cpi  &&
-		 labs ((*hicpi)->pos - beg) <= FUZZY )
+	  for ( i = c; i > 0  &&  cv [i - 1] -> pos >= beg - FUZZY; -- i ) ;
+	  for ( ; i < nc  &&  cv [i] -> pos <= beg + FUZZY; ++ i )
+	    if ( i != c )
 	      {
-		breaks . push_back (*hicpi);
+		hip = cv [i];
+		breaks . push_back (hip);
 
-		if ( (*hicpi) -> type == Conflict_t::HIBREAK )
+		if ( hip -> type == Conflict_t::HIBREAK )
 		  {
 
 		    //-- Add to INDEL support if hang isn't too large
-		    for ( si  = (*hicpi) -> support . begin( );
-			  si != (*hicpi) -> support . end( ); ++ si )
+		    for ( si  = hip -> support . begin( );
+			  si != hip -> support . end( ); ++ si )
 		      if ( (*si) -> place -> end - beg <
-			   (*cpi) -> gapQ + OPT_MaxTrimLen )
-			(*cpi) -> support . insert (*si);
+			   cp -> gapQ + OPT_MaxTrimLen )
+			cp -> support . insert (*si);
 
 		    //-- Add to hibreak discount
-		    for ( si  = (*hicpi) -> discount . begin( );
-			  si != (*hicpi) -> discount . end( ); ++ si )
+		    for ( si  = hip -> discount . begin( );
+			  si != hip -> discount . end( ); ++ si )
 		      readsetA . insert (*si);
 		  }
 	      }
 
-	  //-- Find conflicts corresponding to the reference LOBREAK
-	  for ( locpi = bcpi; locpi != ecpi; ++ locpi )
-	    if ( locpi != cpi  &&
-		 labs ((*locpi)->pos + (*locpi)->gapR + 1 - end) <= FUZZY )
+	  //-- Find conflicts corresponding to the reference LOBREAK,
+	  //   visiting them in list order
+	  lorank . clear( );
+	  for ( i = lower_bound (cv . begin( ), cv . end( ),
+				 end - 1 - FUZZY, ConflictPosCmp_t( ))
+		  - cv . begin( );
+		i < nc  &&  cv [i] -> pos <= end - 1 + FUZZY; ++ i )
+	    if ( cv [i] -> gapR == 0 )
+	      lorank . push_back (i);
+	  for ( gi = lower_bound (gapped . begin( ), gapped . end( ),
+				  make_pair (end - FUZZY, LONG_MIN));
+		gi != gapped . end( )  &&  gi -> first <= end + FUZZY; ++ gi )
+	    lorank . push_back (gi -> second);
+	  sort (lorank . begin( ), lorank . end( ));
+
+	  for ( li = lorank . begin( ); li != lorank . end( ); ++ li )
+	    if ( *li != c )
 	      {
-		breaks . push_back (*locpi);
+		lop = cv [*li];
+		breaks . push_back (lop);
 
-		if ( (*locpi) -> type == Conflict_t::LOBREAK )
+		if ( lop -> type == Conflict_t::LOBREAK )
 		  {
 		    //-- Add to INDEL support if hang isn't too large
-		    for ( si  = (*locpi) -> support . begin( );
-			  si != (*locpi) -> support . end( ); ++ si )
+		    for ( si  = lop -> support . begin( );
+			  si != lop -> support . end( ); ++ si )
 		      if ( end - (*si) -> place -> beg <
-			   (*cpi) -> gapQ + OPT_MaxTrimLen )
-			(*cpi) -> support . insert (*si);
+			   cp -> gapQ + OPT_MaxTrimLen )
+			cp -> support . insert (*si);
 
 		    //-- Add to lobreak discount
-		    for ( si  = (*locpi) -> discount . begin( );
-			  si != (*locpi) -> discount . end( ); ++ si )
+		    for ( si  = lop -> discount . begin( );
+			  si != lop -> discount . end( ); ++ si )
 		      readsetB . insert (*si);
 		  }
 	      }
 
 	  //-- One break discounted good enough for regular gap
-	  if ( (*cpi) -> gapR > 0 )
+	  if ( cp -> gapR > 0 )
 	    set_union
 	      (readsetA . begin( ), readsetA . end( ),
 	       readsetB . begin( ), readsetB . end( ),
 	       insert_iterator<set<ReadMap_t *> >
-	       ((*cpi) -> discount, (*cpi) -> discount . begin( )));
+	       (cp -> discount, cp -> discount . begin( )));
 	  //-- Tandems with reference overlap need both breaks discounted
 	  else
 	    set_intersection
 	      (readsetA . begin( ), readsetA . end( ),
 	       readsetB . begin( ), readsetB . end( ),
 	       insert_iterator<set<ReadMap_t *> >
-	       ((*cpi) -> discount, (*cpi) -> discount . begin( )));
+	       (cp -> discount, cp -> discount . begin( )));
 	  readsetA . clear( );
 	  readsetB . clear( );
 
 	  //-- Can't support indel if discounting it
 	  set_difference
-	    ((*cpi) -> support  . begin( ), (*cpi) -> support  . end( ),
-	     (*cpi) -> discount . begin( ), (*cpi) -> discount . end( ),
+	    (cp -> support  . begin( ), cp -> support  . end( ),
+	     cp -> discount . begin( ), cp -> discount . end( ),
 	     insert_iterator<set<ReadMap_t *> >
 	     (readsetA, readsetA . begin( )));
-	  (*cpi) -> support . swap (readsetA);
+	  cp -> support . swap (readsetA);
 	  readsetA . clear( );
 
 	  //-- Call the indel SUPPORTED, UNSUPPORTED, AMBIGUOUS
-	  CallConflict (*cpi);
+	  CallConflict (cp);
 
 	  //-- Flag indel breaks as artifacts
-	  if ( (*cpi) -> status != Conflict_t::UNSUPPORTED )
+	  if ( cp -> status != Conflict_t::UNSUPPORTED )
 	    for ( bi = breaks . begin( ); bi != breaks . end( ); ++ bi )
 	      {
 		if ( (*bi) -> type != Conflict_t::INDEL )
 		  (*bi) -> status = Conflict_t::ARTIFACT;
 		else if ( (*bi)  -> status != Conflict_t::UNSUPPORTED  &&
-			  (*cpi) -> status != Conflict_t::ARTIFACT )
+			  cp -> status != Conflict_t::ARTIFACT )
 		  {
 		    long int byay = (*bi) -> support . size( );
-		    long int cyay = (*cpi) -> support . size( );
+		    long int cyay = cp -> support . size( );
 		    float tyay = byay + cyay;
 		    if ( tyay == 0 ) tyay = -1;
 
 		    if ((float)byay / tyay * 100.0 >= OPT_Majority)
-		      (*cpi) -> status = Conflict_t::ARTIFACT;
+		      cp -> status = Conflict_t::ARTIFACT;
 		    else if ((float)cyay / tyay * 100.0 >= OPT_Majority)
 		      (*bi) -> status = Conflict_t::ARTIFACT;
 		    else
 		      {
 			long int bnay = (*bi) -> discount . size( );
-			long int cnay = (*cpi) -> discount . size( );
+			long int cnay = cp -> discount . size( );
 			float tnay = bnay + cnay;
 			if ( tnay == 0 ) tnay = -1;
 			
 			if ((float)bnay / tnay * 100.0 >= OPT_Majority)
 			  (*bi) -> status = Conflict_t::ARTIFACT;
 			else if ((float)cnay / tnay * 100.0 >= OPT_Majority)
-			  (*cpi) -> status = Conflict_t::ARTIFACT;
+			  cp -> status = Conflict_t::ARTIFACT;
 			else
 			  {
 			    (*bi)  -> status = Conflict_t::AMBIGUOUS;
-			    (*cpi) -> status = Conflict_t::AMBIGUOUS;
+			    cp -> status = Conflict_t::AMBIGUOUS;
 			  }
 		      }
 		  }
@@ -2207,7 +2498,7 @@ void ParseArgs (int argc, char ** argv)
   optarg = NULL;
 
   while ( !errflg  &&
-  ((ch = getopt (argc, argv, "b:C:d:g:hi:I:m:M:o:prs:St:T:U:v:V:")) != EOF) )
+  ((ch = getopt (argc, argv, "b:C:d:g:hi:I:j:m:M:o:prs:St:T:U:v:V:")) != EOF) )
     switch (ch)
       {
       case 'b':
@@ -2239,6 +2530,17 @@ void ParseArgs (int argc, char ** argv)
 	OPT_MaxIdentityDiff = atof (optarg);
 	break;
 
+      case 'j':
+	OPT_Threads = atoi (optarg);
+	if ( OPT_Threads < 1 )
+	  OPT_Threads = 1;
+#ifndef AMOS_HAVE_OPENMP
+	if ( OPT_Threads > 1 )
+	  cerr << "WARNING: built without OpenMP, -j ignored" << endl;
+	OPT_Threads = 1;
+#endif
+	break;
+
       case 'm':
 	OPT_Majority = atof (optarg);
 	break;
@@ -2323,6 +2625,8 @@ void PrintHelp (const char * s)
     << OPT_MinIdentity << endl
     << "-I float      Set the identity tolerance between repeats, default "
     << OPT_MaxIdentityDiff << endl
+    << "-j uint       Set the number of threads, default "
+    << OPT_Threads << endl
     << "-m float      Set the majority needed to discern a conflict, default "
     << OPT_Majority << endl
     << "-M path       Output read mappings to file\n"
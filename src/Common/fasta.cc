@@ -7,7 +7,7 @@
 //  Routines to manipulate FASTA format files
 
 
-#include  "inttypes_AMOS.hh"
+#include  "exceptions_AMOS.hh"
 #include  "fasta.hh"
 using namespace std;
 
@@ -241,6 +241,76 @@ bool  Fasta_Read
 
 
 
+bool  Fasta_Qual_Read
+    (SeqReader_t & in, string & q, string & hdr)
+
+//  Read next fasta-like-format quality value sequence from
+//  in  into string  q  (encoded by adding the quality value to
+//  the  MIN_QUALITY  value).  Put the header line into  hdr .
+//  Return  true  if a string is successfully read; false, otherwise.
+
+  {
+   SeqRecord_t  rec;
+
+   if  (! in . nextQual (rec, AMOS::MIN_QUALITY))
+       return  false;
+
+   q . assign (rec . qual, rec . qual_len);
+   hdr . assign (rec . name, rec . name_len);
+
+   return  true;
+  }
+
+
+
+bool  Fasta_Read
+    (SeqReader_t & in, string & s, string & hdr)
+
+//  Read next string from  in  into string  s  and its header line
+//  into  hdr .  Works like the  FILE *  version but scans in large
+//  blocks and also accepts gzip'd input.  FASTQ input is accepted
+//  too, in which case the qualities are dropped.  Return  true  if a
+//  string is successfully read; false, otherwise.
+
+  {
+   SeqRecord_t  rec;
+
+   if  (! in . next (rec))
+       return  false;
+
+   s . assign (rec . seq, rec . seq_len);
+   hdr . assign (rec . name, rec . name_len);
+
+   return  true;
+  }
+
+
+
+void  Seq_File_Open
+    (SeqReader_t & in, const char * fname, const char * src_fname,
+     size_t line_num)
+
+//  Open sequence file  fname  for reading with  in .  If fail, print
+//  a message and exit, assuming the call came from source file
+//  src_fname  at line  line_num .
+
+  {
+   try
+     {
+      in . open (fname);
+     }
+   catch  (const AMOS::IOException_t & e)
+     {
+      sprintf (Clean_Exit_Msg_Line,
+               "ERROR:  Could not open file  %s \n", fname);
+      Clean_Exit (Clean_Exit_Msg_Line, src_fname, line_num);
+     }
+
+   return;
+  }
+
+
+
 void  Reverse_Complement
   (char * s)
 
@@ -12,6 +12,7 @@
 
 
 #include  "delcher.hh"
+#include  "seqreader.hh"
 #include  <string>
 #include  <vector>
 #include  <cstring>
@@ -36,6 +37,13 @@ bool  Fasta_Qual_Read
     (FILE * fp, std::string & q, std::string & hdr);
 bool  Fasta_Read
     (FILE * fp, std::string & s, std::string & hdr);
+bool  Fasta_Qual_Read
+    (SeqReader_t & in, std::string & q, std::string & hdr);
+bool  Fasta_Read
+    (SeqReader_t & in, std::string & s, std::string & hdr);
+void  Seq_File_Open
+    (SeqReader_t & in, const char * fname, const char * src_fname = NULL,
+     size_t line_num = 0);
 void  Reverse_Complement
     (char * s);
 void  Reverse_Complement
@@ -13,6 +13,25 @@ using namespace std;
 
 static const char FastqOffset[] = {'@', '!'};
 
+static inline char Fastq_Convert_Char(int ch, FastqQualType qualType)
+//  Convert one raw fastq quality character to an AMOS quality,
+//  capping it at  MAX_QUALITY .
+
+  {
+   // check of errors
+   int qlVal = (int)ch;
+   qlVal -= (int) FastqOffset[qualType];
+   int maxQlt = (int)AMOS::MAX_QUALITY - (int)AMOS::MIN_QUALITY;
+   if (qlVal < 0) {
+      sprintf (Clean_Exit_Msg_Line,
+                 "Failed: invalid quality value too low %c %d. Please check quality type\n", ch, qlVal);
+      throw AMOS::Exception_t(Clean_Exit_Msg_Line, __LINE__, __FILE__);
+   } else if (qlVal > maxQlt) {
+      ch = FastqOffset[qualType] + AMOS::MAX_QUALITY;
+   }
+   return char (ch - FastqOffset[qualType] + AMOS::MIN_QUALITY);
+  }
+
 bool  Fastq_Read(FILE * fp, string & s, string & hdr, string & q, string & qualHdr, FastqQualType qualType)
 //  Read next fastq-format string from file  fp  (which must
 //  already be open) into string  s .  Put the fasta header line into
@@ -67,26 +86,44 @@ bool  Fastq_Read(FILE * fp, string & s, string & hdr, string & q, string & qualH
 
    // put all numbers up till newline into  q
    while((ch = fgetc(fp)) != EOF && ch != '\n')
-     {
-       // check of errors
-       int qlVal = (int)ch;
-       qlVal -= (int) FastqOffset[qualType];
-       int maxQlt = (int)AMOS::MAX_QUALITY - (int)AMOS::MIN_QUALITY;
-       if (qlVal < 0) {
-          sprintf (Clean_Exit_Msg_Line,
-                     "Failed: invalid quality value too low %c %d. Please check quality type\n", ch, qlVal);
-          throw AMOS::Exception_t(Clean_Exit_Msg_Line, __LINE__, __FILE__);
-       } else if (qlVal > maxQlt) {
-          ch = FastqOffset[qualType] + AMOS::MAX_QUALITY;
-       }
-       q.push_back(char (ch - FastqOffset[qualType] + AMOS::MIN_QUALITY));
-     }
+     q.push_back(Fastq_Convert_Char(ch, qualType));
 
 
    return  true;
   }
 
 
+bool  Fastq_Read(SeqReader_t & in, string & s, string & hdr, string & q, FastqQualType qualType)
+//  Read next fastq-format record from  in  into  s ,  hdr  and the
+//  converted qualities  q .  Works like the  FILE *  version but scans
+//  in large blocks and also accepts gzip'd input.  Return  true  if a
+//  record is successfully read; false, otherwise.
+
+  {
+   SeqRecord_t rec;
+
+   if  (! in.next(rec))
+       return  false;
+
+   s.assign(rec.seq, rec.seq_len);
+   hdr.assign(rec.name, rec.name_len);
+   Fastq_Convert_Qual(rec.qual, rec.qual_len, q, qualType);
+
+   return  true;
+  }
+
+
+void  Fastq_Convert_Qual(const char * raw, size_t len, string & q, FastqQualType qualType)
+//  Convert  len  raw fastq quality characters in  raw  to AMOS
+//  qualities in  q .
+
+  {
+   q.resize(len);
+   for  (size_t i = 0; i < len; i++)
+     q[i] = Fastq_Convert_Char(raw[i], qualType);
+  }
+
+
 
 
 
@@ -13,6 +13,7 @@
 
 #include  "delcher.hh"
 #include  "inttypes_AMOS.hh"
+#include  "seqreader.hh"
 #include  <string>
 #include  <vector>
 #include  <cstring>
@@ -27,5 +28,7 @@ const uint32_t FASTQ_QUALITY_COUNT = 2;
 const FastqQualType FASTQ_DEFAULT_QUALITY_TYPE = SANGER;
 
 bool  Fastq_Read(FILE * fp, std::string & s, std::string & hdr, std::string & q, std::string & qualHdr, FastqQualType qualType = FASTQ_DEFAULT_QUALITY_TYPE);
+bool  Fastq_Read(SeqReader_t & in, std::string & s, std::string & hdr, std::string & q, FastqQualType qualType = FASTQ_DEFAULT_QUALITY_TYPE);
+void  Fastq_Convert_Qual(const char * raw, size_t len, std::string & q, FastqQualType qualType = FASTQ_DEFAULT_QUALITY_TYPE);
 
 #endif // #ifndef __FASTQ_HH
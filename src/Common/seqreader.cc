@@ -0,0 +1,710 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Source for SeqReader_t
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "exceptions_AMOS.hh"
+#include "alloc.hh"
+#include "seqreader.hh"
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBZ
+# include <zlib.h>
+#endif
+#ifdef HAVE_LIBPTHREAD
+# include <pthread.h>
+#endif
+
+using namespace AMOS;
+using namespace std;
+
+
+//-- Number of decompressed blocks that may be queued ahead of the parser
+static const int INFLATE_QUEUE_DEPTH = 4;
+
+
+
+
+#ifdef HAVE_LIBZ
+//================================================ Inflater_t ==================
+//! \brief Gzip decoder feeding a SeqReader_t
+//!
+//! With pthreads, a producer thread inflates into a small ring of blocks
+//! and the reader consumes them; otherwise inflation happens on demand in
+//! the reading thread. Concatenated gzip members (e.g. BGZF) are handled.
+//!
+//==============================================================================
+struct SeqReader_t::Inflater_t
+{
+  int fd;               //!< compressed input
+  z_stream zs;          //!< zlib state
+  char * in;            //!< compressed input buffer
+  bool member_end;      //!< last inflate ended a gzip member
+  bool done;            //!< no more output will be produced
+  string error;         //!< decompression error, if any
+
+  char * blocks [INFLATE_QUEUE_DEPTH]; //!< decompressed block ring
+  size_t lens [INFLATE_QUEUE_DEPTH];   //!< bytes in each block
+  int head;             //!< block being consumed
+  int count;            //!< number of published blocks
+  size_t pos;           //!< read position in the head block
+
+#ifdef HAVE_LIBPTHREAD
+  pthread_t thread;     //!< producer thread
+  pthread_mutex_t lock; //!< guards head, count, done and stop
+  pthread_cond_t cond;  //!< signalled on every queue change
+  bool stop;            //!< consumer asked the producer to quit
+  bool running;         //!< thread was started
+#endif
+
+
+  Inflater_t (int f, const char * primed, size_t nprimed)
+    : fd (f), member_end (false), done (false), head (0), count (0), pos (0)
+  {
+    memset (&zs, 0, sizeof (zs));
+    if ( inflateInit2 (&zs, 15 + 32) != Z_OK )
+      AMOS_THROW_IO ("Could not initialize zlib");
+
+    in = (char *) SafeMalloc (SeqReader_t::DEFAULT_BLOCK_SIZE);
+    memcpy (in, primed, nprimed);
+    zs . next_in = (Bytef *) in;
+    zs . avail_in = nprimed;
+
+    for ( int i = 0; i < INFLATE_QUEUE_DEPTH; i ++ )
+      {
+        blocks [i] = NULL;
+        lens [i] = 0;
+      }
+
+#ifdef HAVE_LIBPTHREAD
+    stop = false;
+    running = false;
+    pthread_mutex_init (&lock, NULL);
+    pthread_cond_init (&cond, NULL);
+
+    for ( int i = 0; i < INFLATE_QUEUE_DEPTH; i ++ )
+      blocks [i] = (char *) SafeMalloc (SeqReader_t::DEFAULT_BLOCK_SIZE);
+    if ( pthread_create (&thread, NULL, Inflater_t::run, this) == 0 )
+      running = true;
+    else
+      for ( int i = 0; i < INFLATE_QUEUE_DEPTH; i ++ )
+        {
+          free (blocks [i]);
+          blocks [i] = NULL;
+        }
+#endif
+  }
+
+
+  ~Inflater_t ( )
+  {
+#ifdef HAVE_LIBPTHREAD
+    if ( running )
+      {
+        pthread_mutex_lock (&lock);
+        stop = true;
+        pthread_cond_broadcast (&cond);
+        pthread_mutex_unlock (&lock);
+        pthread_join (thread, NULL);
+      }
+    pthread_cond_destroy (&cond);
+    pthread_mutex_destroy (&lock);
+#endif
+    for ( int i = 0; i < INFLATE_QUEUE_DEPTH; i ++ )
+      free (blocks [i]);
+    free (in);
+    inflateEnd (&zs);
+  }
+
+
+  //-- Inflate up to n bytes into dst, returns 0 at end of stream or error
+  size_t inflateSome (char * dst, size_t n)
+  {
+    zs . next_out = (Bytef *) dst;
+    zs . avail_out = n;
+
+    while ( zs . avail_out > 0 )
+      {
+        if ( zs . avail_in == 0 )
+          {
+            ssize_t got;
+            do
+              got = ::read (fd, in, SeqReader_t::DEFAULT_BLOCK_SIZE);
+            while ( got < 0 && errno == EINTR );
+
+            if ( got < 0 )
+              {
+                error = "read failed on compressed input";
+                break;
+              }
+            if ( got == 0 )
+              {
+                if ( ! member_end )
+                  error = "unexpected end of compressed input";
+                break;
+              }
+            zs . next_in = (Bytef *) in;
+            zs . avail_in = got;
+          }
+
+        if ( member_end )
+          {
+            //-- more data after a complete member, start the next one
+            inflateReset (&zs);
+            member_end = false;
+          }
+
+        int ret = inflate (&zs, Z_NO_FLUSH);
+        if ( ret == Z_STREAM_END )
+          member_end = true;
+        else if ( ret != Z_OK && ret != Z_BUF_ERROR )
+          {
+            error = zs . msg ? zs . msg : "corrupt compressed input";
+            break;
+          }
+      }
+
+    return n - zs . avail_out;
+  }
+
+
+#ifdef HAVE_LIBPTHREAD
+  //-- Producer thread body, fills free ring slots until done or stopped
+  static void * run (void * arg)
+  {
+    Inflater_t * self = (Inflater_t *) arg;
+
+    for ( ;; )
+      {
+        pthread_mutex_lock (&self->lock);
+        while ( self->count == INFLATE_QUEUE_DEPTH && ! self->stop )
+          pthread_cond_wait (&self->cond, &self->lock);
+        int slot = (self->head + self->count) % INFLATE_QUEUE_DEPTH;
+        bool stop = self->stop;
+        pthread_mutex_unlock (&self->lock);
+        if ( stop )
+          break;
+
+        size_t len = self->inflateSome
+          (self->blocks [slot], SeqReader_t::DEFAULT_BLOCK_SIZE);
+
+        pthread_mutex_lock (&self->lock);
+        self->lens [slot] = len;
+        if ( len > 0 )
+          self->count ++;
+        if ( len < SeqReader_t::DEFAULT_BLOCK_SIZE )
+          self->done = true;
+        pthread_cond_broadcast (&self->cond);
+        bool done = self->done;
+        pthread_mutex_unlock (&self->lock);
+        if ( done )
+          break;
+      }
+
+    return NULL;
+  }
+#endif
+
+
+  //-- Copy up to n decompressed bytes into dst, returns 0 at end of stream
+  size_t read (char * dst, size_t n)
+  {
+#ifdef HAVE_LIBPTHREAD
+    if ( running )
+      {
+        pthread_mutex_lock (&lock);
+        if ( count > 0 && pos == lens [head] )
+          {
+            //-- release the exhausted block back to the producer
+            head = (head + 1) % INFLATE_QUEUE_DEPTH;
+            count --;
+            pos = 0;
+            pthread_cond_broadcast (&cond);
+          }
+        while ( count == 0 && ! done )
+          pthread_cond_wait (&cond, &lock);
+        bool empty = (count == 0);
+        pthread_mutex_unlock (&lock);
+
+        if ( empty )
+          {
+            if ( ! error . empty( ) )
+              AMOS_THROW_IO ("Could not decompress input, " + error);
+            return 0;
+          }
+
+        size_t len = lens [head] - pos;
+        if ( len > n )
+          len = n;
+        memcpy (dst, blocks [head] + pos, len);
+        pos += len;
+        return len;
+      }
+#endif
+
+    size_t len = done ? 0 : inflateSome (dst, n);
+    if ( len < n )
+      done = true;
+    if ( len == 0 && ! error . empty( ) )
+      AMOS_THROW_IO ("Could not decompress input, " + error);
+    return len;
+  }
+};
+#endif // #ifdef HAVE_LIBZ
+
+
+
+
+//----------------------------------------------------- SeqReader_t ------------
+SeqReader_t::SeqReader_t ( )
+{
+  init( );
+}
+
+
+//----------------------------------------------------- SeqReader_t ------------
+SeqReader_t::SeqReader_t (const string & path)
+{
+  init( );
+  open (path);
+}
+
+
+//----------------------------------------------------- ~SeqReader_t -----------
+SeqReader_t::~SeqReader_t ( )
+{
+  close( );
+}
+
+
+//----------------------------------------------------- init -------------------
+void SeqReader_t::init ( )
+{
+  is_open_m = false;
+  codec_m = PLAIN_CODEC;
+  format_m = UNKNOWN_FORMAT;
+  fd_m = -1;
+  own_fd_m = false;
+  pipe_m = NULL;
+  inflater_m = NULL;
+  buff_m = NULL;
+  cap_m = beg_m = end_m = 0;
+  eof_m = false;
+  marker_m = false;
+}
+
+
+//----------------------------------------------------- open -------------------
+void SeqReader_t::open (const string & path)
+{
+  close( );
+
+  if ( path == "-" )
+    {
+      fd_m = STDIN_FILENO;
+      own_fd_m = false;
+    }
+  else
+    {
+      fd_m = ::open (path . c_str( ), O_RDONLY);
+      if ( fd_m < 0 )
+        AMOS_THROW_IO ("Could not open sequence file " + path);
+      own_fd_m = true;
+    }
+
+  start (path . c_str( ));
+}
+
+
+//----------------------------------------------------- open -------------------
+void SeqReader_t::open (FILE * fp)
+{
+  close( );
+
+  fd_m = fileno (fp);
+  own_fd_m = false;
+
+  start (NULL);
+}
+
+
+//----------------------------------------------------- start ------------------
+void SeqReader_t::start (const char * path)
+{
+  name_m = path ? path : "stream";
+  cap_m = 2 * DEFAULT_BLOCK_SIZE + 1;
+  buff_m = (char *) SafeMalloc (cap_m);
+  is_open_m = true;
+
+  //-- peek at the magic number to pick a decoder
+  unsigned char magic [3];
+  size_t n = 0;
+  while ( n < sizeof (magic) )
+    {
+      ssize_t got = ::read (fd_m, magic + n, sizeof (magic) - n);
+      if ( got < 0 && errno == EINTR )
+        continue;
+      if ( got <= 0 )
+        break;
+      n += got;
+    }
+
+  bool gzip = n >= 2 && magic [0] == 0x1f && magic [1] == 0x8b;
+  bool bzip2 = n >= 3 && magic [0] == 'B' && magic [1] == 'Z' && magic [2] == 'h';
+
+#ifdef HAVE_LIBZ
+  if ( gzip )
+    {
+      codec_m = GZIP_CODEC;
+      inflater_m = new Inflater_t (fd_m, (char *) magic, n);
+      return;
+    }
+#endif
+
+  if ( gzip || bzip2 )
+    {
+      if ( path == NULL || strcmp (path, "-") == 0 )
+        {
+          close( );
+          AMOS_THROW_IO ("Cannot decompress " + name_m + ", pipe it in uncompressed");
+        }
+
+      string cmd = gzip ? "gzip -dc '" : "bzip2 -dc '";
+      cmd += path;
+      cmd += "'";
+      pipe_m = popen (cmd . c_str( ), "r");
+      if ( pipe_m == NULL )
+        {
+          close( );
+          AMOS_THROW_IO ("Could not decompress sequence file " + name_m);
+        }
+      if ( own_fd_m )
+        ::close (fd_m);
+      fd_m = fileno (pipe_m);
+      own_fd_m = false;
+      codec_m = PIPE_CODEC;
+      return;
+    }
+
+  memcpy (buff_m, magic, n);
+  end_m = n;
+}
+
+
+//----------------------------------------------------- close ------------------
+void SeqReader_t::close ( )
+{
+#ifdef HAVE_LIBZ
+  delete inflater_m;
+#endif
+  if ( pipe_m != NULL )
+    pclose (pipe_m);
+  else if ( own_fd_m && fd_m >= 0 )
+    ::close (fd_m);
+  free (buff_m);
+
+  init( );
+}
+
+
+//----------------------------------------------------- rawRead ----------------
+size_t SeqReader_t::rawRead (char * dst, size_t n)
+{
+#ifdef HAVE_LIBZ
+  if ( inflater_m != NULL )
+    return inflater_m -> read (dst, n);
+#endif
+
+  ssize_t got;
+  do
+    got = ::read (fd_m, dst, n);
+  while ( got < 0 && errno == EINTR );
+
+  if ( got < 0 )
+    AMOS_THROW_IO ("Could not read sequence file " + name_m);
+
+  return got;
+}
+
+
+//----------------------------------------------------- fill -------------------
+bool SeqReader_t::fill ( )
+{
+  if ( eof_m || ! is_open_m )
+    return false;
+
+  //-- slide the partial record to the front
+  if ( beg_m > 0 )
+    {
+      memmove (buff_m, buff_m + beg_m, end_m - beg_m);
+      end_m -= beg_m;
+      beg_m = 0;
+    }
+
+  //-- grow for records longer than the buffer, keeping a spare byte for NUL
+  if ( cap_m - end_m < DEFAULT_BLOCK_SIZE / 2 + 1 )
+    {
+      cap_m = 2 * cap_m;
+      buff_m = (char *) SafeRealloc (buff_m, cap_m);
+    }
+
+  size_t got = rawRead (buff_m + end_m, cap_m - end_m - 1);
+  if ( got == 0 )
+    {
+      eof_m = true;
+      return false;
+    }
+
+  end_m += got;
+  return true;
+}
+
+
+//----------------------------------------------------- findLine ---------------
+size_t SeqReader_t::findLine (size_t off)
+{
+  for ( ;; )
+    {
+      size_t avail = end_m - beg_m;
+      if ( off < avail )
+        {
+          char * p = (char *) memchr (buff_m + beg_m + off, '\n', avail - off);
+          if ( p != NULL )
+            return p - (buff_m + beg_m);
+          off = avail;
+        }
+      if ( ! fill( ) )
+        return end_m - beg_m;
+    }
+}
+
+
+//----------------------------------------------------- skipTo -----------------
+bool SeqReader_t::skipTo (char marker)
+{
+  if ( marker_m )
+    {
+      //-- the previous record's terminator overwrote this marker
+      marker_m = false;
+      return true;
+    }
+
+  for ( ;; )
+    {
+      char * p = (char *) memchr (buff_m + beg_m, marker, end_m - beg_m);
+      if ( p != NULL )
+        {
+          beg_m = p - buff_m;
+          return true;
+        }
+      beg_m = end_m;
+      if ( ! fill( ) )
+        return false;
+    }
+}
+
+
+//----------------------------------------------------- getFormat --------------
+SeqReader_t::Format_t SeqReader_t::getFormat ( )
+{
+  if ( format_m != UNKNOWN_FORMAT || ! is_open_m )
+    return format_m;
+
+  for ( size_t i = 0; ; i ++ )
+    {
+      if ( i == end_m - beg_m && ! fill( ) )
+        break;
+
+      char ch = buff_m [beg_m + i];
+      if ( ch == '>' )
+        format_m = FASTA_FORMAT;
+      else if ( ch == '@' )
+        format_m = FASTQ_FORMAT;
+      else if ( isspace ((unsigned char) ch) )
+        continue;
+      break;
+    }
+
+  return format_m;
+}
+
+
+//----------------------------------------------------- readHeader -------------
+size_t SeqReader_t::readHeader (size_t & off, size_t & len)
+{
+  //-- beg_m is on the record marker, the header runs to end of line
+  size_t nl = findLine (1);
+  char * b = buff_m + beg_m;
+
+  off = 1;
+  while ( off < nl && b [off] == ' ' )
+    off ++;
+  len = nl - off;
+  if ( len > 0 && b [off + len - 1] == '\r' )
+    len --;
+  b [off + len] = '\0';
+
+  return nl;
+}
+
+
+//----------------------------------------------------- next -------------------
+bool SeqReader_t::next (SeqRecord_t & rec)
+{
+  switch ( getFormat( ) )
+    {
+    case FASTA_FORMAT:
+      return nextFasta (rec, false, 0);
+    case FASTQ_FORMAT:
+      return nextFastq (rec);
+    default:
+      return false;
+    }
+}
+
+
+//----------------------------------------------------- nextQual ---------------
+bool SeqReader_t::nextQual (SeqRecord_t & rec, char offset)
+{
+  return nextFasta (rec, true, offset);
+}
+
+
+//----------------------------------------------------- nextFasta --------------
+bool SeqReader_t::nextFasta (SeqRecord_t & rec, bool numeric, char offset)
+{
+  size_t name_off, name_len;
+
+  if ( ! skipTo ('>') )
+    return false;
+
+  size_t r = readHeader (name_off, name_len);
+  if ( r < end_m - beg_m )
+    r ++;
+  size_t start = r;
+  size_t w = r;
+  int val = -1;
+
+  //-- compact the body in place up to the next '>', w never passes r
+  for ( ;; )
+    {
+      size_t avail = end_m - beg_m;
+      char * b = buff_m + beg_m;
+
+      if ( ! numeric )
+        {
+          for ( ; r < avail; r ++ )
+            {
+              char ch = b [r];
+              if ( ch == '>' )
+                break;
+              if ( ! isspace ((unsigned char) ch) )
+                b [w ++] = ch;
+            }
+        }
+      else
+        {
+          for ( ; r < avail; r ++ )
+            {
+              char ch = b [r];
+              if ( ch == '>' )
+                break;
+              if ( isdigit ((unsigned char) ch) )
+                val = (val < 0 ? 0 : 10 * val) + ch - '0';
+              else if ( isspace ((unsigned char) ch) && val >= 0 )
+                {
+                  b [w ++] = char (val + offset);
+                  val = -1;
+                }
+            }
+        }
+
+      if ( r < avail || ! fill( ) )
+        break;
+    }
+
+  char * b = buff_m + beg_m;
+  if ( val >= 0 )
+    b [w ++] = char (val + offset);
+
+  //-- NUL terminate, remembering if that clobbers the next record's '>'
+  if ( w == r && r < end_m - beg_m )
+    marker_m = true;
+  b [w] = '\0';
+
+  rec . name = b + name_off;
+  rec . name_len = name_len;
+  if ( numeric )
+    {
+      rec . seq = "";
+      rec . seq_len = 0;
+      rec . qual = b + start;
+      rec . qual_len = w - start;
+    }
+  else
+    {
+      rec . seq = b + start;
+      rec . seq_len = w - start;
+      rec . qual = "";
+      rec . qual_len = 0;
+    }
+
+  beg_m += r;
+  return true;
+}
+
+
+//----------------------------------------------------- nextFastq --------------
+bool SeqReader_t::nextFastq (SeqRecord_t & rec)
+{
+  size_t name_off, name_len;
+
+  if ( ! skipTo ('@') )
+    return false;
+
+  //-- header and sequence lines must both be complete
+  size_t seq_off = readHeader (name_off, name_len) + 1;
+  size_t seq_end = seq_off > end_m - beg_m ? seq_off : findLine (seq_off);
+  if ( seq_end >= end_m - beg_m )
+    {
+      beg_m = end_m;
+      return false;
+    }
+
+  char * b = buff_m + beg_m;
+  size_t w = seq_off;
+  for ( size_t r = seq_off; r < seq_end; r ++ )
+    if ( ! isspace ((unsigned char) b [r]) )
+      b [w ++] = b [r];
+  b [w] = '\0';
+  size_t seq_len = w - seq_off;
+
+  //-- skip the '+' line, the quality line may end the input
+  size_t qual_off = findLine (seq_end + 1);
+  if ( qual_off < end_m - beg_m )
+    qual_off ++;
+  size_t qual_end = findLine (qual_off);
+  size_t next = qual_end < end_m - beg_m ? qual_end + 1 : qual_end;
+
+  b = buff_m + beg_m;
+  size_t qual_len = qual_end - qual_off;
+  if ( qual_len > 0 && b [qual_off + qual_len - 1] == '\r' )
+    qual_len --;
+  b [qual_off + qual_len] = '\0';
+
+  rec . name = b + name_off;
+  rec . name_len = name_len;
+  rec . seq = b + seq_off;
+  rec . seq_len = seq_len;
+  rec . qual = b + qual_off;
+  rec . qual_len = qual_len;
+
+  beg_m += next;
+  return true;
+}
@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Buffered FASTA/FASTQ reader with in-process decompression
+//!
+//! SeqReader_t scans large blocks of its input instead of going through
+//! stdio one character at a time, and hands out records as views into its
+//! own buffer so steady-state reading does not allocate. Gzip input is
+//! detected by its magic number and inflated in-process; when threads are
+//! available the inflation runs on a background thread so it overlaps
+//! with parsing. Bzip2 input is piped through an external bzip2.
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SEQREADER_HH
+#define __SEQREADER_HH
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+
+
+
+
+//================================================ SeqRecord_t =================
+//! \brief A view of one FASTA/FASTQ record inside a SeqReader_t buffer
+//!
+//! All three fields are NUL terminated. The view is only valid until the
+//! next call to read from, or close, the reader that filled it. Copy the
+//! fields out if they are needed longer than that.
+//!
+//==============================================================================
+struct SeqRecord_t
+{
+  const char * name;  //!< header line without the leading '>' or '@'
+  size_t name_len;    //!< length of name
+  const char * seq;   //!< sequence with all whitespace removed
+  size_t seq_len;     //!< length of seq
+  const char * qual;  //!< raw quality string, "" for FASTA records
+  size_t qual_len;    //!< length of qual
+
+  SeqRecord_t ( )
+    : name (""), name_len (0), seq (""), seq_len (0), qual (""), qual_len (0)
+  { }
+};
+
+
+
+
+//================================================ SeqReader_t =================
+//! \brief High-throughput reader for FASTA, FASTQ and FASTA-style quality files
+//!
+//! The record format is taken from the first record marker in the input,
+//! '>' for FASTA and '@' for FASTQ. Plain, gzip and bzip2 files are
+//! accepted; a file name of "-" reads from stdin.
+//!
+//==============================================================================
+class SeqReader_t
+{
+
+public:
+
+  enum Format_t
+    {
+      UNKNOWN_FORMAT,
+      FASTA_FORMAT,
+      FASTQ_FORMAT
+    };
+
+  static const size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+  //!< bytes fetched from the underlying file per read
+
+
+  //---------------------------------------------- SeqReader_t -----------------
+  //! \brief Constructs a closed reader
+  //!
+  SeqReader_t ( );
+
+
+  //---------------------------------------------- SeqReader_t -----------------
+  //! \brief Constructs and opens a reader
+  //!
+  //! \param path File to open, "-" for stdin
+  //! \exception IOException_t If the file could not be opened
+  //!
+  explicit SeqReader_t (const std::string & path);
+
+
+  //---------------------------------------------- ~SeqReader_t ----------------
+  //! \brief Closes the reader and stops any decompression thread
+  //!
+  ~SeqReader_t ( );
+
+
+  //---------------------------------------------- open ------------------------
+  //! \brief Opens a file for reading, closing any previously open file
+  //!
+  //! \param path File to open, "-" for stdin
+  //! \exception IOException_t If the file could not be opened
+  //!
+  void open (const std::string & path);
+
+
+  //---------------------------------------------- open ------------------------
+  //! \brief Reads from an already open stdio stream
+  //!
+  //! Reads the underlying descriptor directly, so nothing should have been
+  //! read from fp through stdio beforehand. The stream is not closed.
+  //!
+  //! \param fp Open stream, e.g. stdin
+  //!
+  void open (FILE * fp);
+
+
+  //---------------------------------------------- close -----------------------
+  //! \brief Closes the reader, invalidating any outstanding record views
+  //!
+  void close ( );
+
+
+  //---------------------------------------------- isOpen ----------------------
+  //! \brief Checks if the reader is open
+  //!
+  bool isOpen ( ) const
+  {
+    return is_open_m;
+  }
+
+
+  //---------------------------------------------- isCompressed ----------------
+  //! \brief Checks if the input is being decompressed
+  //!
+  bool isCompressed ( ) const
+  {
+    return codec_m != PLAIN_CODEC;
+  }
+
+
+  //---------------------------------------------- getFormat -------------------
+  //! \brief Returns the record format, detecting it if necessary
+  //!
+  Format_t getFormat ( );
+
+
+  //---------------------------------------------- next ------------------------
+  //! \brief Reads the next FASTA or FASTQ record
+  //!
+  //! \param rec Filled with a view of the record
+  //! \exception IOException_t On a read, decompression or format error
+  //! \return false at end of input, true otherwise
+  //!
+  bool next (SeqRecord_t & rec);
+
+
+  //---------------------------------------------- nextQual --------------------
+  //! \brief Reads the next record of a FASTA-style numeric quality file
+  //!
+  //! The whitespace separated quality values are converted in place to
+  //! characters by adding offset, and returned in rec.qual; rec.seq is "".
+  //!
+  //! \param rec Filled with a view of the record
+  //! \param offset Added to each quality value, e.g. AMOS::MIN_QUALITY
+  //! \return false at end of input, true otherwise
+  //!
+  bool nextQual (SeqRecord_t & rec, char offset);
+
+
+private:
+
+  enum Codec_t
+    {
+      PLAIN_CODEC,
+      GZIP_CODEC,
+      PIPE_CODEC
+    };
+
+  struct Inflater_t;
+
+  SeqReader_t (const SeqReader_t &);
+  SeqReader_t & operator= (const SeqReader_t &);
+
+  void init ( );
+  void start (const char * path);
+  size_t rawRead (char * dst, size_t n);
+  bool fill ( );
+  size_t findLine (size_t off);
+  bool skipTo (char marker);
+  size_t readHeader (size_t & off, size_t & len);
+  bool nextFasta (SeqRecord_t & rec, bool numeric, char offset);
+  bool nextFastq (SeqRecord_t & rec);
+
+  bool is_open_m;          //!< open status
+  Codec_t codec_m;         //!< how the input is decoded
+  Format_t format_m;       //!< detected record format
+  std::string name_m;      //!< input name for error messages
+  int fd_m;                //!< input file descriptor
+  bool own_fd_m;           //!< close fd_m on close
+  FILE * pipe_m;           //!< popen'd decompressor, or NULL
+  Inflater_t * inflater_m; //!< gzip state, or NULL
+
+  char * buff_m;           //!< scan buffer
+  size_t cap_m;            //!< allocated size of buff_m
+  size_t beg_m;            //!< start of the current record in buff_m
+  size_t end_m;            //!< end of valid data in buff_m
+  bool eof_m;              //!< underlying input exhausted
+  bool marker_m;           //!< record marker at beg_m was overwritten
+};
+
+#endif // #ifndef __SEQREADER_HH
@@ -0,0 +1,140 @@
+#include "CEStatSweep.hh"
+#include <cmath>
+#include <algorithm>
+
+using namespace AMOS;
+using namespace std;
+
+
+double CEPoint::stdev() const
+{
+  if (m_n < 2) { return 0; }
+
+  double var = (m_sumsq - m_sum * m_sum / m_n) / (m_n - 1);
+  return (var > 0) ? sqrt(var) : 0;
+}
+
+
+double CEPoint::zscore(double libmean, double libsd) const
+{
+  if (libsd == 0) { return 0; }
+  return (mean() - libmean) * sqrt((double)m_n) / libsd;
+}
+
+
+CEStatSweep::CEStatSweep(bool endsfirst)
+ : m_endsfirst(endsfirst)
+{
+}
+
+
+void CEStatSweep::clear()
+{
+  m_starts.clear();
+  m_ends.clear();
+  m_points.clear();
+}
+
+
+void CEStatSweep::addInsert(Pos_t left, Pos_t right)
+{
+  if (right < left) { swap(left, right); }
+
+  m_starts.push_back(make_pair(left, right - left));
+  m_ends.push_back(make_pair(right, right - left));
+}
+
+
+const vector<CEPoint> & CEStatSweep::sweep()
+{
+  sort(m_starts.begin(), m_starts.end());
+  sort(m_ends.begin(), m_ends.end());
+
+  m_points.clear();
+  m_points.reserve(m_starts.size() + m_ends.size());
+
+  CEPoint p;
+  p.m_n = 0;
+  p.m_sum = p.m_sumsq = 0;
+
+  unsigned int si = 0, ei = 0;
+  while (ei < m_ends.size())
+  {
+    bool start = false;
+
+    if (si < m_starts.size())
+    {
+      if (m_endsfirst) { start = m_starts[si].first <  m_ends[ei].first; }
+      else             { start = m_starts[si].first <= m_ends[ei].first; }
+    }
+
+    double size;
+    if (start)
+    {
+      p.m_pos = m_starts[si].first;
+      size = m_starts[si].second;
+      si++;
+
+      p.m_n++;
+      p.m_sum += size;
+      p.m_sumsq += size * size;
+    }
+    else
+    {
+      p.m_pos = m_ends[ei].first;
+      size = m_ends[ei].second;
+      ei++;
+
+      p.m_n--;
+      p.m_sum -= size;
+      p.m_sumsq -= size * size;
+    }
+
+    m_points.push_back(p);
+  }
+
+  return m_points;
+}
+
+
+void CEStatSweep::findRegions(double libmean, double libsd, bool uselibsd,
+                              double numsd, int minobs,
+                              list<pair<Pos_t, Pos_t> > & interest,
+                              list<bool> & stretch) const
+{
+  Pos_t st = 0;
+  bool over = false;  // is error on the longer or shorter side
+  bool inbad = false; // are we in a bad region
+
+  interest.clear();
+  stretch.clear();
+
+  for (vector<CEPoint>::const_iterator pi = m_points.begin(); pi != m_points.end(); pi++)
+  {
+    double mea = pi->mean();
+    double sderr = uselibsd ? libsd : pi->stdev();
+
+    if (pi->m_n > minobs && fabs(mea - libmean) > numsd * sderr / sqrt((double)pi->m_n))
+    {
+      if (inbad && over != (mea > libmean)) // switched type of bad region
+      {
+        interest.push_back(make_pair(st, pi->m_pos));
+        stretch.push_back(over);
+        st = pi->m_pos;
+      }
+      over = (mea > libmean);
+
+      if (! inbad) // if not already in a bad region, we are now
+      {
+        inbad = true;
+        st = pi->m_pos;
+      }
+    }
+    else if (inbad) // bad region ended
+    {
+      inbad = false;
+      interest.push_back(make_pair(st, pi->m_pos));
+      stretch.push_back(over);
+    }
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef CESTATSWEEP_HH_
+#define CESTATSWEEP_HH_ 1
+
+#include <foundation_AMOS.hh>
+#include <vector>
+#include <list>
+#include <utility>
+
+// Sweep-line computation of the compression-expansion (C/E) statistic.
+//
+// Inserts are added as (left, right) ranges, then sweep() sorts their
+// starts and ends once and walks them in position order, keeping running
+// sums of the sizes of the inserts spanning the current position. Every
+// start or end yields one CEPoint, so a contig with n inserts costs
+// O(n log n) instead of rescanning the spanning inserts at each event.
+struct CEPoint
+{
+  AMOS::Pos_t m_pos;    // position of the event
+  int m_n;              // inserts spanning m_pos after the event
+  double m_sum;         // sum of their sizes
+  double m_sumsq;       // sum of the squares of their sizes
+
+  double mean() const  { return m_n ? m_sum / m_n : 0; }
+  double stdev() const;
+  double zscore(double libmean, double libsd) const;
+};
+
+class CEStatSweep
+{
+public:
+  // With endsfirst, inserts ending at a position are removed before the
+  // ones starting there are added, otherwise starts come first
+  CEStatSweep(bool endsfirst = false);
+
+  void clear();
+  void addInsert(AMOS::Pos_t left, AMOS::Pos_t right);
+  int  size() const { return m_starts.size(); }
+
+  // Computes m_points from the inserts added so far
+  const std::vector<CEPoint> & sweep();
+
+  // Reports the stretches of m_points whose mean insert size is more than
+  // numsd standard errors off libmean, with more than minobs inserts.
+  // The standard error is libsd / sqrt(n), or the local standard deviation
+  // of the inserts when uselibsd is false. stretch is true for regions
+  // where the inserts are longer than expected.
+  void findRegions(double libmean, double libsd, bool uselibsd,
+                   double numsd, int minobs,
+                   std::list<std::pair<AMOS::Pos_t, AMOS::Pos_t> > & interest,
+                   std::list<bool> & stretch) const;
+
+  std::vector<CEPoint> m_points;
+
+private:
+  bool m_endsfirst;
+  std::vector<std::pair<AMOS::Pos_t, AMOS::Size_t> > m_starts;
+  std::vector<std::pair<AMOS::Pos_t, AMOS::Size_t> > m_ends;
+};
+
+
+#endif
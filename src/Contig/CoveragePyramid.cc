@@ -0,0 +1,492 @@
+#include "CoveragePyramid.hh"
+#include "TilingIndex_AMOS.hh"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace AMOS;
+using namespace std;
+
+const string CoveragePyramid::PYRAMID_SUFFIX = ".cvp";
+
+const int CoveragePyramid::INSERT_TRACK;
+const int CoveragePyramid::READ_TRACK;
+
+namespace {
+
+  const char CVP_MAGIC[4] = { 'C', 'V', 'P', '2' };
+
+  // On-disk layout, all fields little-endian:
+  //   header  magic, ncode, binshift, tracks, happy distance (32-bit float),
+  //           stamp hash (64), stamp size (64), bins (64)
+  //   bins    min, max, mean as 32-bit floats, the levels of each track one
+  //           after the other
+  //   tracks  iid, track, begin, end, levels, offset of the first bin (64)
+  const size_t HEADER_SIZE = 44;
+  const size_t BIN_SIZE    = 12;
+  const size_t TRACK_SIZE  = 28;
+
+  const int MAX_BINSHIFT = 24;
+
+  inline uint32_t field32(const char * p, int i)
+  {
+    uint32_t v;
+    memcpy(&v, p + i * sizeof(uint32_t), sizeof(uint32_t));
+    return ltoh32(v);
+  }
+
+  inline uint64_t field64(const char * p)
+  {
+    uint64_t v;
+    memcpy(&v, p, sizeof(uint64_t));
+    return ltoh64(v);
+  }
+
+  inline float toFloat(uint32_t v)
+  {
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+  }
+
+  void writeFloat(ostream & out, float f)
+  {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    writeLE(out, &v);
+  }
+
+  // A bin while the levels are built, with the number of positions it holds
+  struct BuildBin
+  {
+    double m_min, m_max, m_sum;
+    int64_t m_count;
+
+    BuildBin() : m_min(0), m_max(0), m_sum(0), m_count(0) {}
+
+    void add(double v, int64_t n)
+    {
+      if (m_count == 0 || v < m_min) { m_min = v; }
+      if (m_count == 0 || v > m_max) { m_max = v; }
+      m_sum += v * n;
+      m_count += n;
+    }
+
+    void add(const BuildBin & b)
+    {
+      if (b.m_count == 0) { return; }
+      if (m_count == 0 || b.m_min < m_min) { m_min = b.m_min; }
+      if (m_count == 0 || b.m_max > m_max) { m_max = b.m_max; }
+      m_sum += b.m_sum;
+      m_count += b.m_count;
+    }
+  };
+}
+
+
+CoveragePyramid::CoveragePyramid()
+  : m_type(NULL_NCODE), m_binshift(0), m_happydistance(0), m_written(0),
+    m_base(NULL), m_length(0)
+{ }
+
+
+CoveragePyramid::~CoveragePyramid()
+{
+  close();
+}
+
+
+string CoveragePyramid::getPyramidName(const string & bank, NCode_t type)
+{
+  return bank + '/' + Decode(type) + PYRAMID_SUFFIX;
+}
+
+
+// The tracks depend on the tilings and on the mates and libraries of the
+// reads, so the stamps of all of those stores are combined
+void CoveragePyramid::getStamp(const string & bank, int64_t & hash, int64_t & size)
+{
+  static const NCode_t STORES [] =
+    { Contig_t::NCODE, Scaffold_t::NCODE, Fragment_t::NCODE, Library_t::NCODE };
+
+  uint64_t h = 14695981039346656037ULL;
+  size = 0;
+
+  for (unsigned int i = 0; i < sizeof(STORES) / sizeof(STORES[0]); i++)
+  {
+    int64_t shash = 0, ssize = -1;
+    TilingIndex_t::getStamp(bank, STORES[i], shash, ssize);
+
+    h = (h ^ (uint64_t) shash) * 1099511628211ULL;
+    h = (h ^ (uint64_t) ssize) * 1099511628211ULL;
+    size += ssize;
+  }
+
+  hash = (int64_t) h;
+}
+
+
+void CoveragePyramid::create(const string & bank, NCode_t type,
+                             float happydistance, int binshift)
+{
+  close();
+
+  if (binshift < 0 || binshift > MAX_BINSHIFT)
+    AMOS_THROW_ARGUMENT("Bad coverage pyramid bin size");
+
+  m_type = type;
+  m_binshift = binshift;
+  m_happydistance = happydistance;
+  m_tracks.clear();
+  m_written = 0;
+  m_name = getPyramidName(bank, type);
+
+  string tname = m_name + Bank_t::TMP_STORE_SUFFIX;
+  m_out.clear();
+  m_out.open(tname.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!m_out.is_open())
+    AMOS_THROW_IO("Could not open coverage pyramid " + tname);
+
+  // The header is written by commit once the bank stamp is known
+  char header [HEADER_SIZE];
+  memset(header, 0, HEADER_SIZE);
+  m_out.write(header, HEADER_SIZE);
+}
+
+
+void CoveragePyramid::addTrack(ID_t iid, int track, const PointArray_t & points,
+                               const vector<double> * values, int npoints)
+{
+  if (!m_out.is_open())
+    AMOS_THROW_IO("Coverage pyramid is not open for writing");
+  if (npoints <= 0) { return; }
+
+  Track t;
+  t.m_iid = iid;
+  t.m_track = track;
+  t.m_begin = (Pos_t) points[0].x();
+  t.m_end = (Pos_t) points[npoints-1].x();
+  t.m_offset = m_written;
+
+  if (t.m_end < t.m_begin)
+    AMOS_THROW_ARGUMENT("Coverage track points are not sorted");
+
+  // Level 0 from the steps of the track
+  vector<BuildBin> level(getBinCount(t, 0));
+
+  for (int i = 0; i < npoints; i++)
+  {
+    Pos_t s = (Pos_t) points[i].x();
+    Pos_t e = (i + 1 < npoints) ? (Pos_t) points[i+1].x() - 1 : s;
+    if (e < s) { continue; }
+
+    double v = values ? (*values)[i] : points[i].y();
+
+    int b0 = (s - t.m_begin) >> m_binshift;
+    int b1 = (e - t.m_begin) >> m_binshift;
+    for (int b = b0; b <= b1; b++)
+    {
+      Pos_t bs = t.m_begin + (b << m_binshift);
+      Pos_t be = bs + (1 << m_binshift) - 1;
+      level[b].add(v, min(e, be) - max(s, bs) + 1);
+    }
+  }
+
+  // Every level up merges pairs of bins, until one bin holds the track
+  t.m_levels = 0;
+  while (true)
+  {
+    for (size_t b = 0; b < level.size(); b++)
+    {
+      const BuildBin & bb = level[b];
+      writeFloat(m_out, bb.m_min);
+      writeFloat(m_out, bb.m_max);
+      writeFloat(m_out, bb.m_count ? bb.m_sum / bb.m_count : 0);
+    }
+    m_written += level.size();
+    t.m_levels++;
+
+    if (level.size() == 1) { break; }
+
+    vector<BuildBin> up((level.size() + 1) / 2);
+    for (size_t b = 0; b < level.size(); b++)
+    {
+      up[b/2].add(level[b]);
+    }
+    level.swap(up);
+  }
+
+  m_tracks.push_back(t);
+}
+
+
+int CoveragePyramid::commit()
+{
+  if (!m_out.is_open())
+    AMOS_THROW_IO("Coverage pyramid is not open for writing");
+
+  string bank = m_name.substr(0, m_name.rfind('/'));
+  string tname = m_name + Bank_t::TMP_STORE_SUFFIX;
+
+  sort(m_tracks.begin(), m_tracks.end());
+  for (vector<Track>::iterator ti = m_tracks.begin(); ti != m_tracks.end(); ti++)
+  {
+    int32_t track = ti->m_track;
+    int32_t levels = ti->m_levels;
+    writeLE(m_out, &(ti->m_iid));
+    writeLE(m_out, &track);
+    writeLE(m_out, &(ti->m_begin));
+    writeLE(m_out, &(ti->m_end));
+    writeLE(m_out, &levels);
+    writeLE(m_out, &(ti->m_offset));
+  }
+
+  int64_t hash, size;
+  getStamp(bank, hash, size);
+
+  uint32_t ncode = m_type;
+  uint32_t binshift = m_binshift;
+  uint32_t ntracks = m_tracks.size();
+  m_out.seekp(0);
+  m_out.write(CVP_MAGIC, sizeof(CVP_MAGIC));
+  writeLE(m_out, &ncode);
+  writeLE(m_out, &binshift);
+  writeLE(m_out, &ntracks);
+  writeFloat(m_out, m_happydistance);
+  writeLE(m_out, &hash);
+  writeLE(m_out, &size);
+  writeLE(m_out, &m_written);
+  m_out.close();
+
+  m_tracks.clear();
+
+  if (m_out.fail())
+  {
+    unlink(tname.c_str());
+    AMOS_THROW_IO("Could not write coverage pyramid " + tname);
+  }
+  if (rename(tname.c_str(), m_name.c_str()) != 0)
+  {
+    unlink(tname.c_str());
+    AMOS_THROW_IO("Could not rename coverage pyramid " + tname);
+  }
+
+  return ntracks;
+}
+
+
+bool CoveragePyramid::isCurrent(const string & bank, NCode_t type)
+{
+  int64_t hash, size, phash, psize;
+  char magic [sizeof(CVP_MAGIC)];
+  uint32_t ncode, binshift, ntracks, happydistance;
+
+  ifstream in(getPyramidName(bank, type).c_str(), ios::in | ios::binary);
+  if (!in.is_open()) { return false; }
+
+  getStamp(bank, hash, size);
+
+  in.read(magic, sizeof(magic));
+  readLE(in, &ncode);
+  readLE(in, &binshift);
+  readLE(in, &ntracks);
+  readLE(in, &happydistance);
+  readLE(in, &phash);
+  readLE(in, &psize);
+
+  return in.good() &&
+    memcmp(magic, CVP_MAGIC, sizeof(magic)) == 0 &&
+    ncode == type && phash == hash && psize == size;
+}
+
+
+void CoveragePyramid::open(const string & bank, NCode_t type)
+{
+  close();
+
+  string name = getPyramidName(bank, type);
+  if (!isCurrent(bank, type))
+    AMOS_THROW_IO("Missing or out of date coverage pyramid " + name);
+
+  int fd = ::open(name.c_str(), O_RDONLY);
+  if (fd < 0)
+    AMOS_THROW_IO("Could not open coverage pyramid " + name);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < HEADER_SIZE)
+  {
+    ::close(fd);
+    AMOS_THROW_IO("Damaged coverage pyramid " + name);
+  }
+
+  void * p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED)
+    AMOS_THROW_IO("Could not map coverage pyramid " + name);
+
+  m_base = (const char *) p;
+  m_length = st.st_size;
+  m_type = type;
+  m_binshift = field32(m_base, 2);
+  m_happydistance = toFloat(field32(m_base, 4));
+
+  uint32_t ntracks = field32(m_base, 3);
+  uint64_t nbins = field64(m_base + 36);
+  size_t dir = HEADER_SIZE + nbins * BIN_SIZE;
+
+  if (m_binshift > MAX_BINSHIFT || dir + ntracks * TRACK_SIZE != m_length)
+  {
+    close();
+    AMOS_THROW_IO("Damaged coverage pyramid " + name);
+  }
+
+  m_tracks.resize(ntracks);
+  for (uint32_t i = 0; i < ntracks; i++)
+  {
+    const char * q = m_base + dir + i * TRACK_SIZE;
+    Track & t = m_tracks[i];
+    t.m_iid = field32(q, 0);
+    t.m_track = (int32_t) field32(q, 1);
+    t.m_begin = (int32_t) field32(q, 2);
+    t.m_end = (int32_t) field32(q, 3);
+    t.m_levels = (int32_t) field32(q, 4);
+    t.m_offset = field64(q + 20);
+
+    uint64_t bins = 0;
+    for (int l = 0; l < t.m_levels; l++) { bins += getBinCount(t, l); }
+
+    if (t.m_end < t.m_begin || t.m_levels <= 0 || t.m_offset + bins > nbins)
+    {
+      close();
+      AMOS_THROW_IO("Damaged coverage pyramid " + name);
+    }
+  }
+}
+
+
+void CoveragePyramid::close()
+{
+  if (m_out.is_open())
+  {
+    m_out.close();
+    unlink((m_name + Bank_t::TMP_STORE_SUFFIX).c_str());
+  }
+
+  if (m_base != NULL)
+    munmap((void *) m_base, m_length);
+
+  m_base = NULL;
+  m_length = 0;
+  m_tracks.clear();
+}
+
+
+const CoveragePyramid::Track * CoveragePyramid::findTrack(ID_t iid, int track) const
+{
+  Track key;
+  key.m_iid = iid;
+  key.m_track = track;
+
+  vector<Track>::const_iterator ti = lower_bound(m_tracks.begin(), m_tracks.end(), key);
+  if (ti == m_tracks.end() || ti->m_iid != iid || ti->m_track != track)
+    return NULL;
+  return &(*ti);
+}
+
+
+int CoveragePyramid::getBinCount(const Track & t, int level) const
+{
+  return ((int64_t) (t.m_end - t.m_begin) >> (m_binshift + level)) + 1;
+}
+
+
+uint64_t CoveragePyramid::getLevelOffset(const Track & t, int level) const
+{
+  uint64_t off = t.m_offset;
+  for (int l = 0; l < level; l++) { off += getBinCount(t, l); }
+  return off;
+}
+
+
+CoveragePyramid::Bin CoveragePyramid::getBin(uint64_t bin) const
+{
+  const char * p = m_base + HEADER_SIZE + bin * BIN_SIZE;
+  Bin b;
+  b.m_min = toFloat(field32(p, 0));
+  b.m_max = toFloat(field32(p, 1));
+  b.m_mean = toFloat(field32(p, 2));
+  return b;
+}
+
+
+int CoveragePyramid::getLevel(double binsize) const
+{
+  int level = 0;
+  while (m_binshift + level + 1 < 31 && getBinSize(level + 1) <= binsize)
+  {
+    level++;
+  }
+  return level;
+}
+
+
+void CoveragePyramid::getTracks(ID_t iid, vector<int> & tracks) const
+{
+  tracks.clear();
+
+  Track key;
+  key.m_iid = iid;
+  key.m_track = INT_MIN;
+
+  vector<Track>::const_iterator ti = lower_bound(m_tracks.begin(), m_tracks.end(), key);
+  for (; ti != m_tracks.end() && ti->m_iid == iid; ti++)
+  {
+    tracks.push_back(ti->m_track);
+  }
+}
+
+
+bool CoveragePyramid::getSummary(ID_t iid, int track,
+                                 Pos_t & begin, Pos_t & end, Bin & summary) const
+{
+  const Track * t = findTrack(iid, track);
+  if (t == NULL) { return false; }
+
+  begin = t->m_begin;
+  end = t->m_end;
+  summary = getBin(getLevelOffset(*t, t->m_levels - 1));
+  return true;
+}
+
+
+int CoveragePyramid::fetch(ID_t iid, int track, int & level,
+                           Pos_t begin, Pos_t end,
+                           vector<Bin> & bins, Pos_t & first) const
+{
+  bins.clear();
+  first = begin;
+
+  const Track * t = findTrack(iid, track);
+  if (t == NULL || end < t->m_begin || begin > t->m_end) { return 0; }
+
+  level = max(0, min(level, t->m_levels - 1));
+  int shift = m_binshift + level;
+  int i0 = (max(begin, t->m_begin) - t->m_begin) >> shift;
+  int i1 = (min(end, t->m_end) - t->m_begin) >> shift;
+
+  uint64_t off = getLevelOffset(*t, level);
+
+  first = t->m_begin + ((Pos_t) i0 << shift);
+  for (int i = i0; i <= i1; i++)
+  {
+    bins.push_back(getBin(off + i));
+  }
+
+  return bins.size();
+}
@@ -0,0 +1,132 @@
+#ifndef COVERAGEPYRAMID_HH_
+#define COVERAGEPYRAMID_HH_ 1
+
+#include <foundation_AMOS.hh>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "CoverageStats.hh"
+
+// Precomputed coverage tracks of the contigs or scaffolds of a bank, stored
+// in the bank directory as CTG.cvp or SCF.cvp.
+//
+// Each track is a step function over the positions of its object, such as
+// the read coverage, the happy insert coverage or the C/E statistic of a
+// library. It is stored as a pyramid of levels of fixed size bins: the bins
+// of level 0 hold 2^binshift positions, and every level up doubles the bin
+// size until a single bin covers the whole track. A bin keeps the min, max
+// and mean of the track over its positions, so a viewer can draw a track at
+// any zoom by reading the one level whose bin size matches a screen pixel,
+// without looking at the reads or inserts.
+//
+// The pyramid is a snapshot of the bank: once the contigs, scaffolds,
+// fragments or libraries change, isCurrent() is false and open() refuses it.
+// It also records the happy distance, Insert::MAXSTDEV, its insert and C/E
+// tracks were computed with, a viewer set to another one cannot use them.
+class CoveragePyramid
+{
+public:
+  struct Bin
+  {
+    float m_min;
+    float m_max;
+    float m_mean;
+  };
+
+  // Track ids, the C/E statistic track of a library uses the library IID
+  static const int INSERT_TRACK = -1;   // happy insert coverage
+  static const int READ_TRACK   = -2;   // read coverage
+
+  static const std::string PYRAMID_SUFFIX;
+
+  CoveragePyramid();
+  ~CoveragePyramid();
+
+  // Writing: create() starts a new pyramid, every track is added with
+  // addTrack() and commit() replaces the pyramid of the bank
+  void create(const std::string & bank, AMOS::NCode_t type,
+              float happydistance, int binshift = 6);
+
+  // Adds the step function through the first npoints points of a
+  // CoverageStats, with the y of each point as value, or values[i] when
+  // values is given. Points are sorted by x, the value of a point holds up
+  // to the next point, the one of the last point only at its x.
+  void addTrack(AMOS::ID_t iid, int track, const PointArray_t & points,
+                const std::vector<double> * values, int npoints);
+
+  // Returns the number of tracks written
+  int commit();
+
+  // Reading
+  static bool isCurrent(const std::string & bank, AMOS::NCode_t type);
+  void open(const std::string & bank, AMOS::NCode_t type);
+  void close();
+  bool isOpen() const { return m_base != NULL; }
+  AMOS::NCode_t getType() const { return m_type; }
+  float getHappyDistance() const { return m_happydistance; }
+
+  int getBinSize(int level) const { return 1 << (m_binshift + level); }
+
+  // The coarsest level whose bins hold at most binsize positions, 0 if
+  // even level 0 has larger bins
+  int getLevel(double binsize) const;
+
+  // The tracks of an object, sorted by id
+  void getTracks(AMOS::ID_t iid, std::vector<int> & tracks) const;
+
+  // Extent of a track and its min, max and mean over the whole extent,
+  // false if the object has no such track
+  bool getSummary(AMOS::ID_t iid, int track,
+                  AMOS::Pos_t & begin, AMOS::Pos_t & end, Bin & summary) const;
+
+  // The bins of a level that overlap [begin, end], level is clamped to the
+  // levels of the track. Returns the number of bins, first is set to the
+  // position of the first bin, which is followed by the others without gaps.
+  int fetch(AMOS::ID_t iid, int track, int & level,
+            AMOS::Pos_t begin, AMOS::Pos_t end,
+            std::vector<Bin> & bins, AMOS::Pos_t & first) const;
+
+private:
+  struct Track
+  {
+    AMOS::ID_t m_iid;
+    int m_track;
+    AMOS::Pos_t m_begin;    // first position
+    AMOS::Pos_t m_end;      // last position
+    int m_levels;
+    uint64_t m_offset;      // first bin of level 0 in the file
+
+    bool operator< (const Track & o) const
+    {
+      return m_iid < o.m_iid || (m_iid == o.m_iid && m_track < o.m_track);
+    }
+  };
+
+  CoveragePyramid(const CoveragePyramid &);
+  CoveragePyramid & operator=(const CoveragePyramid &);
+
+  static std::string getPyramidName(const std::string & bank, AMOS::NCode_t type);
+  static void getStamp(const std::string & bank, int64_t & hash, int64_t & size);
+
+  const Track * findTrack(AMOS::ID_t iid, int track) const;
+  int getBinCount(const Track & t, int level) const;
+  uint64_t getLevelOffset(const Track & t, int level) const;
+  Bin getBin(uint64_t bin) const;
+
+  AMOS::NCode_t m_type;
+  int m_binshift;
+  float m_happydistance;          // Insert::MAXSTDEV of the insert tracks
+  std::vector<Track> m_tracks;    // directory, sorted by object and track
+
+  // writing
+  std::string m_name;
+  std::ofstream m_out;
+  uint64_t m_written;             // bins written
+
+  // reading
+  const char * m_base;
+  size_t m_length;
+};
+
+
+#endif
@@ -146,6 +146,7 @@ void DataStore::indexReads()
 
   read_bank.seekg(1);
   read_bank.setFixedStoreOnly(true);
+  read_bank.setReadAhead(4);
 
   while (read_bank >> red)
   {
@@ -156,6 +157,7 @@ void DataStore::indexReads()
   }
 
   read_bank.setFixedStoreOnly(false);
+  read_bank.setReadAhead(0);
 
   cerr << " " << timer.str() << " "
        << m_readfraglookup.size() << " reads" << endl;
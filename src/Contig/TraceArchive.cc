@@ -0,0 +1,249 @@
+#include "TraceArchive.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace AMOS;
+using namespace std;
+
+const string TraceArchive::ARCHIVE_SUFFIX = ".trc";
+
+namespace {
+
+  const char TRC_MAGIC[4] = { 'T', 'R', 'C', '1' };
+
+  // On-disk layout, all fields little-endian:
+  //   header  magic, traces, offset of the index (64)
+  //   traces  EID followed by the ZTR bytes of the trace, one after the other
+  //   index   iid, EID size, offset (64), trace size
+  const size_t HEADER_SIZE = 16;
+  const size_t TRACE_SIZE  = 20;
+
+  inline uint32_t field32(const char * p, int i)
+  {
+    uint32_t v;
+    memcpy(&v, p + i * sizeof(uint32_t), sizeof(uint32_t));
+    return ltoh32(v);
+  }
+
+  inline uint64_t field64(const char * p)
+  {
+    uint64_t v;
+    memcpy(&v, p, sizeof(uint64_t));
+    return ltoh64(v);
+  }
+}
+
+
+TraceArchive::TraceArchive()
+  : m_written(0), m_base(NULL), m_length(0)
+{ }
+
+
+TraceArchive::~TraceArchive()
+{
+  close();
+}
+
+
+string TraceArchive::getArchiveName(const string & bank)
+{
+  return bank + '/' + Decode(Read_t::NCODE) + ARCHIVE_SUFFIX;
+}
+
+
+void TraceArchive::create(const string & bank)
+{
+  close();
+
+  m_traces.clear();
+  m_name = getArchiveName(bank);
+
+  string tname = m_name + Bank_t::TMP_STORE_SUFFIX;
+  m_out.clear();
+  m_out.open(tname.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!m_out.is_open())
+    AMOS_THROW_IO("Could not open trace archive " + tname);
+
+  // The header is written by commit once the index is in place
+  char header [HEADER_SIZE];
+  memset(header, 0, HEADER_SIZE);
+  m_out.write(header, HEADER_SIZE);
+  m_written = HEADER_SIZE;
+}
+
+
+void TraceArchive::add(ID_t iid, const string & eid,
+                       const char * data, size_t size)
+{
+  if (!m_out.is_open())
+    AMOS_THROW_IO("Trace archive is not open for writing");
+  if (size > 0xffffffffUL)
+    AMOS_THROW_ARGUMENT("Trace too large for the trace archive");
+
+  Trace t;
+  t.m_iid = iid;
+  t.m_eidsize = eid.size();
+  t.m_offset = m_written;
+  t.m_size = size;
+
+  m_out.write(eid.data(), eid.size());
+  m_out.write(data, size);
+  m_written += eid.size() + size;
+
+  m_traces.push_back(t);
+}
+
+
+int TraceArchive::commit()
+{
+  if (!m_out.is_open())
+    AMOS_THROW_IO("Trace archive is not open for writing");
+
+  string tname = m_name + Bank_t::TMP_STORE_SUFFIX;
+
+  sort(m_traces.begin(), m_traces.end());
+  for (size_t i = 1; i < m_traces.size(); i++)
+  {
+    if (m_traces[i].m_iid == m_traces[i-1].m_iid)
+    {
+      close();
+      AMOS_THROW_ARGUMENT("Trace archive holds two traces of one read");
+    }
+  }
+
+  for (vector<Trace>::iterator ti = m_traces.begin(); ti != m_traces.end(); ti++)
+  {
+    writeLE(m_out, &(ti->m_iid));
+    writeLE(m_out, &(ti->m_eidsize));
+    writeLE(m_out, &(ti->m_offset));
+    writeLE(m_out, &(ti->m_size));
+  }
+
+  uint32_t ntraces = m_traces.size();
+  m_out.seekp(0);
+  m_out.write(TRC_MAGIC, sizeof(TRC_MAGIC));
+  writeLE(m_out, &ntraces);
+  writeLE(m_out, &m_written);
+  m_out.close();
+
+  m_traces.clear();
+
+  if (m_out.fail())
+  {
+    unlink(tname.c_str());
+    AMOS_THROW_IO("Could not write trace archive " + tname);
+  }
+  if (rename(tname.c_str(), m_name.c_str()) != 0)
+  {
+    unlink(tname.c_str());
+    AMOS_THROW_IO("Could not rename trace archive " + tname);
+  }
+
+  return ntraces;
+}
+
+
+bool TraceArchive::exists(const string & bank)
+{
+  return access(getArchiveName(bank).c_str(), R_OK) == 0;
+}
+
+
+void TraceArchive::open(const string & bank)
+{
+  close();
+
+  string name = getArchiveName(bank);
+
+  int fd = ::open(name.c_str(), O_RDONLY);
+  if (fd < 0)
+    AMOS_THROW_IO("Could not open trace archive " + name);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < HEADER_SIZE)
+  {
+    ::close(fd);
+    AMOS_THROW_IO("Damaged trace archive " + name);
+  }
+
+  void * p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED)
+    AMOS_THROW_IO("Could not map trace archive " + name);
+
+  m_base = (const char *) p;
+  m_length = st.st_size;
+
+  uint32_t ntraces = field32(m_base, 1);
+  uint64_t index = field64(m_base + 8);
+
+  if (memcmp(m_base, TRC_MAGIC, sizeof(TRC_MAGIC)) != 0 ||
+      index < HEADER_SIZE || index + ntraces * TRACE_SIZE != m_length)
+  {
+    close();
+    AMOS_THROW_IO("Damaged trace archive " + name);
+  }
+
+  m_traces.resize(ntraces);
+  for (uint32_t i = 0; i < ntraces; i++)
+  {
+    const char * q = m_base + index + i * TRACE_SIZE;
+    Trace & t = m_traces[i];
+    t.m_iid = field32(q, 0);
+    t.m_eidsize = field32(q, 1);
+    t.m_offset = field64(q + 8);
+    t.m_size = field32(q, 4);
+
+    if (t.m_offset < HEADER_SIZE ||
+        t.m_offset + t.m_eidsize + t.m_size > index ||
+        (i > 0 && !(m_traces[i-1] < t)))
+    {
+      close();
+      AMOS_THROW_IO("Damaged trace archive " + name);
+    }
+  }
+}
+
+
+void TraceArchive::close()
+{
+  if (m_out.is_open())
+  {
+    m_out.close();
+    unlink((m_name + Bank_t::TMP_STORE_SUFFIX).c_str());
+  }
+
+  if (m_base != NULL)
+    munmap((void *) m_base, m_length);
+
+  m_base = NULL;
+  m_length = 0;
+  m_traces.clear();
+}
+
+
+bool TraceArchive::find(ID_t iid, const string & eid,
+                        const char * & data, size_t & size) const
+{
+  if (m_base == NULL) { return false; }
+
+  Trace key;
+  key.m_iid = iid;
+
+  vector<Trace>::const_iterator ti = lower_bound(m_traces.begin(), m_traces.end(), key);
+  if (ti == m_traces.end() || ti->m_iid != iid) { return false; }
+
+  const char * p = m_base + ti->m_offset;
+  if (ti->m_eidsize != eid.size() || memcmp(p, eid.data(), eid.size()) != 0)
+    return false;
+
+  data = p + ti->m_eidsize;
+  size = ti->m_size;
+  return true;
+}
@@ -0,0 +1,82 @@
+#ifndef TRACEARCHIVE_HH_
+#define TRACEARCHIVE_HH_ 1
+
+#include <foundation_AMOS.hh>
+#include <string>
+#include <vector>
+#include <fstream>
+
+// The chromatograms of the reads of a bank packed into one file, stored in
+// the bank directory as RED.trc.
+//
+// Every trace is kept as the bytes of a ZTR file together with the EID of
+// its read, and the file ends with an index of the traces sorted by read
+// IID. A viewer maps the archive and finds the trace of a read with a binary
+// search, without searching the trace directories or opening a file per
+// read. The archive only holds bytes, decoding them is left to the caller.
+//
+// Traces are keyed by IID but also checked against the EID of the read, so
+// a trace packed before the reads were renumbered is never handed out for
+// the wrong read.
+class TraceArchive
+{
+public:
+  static const std::string ARCHIVE_SUFFIX;
+
+  TraceArchive();
+  ~TraceArchive();
+
+  // Writing: create() starts a new archive, every trace is added with add()
+  // and commit() replaces the archive of the bank
+  void create(const std::string & bank);
+  void add(AMOS::ID_t iid, const std::string & eid,
+           const char * data, size_t size);
+
+  // Returns the number of traces written
+  int commit();
+
+  // Reading
+  static bool exists(const std::string & bank);
+  void open(const std::string & bank);
+  void close();
+  bool isOpen() const { return m_base != NULL; }
+  int getSize() const { return m_traces.size(); }
+
+  // Points data at the packed trace of a read, false if the archive has no
+  // trace for iid or it was packed for a read with another EID
+  bool find(AMOS::ID_t iid, const std::string & eid,
+            const char * & data, size_t & size) const;
+
+private:
+  struct Trace
+  {
+    AMOS::ID_t m_iid;
+    uint32_t m_eidsize;
+    uint64_t m_offset;      // EID, followed by the trace
+    uint32_t m_size;        // size of the trace
+
+    bool operator< (const Trace & o) const
+    {
+      return m_iid < o.m_iid;
+    }
+  };
+
+  TraceArchive(const TraceArchive &);
+  TraceArchive & operator=(const TraceArchive &);
+
+  static std::string getArchiveName(const std::string & bank);
+
+  std::vector<Trace> m_traces;    // index, sorted by IID
+
+  // writing
+  std::string m_name;
+  std::ofstream m_out;
+  uint64_t m_written;             // bytes written
+
+  // reading
+  const char * m_base;
+  size_t m_length;
+};
+
+
+#endif
@@ -0,0 +1,268 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Precomputes the coverage tracks of hawkeye's insert view
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "foundation_AMOS.hh"
+#include "DataStore.hh"
+#include "Insert.hh"
+#include "CoverageStats.hh"
+#include "CoveragePyramid.hh"
+#include <unistd.h>
+
+using namespace std;
+using namespace AMOS;
+
+
+//=============================================================== Globals ====//
+string OPT_BankName;              // bank name parameter
+bool   OPT_Scaffolds = true;      // build the scaffold pyramid
+bool   OPT_Contigs = true;        // build the contig pyramid
+int    OPT_BinShift = 6;          // level 0 bins hold 2^OPT_BinShift bases
+
+
+//========================================================== Fuction Decs ====//
+void ParseArgs (int argc, char ** argv);
+void PrintHelp (const char * s);
+void PrintUsage (const char * s);
+
+
+//-- Read tiling of a scaffold in the coordinates of hawkeye's insert view,
+//   where every contig takes its gapped length
+void mapScaffold(DataStore & datastore, Scaffold_t & scaff, vector<Tile_t> & tiling)
+{
+  vector<Tile_t> ctiling = scaff.getContigTiling();
+  sort(ctiling.begin(), ctiling.end(), TileOrderCmp());
+
+  int lendiff = 0;
+  Contig_t contig;
+
+  vector<Tile_t>::iterator ci;
+  for (ci = ctiling.begin(); ci != ctiling.end(); ci++)
+  {
+    datastore.fetchContigIID(ci->source, contig);
+
+    ci->offset += lendiff;
+
+    int clen = contig.getLength();
+    Range_t scaffrange = ci->range;
+
+    if (scaffrange.isReverse())
+    {
+      scaffrange.begin = scaffrange.end+clen;
+      lendiff += scaffrange.begin - ci->range.begin;
+      contig.reverseComplement();
+    }
+    else
+    {
+      scaffrange.end = scaffrange.begin+clen;
+      lendiff += scaffrange.end - ci->range.end;
+    }
+
+    vector<Tile_t> & rtiling = contig.getReadTiling();
+    vector<Tile_t>::const_iterator ri;
+    for (ri = rtiling.begin(); ri != rtiling.end(); ri++)
+    {
+      Tile_t mappedTile;
+      mappedTile.source = ri->source;
+      mappedTile.gaps   = ri->gaps;
+      mappedTile.range  = ri->range;
+      mappedTile.offset = ci->offset + ri->offset;
+
+      tiling.push_back(mappedTile);
+    }
+  }
+}
+
+
+//-- Adds the tracks InsertWidget::computeCoverage plots for a tiling
+int addTracks(DataStore & datastore, CoveragePyramid & pyramid,
+              ID_t iid, vector<Tile_t> & tiling)
+{
+  sort(tiling.begin(), tiling.end(), TileOrderCmp());
+
+  vector<Insert *> inserts;
+  datastore.calculateInserts(tiling, inserts, 1, 0);
+
+  int leftmost = inserts.empty() ? 0 : min(0, inserts.front()->m_loffset);
+  int rightmost = 0;
+
+  CoverageStats happy((2+inserts.size())*4, 0, Distribution_t());
+  happy.addEndpoints(leftmost, leftmost);
+
+  vector<Insert *>::iterator ii;
+  for (ii = inserts.begin(); ii != inserts.end(); ii++)
+  {
+    if ((*ii)->m_roffset > rightmost) { rightmost = (*ii)->m_roffset; }
+
+    if ((*ii)->m_state == Insert::Happy)
+    {
+      happy.addEndpoints((*ii)->m_loffset, (*ii)->m_roffset);
+    }
+  }
+
+  happy.addEndpoints(rightmost, rightmost);
+  happy.finalize();
+
+  map<ID_t, CoverageStats> ce = datastore.computeCEStats(inserts);
+
+  CoverageStats reads(tiling.size()*4, 0, Distribution_t());
+  vector<Tile_t>::const_iterator ti;
+  for (ti = tiling.begin(); ti != tiling.end(); ti++)
+  {
+    reads.addEndpoints(ti->offset, ti->offset + ti->getGappedLength() - 1);
+  }
+  reads.finalize();
+
+  pyramid.addTrack(iid, CoveragePyramid::READ_TRACK,
+                   reads.m_coverage, NULL, reads.m_curpos);
+  pyramid.addTrack(iid, CoveragePyramid::INSERT_TRACK,
+                   happy.m_coverage, NULL, happy.m_curpos);
+
+  map<ID_t, CoverageStats>::const_iterator li;
+  for (li = ce.begin(); li != ce.end(); li++)
+  {
+    pyramid.addTrack(iid, li->first, li->second.m_coverage,
+                     &li->second.m_cestat, li->second.m_curpos);
+  }
+
+  for (ii = inserts.begin(); ii != inserts.end(); ii++) { delete *ii; }
+
+  return 2 + ce.size();
+}
+
+
+//========================================================= Function Defs ====//
+int main (int argc, char ** argv)
+{
+  int exitcode = EXIT_SUCCESS;
+
+  ParseArgs (argc, argv);
+
+  try
+  {
+    DataStore datastore;
+    if (datastore.openBank(OPT_BankName))
+      AMOS_THROW_IO("Could not open bank " + OPT_BankName);
+
+    if (OPT_Scaffolds && datastore.scaffold_bank.isOpen())
+    {
+      CoveragePyramid pyramid;
+      pyramid.create(OPT_BankName, Scaffold_t::NCODE, Insert::MAXSTDEV, OPT_BinShift);
+
+      Scaffold_t scaff;
+      int count = 0;
+
+      datastore.scaffold_bank.seekg(1);
+      while (datastore.scaffold_bank >> scaff)
+      {
+        vector<Tile_t> tiling;
+        mapScaffold(datastore, scaff, tiling);
+        addTracks(datastore, pyramid, scaff.getIID(), tiling);
+        count++;
+      }
+
+      int tracks = pyramid.commit();
+      cerr << "Wrote " << tracks << " tracks of " << count << " scaffolds" << endl;
+    }
+
+    if (OPT_Contigs)
+    {
+      CoveragePyramid pyramid;
+      pyramid.create(OPT_BankName, Contig_t::NCODE, Insert::MAXSTDEV, OPT_BinShift);
+
+      Contig_t contig;
+      int count = 0;
+
+      datastore.contig_bank.seekg(1);
+      while (datastore.contig_bank >> contig)
+      {
+        addTracks(datastore, pyramid, contig.getIID(), contig.getReadTiling());
+        count++;
+      }
+
+      int tracks = pyramid.commit();
+      cerr << "Wrote " << tracks << " tracks of " << count << " contigs" << endl;
+    }
+  }
+  catch (const Exception_t & e)
+  {
+    cerr << "FATAL: " << e . what( ) << endl
+         << "  there has been a fatal error, abort" << endl;
+    exitcode = EXIT_FAILURE;
+  }
+
+  return exitcode;
+}
+
+
+//------------------------------------------------------------- ParseArgs ----//
+void ParseArgs (int argc, char ** argv)
+{
+  int ch, errflg = 0;
+  optarg = NULL;
+
+  while ( !errflg && ((ch = getopt (argc, argv, "b:cd:hs")) != EOF) )
+    switch (ch)
+      {
+      case 'b': OPT_BinShift = atoi (optarg); break;
+      case 'c': OPT_Scaffolds = false; break;
+      case 'd': Insert::MAXSTDEV = atof (optarg); break;
+      case 's': OPT_Contigs = false; break;
+      case 'h':
+        PrintHelp (argv[0]);
+        exit (EXIT_SUCCESS);
+        break;
+      default:
+        errflg ++;
+      }
+
+  if ( OPT_BinShift < 0 || OPT_BinShift > 24 )
+    {
+      cerr << "ERROR: -b must be between 0 and 24\n";
+      errflg ++;
+    }
+
+  if ( errflg > 0 || optind != argc - 1 || (!OPT_Scaffolds && !OPT_Contigs) )
+    {
+      PrintUsage (argv[0]);
+      cerr << "Try '" << argv[0] << " -h' for more information.\n";
+      exit (EXIT_FAILURE);
+    }
+
+  OPT_BankName = argv [optind ++];
+}
+
+
+//------------------------------------------------------------- PrintHelp ----//
+void PrintHelp (const char * s)
+{
+  PrintUsage (s);
+  cerr
+    << "-b n          Level 0 bins hold 2^n bases, default 6\n"
+    << "-c            Only build the contig pyramid\n"
+    << "-d sd         Inserts are happy within sd standard deviations of their\n"
+    << "              library's mean, default 2 as in hawkeye\n"
+    << "-s            Only build the scaffold pyramid\n"
+    << "-h            Display help information\n\n";
+
+  cerr
+    << "Computes the read coverage, happy insert coverage and C/E statistic\n"
+    << "of every scaffold and contig the way hawkeye's insert view does, and\n"
+    << "stores them in the bank as SCF.cvp and CTG.cvp, pyramids of bins of\n"
+    << "increasing size. hawkeye draws the coverage of a large scaffold from\n"
+    << "the level matching its zoom instead of recomputing it. Rerun after\n"
+    << "the bank changes, hawkeye ignores an out of date pyramid. hawkeye also\n"
+    << "ignores a pyramid built with another -d than its happy distance.\n\n";
+}
+
+
+//------------------------------------------------------------ PrintUsage ----//
+void PrintUsage (const char * s)
+{
+  cerr
+    << "\nUSAGE: " << s << "  [options]  <bank path>\n\n";
+}
@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////////////
+//! \file
+//! \date 10/19/2026
+//!
+//! \brief Packs the chromatograms of the reads of a bank into one archive
+//!
+////////////////////////////////////////////////////////////////////////////////
+
+#include "foundation_AMOS.hh"
+#include "TraceArchive.hh"
+#include <cstdio>
+#include <unistd.h>
+
+extern "C"
+{
+  #include "Read.h"
+}
+
+using namespace std;
+using namespace AMOS;
+
+
+//=============================================================== Globals ====//
+string OPT_BankName;              // bank name parameter
+vector<string> OPT_TracePaths;    // trace directories, with hawkeye's tokens
+string OPT_TraceDB;               // value of %TRACEDB%
+bool   OPT_Verbose = false;       // report the reads without a trace
+
+
+//========================================================== Fuction Decs ====//
+void ParseArgs (int argc, char ** argv);
+void PrintHelp (const char * s);
+void PrintUsage (const char * s);
+
+
+//-- Replaces %TOKEN% by value, and %TOKENn% by its first n characters, the
+//   way hawkeye's ChromoStore expands its trace paths
+static void replaceAll(string & str, const string & token, const string & value)
+{
+  string::size_type startpos;
+  string::size_type endpos;
+
+  string searchtoken = "%" + token;
+
+  while ((startpos = str.find(searchtoken)) != string::npos)
+  {
+    string replaceval;
+    endpos = startpos + searchtoken.length();
+
+    if (endpos < str.length() && str[endpos] == '%')
+    {
+      replaceval = value;
+    }
+    else
+    {
+      size_t len = atoi(str.c_str() + endpos);
+      replaceval = value.substr(0, len);
+
+      while (endpos < str.length() && str[endpos] != '%') { endpos++; }
+    }
+
+    str.replace(startpos, endpos - startpos + 1, replaceval);
+  }
+}
+
+
+//-- Reads the trace of a read from the first trace directory that has it,
+//   or through the Staden search path (RAWDATA) if no directory is given
+Read * findTrace(const string & eid, ID_t iid)
+{
+  if (OPT_TracePaths.empty())
+  {
+    return read_reading((char *) eid.c_str(), TT_ANY);
+  }
+
+  char iidarr[16];
+  sprintf(iidarr, "%d", (int) iid);
+
+  Read * trace = NULL;
+  vector<string>::const_iterator pi;
+  for (pi = OPT_TracePaths.begin(); pi != OPT_TracePaths.end() && !trace; pi++)
+  {
+    string path(*pi);
+    replaceAll(path, "TRACEDB", OPT_TraceDB);
+    replaceAll(path, "EID", eid);
+    replaceAll(path, "IID", iidarr);
+    path += "/" + eid;
+
+    if (access(path.c_str(), R_OK) == 0)
+    {
+      trace = read_reading((char *) path.c_str(), TT_ANY);
+    }
+  }
+
+  return trace;
+}
+
+
+//========================================================= Function Defs ====//
+int main (int argc, char ** argv)
+{
+  int exitcode = EXIT_SUCCESS;
+  FILE * ztr = NULL;
+
+  ParseArgs (argc, argv);
+
+  try
+  {
+    BankStream_t red_bank(Read_t::NCODE);
+    red_bank.open(OPT_BankName, B_READ);
+
+    //-- Every trace is converted to ZTR in a scratch file, then copied
+    ztr = tmpfile();
+    if (ztr == NULL)
+      AMOS_THROW_IO("Could not open a temporary file");
+
+    TraceArchive archive;
+    archive.create(OPT_BankName);
+
+    Read_t red;
+    vector<char> buffer;
+    int count = 0, missing = 0;
+    uint64_t bytes = 0;
+
+    while (red_bank >> red)
+    {
+      Read * trace = findTrace(red.getEID(), red.getIID());
+      if (trace == NULL)
+      {
+        if (OPT_Verbose)
+          cerr << "No trace for read " << red.getEID() << endl;
+        missing++;
+        continue;
+      }
+
+      rewind(ztr);
+      int retval = fwrite_reading(ztr, trace, TT_ZTR);
+      long size = ftell(ztr);
+      read_deallocate(trace);
+
+      if (retval != 0 || size <= 0)
+        AMOS_THROW_IO("Could not convert the trace of read " + red.getEID());
+
+      buffer.resize(size);
+      rewind(ztr);
+      if (fread(&buffer[0], 1, size, ztr) != (size_t) size)
+        AMOS_THROW_IO("Could not convert the trace of read " + red.getEID());
+
+      archive.add(red.getIID(), red.getEID(), &buffer[0], size);
+      bytes += size;
+      count++;
+    }
+
+    red_bank.close();
+    archive.commit();
+
+    cerr << "Packed " << count << " traces, " << bytes << " bytes";
+    if (missing) { cerr << ", " << missing << " reads without a trace"; }
+    cerr << endl;
+  }
+  catch (const Exception_t & e)
+  {
+    cerr << "FATAL: " << e . what( ) << endl
+         << "  there has been a fatal error, abort" << endl;
+    exitcode = EXIT_FAILURE;
+  }
+
+  if (ztr) { fclose(ztr); }
+
+  return exitcode;
+}
+
+
+//------------------------------------------------------------- ParseArgs ----//
+void ParseArgs (int argc, char ** argv)
+{
+  int ch, errflg = 0;
+  optarg = NULL;
+
+  while ( !errflg && ((ch = getopt (argc, argv, "d:hp:v")) != EOF) )
+    switch (ch)
+      {
+      case 'd': OPT_TraceDB = optarg; break;
+      case 'p': OPT_TracePaths.push_back(optarg); break;
+      case 'v': OPT_Verbose = true; break;
+      case 'h':
+        PrintHelp (argv[0]);
+        exit (EXIT_SUCCESS);
+        break;
+      default:
+        errflg ++;
+      }
+
+  if ( errflg > 0 || optind != argc - 1 )
+    {
+      PrintUsage (argv[0]);
+      cerr << "Try '" << argv[0] << " -h' for more information.\n";
+      exit (EXIT_FAILURE);
+    }
+
+  OPT_BankName = argv [optind ++];
+}
+
+
+//------------------------------------------------------------- PrintHelp ----//
+void PrintHelp (const char * s)
+{
+  PrintUsage (s);
+  cerr
+    << "-p path       Trace directory, may be repeated, searched in order\n"
+    << "-d db         Value of %TRACEDB% in the trace directories\n"
+    << "-v            Report the reads without a trace\n"
+    << "-h            Display help information\n\n";
+
+  cerr
+    << "Finds the chromatogram of every read of the bank, named by the read\n"
+    << "EID, and packs them ZTR compressed into the bank as RED.trc, indexed\n"
+    << "by read IID. hawkeye reads the traces of a bank from its archive\n"
+    << "instead of searching the trace directories. The directories take\n"
+    << "the tokens of hawkeye's chromatogram paths, %EID%, %IID%, %TRACEDB%\n"
+    << "and %EIDn% for the first n characters of the EID. Without -p the\n"
+    << "traces are searched along the Staden RAWDATA path.\n\n";
+}
+
+
+//------------------------------------------------------------ PrintUsage ----//
+void PrintUsage (const char * s)
+{
+  cerr
+    << "\nUSAGE: " << s << "  [options]  <bank path>\n\n";
+}
@@ -83,6 +83,7 @@ struct config {
   uint32_t      surroageAsFragment;
   uint32_t      layoutOnly;
   uint8_t       debugLevel;
+  uint32_t      threads;
 };
 config globals;
 
@@ -174,6 +175,7 @@ void PrintHelp()
          << "  -I - lib Identifier\n"
          << "  -N - min insert length\n"
          << "  -X - max insert length\n"
+         << "  -j <threads> - number of threads used to convert fastq reads (default 1)\n"
          << "  -t - fastq quality type. The currently supported types are";
          for (uint32_t i = 0; i < FASTQ_QUALITY_COUNT; i++) {
             cerr << " " << FASTQ_QUALITY_NAMES[i];
@@ -203,6 +205,7 @@ bool GetOptions (int argc, char ** argv)
   globals.surrogateAsFragment = 0;
   globals.debugLevel = 0;
   globals.libname = "lib1";
+  globals.threads = 1;
   while (1)
     {
       int ch, option_index = 0;
@@ -228,10 +231,11 @@ bool GetOptions (int argc, char ** argv)
         {"layoutsOnly",no_argument,              0, 'L'},
         {"fasqQuality", required_argument,       0, 't'},
         {"debugLevel", required_argument,        0, 'd'},
+        {"threads",   required_argument,         0, 'j'},
         {0,           0,                         0, 0}
       };
       
-      ch = getopt_long(argc, argv, "hlb:m:c:f:x:a:t:iI:N:X:k:q:s:Q:M:G:B:p:SCUFLt:", long_options, &option_index);
+      ch = getopt_long(argc, argv, "hlb:m:c:f:x:a:t:iI:N:X:k:q:s:Q:M:G:B:p:SCUFLt:j:", long_options, &option_index);
       if (ch == -1)
         break;
 
@@ -330,6 +334,17 @@ bool GetOptions (int argc, char ** argv)
        case 'd':
           globals.debugLevel = atoi(optarg);
           break;
+       case 'j':
+          globals.threads = atoi(optarg);
+          if (globals.threads < 1) {
+             globals.threads = 1;
+          }
+#ifndef AMOS_HAVE_OPENMP
+          if (globals.threads > 1) {
+             cerr << "Warning: built without OpenMP support, converting with 1 thread" << endl;
+          }
+#endif
+          break;
        case 'h':
           PrintHelp();
           return (EXIT_SUCCESS);
@@ -621,10 +636,10 @@ bool parseFastaFile() {
   int temp2 = 0;
   int id = 0;
 
-  FILE* fastafile = fileOpen(globals.fastafile.c_str(), "r");
-  FILE* qualFile = NULL;
+  SeqReader_t fastafile(globals.fastafile);
+  SeqReader_t qualFile;
   if (globals.qualfile.size() > 0)
-    qualFile = fileOpen(globals.qualfile.c_str(), "r");
+    qualFile.open(globals.qualfile);
 
   while (Fasta_Read(fastafile,tempSeqBuff,tempSeqHeader) != 0) {
     if (counter % PRINT_INTERVAL == 0 && globals.debugLevel > 0) {
@@ -694,33 +709,137 @@ bool parseFastaFile() {
     cll = clr = -1;
   }
 
-  fileClose(fastafile);
-  if (qualFile != NULL) {
-     fileClose(qualFile);
+  fastafile.close();
+  qualFile.close();
+}
+
+//----------------------------------------------------- FastqItem_t ----------//
+//! \brief One fastq record on its way from the reader to the read bank
+//!
+//! Records are read in batches by a single thread, converted and serialized
+//! by the workers, then appended in input order so that the bank comes out
+//! exactly as a serial conversion would have left it.
+//!
+//----------------------------------------------------------------------- ----//
+struct FastqItem_t
+{
+  string header;      // raw header line
+  string seq;         // sequence
+  string qual;        // raw, unconverted quality string
+  string seqname;     // read name taken from the header
+  int cll, clr;       // clear range from the header, or the whole read
+  bool ok;            // sequence and quality have the same length
+  ID_t iid;           // IID assigned to the read
+  BankRecord_t read;  // the serialized Read_t
+};
+
+//----------------------------------------------------- FastqPair_t ----------//
+//! \brief The template of an interleaved fastq pair
+//!
+//----------------------------------------------------------------------- ----//
+struct FastqPair_t
+{
+  Size_t prefix;      // length of the name prefix shared by both reads
+  ID_t iid;           // IID assigned to the fragment, NULL_ID if skipped
+  BankRecord_t frag;  // the serialized Fragment_t
+};
+
+const int FASTQ_BATCH_SIZE = 65536; // records per batch, must be even
+
+
+//----------------------------------------------------- readFastqBatch -------//
+//! \brief Reads up to a batch of raw records into items
+//!
+//! \return The number of records read, 0 at end of input
+//!
+//----------------------------------------------------------------------- ----//
+int readFastqBatch(SeqReader_t & in, vector<FastqItem_t> & items)
+{
+  SeqRecord_t rec;
+  int n = 0;
+
+  while (n < (int)items.size() && in.next(rec)) {
+    items[n].header.assign(rec.name, rec.name_len);
+    items[n].seq.assign(rec.seq, rec.seq_len);
+    items[n].qual.assign(rec.qual, rec.qual_len);
+    n++;
   }
+  return n;
 }
 
-bool parseFastqFileInterleaved(int min,int max, string libname="lib1") {
-  int counter = 0;
-  string tempSeqHeader;
-  string tempSeqBuff;
-  string tempQualHeader;
-  string tempQualBuff;
-  string seqname;
-  string tempSeqHeader2;
-  string tempSeqBuff2;
-  string tempQualHeader2;
-  string tempQualBuff2;
-  string seqname2;
-  int cll2 = -1;
-  int clr2 = -1;
-  int cll = -1;
-  int clr = -1;
+//----------------------------------------------------- parseFastqItem -------//
+//! \brief Takes the read name and clear range out of the header
+//!
+//! A header may give the clear range as "name cll clr" or as
+//! "name x y . cll clr", otherwise the whole read is clear.
+//!
+//----------------------------------------------------------------------- ----//
+void parseFastqItem(FastqItem_t & item)
+{
   int temp1 = 0;
   int temp2 = 0;
-  int temp11 = 0;
-  int temp22 = 0;
-  int id = 0;
+
+  item.seqname.erase();
+  item.cll = item.clr = -1;
+  item.ok = (item.seq.length() == item.qual.length());
+
+  stringstream seqheaderstream (stringstream::in);
+  seqheaderstream.str(item.header.c_str());
+  seqheaderstream >> item.seqname;
+  if (!seqheaderstream.eof()) {
+    seqheaderstream >> temp1;
+    seqheaderstream >> temp2;
+    if (!seqheaderstream.eof()) {
+      seqheaderstream.ignore(5, ' ');
+      seqheaderstream >> item.cll;
+      seqheaderstream >> item.clr;
+    } else {
+      item.cll = temp1;
+      item.clr = temp2;
+    }
+  } else {
+    item.cll = 0;
+    item.clr = item.seq.length();
+  }
+
+  // So we don't overwrite an externally provided clear range
+  if (item.cll == -1) {
+    item.cll = 0;
+    item.clr = item.seq.length();
+  }
+}
+
+//----------------------------------------------------- serializeFastqItem ---//
+//! \brief Converts the qualities and serializes the item as a Read_t
+//!
+//----------------------------------------------------------------------- ----//
+void serializeFastqItem(FastqItem_t & item, ID_t frag)
+{
+  Read_t read;
+  string qual;
+
+  Fastq_Convert_Qual(item.qual.data(), item.qual.length(), qual, globals.fastqQualityType);
+
+  read.setIID(item.iid);
+  read.setEID(item.seqname);
+  read.setClearRange(Range_t(item.cll, item.clr));
+  read.setSequence(item.seq.c_str(), qual.c_str());
+  read.setFragment(frag);
+  item.read.serialize(read);
+}
+
+//----------------------------------------------------- reportSeqQualMismatch //
+void reportSeqQualMismatch(const FastqItem_t & item)
+{
+  cerr << "Sequence and quality records must have same length for " << item.seqname << ": "
+       << item.seq.length() << " vs " << item.qual.length() << endl;
+}
+
+bool parseFastqFileInterleaved(int min,int max, string libname="lib1") {
+  int counter = 0;
+  vector<FastqItem_t> items(FASTQ_BATCH_SIZE);
+  vector<FastqPair_t> pairs(FASTQ_BATCH_SIZE / 2);
+  int n, npairs, i;
 
   Pos_t mean = (min + max) / 2;
   SD_t stdev = (max - min) / 6;
@@ -735,214 +854,153 @@ bool parseFastqFileInterleaved(int min,int max, string libname="lib1") {
   lib.setEID(libname);
   lib_stream.append(lib);
 
-  FILE* fastqfile = fileOpen(globals.fastqfile.c_str(), "r");
+  SeqReader_t fastqfile(globals.fastqfile);
 
-  while (Fastq_Read(fastqfile,tempSeqBuff,tempSeqHeader,tempQualBuff,tempQualHeader, globals.fastqQualityType) != 0
-	 && Fastq_Read(fastqfile,tempSeqBuff2,tempSeqHeader2,tempQualBuff2,tempQualHeader2,globals.fastqQualityType) != 0) {
-    if (counter % PRINT_INTERVAL == 0 && globals.debugLevel > 0) {
-       cerr << "Read " << counter << " reads " << endl;
-    }
-    counter+=2;
-    
-    stringstream seqheaderstream (stringstream::in);
-    seqheaderstream.str(tempSeqHeader.c_str());
-    seqheaderstream >> seqname;
-    if (!seqheaderstream.eof()) {
-      seqheaderstream >> temp1;
-      seqheaderstream >> temp2;
-      if (!seqheaderstream.eof()) {
-        seqheaderstream.ignore(5, ' ');
-        seqheaderstream >> cll;
-        seqheaderstream >> clr;
-      } else {
-        cll = temp1;
-        clr = temp2;
-      }
-    } else {
-      cll = 0;
-      clr = tempSeqBuff.length();
-      //cerr << "Format not recognized" << endl;
-    } 
- 
-    // So we don't overwrite an externally provided clear range
-    if (cll == -1) {
-      cll = 0;
-      clr = tempSeqBuff.length();
-    }
+  while ((n = readFastqBatch(fastqfile, items)) > 0) {
+    // a trailing unpaired record is dropped
+    npairs = n / 2;
 
-    stringstream seqheaderstream2 (stringstream::in);
-    seqheaderstream2.str(tempSeqHeader2.c_str());
-    seqheaderstream2 >> seqname2;
-    if (!seqheaderstream2.eof()) {
-      seqheaderstream2 >> temp11;
-      seqheaderstream2 >> temp22;
-      if (!seqheaderstream2.eof()) {
-        seqheaderstream2.ignore(5, ' ');
-        seqheaderstream2 >> cll2;
-        seqheaderstream2 >> clr2;
-      } else {
-        cll2 = temp11;
-        clr2 = temp22;
+    //-- Parse the headers and find each template name
+#ifdef AMOS_HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(globals.threads)
+#endif
+    for (i = 0; i < npairs; i++) {
+      FastqItem_t & item1 = items[2*i];
+      FastqItem_t & item2 = items[2*i+1];
+      parseFastqItem(item1);
+      parseFastqItem(item2);
+
+      const string & frg1 = item1.seqname;
+      const string & frg2 = item2.seqname;
+      Size_t offset = 0; 
+      for (offset = 0; offset < frg1.length(); ++offset) {
+         if (frg2.length() <= offset) {
+            break;
+         }
+         if (frg1[offset] != frg2[offset]) {
+            break;
+         }
       }
-    } else {
-      cll2 = 0;
-      clr2 = tempSeqBuff2.length();
-      //cerr << "Format not recognized" << endl;
-    } 
- 
-    // So we don't overwrite an externally provided clear range
-    if (cll2 == -1) {
-      cll2 = 0;
-      clr2 = tempSeqBuff2.length();
+      pairs[i].prefix = offset;
     }
-    Read_t read1;
-    read1.setIID(minSeqID++);
-    read1.setEID(seqname);
 
-    if (tempQualBuff.length() != tempSeqBuff.length()) {
-        cerr << "Sequence and quality records must have same length for " << seqname << ": "
-             << tempSeqBuff.length() << " vs " << tempQualBuff.length() << endl;
-        return 1; 
+    //-- Hand out IIDs in input order, stopping at the first bad record
+    int nerror = npairs;
+    for (i = 0; i < npairs; i++) {
+      items[2*i].iid = minSeqID++;
+      if (!items[2*i].ok) {
+        nerror = i;
+        break;
+      }
+      items[2*i+1].iid = minSeqID++;
+      if (!items[2*i+1].ok) {
+        nerror = i;
+        break;
+      }
+      pairs[i].iid = (pairs[i].prefix == 0 ? NULL_ID : minSeqID++);
     }
 
-    read1.setClearRange(Range_t(cll, clr));
-    read1.setSequence(tempSeqBuff.c_str(), tempQualBuff.c_str());
-
-
-    Read_t read2;
-    read2.setIID(minSeqID++);
-    read2.setEID(seqname2);
-
-    if (tempQualBuff2.length() != tempSeqBuff2.length()) {
-        cerr << "Sequence and quality records must have same length for " << seqname2 << ": "
-             << tempSeqBuff2.length() << " vs " << tempQualBuff2.length() << endl;
-        return 1; 
+    //-- Build and serialize the reads and fragments
+#ifdef AMOS_HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(globals.threads)
+#endif
+    for (i = 0; i < nerror; i++) {
+      if (pairs[i].iid == NULL_ID) {
+        continue;
+      }
+      stringstream templateID(stringstream::in | stringstream::out);
+      templateID << items[2*i].seqname.substr(0, pairs[i].prefix);
+      templateID << "_" << (counter + 2*(i+1));
+
+      Fragment_t frag;
+      frag.setLibrary(lib.getIID()); 
+      frag.setIID(pairs[i].iid);
+      frag.setEID(templateID.str());
+      frag.setReads(std::pair<ID_t, ID_t>(items[2*i].iid, items[2*i+1].iid));
+      frag.setType(Fragment_t::INSERT);
+      pairs[i].frag.serialize(frag);
+
+      serializeFastqItem(items[2*i], pairs[i].iid);
+      serializeFastqItem(items[2*i+1], pairs[i].iid);
     }
 
-    read2.setClearRange(Range_t(cll2, clr2));
-    read2.setSequence(tempSeqBuff2.c_str(), tempQualBuff2.c_str());
-
-
-    // now that we've handled everything else, this must be a simple pair of reads
-    string frg1 = seqname;
-    string frg2 = seqname2;
-
-    stringstream templateID(stringstream::in | stringstream::out);
+    //-- Append in input order
+    for (i = 0; i < npairs; i++) {
+      if (counter % PRINT_INTERVAL == 0 && globals.debugLevel > 0) {
+         cerr << "Read " << counter << " reads " << endl;
+      }
+      counter+=2;
 
-    Size_t offset = 0; 
-    for (offset = 0; offset < frg1.length(); ++offset) {
-       if (frg2.length() < offset) {
-          break;
-       }
-       if (frg1[offset] != frg2[offset]) {
-          break;
-       }
-    }
-    if (offset == 0) {
-       cerr << "Error fragments " << frg1 << " AND " << frg2 << " do not have any common template substring" << endl;
-       continue;
+      if (i == nerror) {
+        reportSeqQualMismatch(items[2*i].ok ? items[2*i+1] : items[2*i]);
+        return false;
+      }
+      if (pairs[i].iid == NULL_ID) {
+         cerr << "Error fragments " << items[2*i].seqname << " AND " << items[2*i+1].seqname
+              << " do not have any common template substring" << endl;
+         continue;
+      }
+      frag_stream.append(pairs[i].frag);
+      read_stream.append(items[2*i].read);
+      read_stream.append(items[2*i+1].read);
     }
-    templateID << frg1.substr(0, offset);
-    templateID << "_" << counter;
-
-    Fragment_t frag;
-    frag.setLibrary(lib.getIID()); 
-    //frag.setLibrary(1); 
-    frag.setIID(minSeqID++);
-    frag.setEID(templateID.str());
-    frag.setReads(std::pair<ID_t, ID_t>(read1.getIID(), read2.getIID()));
-    frag.setType(Fragment_t::INSERT);
-    frag_stream.append(frag);
-
-    // also update the reads
-    Read_t read;
-    //read_stream.fetch(read1, read);
-    read1.setFragment(frag.getIID());
-    //read_stream.replace(read.getIID(), read);
-    read_stream.append(read1);    
-
-    //read_stream.fetch(read2, read);
-    read2.setFragment(frag.getIID());
-    //read_stream.replace(read.getIID(), read);
-    read_stream.append(read2);    
-    //counter++;
-
-
-    // reset the clear ranges
-    cll = clr = -1;
-    cll2 = clr2 = -1;
   }
   cerr << "Finished reading " << counter << " reads " << endl;
 
-  fileClose(fastqfile);
+  fastqfile.close();
+  return true;
 }
 
 bool parseFastqFile() {
   int counter = 0;
-  string tempSeqHeader;
-  string tempSeqBuff;
-  string tempQualHeader;
-  string tempQualBuff;
-  string seqname;
-  int cll = -1;
-  int clr = -1;
-  int temp1 = 0;
-  int temp2 = 0;
-  int id = 0;
+  vector<FastqItem_t> items(FASTQ_BATCH_SIZE);
+  int n, i;
 
-  FILE* fastqfile = fileOpen(globals.fastqfile.c_str(), "r");
+  SeqReader_t fastqfile(globals.fastqfile);
 
-  while (Fastq_Read(fastqfile,tempSeqBuff,tempSeqHeader,tempQualBuff,tempQualHeader, globals.fastqQualityType) != 0) {
-    if (counter % PRINT_INTERVAL == 0 && globals.debugLevel > 0) {
-       cerr << "Read " << counter << " reads " << endl;
+  while ((n = readFastqBatch(fastqfile, items)) > 0) {
+    //-- IIDs follow input order, up to and including the first bad record
+    int nerror = n;
+    for (i = 0; i < n; i++) {
+      items[i].iid = minSeqID + i;
     }
-    counter++;
-    
-    stringstream seqheaderstream (stringstream::in);
-    seqheaderstream.str(tempSeqHeader.c_str());
-    seqheaderstream >> seqname;
-    if (!seqheaderstream.eof()) {
-      seqheaderstream >> temp1;
-      seqheaderstream >> temp2;
-      if (!seqheaderstream.eof()) {
-        seqheaderstream.ignore(5, ' ');
-        seqheaderstream >> cll;
-        seqheaderstream >> clr;
-      } else {
-        cll = temp1;
-        clr = temp2;
+
+    //-- Parse, convert and serialize the reads
+#ifdef AMOS_HAVE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(globals.threads)
+#endif
+    for (i = 0; i < n; i++) {
+      parseFastqItem(items[i]);
+      if (items[i].ok) {
+        serializeFastqItem(items[i], NULL_ID);
       }
-    } else {
-      cll = 0;
-      clr = tempSeqBuff.length();
-      //cerr << "Format not recognized" << endl;
-    } 
- 
-    // So we don't overwrite an externally provided clear range
-    if (cll == -1) {
-      cll = 0;
-      clr = tempSeqBuff.length();
     }
-    Read_t read;
-    read.setIID(minSeqID++);
-    read.setEID(seqname);
 
-    if (tempQualBuff.length() != tempSeqBuff.length()) {
-        cerr << "Sequence and quality records must have same length for " << seqname << ": "
-             << tempSeqBuff.length() << " vs " << tempQualBuff.length() << endl;
-        return 1; 
-    }
+    //-- Append in input order
+    for (i = 0; i < n; i++) {
+      if (counter % PRINT_INTERVAL == 0 && globals.debugLevel > 0) {
+         cerr << "Read " << counter << " reads " << endl;
+      }
+      counter++;
 
-    read.setClearRange(Range_t(cll, clr));
-    read.setSequence(tempSeqBuff.c_str(), tempQualBuff.c_str());
-    read_stream.append(read);
+      if (!items[i].ok) {
+        nerror = i;
+        break;
+      }
+      read_stream.append(items[i].read);
+    }
 
-    // reset the clear ranges
-    cll = clr = -1;
+    if (nerror < n) {
+      minSeqID += nerror + 1;
+      reportSeqQualMismatch(items[nerror]);
+      return false;
+    }
+    minSeqID += n;
   }
   cerr << "Finished reading " << counter << " reads " << endl;
 
-  fileClose(fastqfile);
+  fastqfile.close();
+  return true;
 }
 
 
@@ -0,0 +1,611 @@
+// Partial order graph of a set of reads, see POGraph.hh
+
+#include "POGraph.hh"
+#include <algorithm>
+#include <climits>
+#include <cctype>
+#include <deque>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace AMOS;
+
+
+const int POGraph::MATCH;
+const int POGraph::MISMATCH;
+const int POGraph::INDEL;
+
+// Score of the cells outside of the band, low enough to never win and to
+// never overflow when a few scores are added to it
+static const int NEG = INT_MIN / 4;
+
+// Half width of the band of the nodes before the start of a read, when the
+// alignment is not banded
+static const int START_SLACK = 10;
+
+// Default band, max(MIN_BAND, read length / BAND_DIV)
+static const int MIN_BAND = 100;
+static const int BAND_DIV = 10;
+
+static const char CONSBASE[] = "ACGT-N";
+
+
+static int baseIndex(char c)
+{
+  switch (toupper(c))
+  {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    case '-': return 4;
+  }
+
+  return 5;
+}
+
+
+// Relaxes n cells of the band with the scores p[k] + add[k], the first of
+// equal scores is kept. This is the inner loop of the alignment, 4 cells at
+// a time where SSE2 is available.
+static void relax(int * x, int * xfrom, int * xdir,
+                  const int * p, const int * add, int n, int from, int dir)
+{
+  int k = 0;
+
+#ifdef __SSE2__
+  __m128i vfrom = _mm_set1_epi32(from);
+  __m128i vdir = _mm_set1_epi32(dir);
+
+  for (; k + 4 <= n; k += 4)
+  {
+    __m128i c = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(p + k)),
+                              _mm_loadu_si128((const __m128i *)(add + k)));
+    __m128i v = _mm_loadu_si128((const __m128i *)(x + k));
+    __m128i gt = _mm_cmpgt_epi32(c, v);
+
+    if (_mm_movemask_epi8(gt) == 0) { continue; }
+
+    __m128i f = _mm_loadu_si128((const __m128i *)(xfrom + k));
+    __m128i d = _mm_loadu_si128((const __m128i *)(xdir + k));
+
+    _mm_storeu_si128((__m128i *)(x + k),
+                     _mm_or_si128(_mm_and_si128(gt, c), _mm_andnot_si128(gt, v)));
+    _mm_storeu_si128((__m128i *)(xfrom + k),
+                     _mm_or_si128(_mm_and_si128(gt, vfrom), _mm_andnot_si128(gt, f)));
+    _mm_storeu_si128((__m128i *)(xdir + k),
+                     _mm_or_si128(_mm_and_si128(gt, vdir), _mm_andnot_si128(gt, d)));
+  }
+#endif
+
+  for (; k < n; k++)
+  {
+    int c = p[k] + add[k];
+    if (c > x[k])
+    {
+      x[k] = c;
+      xfrom[k] = from;
+      xdir[k] = dir;
+    }
+  }
+}
+
+
+
+
+POGraph::POGraph(int band)
+  : m_band(band), m_sorted(true)
+{
+}
+
+
+int POGraph::addNode(char base, int aligned)
+{
+  int n = m_base.size();
+
+  m_base.push_back(base);
+  m_left.push_back(vector<int>());
+  m_right.push_back(vector<int>());
+  m_sorted = false;
+
+  if (aligned < 0)
+  {
+    m_ring.push_back(m_rings.size());
+    m_rings.push_back(vector<int>(1, n));
+  }
+  else
+  {
+    m_ring.push_back(m_ring[aligned]);
+    m_rings[m_ring[aligned]].push_back(n);
+  }
+
+  return n;
+}
+
+
+void POGraph::addEdge(int left, int right)
+{
+  vector<int> & r = m_right[left];
+  if (find(r.begin(), r.end(), right) != r.end()) { return; }
+
+  r.push_back(right);
+  m_left[right].push_back(left);
+  m_sorted = false;
+}
+
+
+void POGraph::sort()
+{
+  if (m_sorted) { return; }
+
+  int rings = m_rings.size();
+  vector<int> indegree(rings, 0);
+  vector<int> column(rings, 0);
+  deque<int> fringe;
+
+  m_order.clear();
+  m_order.reserve(m_base.size());
+  m_column.assign(m_base.size(), 0);
+
+  for (int n = 0; n < (int) m_base.size(); n++)
+  {
+    indegree[m_ring[n]] += m_left[n].size();
+  }
+
+  for (int g = 0; g < rings; g++)
+  {
+    if (indegree[g] == 0) { fringe.push_back(g); }
+  }
+
+  // Kahn's algorithm over the rings, assigning each ring the max distance
+  // from a source
+  while (!fringe.empty())
+  {
+    int g = fringe.front();
+    fringe.pop_front();
+
+    vector<int>::const_iterator ni, ri;
+    for (ni = m_rings[g].begin(); ni != m_rings[g].end(); ni++)
+    {
+      m_order.push_back(*ni);
+      m_column[*ni] = column[g];
+
+      for (ri = m_right[*ni].begin(); ri != m_right[*ni].end(); ri++)
+      {
+        int rg = m_ring[*ri];
+        if (column[g] + 1 > column[rg]) { column[rg] = column[g] + 1; }
+        if (--indegree[rg] == 0) { fringe.push_back(rg); }
+      }
+    }
+  }
+
+  m_sorted = true;
+}
+
+
+int POGraph::startColumn(int offset)
+{
+  // Locate the offset in the most recent read that covers it
+  for (int r = m_paths.size() - 1; r >= 0; r--)
+  {
+    int k = offset - m_offsets[r];
+    if (k >= 0 && k < (int) m_paths[r].size())
+    {
+      return m_column[m_paths[r][k]];
+    }
+  }
+
+  // or extrapolate from the read that ends last
+  int bestend = INT_MIN;
+  int column = 0;
+
+  for (int r = 0; r < (int) m_paths.size(); r++)
+  {
+    int end = m_offsets[r] + m_paths[r].size();
+    if (!m_paths[r].empty() && end > bestend && offset >= end)
+    {
+      bestend = end;
+      column = m_column[m_paths[r].back()] + offset - end + 1;
+    }
+  }
+
+  return column;
+}
+
+
+int POGraph::scoreRow(int node, int lo, int hi, const string & str)
+{
+  int n = hi - lo + 1;
+  int row = m_rows.size();
+
+  m_x.assign(n, NEG);
+  m_xfrom.assign(n, 0);
+  m_xdir.assign(n, '<');
+
+  vector<int> & profile = m_profile[(unsigned char) m_base[node]];
+  if (profile.empty())
+  {
+    profile.resize(str.length() + 1);
+    profile[0] = 0;
+    for (int i = 1; i <= (int) str.length(); i++)
+    {
+      profile[i] = (str[i-1] == m_base[node]) ? MATCH : MISMATCH;
+    }
+  }
+
+  // Try all previous nodes as both mismatch and indel, a node without an
+  // aligned previous node starts from the seed row
+  vector<int> preds;
+  vector<int>::const_iterator pi;
+  for (pi = m_left[node].begin(); pi != m_left[node].end(); pi++)
+  {
+    if (m_noderow[*pi] >= 0) { preds.push_back(m_noderow[*pi]); }
+  }
+  if (preds.empty()) { preds.push_back(0); }
+
+  for (pi = preds.begin(); pi != preds.end(); pi++)
+  {
+    const Row & p = m_rows[*pi];
+
+    // match
+    int a = max(max(lo, p.lo + 1), 1);
+    int b = min(hi, p.hi + 1);
+    if (a <= b)
+    {
+      relax(&m_x[a-lo], &m_xfrom[a-lo], &m_xdir[a-lo],
+            &m_score[cell(*pi, a-1)], &profile[a], b-a+1, *pi, '\\');
+    }
+
+    // indel
+    a = max(lo, p.lo);
+    b = min(hi, p.hi);
+    if (a <= b)
+    {
+      relax(&m_x[a-lo], &m_xfrom[a-lo], &m_xdir[a-lo],
+            &m_score[cell(*pi, a)], &m_indel[a], b-a+1, *pi, '^');
+    }
+  }
+
+  Row r;
+  r.node = node;
+  r.lo = lo;
+  r.hi = hi;
+  r.best = lo;
+  r.off = m_score.size();
+
+  m_score.resize(r.off + n);
+  m_from.resize(r.off + n);
+  m_dir.resize(r.off + n);
+
+  // A left indel within the row wins ties, the read may start anywhere
+  for (int k = 0; k < n; k++)
+  {
+    int c = r.off + k;
+
+    if (lo + k == 0)
+    {
+      m_score[c] = 0;
+      m_from[c] = row;
+      m_dir[c] = '*';
+    }
+    else
+    {
+      int left = (k > 0) ? m_score[c-1] + INDEL : NEG;
+
+      if (left >= m_x[k])
+      {
+        m_score[c] = left;
+        m_from[c] = row;
+        m_dir[c] = '<';
+      }
+      else
+      {
+        m_score[c] = m_x[k];
+        m_from[c] = m_xfrom[k];
+        m_dir[c] = m_xdir[k];
+      }
+    }
+
+    if (m_score[c] > m_score[r.off + r.best - lo]) { r.best = lo + k; }
+  }
+
+  m_rows.push_back(r);
+  return row;
+}
+
+
+void POGraph::align(const string & str, int offset)
+{
+  int len = str.length();
+  vector<int> path;
+
+  if (len == 0 || m_base.empty())
+  {
+    // seed the graph
+    for (int i = 0; i < len; i++)
+    {
+      path.push_back(addNode(str[i]));
+      if (i) { addEdge(path[i-1], path[i]); }
+    }
+
+    m_paths.push_back(path);
+    m_offsets.push_back(offset);
+    return;
+  }
+
+  sort();
+
+  int band = m_band < 0 ? max(MIN_BAND, len / BAND_DIV) : m_band;
+  int start = startColumn(offset);
+  int first = start - (band ? band : START_SLACK);
+
+  m_noderow.assign(m_base.size(), -1);
+  m_rows.clear();
+  m_score.clear();
+  m_from.clear();
+  m_dir.clear();
+  m_indel.assign(len + 1, INDEL);
+  for (int c = 0; c < 256; c++) { m_profile[c].clear(); }
+
+  // The seed row, unaligned read bases before the graph
+  Row seed;
+  seed.node = -1;
+  seed.lo = 0;
+  seed.hi = len;
+  seed.best = 0;
+  seed.off = 0;
+  m_rows.push_back(seed);
+  for (int i = 0; i <= len; i++)
+  {
+    m_score.push_back(i * INDEL);
+    m_from.push_back(0);
+    m_dir.push_back(i ? '<' : '*');
+  }
+
+  // Align the nodes in topological order, each within a band around the
+  // diagonal of the read's offset and around the best scores of its
+  // previous nodes. The scores allow random sequence to align with a
+  // positive score, so the best scores alone may wander off the read.
+  vector<int>::const_iterator oi;
+  for (oi = m_order.begin(); oi != m_order.end(); oi++)
+  {
+    int node = *oi;
+    if (m_column[node] < first) { continue; }
+
+    int lo = 0;
+    int hi = len;
+
+    if (band)
+    {
+      int plo = m_column[node] - start;
+      int phi = plo;
+
+      if (m_column[node] > start)
+      {
+        vector<int>::const_iterator pi;
+        for (pi = m_left[node].begin(); pi != m_left[node].end(); pi++)
+        {
+          int p = m_noderow[*pi];
+          if (p >= 0)
+          {
+            plo = min(plo, m_rows[p].best + 1);
+            phi = max(phi, m_rows[p].best + 1);
+          }
+        }
+      }
+
+      lo = max(0, plo - band);
+      hi = m_right[node].empty() ? len : min(len, phi + band);
+    }
+
+    if (lo <= hi) { m_noderow[node] = scoreRow(node, lo, hi, str); }
+  }
+
+  // Find the best scoring end of the read
+  int cur = 0;
+  int bestscore = NEG;
+
+  for (int r = 1; r < (int) m_rows.size(); r++)
+  {
+    if (m_rows[r].hi == len && m_score[cell(r, len)] > bestscore)
+    {
+      cur = r;
+      bestscore = m_score[cell(r, len)];
+    }
+  }
+
+  // Backtrack, merging matches into the graph and adding new nodes for
+  // mismatches and read insertions
+  int pos = len;
+  while (pos > 0)
+  {
+    const Row & r = m_rows[cur];
+    char strbase = str[pos-1];
+
+    if (cur == 0 || pos < r.lo || pos > r.hi)
+    {
+      path.push_back(addNode(strbase));
+      pos--;
+      continue;
+    }
+
+    int c = cell(cur, pos);
+    char dir = m_dir[c];
+
+    if (dir == '\\')
+    {
+      // reuse the aligned node with the same base, if any
+      int n = -1;
+      vector<int>::const_iterator ni;
+      const vector<int> & ring = m_rings[m_ring[r.node]];
+      for (ni = ring.begin(); ni != ring.end() && n < 0; ni++)
+      {
+        if (m_base[*ni] == strbase) { n = *ni; }
+      }
+      if (n < 0) { n = addNode(strbase, r.node); }
+
+      path.push_back(n);
+      pos--;
+      cur = m_from[c];
+    }
+    else if (dir == '<')
+    {
+      path.push_back(addNode(strbase));
+      pos--;
+    }
+    else if (dir == '^')
+    {
+      // gap in read aligns to graph, edge created below
+      cur = m_from[c];
+    }
+    else
+    {
+      AMOS_THROW("Bad traceback direction '" + string(1, dir) + "'");
+    }
+  }
+
+  reverse(path.begin(), path.end());
+  for (int i = 1; i < len; i++) { addEdge(path[i-1], path[i]); }
+
+  m_paths.push_back(path);
+  m_offsets.push_back(offset);
+}
+
+
+int POGraph::getStartOffset(int readcount)
+{
+  sort();
+
+  const vector<int> & path = m_paths[readcount];
+  return path.empty() ? 0 : m_column[path[0]];
+}
+
+
+string POGraph::getAlignedString(int readcount)
+{
+  sort();
+
+  const vector<int> & path = m_paths[readcount];
+  string aligned;
+
+  for (int i = 0; i < (int) path.size(); i++)
+  {
+    if (i)
+    {
+      for (int g = m_column[path[i-1]] + 1; g < m_column[path[i]]; g++)
+      {
+        aligned.push_back('-');
+      }
+    }
+
+    aligned.push_back(m_base[path[i]]);
+  }
+
+  return aligned;
+}
+
+
+vector<Pos_t> POGraph::getGaps(int readcount)
+{
+  sort();
+
+  const vector<int> & path = m_paths[readcount];
+  vector<Pos_t> retval;
+
+  for (int i = 1; i < (int) path.size(); i++)
+  {
+    for (int g = m_column[path[i-1]] + 1; g < m_column[path[i]]; g++)
+    {
+      retval.push_back(i);
+    }
+  }
+
+  return retval;
+}
+
+
+void POGraph::getConsensus(string & cons, string & qual)
+{
+  sort();
+
+  int columns = 0;
+  for (int n = 0; n < (int) m_column.size(); n++)
+  {
+    columns = max(columns, m_column[n] + 1);
+  }
+
+  vector<int> counts(columns * 6, 0);
+
+  for (int r = 0; r < (int) m_paths.size(); r++)
+  {
+    const vector<int> & path = m_paths[r];
+
+    for (int i = 0; i < (int) path.size(); i++)
+    {
+      if (i)
+      {
+        for (int g = m_column[path[i-1]] + 1; g < m_column[path[i]]; g++)
+        {
+          counts[g * 6 + 4]++;
+        }
+      }
+
+      counts[m_column[path[i]] * 6 + baseIndex(m_base[path[i]])]++;
+    }
+  }
+
+  cons.resize(columns);
+  qual.resize(columns);
+
+  for (int c = 0; c < columns; c++)
+  {
+    int best = 5;
+    int depth = 0;
+
+    for (int b = 0; b < 6; b++)
+    {
+      depth += counts[c * 6 + b];
+      if (counts[c * 6 + b] > counts[c * 6 + best]) { best = b; }
+    }
+
+    cons[c] = CONSBASE[best];
+    qual[c] = depth ? '0' + (60 * counts[c * 6 + best]) / depth : '0';
+  }
+}
+
+
+void POGraph::dumpDot(ostream & os)
+{
+  os << "digraph G" << endl;
+  os << "{" << endl;
+  os << "  rankdir=LR;" << endl;
+
+  for (int n = 0; n < (int) m_base.size(); n++)
+  {
+    os << "  " << n << " [label=\"" << m_base[n] << " (" << n << ")\"];" << endl;
+
+    vector<int>::const_iterator ri;
+    for (ri = m_right[n].begin(); ri != m_right[n].end(); ri++)
+    {
+      os << "  " << n << " -> " << *ri << ";" << endl;
+    }
+  }
+
+  os << "}" << endl;
+}
+
+
+void POGraph::dumpMSA(ostream & os)
+{
+  for (int r = 0; r < (int) m_paths.size(); r++)
+  {
+    int offset = getStartOffset(r);
+
+    os << ">" << r << "\t" << offset << "\t";
+    for (int j = 0; j < offset; j++) { os << " "; }
+    os << '\'' << getAlignedString(r) << endl;
+  }
+}
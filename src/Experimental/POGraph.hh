@@ -0,0 +1,103 @@
+// Partial order graph of a set of reads, built by aligning the reads to the
+// graph one at a time. The graph is used to lay out the reads of a contig
+// and to call its consensus, see po-align.cc
+
+#ifndef POGRAPH_HH
+#define POGRAPH_HH 1
+
+#include "foundation_AMOS.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+class POGraph
+{
+public:
+  // Scores of the alignment, a read may start and end anywhere in the
+  // graph without penalty. A mismatch has to score better than an insertion
+  // next to a deletion or the substitutions never line up in a column
+  static const int MATCH = 4;
+  static const int MISMATCH = -2;
+  static const int INDEL = -3;
+
+  // band < 0 sizes the band of each read from its length, band == 0 turns
+  // banding off and band > 0 is the half width of the band
+  POGraph(int band = -1);
+
+  // Aligns a read to the graph and adds it. offset is the layout offset of
+  // the read, the alignment starts in a band around the graph column at
+  // that offset and follows the best scores from there. Reads are best
+  // added in order of offset. Throws an Exception_t if the traceback is
+  // broken, the graph is then only fit to be thrown away.
+  void align(const std::string & str, int offset);
+
+  int getReadCount() const { return m_paths.size(); }
+  int getNodeCount() const { return m_base.size(); }
+
+  // Column of the first base of a read in the multiple alignment
+  int getStartOffset(int readcount);
+
+  // Gapped sequence of a read, from its start offset
+  std::string getAlignedString(int readcount);
+
+  // Gap positions of a read in the ungapped read, as in Tile_t::gaps
+  std::vector<AMOS::Pos_t> getGaps(int readcount);
+
+  // Majority vote consensus of the multiple alignment, with qualities from
+  // the fraction of the reads that agree with each column
+  void getConsensus(std::string & cons, std::string & qual);
+
+  void dumpDot(std::ostream & os);
+  void dumpMSA(std::ostream & os);
+
+private:
+  struct Row
+  {
+    int node;     // graph node, -1 for the seed row
+    int lo, hi;   // band of read positions
+    int best;     // position of the best score in the band
+    size_t off;   // first cell in the cell pool
+  };
+
+  int addNode(char base, int aligned = -1);
+  void addEdge(int left, int right);
+  void sort();
+  int startColumn(int offset);
+  int scoreRow(int node, int lo, int hi, const std::string & str);
+  int cell(int row, int i) const { return m_rows[row].off + i - m_rows[row].lo; }
+
+  int m_band;
+
+  // The nodes, in order of creation
+  std::vector<char> m_base;
+  std::vector<std::vector<int> > m_left;
+  std::vector<std::vector<int> > m_right;
+
+  // Nodes holding different bases of the same column are aligned to each
+  // other, each node is in exactly one ring of aligned nodes
+  std::vector<int> m_ring;
+  std::vector<std::vector<int> > m_rings;
+
+  // Nodes in topological order, the nodes of a ring next to each other, and
+  // the column of each node as the longest path to its ring from a source
+  std::vector<int> m_order;
+  std::vector<int> m_column;
+  bool m_sorted;
+
+  // The nodes and layout offset of each read
+  std::vector<std::vector<int> > m_paths;
+  std::vector<int> m_offsets;
+
+  // Banded dynamic programming rows of the current alignment
+  std::vector<int> m_noderow;
+  std::vector<Row> m_rows;
+  std::vector<int> m_score;
+  std::vector<int> m_from;
+  std::vector<char> m_dir;
+  std::vector<int> m_profile[256];
+  std::vector<int> m_indel;
+  std::vector<int> m_x, m_xfrom, m_xdir;
+};
+
+#endif
@@ -1,5 +1,12 @@
 #include "sw_align.hh"
 
+//-- The SSE4.2 and AVX2 node kernels need 64 bit long ints and gcc function
+//   targets, they are selected at runtime so the file still builds for any cpu
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__LP64__) && \
+  ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define SW_ALIGN_X86_KERNELS
+#include <immintrin.h>
+#endif
 
 
 
@@ -15,6 +22,7 @@ static const char START  = 3;
 static const char NONE   = 4;
 
 
+int _align_kernel = _bestAlignKernel( );
 int _break_len = DEFAULT_BREAK_LEN;
 int _matrix_type = NUCLEOTIDE;
 
@@ -23,22 +31,51 @@ int _matrix_type = NUCLEOTIDE;
 
 
 //----------------------------------------- Private Function Declarations ----//
+static void allocDiagonal
+     (Diagonal & Diag, long int Ds);
+
+
 static void generateDelta
      (const Diagonal * Diag, long int FinishCt, long int FinishCDi,
       long int N, vector<long int> & Delta);
 
 
-static inline Score * maxScore
-     (Score S[3]);
+static inline char maxScore
+     (const long int del, const long int ins, const long int mat);
+
+
+static inline long int maxValue
+     (const Diagonal & Diag, long int Di);
 
 
 static inline long int scoreMatch
-     (const Diagonal Diag, long int Dct, long int CDi, 
+     (long int Dct, long int CDi,
       const char * A, const char * B, long int N, unsigned int m_o);
 
 
+static void scoreNodes
+     (Diagonal & Diag, const Diagonal & PDiag, const Diagonal * PPDiag,
+      long int First, long int Last, long int PDi, long int PPDi,
+      const long int * Match);
+
+
 static inline void scoreEdit
-     (Score & curr, const long int del, const long int ins, const long int mat);
+     (long int & value, char & used,
+      const long int del, const long int ins, const long int mat);
+
+
+#ifdef SW_ALIGN_X86_KERNELS
+static long int scoreNodesAVX2
+     (Diagonal & Diag, const Diagonal & PDiag, const Diagonal & PPDiag,
+      long int First, long int Last, long int PDi, long int PPDi,
+      const long int * Match);
+
+
+static long int scoreNodesSSE42
+     (Diagonal & Diag, const Diagonal & PDiag, const Diagonal & PPDiag,
+      long int First, long int Last, long int PDi, long int PPDi,
+      const long int * Match);
+#endif
 
 
 
@@ -68,6 +105,9 @@ bool _alignEngine
 
   const char * A, * B;       // the sequence pointers to be used by this func
 
+  long int * Match;          // the match scores of the current diagonal
+  long int Ml = 100;         // capacity of the match score list
+
   long int min_score = (-1 * LONG_MAX);           // minimum possible score
   long int high_score = min_score;                // global maximum score
   long int xhigh_score = min_score;               // non-optimal high score
@@ -90,6 +130,7 @@ bool _alignEngine
   long int xFinishCt = 0;    // non-optimal ...
   long int xFinishCDi = 0;   // non-optimal ...
   long int N, M, L;          // maximum matrix dimensions... N rows, M columns
+  long int Ilo, Ihi;         // interior nodes, those with all parents in bounds
 
   int Iadj, Dadj, Madj;      // insert, delete and match adjust values
 
@@ -115,22 +156,23 @@ bool _alignEngine
       M = Bstart - Bend + 1;
     }
 
-  //-- Initialize the diagonals list
+  //-- Initialize the diagonals and match score lists
   Diag = (Diagonal *) Safe_malloc ( Ll * sizeof(Diagonal) );
+  Match = (long int *) Safe_malloc ( Ml * sizeof(long int) );
 
   //-- Initialize position 0,0 in the matrices
   Diag[0] . lbound = lbound;
   Diag[0] . rbound = rbound ++;
 
-  Diag[0] . I = (Node *) Safe_malloc ( 1 * sizeof(Node) );
-  Diag[0] . I[0] . S[DELETE] . value = min_score;
-  Diag[0] . I[0] . S[INSERT] . value = min_score;
-  Diag[0] . I[0] . S[MATCH] . value = 0;
-  Diag[0] . I[0] . max = Diag[0] . I[0] . S + MATCH;
+  allocDiagonal ( Diag[0], 1 );
+  Diag[0] . V[DELETE][0] = min_score;
+  Diag[0] . V[INSERT][0] = min_score;
+  Diag[0] . V[MATCH][0] = 0;
+  Diag[0] . Max[0] = MATCH;
 
-  Diag[0] . I[0] . S[DELETE] . used = NONE;
-  Diag[0] . I[0] . S[INSERT] . used = NONE;
-  Diag[0] . I[0] . S[MATCH] . used = START;
+  Diag[0] . U[DELETE][0] = NONE;
+  Diag[0] . U[INSERT][0] = NONE;
+  Diag[0] . U[MATCH][0] = START;
 
   L = N < M ? N : M;
 
@@ -147,14 +189,21 @@ bool _alignEngine
           Diag = (Diagonal *) Safe_realloc
             ( Diag, sizeof(Diagonal) * Ll );
         }
-      
+
       Diag[Dct] . lbound = lbound;
       Diag[Dct] . rbound = rbound;
 
       //-- malloc space for the edit char and score nodes
       Ds = rbound - lbound + 1;
-      Diag[Dct] . I = (Node *) Safe_malloc
-	( Ds * sizeof(Node) );
+      allocDiagonal ( Diag[Dct], Ds );
+
+      if ( Ds > Ml )
+	{
+	  while ( Ds > Ml )
+	    Ml *= 2;
+	  Match = (long int *) Safe_realloc
+	    ( Match, sizeof(long int) * Ml );
+	}
 
 #ifdef _DEBUG_VERBOSE
       //-- Keep count of trimmed and calculated nodes
@@ -176,7 +225,7 @@ bool _alignEngine
 	  Madj = Dct == N + 1 ? 0 : 1;
 	}
       Dadj = Iadj - 1;
-      
+
       //-- Set parent diagonal values
       PDct = Dct - 1;
       PDs = Diag[PDct] . rbound - Diag[PDct] . lbound + 1;
@@ -198,84 +247,53 @@ bool _alignEngine
       if ( m_o & FORCED_BIT )
 	high_score = min_score;
 
+      //-- Find the interior nodes, whose DELETE, INSERT and MATCH parents
+      //   are all within bounds
+      Ilo = 0;
+      if ( -PDi > Ilo )
+	Ilo = -PDi;
+      if ( -PPDi > Ilo )
+	Ilo = -PPDi;
+      Ihi = Ds;
+      if ( PDs - PDi - 1 < Ihi )
+	Ihi = PDs - PDi - 1;
+      if ( PPDs - PPDi < Ihi )
+	Ihi = PPDs - PPDi;
+      if ( Ihi < Ilo )
+	Ilo = Ihi = 0;
+
+      //-- Score the MATCH/MIS-MATCH of every node with a grandparent
+      for ( Di = 0; Di < Ds; Di ++ )
+	if ( PPDi + Di >= 0  &&  PPDi + Di < PPDs )
+	  Match[Di] = scoreMatch (Dct, lbound + Di, A, B, N, m_o);
+
       //-- **START** of internal node scoring loop
-      //-- Calculate scores for every node (within bounds) for diagonal Dct
+      //-- Calculate scores for every node (within bounds) for diagonal Dct,
+      //   the interior nodes are independent and scored with the kernel
+      Di = Ilo;
+#ifdef SW_ALIGN_X86_KERNELS
+      if ( Ihi <= Ilo )
+	;
+      else if ( _align_kernel == AVX2_KERNEL )
+	Di = scoreNodesAVX2 (Diag[Dct], Diag[PDct], Diag[PPDct],
+			     Ilo, Ihi, PDi, PPDi, Match);
+      else if ( _align_kernel == SSE42_KERNEL )
+	Di = scoreNodesSSE42 (Diag[Dct], Diag[PDct], Diag[PPDct],
+			      Ilo, Ihi, PDi, PPDi, Match);
+#endif
+      scoreNodes (Diag[Dct], Diag[PDct], PPDct >= 0 ? Diag + PPDct : NULL,
+		  0, Ilo, PDi, PPDi, Match);
+      scoreNodes (Diag[Dct], Diag[PDct], PPDct >= 0 ? Diag + PPDct : NULL,
+		  Di, Ds, PDi, PPDi, Match);
+
       for ( CDi = lbound; CDi <= rbound; CDi ++ )
 	{
-	  //-- Set the index (in memory) of current node and clear score
 	  Di = CDi - Diag[Dct] . lbound;
 
-	  //-- Calculate DELETE score
-	  if ( PDi >= 0  &&  PDi < PDs )
-	    scoreEdit
-	      (Diag[Dct] . I[Di] . S[DELETE],
-	       Diag[PDct] . I[PDi] . S[DELETE] . used == NONE ?
-	       Diag[PDct] . I[PDi] . S[DELETE] . value :
-	       Diag[PDct] . I[PDi] . S[DELETE] . value +
-	       CONT_GAP_SCORE [_matrix_type],
-	       Diag[PDct] . I[PDi] . S[INSERT] . used == NONE ?
-	       Diag[PDct] . I[PDi] . S[INSERT] . value :
-	       Diag[PDct] . I[PDi] . S[INSERT] . value +
-	       OPEN_GAP_SCORE [_matrix_type],
-	       Diag[PDct] . I[PDi] . S[MATCH]  . used == NONE ?
-	       Diag[PDct] . I[PDi] . S[MATCH]  . value :
-	       Diag[PDct] . I[PDi] . S[MATCH]  . value +
-	       OPEN_GAP_SCORE [_matrix_type]);
-	  else
-	    {
-	      Diag[Dct] . I[Di] . S[DELETE] . value = min_score;
-	      Diag[Dct] . I[Di] . S[DELETE] . used = NONE;
-	    }
-
-	  PDi ++;
-
-	  //-- Calculate INSERT score
-	  if ( PDi >= 0  &&  PDi < PDs )
-	    scoreEdit
-	      (Diag[Dct] . I[Di] . S[INSERT],
-	       Diag[PDct] . I[PDi] . S[DELETE] . used == NONE ?
-	       Diag[PDct] . I[PDi] . S[DELETE] . value :
-	       Diag[PDct] . I[PDi] . S[DELETE] . value +
-	       OPEN_GAP_SCORE [_matrix_type],
-	       Diag[PDct] . I[PDi] . S[INSERT] . used == NONE ?
-	       Diag[PDct] . I[PDi] . S[INSERT] . value :
-	       Diag[PDct] . I[PDi] . S[INSERT] . value +
-	       CONT_GAP_SCORE [_matrix_type],
-	       Diag[PDct] . I[PDi] . S[MATCH]  . used == NONE ?
-	       Diag[PDct] . I[PDi] . S[MATCH]  . value :
-	       Diag[PDct] . I[PDi] . S[MATCH]  . value +
-	       OPEN_GAP_SCORE [_matrix_type]);
-	  else
-	    {
-	      Diag[Dct] . I[Di] . S[INSERT] . value = min_score;
-	      Diag[Dct] . I[Di] . S[INSERT] . used = NONE;
-	    }
-
-	  //-- Calculate MATCH/MIS-MATCH score
-	  if ( PPDi >= 0  &&  PPDi < PPDs )
-	    {
-	      scoreEdit
-		(Diag[Dct] . I[Di] . S[MATCH],
-		 Diag[PPDct] . I[PPDi] . S[DELETE] . value,
-		 Diag[PPDct] . I[PPDi] . S[INSERT] . value,
-		 Diag[PPDct] . I[PPDi] . S[MATCH]  . value);
-	      Diag[Dct] . I[Di] . S[MATCH] . value +=
-		scoreMatch (Diag[Dct], Dct, CDi, A, B, N, m_o);
-	    }
-	  else
-	    {
-	      Diag[Dct] . I[Di] . S[MATCH] . value = min_score;
-	      Diag[Dct] . I[Di] . S[MATCH] . used = NONE;
-	    }
-
-	  PPDi ++;
-
-	  Diag[Dct] . I[Di] . max = maxScore (Diag[Dct] . I[Di] . S);
-
 	  //-- Reset high_score if new global max was found
-	  if ( Diag[Dct] . I[Di] . max->value >= high_score )
+	  if ( maxValue (Diag[Dct], Di) >= high_score )
 	    {
-	      high_score = Diag[Dct] . I[Di] . max->value;
+	      high_score = maxValue (Diag[Dct], Di);
 	      FinishCt = Dct;
 	      FinishCDi = CDi;
 	    }
@@ -290,9 +308,9 @@ bool _alignEngine
 	    {
 	      if ( lbound == 0 )
 		{
-		  if ( Diag[Dct] . I[0] . max->value >= xhigh_score )
+		  if ( maxValue (Diag[Dct], 0) >= xhigh_score )
 		    {
-		      xhigh_score = Diag[Dct] . I[0] . max->value;
+		      xhigh_score = maxValue (Diag[Dct], 0);
 		      xFinishCt = Dct;
 		      xFinishCDi = 0;
 		    }
@@ -302,11 +320,10 @@ bool _alignEngine
 	    {
 	      if ( rbound == M )
 		{
-		  if ( Diag[Dct] . I[M-Diag[Dct].lbound] .
-		       max->value >= xhigh_score )
+		  if ( maxValue (Diag[Dct], M - Diag[Dct] . lbound)
+		       >= xhigh_score )
 		    {
-		      xhigh_score = Diag[Dct] . I[M-Diag[Dct].lbound] .
-			max->value;
+		      xhigh_score = maxValue (Diag[Dct], M - Diag[Dct] . lbound);
 		      xFinishCt = Dct;
 		      xFinishCDi = M;
 		    }
@@ -317,25 +334,25 @@ bool _alignEngine
 
       //-- If in extender modus operandi, free soon to be greatgrandparent diag
       if ( m_o & SEARCH_BIT  &&  Dct > 1 )
-	free ( Diag[PPDct] . I );
+	free ( Diag[PPDct] . V[DELETE] );
 
 
       //-- Trim hopeless diagonal nodes
       for ( Di = 0; Di < Ds; Di ++ )
 	{
-	  if ( high_score - Diag[Dct] . I[Di] . max->value > max_diff )
+	  if ( high_score - maxValue (Diag[Dct], Di) > max_diff )
 	    lbound ++;
 	  else
 	    break;
 	}
       for ( Di = Ds - 1; Di >= 0; Di -- )
 	{
-	  if ( high_score - Diag[Dct] . I[Di] . max->value > max_diff )
+	  if ( high_score - maxValue (Diag[Dct], Di) > max_diff )
 	    rbound --;
 	  else
 	    break;
 	}
-      
+
       //-- Grow new diagonal and reset boundaries
       if ( Dct < N && Dct < M )
 	{ Dl ++; rbound ++; }
@@ -393,17 +410,18 @@ bool _alignEngine
   //-- Ouput calculation statistics
   if ( TargetReached )
     fprintf(stderr,"Finish score = %ld : %ld,%ld\n",
-	    Diag[FinishCt] . I[0] . max->value, N, M);
+	    maxValue (Diag[FinishCt], 0), N, M);
   else
     fprintf(stderr,"High score = %ld : %ld,%ld\n", high_score,
 	    labs(Aadj) + 1, labs(Badj) + 1);
   fprintf(stderr, "%ld nodes calculated, %ld nodes trimmed\n", CalcCt, TrimCt);
+  long int NodeSize = 3 * sizeof(long int) + 4 * sizeof(char);
   if ( m_o & DIRECTION_BIT )
     fprintf(stderr, "%ld bytes used\n",
-	    (long int)sizeof(Diagonal) * Dct + (long int)sizeof(Node) * CalcCt);
+	    (long int)sizeof(Diagonal) * Dct + NodeSize * CalcCt);
   else
     fprintf(stderr, "%ld bytes used\n",
-	    ((long int)sizeof(Diagonal) + (long int)sizeof(Node) * MaxL) * 2);
+	    ((long int)sizeof(Diagonal) + NodeSize * MaxL) * 2);
 #endif
 
 
@@ -413,8 +431,9 @@ bool _alignEngine
 
   //-- Free the scoring and edit spaces remaining
   for ( Di = m_o & SEARCH_BIT ? Dct - 1 : 0; Di <= Dct; Di ++ )
-    free ( Diag[Di] . I );
+    free ( Diag[Di] . V[DELETE] );
   free ( Diag );
+  free ( Match );
 
   return TargetReached;
 }
@@ -422,6 +441,48 @@ bool _alignEngine
 
 
 
+int _bestAlignKernel
+     ( )
+
+     //  Returns the fastest node scoring kernel supported by the cpu
+
+{
+#ifdef SW_ALIGN_X86_KERNELS
+  __builtin_cpu_init( );
+  if ( __builtin_cpu_supports ("avx2") )
+    return AVX2_KERNEL;
+  if ( __builtin_cpu_supports ("sse4.2") )
+    return SSE42_KERNEL;
+#endif
+  return SCALAR_KERNEL;
+}
+
+
+
+
+static void allocDiagonal
+     (Diagonal & Diag, long int Ds)
+
+     //  Allocates the score, edit and max arrays for the Ds nodes of Diag
+     //      in a single block, freed with free (Diag . V[DELETE])
+
+{
+  Diag . V[DELETE] = (long int *) Safe_malloc
+    ( Ds * (3 * sizeof(long int) + 4 * sizeof(char)) );
+  Diag . V[INSERT] = Diag . V[DELETE] + Ds;
+  Diag . V[MATCH]  = Diag . V[INSERT] + Ds;
+
+  Diag . U[DELETE] = (char *) ( Diag . V[MATCH] + Ds );
+  Diag . U[INSERT] = Diag . U[DELETE] + Ds;
+  Diag . U[MATCH]  = Diag . U[INSERT] + Ds;
+  Diag . Max = Diag . U[MATCH] + Ds;
+
+  return;
+}
+
+
+
+
 static void generateDelta
      (const Diagonal * Diag, long int FinishCt, long int FinishCDi,
       long int N, vector<long int> & Delta)
@@ -451,7 +512,7 @@ static void generateDelta
   long int PSize = 100;     // capacity of the path space
   char * Reverse_Path;       // path space
 
-  Score curr_score;
+  char curr_used;
   char edit;
 
   //-- malloc space for the edit path
@@ -459,7 +520,7 @@ static void generateDelta
 
   //-- Which Score index is the maximum value in? Store in edit
   Di = CDi - Diag[Dct] . lbound;
-  edit = Diag[Dct] . I[Di] . max - Diag[Dct] . I[Di] . S;
+  edit = Diag[Dct] . Max[Di];
 
   //-- Walk the path backwards through the edit space
   while ( Dct >= 0 )
@@ -468,12 +529,12 @@ static void generateDelta
       if ( Pi >= PSize )
 	{
 	  PSize *= 2;
-	  Reverse_Path = (char *) Safe_realloc 
+	  Reverse_Path = (char *) Safe_realloc
 	    ( Reverse_Path, sizeof(char) * PSize );
 	}
 
       Di = CDi - Diag[Dct] . lbound;
-      curr_score = Diag[Dct] . I[Di] . S[edit];
+      curr_used = edit < START ? Diag[Dct] . U[(int)edit][Di] : NONE;
 
       Reverse_Path[Pi ++] = edit;
       switch ( edit )
@@ -497,7 +558,7 @@ static void generateDelta
 	  exit ( EXIT_FAILURE );
 	}
 
-      edit = curr_score . used;
+      edit = curr_used;
     }
 
   //-- Generate the delta information
@@ -534,30 +595,43 @@ static void generateDelta
 
 
 
-static inline Score * maxScore
-     (Score S[3])
+static inline char maxScore
+     (const long int del, const long int ins, const long int mat)
 
-     //  Return a pointer to the maximum score in the score array
+     //  Return the edit with the maximum score of a node
 
 {
-  if ( S[DELETE] . value > S[INSERT] . value )
+  if ( del > ins )
     {
-      if ( S[DELETE] . value > S[MATCH] . value )
-	return S + DELETE;
+      if ( del > mat )
+	return DELETE;
       else
-	return S + MATCH;
+	return MATCH;
     }
-  else if ( S[INSERT] . value > S[MATCH] . value )
-    return S + INSERT;
+  else if ( ins > mat )
+    return INSERT;
   else
-    return S + MATCH;
+    return MATCH;
+}
+
+
+
+
+static inline long int maxValue
+     (const Diagonal & Diag, long int Di)
+
+     //  Return the maximum score of node Di of Diag
+
+{
+  return Diag . V[(int)Diag . Max[Di]][Di];
 }
 
 
 
 
 static inline void scoreEdit
-     (Score & curr, const long int del, const long int ins, const long int mat)
+     (long int & value, char & used,
+      const long int del, const long int ins, const long int mat)
 
      //  Assign current edit a maximal score using either del, ins or mat
 
@@ -566,24 +640,24 @@ static inline void scoreEdit
     {
       if ( del > mat )
 	{
-	  curr.value = del;
-	  curr.used = DELETE;
+	  value = del;
+	  used = DELETE;
 	}
       else
 	{
-	  curr.value = mat;
-	  curr.used = MATCH;
+	  value = mat;
+	  used = MATCH;
 	}
     }
   else if ( ins > mat )
     {
-      curr.value = ins;
-      curr.used = INSERT;
+      value = ins;
+      used = INSERT;
     }
   else
     {
-      curr.value = mat;
-      curr.used = MATCH;
+      value = mat;
+      used = MATCH;
     }
 
   return;
@@ -593,12 +667,11 @@ static inline void scoreEdit
 
 
 static inline long int scoreMatch
-     (const Diagonal Diag, long int Dct, long int CDi, 
+     (long int Dct, long int CDi,
       const char * A, const char * B, long int N, unsigned int m_o)
 
-     //  Diag is the single diagonal that contains the node to be scored
-     //  Dct is Diag's diagonal index in the edit matrix
-     //  CDi is the conceptual node to be scored in Diag
+     //  Dct is the diagonal index in the edit matrix of the node to be scored
+     //  CDi is the conceptual node to be scored in Dct
      //  A and B are the alignment sequences
      //  N is the alignment target index in A
      //  m_o is the modus operandi of the alignment:
@@ -630,3 +703,333 @@ static inline long int scoreMatch
 
   return MATCH_SCORE [_matrix_type] [toupper(Ac) - 'A'] [toupper(Bc) - 'A'];
 }
+
+
+
+
+static void scoreNodes
+     (Diagonal & Diag, const Diagonal & PDiag, const Diagonal * PPDiag,
+      long int First, long int Last, long int PDi, long int PPDi,
+      const long int * Match)
+
+     //  Diag is the diagonal to be scored, PDiag its parent and PPDiag its
+     //      grandparent diagonal, or NULL if Diag is the first diagonal
+     //  First and Last are the nodes [First...Last) of Diag to be scored
+     //  PDi and PPDi are the indices in PDiag and PPDiag of the DELETE and
+     //      MATCH parents of node 0, INSERT parents are at PDi + 1
+     //  Match holds the match scores of the nodes that have a MATCH parent
+     //  This is the scalar kernel, it checks the bounds of every parent
+
+{
+  long int min_score = (-1 * LONG_MAX);
+  long int Open = OPEN_GAP_SCORE [_matrix_type];
+  long int Cont = CONT_GAP_SCORE [_matrix_type];
+  long int PDs = PDiag . rbound - PDiag . lbound + 1;
+  long int PPDs = PPDiag ? PPDiag -> rbound - PPDiag -> lbound + 1 : 0;
+  long int Di, Pi;
+
+  for ( Di = First; Di < Last; Di ++ )
+    {
+      //-- Calculate DELETE score
+      Pi = PDi + Di;
+      if ( Pi >= 0  &&  Pi < PDs )
+	scoreEdit
+	  (Diag . V[DELETE][Di], Diag . U[DELETE][Di],
+	   PDiag . U[DELETE][Pi] == NONE ?
+	   PDiag . V[DELETE][Pi] : PDiag . V[DELETE][Pi] + Cont,
+	   PDiag . U[INSERT][Pi] == NONE ?
+	   PDiag . V[INSERT][Pi] : PDiag . V[INSERT][Pi] + Open,
+	   PDiag . U[MATCH][Pi]  == NONE ?
+	   PDiag . V[MATCH][Pi]  : PDiag . V[MATCH][Pi]  + Open);
+      else
+	{
+	  Diag . V[DELETE][Di] = min_score;
+	  Diag . U[DELETE][Di] = NONE;
+	}
+
+      //-- Calculate INSERT score
+      Pi ++;
+      if ( Pi >= 0  &&  Pi < PDs )
+	scoreEdit
+	  (Diag . V[INSERT][Di], Diag . U[INSERT][Di],
+	   PDiag . U[DELETE][Pi] == NONE ?
+	   PDiag . V[DELETE][Pi] : PDiag . V[DELETE][Pi] + Open,
+	   PDiag . U[INSERT][Pi] == NONE ?
+	   PDiag . V[INSERT][Pi] : PDiag . V[INSERT][Pi] + Cont,
+	   PDiag . U[MATCH][Pi]  == NONE ?
+	   PDiag . V[MATCH][Pi]  : PDiag . V[MATCH][Pi]  + Open);
+      else
+	{
+	  Diag . V[INSERT][Di] = min_score;
+	  Diag . U[INSERT][Di] = NONE;
+	}
+
+      //-- Calculate MATCH/MIS-MATCH score
+      Pi = PPDi + Di;
+      if ( Pi >= 0  &&  Pi < PPDs )
+	{
+	  scoreEdit
+	    (Diag . V[MATCH][Di], Diag . U[MATCH][Di],
+	     PPDiag -> V[DELETE][Pi],
+	     PPDiag -> V[INSERT][Pi],
+	     PPDiag -> V[MATCH][Pi]);
+	  Diag . V[MATCH][Di] += Match[Di];
+	}
+      else
+	{
+	  Diag . V[MATCH][Di] = min_score;
+	  Diag . U[MATCH][Di] = NONE;
+	}
+
+      Diag . Max[Di] = maxScore
+	(Diag . V[DELETE][Di], Diag . V[INSERT][Di], Diag . V[MATCH][Di]);
+    }
+
+  return;
+}
+
+
+
+
+#ifdef SW_ALIGN_X86_KERNELS
+//-- The vector kernels compute scoreEdit and maxScore for several nodes at
+//   once with 64 bit compares and blends, so they make the same choices as
+//   the scalar kernel, ties and overflows included
+
+__attribute__((target("avx2")))
+static inline __m256i loadEdits4
+     (const char * U)
+
+     //  Widen the 4 edit chars at U to 64 bit lanes
+
+{
+  int w;
+  memcpy (&w, U, sizeof(w));
+  return _mm256_cvtepi8_epi64 (_mm_cvtsi32_si128 (w));
+}
+
+
+
+
+__attribute__((target("avx2")))
+static inline void storeEdits4
+     (char * U, __m256i e)
+
+     //  Narrow 4 edit lanes to the chars at U
+
+{
+  const __m256i ctl = _mm256_setr_epi8
+    (0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  __m256i p = _mm256_shuffle_epi8 (e, ctl);
+  unsigned short lo = _mm_extract_epi16 (_mm256_castsi256_si128 (p), 0);
+  unsigned short hi = _mm_extract_epi16 (_mm256_extracti128_si256 (p, 1), 0);
+  memcpy (U, &lo, sizeof(lo));
+  memcpy (U + 2, &hi, sizeof(hi));
+}
+
+
+
+
+__attribute__((target("avx2")))
+static inline __m256i maxScore4
+     (__m256i del, __m256i ins, __m256i mat, __m256i & used)
+
+     //  Vector scoreEdit and maxScore, returns the maximal score and sets
+     //      used to the edit it came from
+
+{
+  __m256i gdi = _mm256_cmpgt_epi64 (del, ins);
+  __m256i pdel = _mm256_and_si256 (gdi, _mm256_cmpgt_epi64 (del, mat));
+  __m256i pins = _mm256_andnot_si256 (gdi, _mm256_cmpgt_epi64 (ins, mat));
+
+  used = _mm256_blendv_epi8 (_mm256_set1_epi64x (MATCH),
+			     _mm256_set1_epi64x (DELETE), pdel);
+  used = _mm256_blendv_epi8 (used, _mm256_set1_epi64x (INSERT), pins);
+
+  return _mm256_blendv_epi8 (_mm256_blendv_epi8 (mat, del, pdel), ins, pins);
+}
+
+
+
+
+__attribute__((target("avx2")))
+static long int scoreNodesAVX2
+     (Diagonal & Diag, const Diagonal & PDiag, const Diagonal & PPDiag,
+      long int First, long int Last, long int PDi, long int PPDi,
+      const long int * Match)
+
+     //  As scoreNodes, but all the parents of nodes [First...Last) must be
+     //      within bounds. Scores 4 nodes at a time and returns the first
+     //      node left unscored.
+
+{
+  const __m256i none = _mm256_set1_epi64x (NONE);
+  const __m256i open = _mm256_set1_epi64x (OPEN_GAP_SCORE [_matrix_type]);
+  const __m256i cont = _mm256_set1_epi64x (CONT_GAP_SCORE [_matrix_type]);
+  __m256i del, ins, mat, used, v[3], gap[3];
+  long int Di, Pi, k;
+
+  for ( Di = First; Di + 4 <= Last; Di += 4 )
+    {
+      //-- Gap penalties of the DELETE and INSERT parents, none if unused
+      for ( Pi = PDi + Di, k = 0; k < 3; k ++ )
+	{
+	  gap[k] = _mm256_cmpeq_epi64 (loadEdits4 (PDiag . U[k] + Pi), none);
+	  v[k] = _mm256_loadu_si256 ((const __m256i *)(PDiag . V[k] + Pi));
+	}
+      del = _mm256_add_epi64 (v[DELETE], _mm256_andnot_si256 (gap[DELETE], cont));
+      ins = _mm256_add_epi64 (v[INSERT], _mm256_andnot_si256 (gap[INSERT], open));
+      mat = _mm256_add_epi64 (v[MATCH],  _mm256_andnot_si256 (gap[MATCH],  open));
+      _mm256_storeu_si256 ((__m256i *)(Diag . V[DELETE] + Di),
+			   maxScore4 (del, ins, mat, used));
+      storeEdits4 (Diag . U[DELETE] + Di, used);
+
+      for ( Pi = PDi + Di + 1, k = 0; k < 3; k ++ )
+	{
+	  gap[k] = _mm256_cmpeq_epi64 (loadEdits4 (PDiag . U[k] + Pi), none);
+	  v[k] = _mm256_loadu_si256 ((const __m256i *)(PDiag . V[k] + Pi));
+	}
+      del = _mm256_add_epi64 (v[DELETE], _mm256_andnot_si256 (gap[DELETE], open));
+      ins = _mm256_add_epi64 (v[INSERT], _mm256_andnot_si256 (gap[INSERT], cont));
+      mat = _mm256_add_epi64 (v[MATCH],  _mm256_andnot_si256 (gap[MATCH],  open));
+      _mm256_storeu_si256 ((__m256i *)(Diag . V[INSERT] + Di),
+			   maxScore4 (del, ins, mat, used));
+      storeEdits4 (Diag . U[INSERT] + Di, used);
+
+      //-- MATCH/MIS-MATCH from the grandparent
+      for ( Pi = PPDi + Di, k = 0; k < 3; k ++ )
+	v[k] = _mm256_loadu_si256 ((const __m256i *)(PPDiag . V[k] + Pi));
+      mat = _mm256_add_epi64
+	(maxScore4 (v[DELETE], v[INSERT], v[MATCH], used),
+	 _mm256_loadu_si256 ((const __m256i *)(Match + Di)));
+      _mm256_storeu_si256 ((__m256i *)(Diag . V[MATCH] + Di), mat);
+      storeEdits4 (Diag . U[MATCH] + Di, used);
+
+      //-- The edit with the maximum score of each node
+      maxScore4 (_mm256_loadu_si256 ((const __m256i *)(Diag . V[DELETE] + Di)),
+		 _mm256_loadu_si256 ((const __m256i *)(Diag . V[INSERT] + Di)),
+		 mat, used);
+      storeEdits4 (Diag . Max + Di, used);
+    }
+
+  return Di;
+}
+
+
+
+
+__attribute__((target("sse4.2")))
+static inline __m128i loadEdits2
+     (const char * U)
+
+     //  Widen the 2 edit chars at U to 64 bit lanes
+
+{
+  unsigned short w;
+  memcpy (&w, U, sizeof(w));
+  return _mm_cvtepi8_epi64 (_mm_cvtsi32_si128 (w));
+}
+
+
+
+
+__attribute__((target("sse4.2")))
+static inline void storeEdits2
+     (char * U, __m128i e)
+
+     //  Narrow 2 edit lanes to the chars at U
+
+{
+  const __m128i ctl = _mm_setr_epi8
+    (0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  unsigned short w = _mm_extract_epi16 (_mm_shuffle_epi8 (e, ctl), 0);
+  memcpy (U, &w, sizeof(w));
+}
+
+
+
+
+__attribute__((target("sse4.2")))
+static inline __m128i maxScore2
+     (__m128i del, __m128i ins, __m128i mat, __m128i & used)
+
+     //  Vector scoreEdit and maxScore, returns the maximal score and sets
+     //      used to the edit it came from
+
+{
+  __m128i gdi = _mm_cmpgt_epi64 (del, ins);
+  __m128i pdel = _mm_and_si128 (gdi, _mm_cmpgt_epi64 (del, mat));
+  __m128i pins = _mm_andnot_si128 (gdi, _mm_cmpgt_epi64 (ins, mat));
+
+  used = _mm_blendv_epi8 (_mm_set1_epi64x (MATCH),
+			  _mm_set1_epi64x (DELETE), pdel);
+  used = _mm_blendv_epi8 (used, _mm_set1_epi64x (INSERT), pins);
+
+  return _mm_blendv_epi8 (_mm_blendv_epi8 (mat, del, pdel), ins, pins);
+}
+
+
+
+
+__attribute__((target("sse4.2")))
+static long int scoreNodesSSE42
+     (Diagonal & Diag, const Diagonal & PDiag, const Diagonal & PPDiag,
+      long int First, long int Last, long int PDi, long int PPDi,
+      const long int * Match)
+
+     //  As scoreNodesAVX2, but scores 2 nodes at a time
+
+{
+  const __m128i none = _mm_set1_epi64x (NONE);
+  const __m128i open = _mm_set1_epi64x (OPEN_GAP_SCORE [_matrix_type]);
+  const __m128i cont = _mm_set1_epi64x (CONT_GAP_SCORE [_matrix_type]);
+  __m128i del, ins, mat, used, v[3], gap[3];
+  long int Di, Pi, k;
+
+  for ( Di = First; Di + 2 <= Last; Di += 2 )
+    {
+      //-- Gap penalties of the DELETE and INSERT parents, none if unused
+      for ( Pi = PDi + Di, k = 0; k < 3; k ++ )
+	{
+	  gap[k] = _mm_cmpeq_epi64 (loadEdits2 (PDiag . U[k] + Pi), none);
+	  v[k] = _mm_loadu_si128 ((const __m128i *)(PDiag . V[k] + Pi));
+	}
+      del = _mm_add_epi64 (v[DELETE], _mm_andnot_si128 (gap[DELETE], cont));
+      ins = _mm_add_epi64 (v[INSERT], _mm_andnot_si128 (gap[INSERT], open));
+      mat = _mm_add_epi64 (v[MATCH],  _mm_andnot_si128 (gap[MATCH],  open));
+      _mm_storeu_si128 ((__m128i *)(Diag . V[DELETE] + Di),
+			maxScore2 (del, ins, mat, used));
+      storeEdits2 (Diag . U[DELETE] + Di, used);
+
+      for ( Pi = PDi + Di + 1, k = 0; k < 3; k ++ )
+	{
+	  gap[k] = _mm_cmpeq_epi64 (loadEdits2 (PDiag . U[k] + Pi), none);
+	  v[k] = _mm_loadu_si128 ((const __m128i *)(PDiag . V[k] + Pi));
+	}
+      del = _mm_add_epi64 (v[DELETE], _mm_andnot_si128 (gap[DELETE], open));
+      ins = _mm_add_epi64 (v[INSERT], _mm_andnot_si128 (gap[INSERT], cont));
+      mat = _mm_add_epi64 (v[MATCH],  _mm_andnot_si128 (gap[MATCH],  open));
+      _mm_storeu_si128 ((__m128i *)(Diag . V[INSERT] + Di),
+			maxScore2 (del, ins, mat, used));
+      storeEdits2 (Diag . U[INSERT] + Di, used);
+
+      //-- MATCH/MIS-MATCH from the grandparent
+      for ( Pi = PPDi + Di, k = 0; k < 3; k ++ )
+	v[k] = _mm_loadu_si128 ((const __m128i *)(PPDiag . V[k] + Pi));
+      mat = _mm_add_epi64
+	(maxScore2 (v[DELETE], v[INSERT], v[MATCH], used),
+	 _mm_loadu_si128 ((const __m128i *)(Match + Di)));
+      _mm_storeu_si128 ((__m128i *)(Diag . V[MATCH] + Di), mat);
+      storeEdits2 (Diag . U[MATCH] + Di, used);
+
+      //-- The edit with the maximum score of each node
+      maxScore2 (_mm_loadu_si128 ((const __m128i *)(Diag . V[DELETE] + Di)),
+		 _mm_loadu_si128 ((const __m128i *)(Diag . V[INSERT] + Di)),
+		 mat, used);
+      storeEdits2 (Diag . Max + Di, used);
+    }
+
+  return Di;
+}
+#endif
@@ -69,6 +69,11 @@ static const long int MAX_SEARCH_LENGTH = 50000;
 //-- Maximum number of bases (in either sequence) that the alignTarget may go
 static const long int MAX_ALIGNMENT_LENGTH = 10000;
 
+//-- Node scoring kernels of the alignment engine, see setAlignKernel
+static const int SCALAR_KERNEL = 0;
+static const int SSE42_KERNEL = 1;
+static const int AVX2_KERNEL = 2;
+
 
 
 //------------------------------------------------------ Type Definitions ----//
@@ -78,22 +83,19 @@ struct Score
   char used;
 };
 
-struct Node
-{
-  Score S[3];
-  Score * max;
-};
-
 struct Diagonal
 {
   long int lbound, rbound;   // left(lower) and right(upper) bounds
-  Node * I;          // the matrix nodes
+  long int * V[3];   // the node score values, one array per edit
+  char * U[3];       // the edit each node score was derived from
+  char * Max;        // the edit holding the maximum score of each node
 };
 
 
 
 
 //--------------------------------------------------------------- Externs ----//
+extern int _align_kernel;
 extern int _break_len;
 extern int _matrix_type;
 
@@ -108,6 +110,10 @@ bool _alignEngine
       vector<long int> & Delta, unsigned int m_o);
 
 
+int _bestAlignKernel
+     ( );
+
+
 
 
 
@@ -280,6 +286,18 @@ inline bool alignTarget
 
 
 
+inline int getAlignKernel
+     ( )
+
+     //  Returns the current value of _align_kernel
+
+{
+  return _align_kernel;
+}
+
+
+
+
 inline int getBreakLen
      ( )
 
@@ -304,6 +322,25 @@ inline int getMatrixType
 
 
 
+inline void setAlignKernel
+     (const int Align_Kernel)
+
+     //  Resets the _align_kernel. The engine scores the nodes of each
+     //      diagonal with the best kernel the cpu supports by default,
+     //      all of the kernels produce identical alignments.
+
+{
+  if ( Align_Kernel < SCALAR_KERNEL  ||  Align_Kernel > _bestAlignKernel( ) )
+    fprintf (stderr,
+	     "WARNING: Unsupported align kernel %d, ignoring\n", Align_Kernel);
+  else
+    _align_kernel = Align_Kernel;
+  return;
+}
+
+
+
+
 inline void setBreakLen
      (const int Break_Len)
 
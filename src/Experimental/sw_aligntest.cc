@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+//         File: sw_aligntest.cc
+//
+//   Description: Regression test for the node scoring kernels of sw_align.
+//               Generates random pairs of related sequences and checks that
+//              every kernel the cpu supports returns the same alignments as
+//             the scalar kernel, for searches and targeted alignments in
+//            both directions and with all of the scoring matrices.
+//
+//        Usage: sw_aligntest [trials] [seed]
+//
+//------------------------------------------------------------------------------
+
+#include "sw_align.hh"
+
+
+static const char * ALPHABET [4] =
+  {"acgt", "ACDEFGHIKLMNPQRSTVWY", "ACDEFGHIKLMNPQRSTVWY",
+   "ACDEFGHIKLMNPQRSTVWY"};
+
+static const int MAX_LEN = 1500;
+
+
+struct Result
+{
+  bool rv;
+  long int Aend, Bend;
+  vector<long int> Delta;
+};
+
+
+
+
+static void mutate
+     (const char * S, long int Slen, char * T, long int & Tlen,
+      const char * Alpha, double Err)
+
+     //  Copies S [1...Slen] to T [1...] with substitutions, insertions and
+     //      deletions at a total rate of Err, and terminates T with '\0'
+
+{
+  long int Alen = strlen (Alpha);
+  long int i;
+
+  Tlen = 0;
+  for ( i = 1; i <= Slen; i ++ )
+    {
+      double r = drand48( );
+      if ( r < Err / 3 )
+	T [++ Tlen] = Alpha [lrand48( ) % Alen];
+      else if ( r < 2 * Err / 3 )
+	{
+	  T [++ Tlen] = Alpha [lrand48( ) % Alen];
+	  T [++ Tlen] = S [i];
+	}
+      else if ( r >= Err )
+	T [++ Tlen] = S [i];
+    }
+  if ( Tlen == 0 )
+    T [++ Tlen] = S [1];
+  T [Tlen + 1] = '\0';
+}
+
+
+
+
+static void runKernel
+     (int Kernel, const char * A, long int Astart, long int Aend,
+      const char * B, long int Bstart, long int Bend,
+      unsigned int m_o, Result & R)
+
+     //  Aligns A and B with Kernel and stores the result in R
+
+{
+  setAlignKernel (Kernel);
+  R . Aend = Aend;
+  R . Bend = Bend;
+  R . Delta . clear( );
+  if ( m_o & SEARCH_BIT )
+    R . rv = alignSearch (A, Astart, R . Aend, B, Bstart, R . Bend, m_o);
+  else
+    R . rv = alignTarget (A, Astart, R . Aend, B, Bstart, R . Bend,
+			  R . Delta, m_o);
+}
+
+
+
+
+int main
+     (int argc, char * argv [])
+
+{
+  static const unsigned int MODES [] =
+    {FORWARD_ALIGN, OPTIMAL_FORWARD_ALIGN, FORCED_FORWARD_ALIGN,
+     FORWARD_SEARCH, OPTIMAL_FORWARD_SEARCH, FORCED_FORWARD_SEARCH,
+     BACKWARD_SEARCH, OPTIMAL_BACKWARD_SEARCH, FORCED_BACKWARD_SEARCH};
+  static const int NMODES = sizeof (MODES) / sizeof (MODES [0]);
+
+  long int Trials = argc > 1 ? atol (argv [1]) : 200;
+  long int Seed = argc > 2 ? atol (argv [2]) : time (NULL);
+  int Best = _bestAlignKernel( );
+  long int Checked = 0, Failed = 0;
+
+  char * A = (char *) Safe_malloc ( 2 * MAX_LEN + 2 );
+  char * B = (char *) Safe_malloc ( 2 * MAX_LEN + 2 );
+  long int Alen, Blen;
+
+  fprintf (stderr, "seed %ld, best kernel %d\n", Seed, Best);
+  srand48 (Seed);
+
+  for ( long int t = 0; t < Trials; t ++ )
+    {
+      int Matrix = lrand48( ) % 4;
+      const char * Alpha = ALPHABET [Matrix];
+      long int Alphalen = strlen (Alpha);
+
+      setMatrixType (Matrix);
+      setBreakLen (1 + lrand48( ) % 250);
+
+      //-- A random sequence and a noisy copy, ambiguous bases now and then
+      Alen = 2 + lrand48( ) % (MAX_LEN - 1);
+      A [0] = '\0';
+      for ( long int i = 1; i <= Alen; i ++ )
+	A [i] = lrand48( ) % 50 ? Alpha [lrand48( ) % Alphalen] : 'n';
+      A [Alen + 1] = '\0';
+      mutate (A, Alen, B, Blen, Alpha, drand48( ) * 0.4);
+      if ( Blen < 2 )
+	continue;
+
+      for ( int m = 0; m < NMODES; m ++ )
+	{
+	  unsigned int m_o = MODES [m];
+	  long int Astart, Aend, Bstart, Bend;
+	  long int Amax = m_o & SEARCH_BIT ? MAX_SEARCH_LENGTH
+	    : MAX_ALIGNMENT_LENGTH;
+
+	  if ( m_o & DIRECTION_BIT )
+	    {
+	      Astart = 1 + lrand48( ) % (Alen / 4 + 1);
+	      Bstart = 1 + lrand48( ) % (Blen / 4 + 1);
+	      Aend = Alen - lrand48( ) % (Alen / 4 + 1);
+	      Bend = Blen - lrand48( ) % (Blen / 4 + 1);
+	      if ( Aend <= Astart  ||  Bend <= Bstart )
+		continue;
+	    }
+	  else
+	    {
+	      Astart = Alen - lrand48( ) % (Alen / 4 + 1);
+	      Bstart = Blen - lrand48( ) % (Blen / 4 + 1);
+	      Aend = 1 + lrand48( ) % (Alen / 4 + 1);
+	      Bend = 1 + lrand48( ) % (Blen / 4 + 1);
+	      if ( Astart <= Aend  ||  Bstart <= Bend )
+		continue;
+	    }
+	  if ( labs (Aend - Astart) >= Amax  ||  labs (Bend - Bstart) >= Amax )
+	    continue;
+
+	  Result Scalar, Vector;
+	  runKernel (SCALAR_KERNEL, A, Astart, Aend, B, Bstart, Bend,
+		     m_o, Scalar);
+
+	  for ( int k = SCALAR_KERNEL + 1; k <= Best; k ++ )
+	    {
+	      runKernel (k, A, Astart, Aend, B, Bstart, Bend, m_o, Vector);
+	      Checked ++;
+
+	      if ( Vector . rv != Scalar . rv  ||
+		   Vector . Aend != Scalar . Aend  ||
+		   Vector . Bend != Scalar . Bend  ||
+		   Vector . Delta != Scalar . Delta )
+		{
+		  fprintf (stderr, "MISMATCH: trial %ld, kernel %d, m_o 0x%x, "
+			   "matrix %d, A %ld..%ld, B %ld..%ld: "
+			   "scalar %d %ld %ld, kernel %d %ld %ld\n",
+			   t, k, m_o, Matrix, Astart, Aend, Bstart, Bend,
+			   Scalar . rv, Scalar . Aend, Scalar . Bend,
+			   Vector . rv, Vector . Aend, Vector . Bend);
+		  Failed ++;
+		}
+	    }
+	}
+    }
+
+  free (A);
+  free (B);
+
+  printf ("%ld alignments compared, %ld mismatches\n", Checked, Failed);
+  if ( Best == SCALAR_KERNEL )
+    printf ("No vector kernel supported, nothing to compare\n");
+
+  return Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -15,12 +15,16 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 
 #define MAX_STRING 256         // length of various char*s in file
+#define SAMPLE_USEC 100000     // how often running jobs are sampled
 
 
 using namespace std;
@@ -32,8 +36,62 @@ ofstream logFile;
 string logFileName;
 string confFile;
 time_t allstart; // when program started
+double allwall;  // same, with sub-second precision
 
 bool ECHOMODE = 0;
+bool INJOB = 0;    // set in the forked process running a single job
+bool INCREMENTAL = 0; // skip steps whose files and commands are unchanged
+size_t MAXJOBS = 1;   // jobs allowed to run at once (-j)
+
+typedef unsigned long long hash_t;
+const hash_t HASH_INIT = 14695981039346656037ULL;
+
+// content hash of a file, kept for as long as its size and mtime stay put
+struct FileSig {
+  string stamp;
+  hash_t hash;
+};
+
+map<string, FileSig> hashCache; // file hashes, by path
+map<int, string> manifest;       // step signatures from the last runs
+
+enum {STEP_WAIT, STEP_RUN, STEP_SPLIT, STEP_PARTS, STEP_MERGE, STEP_DONE};
+
+// A numbered step from the config file and its scheduling state
+struct Step {
+  int num;                  // step number
+  string message;           // ## message shown when the step starts
+  vector<string> commands;  // commands, run in order by a single job
+  bool afterSet;            // waits only for the steps in after
+  set<int> after;           // steps listed by AFTER
+  int fanout;               // partitions requested by FANOUT, 0 if none
+  vector<string> reads;     // files and banks listed by READS
+  vector<string> writes;    // files and banks listed by WRITES
+  string commandSig;        // hash of the commands and the tools they run
+  bool skipped;             // up to date, not run
+  string fanBank;           // bank to partition
+  string fanMerged;         // bank the partitions are combined into
+  int state;                // STEP_*
+  int launched;             // jobs launched in the current state
+  int running;              // jobs still running
+  int numParts;             // partitions found after the split
+  time_t start;
+  double wallStart;         // for the report, in seconds
+  double wall;
+  struct rusage usage;      // summed over the jobs of the step
+  int threads;              // peak threads seen across the step's processes
+  bool failed;
+};
+
+// A forked job, with the file collecting its log until it exits
+struct Job {
+  int step;                 // index in steps
+  int part;                 // partition number, 0 if none
+  string log;
+};
+
+vector<Step> steps;         // steps that will be executed
+map<pid_t, Job> jobs;       // jobs currently running
 
 
 string elapsed(time_t time) 
@@ -59,15 +117,28 @@ string elapsed(time_t time)
 } // elapsed
 
 
+void writeReport(int status);
+
 void finish(int status)
 {
-  if (logFile.is_open())
+  if (! INJOB && ! steps.empty())
+    writeReport(status);
+
+  if (logFile.is_open() && ! INJOB)
     logFile << "!!! END - Elapsed time: " << elapsed(time(NULL) - allstart) << endl;
 
   exit(status);
 } // finish
 
 
+double wallTime()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+} // wallTime
+
+
 string timeStr()
 {
   char tm[MAX_STRING+1];
@@ -255,13 +326,19 @@ void printHelpText()
     "\n"
     "USAGE:\n"
     "\n"
-    "runAmos -C config_file [-D VAR=value] [-s start] [-e end] [-clean] [-ocd] prefix\n"
+    "runAmos -C config_file [-D VAR=value] [-s start] [-e end] [-j jobs] [-incremental] [-clean] [-ocd] prefix\n"
     "\n"
     "if the config file is not specified we use environment variable AMOSCONF\n"
     "if a start step is specified (-s) starts with that command\n"
     "if an end step is specified (-e) ends with the command prior to the number\n"
     "if -E is specified, echo the commands to run, but don't actually run\n"
+    "if -j is specified, up to that many independent steps or partitions run\n"
+    "   at the same time\n"
+    "if -incremental is specified, steps whose READS and WRITES files and\n"
+    "   commands are unchanged since they last ran are skipped\n"
     "if -clean is specified, all files listed in the TEMPS var get removed\n"
+    "a report of the time, memory and I/O used by each step is written to\n"
+    "   prefix.runAmos.json and prefix.runAmos.tsv\n"
     "if -ocd is specified checks that all files in the INPUTS variable exist\n"
     "-D option allows variables to be defined outside of the conf file.\n"
     "   multiple such options are allowed\n"
@@ -282,6 +359,21 @@ void printHelpText()
     "2:\n"
     "$(PERL) $(PREFIX)-1.pl\n"
     "$(PERL) $(PREFIX)-2.pl\n"
+    ".\n"
+    "\n"
+    "By default a step waits for all the steps before it. A line\n"
+    "AFTER <step> ... makes the next step wait only for the listed steps, and\n"
+    "FANOUT <N> <bank> [<merged bank>] splits the bank with partitionBank, runs\n"
+    "the next step once per partition with $(PART) set to the partition bank,\n"
+    "then combines the partitions with bank-combine (default <bank>_merged.bnk)\n"
+    "\n"
+    "AFTER 1\n"
+    "3: $(PERL) $(PREFIX)-3.pl\n"
+    "FANOUT 4 $(PREFIX).bnk\n"
+    "4: make-consensus -B -b $(PART)\n"
+    "READS $(PREFIX).bnk\n"
+    "WRITES $(PREFIX).fasta\n"
+    "5: bank2fasta -b $(PREFIX).bnk > $(PREFIX).fasta\n"
        << endl;
 } // printHelpText
 
@@ -302,6 +394,9 @@ bool GetOptions(int argc, char ** argv)
     {"ocd",   0, 0, 'o'},
     {"D",     1, 0, 'D'},
     {"E",     0, 0, 'E'},
+    {"j",     1, 0, 'j'},
+    {"jobs",  1, 0, 'j'},
+    {"incremental", 0, 0, 'i'},
     {0, 0, 0, 0}
   };
 
@@ -336,6 +431,15 @@ bool GetOptions(int argc, char ** argv)
     case 'E':
       ECHOMODE = 1;
       break;
+    case 'i':
+      INCREMENTAL = 1;
+      break;
+    case 'j':
+      {
+	long n = strtol(optarg, NULL, 10);
+	MAXJOBS = (n < 1) ? 1 : n;
+      }
+      break;
     case '?':
       return false;
     }
@@ -459,8 +563,6 @@ string doCommandStr(string command)
 
 void doCommand(string command)
 {
-  command = substVars(command);
-
   logFile << timeStr() << "Running: " << command << endl;
 
   if (ECHOMODE) { return; }
@@ -542,6 +644,709 @@ void doCommand(string command)
 } // doCommand
 
 
+// name of the bank partitionBank writes for partition part
+string partName(const string & bank, int part)
+{
+  ostringstream out;
+  out << bank << "_partition" << part << ".bnk";
+  return out.str();
+} // partName
+
+
+// shell command removing every partition of bank, from this run or an
+// earlier one, since partitionBank will not write over them
+string removeParts(const string & bank)
+{
+  return "rm -rf " + bank + "_partition[0-9]*.bnk";
+} // removeParts
+
+
+// AMOS programs are taken from BINDIR when the config file sets it
+string toolPath(const string & tool)
+{
+  if (variables.find("BINDIR") != variables.end())
+    return variables["BINDIR"] + "/" + tool;
+  return tool;
+} // toolPath
+
+
+string replaceAll(string in, const string & from, const string & to)
+{
+  string::size_type pos = 0;
+  while ((pos = in.find(from, pos)) != in.npos){
+    in.replace(pos, from.length(), to);
+    pos += to.length();
+  }
+  return in;
+} // replaceAll
+
+
+// base name of the log, for the files written next to it
+string logBase()
+{
+  string base = logFileName;
+  if (base.size() > 4 && base.substr(base.size() - 4) == ".log")
+    base = base.substr(0, base.size() - 4);
+  return base;
+} // logBase
+
+
+hash_t hashBytes(const char * buf, size_t n, hash_t h)
+{
+  // FNV-1a, enough to notice that a file or command changed
+  for (size_t i = 0; i < n; i++){
+    h ^= (unsigned char) buf[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+} // hashBytes
+
+
+hash_t hashStr(const string & str, hash_t h)
+{
+  return hashBytes(str.c_str(), str.length() + 1, h);
+} // hashStr
+
+
+hash_t hashHash(hash_t from, hash_t h)
+{
+  return hashBytes((const char *) &from, sizeof(from), h);
+} // hashHash
+
+
+string hexStr(hash_t h)
+{
+  char buf[MAX_STRING+1];
+  snprintf(buf, MAX_STRING, "%016llx", h);
+  return string(buf);
+} // hexStr
+
+
+// content hash of a file, or of everything under a directory such as a bank
+hash_t hashPath(const string & path)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return hashStr("missing", HASH_INIT);
+
+  if (S_ISDIR(st.st_mode)){
+    DIR * dir = opendir(path.c_str());
+    set<string> names;  // readdir order is arbitrary
+    struct dirent * ent;
+    if (dir != NULL){
+      while ((ent = readdir(dir)) != NULL)
+	if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+	  names.insert(ent->d_name);
+      closedir(dir);
+    }
+
+    hash_t h = hashStr("directory", HASH_INIT);
+    for (set<string>::iterator n = names.begin(); n != names.end(); n++)
+      h = hashHash(hashPath(path + "/" + *n), hashStr(*n, h));
+    return h;
+  }
+
+  // only rehash files that were touched since they were last hashed
+  ostringstream stamp;
+  stamp << st.st_size << " " << st.st_mtime;
+#ifdef _STATBUF_ST_NSEC
+  stamp << "." << st.st_mtim.tv_nsec;
+#endif
+  map<string, FileSig>::iterator f = hashCache.find(path);
+  if (f != hashCache.end() && f->second.stamp == stamp.str())
+    return f->second.hash;
+
+  hash_t h = HASH_INIT;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return hashStr("unreadable", HASH_INIT);
+  char buf[65536];
+  int nread;
+  while ((nread = read(fd, buf, sizeof(buf))) > 0)
+    h = hashBytes(buf, nread, h);
+  close(fd);
+
+  FileSig sig;
+  sig.stamp = stamp.str();
+  sig.hash = h;
+  hashCache[path] = sig;
+  return h;
+} // hashPath
+
+
+// the binary a command runs, found like the shell would, "" for builtins
+string toolOf(const string & command)
+{
+  istringstream in(command);
+  string tool;
+  in >> tool;
+  if (tool.empty() || tool.find('/') != tool.npos)
+    return tool;
+
+  char * path = getenv("PATH");
+  istringstream dirs(path == NULL ? "" : path);
+  string dir;
+  while (getline(dirs, dir, ':'))
+    if (access((dir + "/" + tool).c_str(), X_OK) == 0)
+      return dir + "/" + tool;
+
+  return "";
+} // toolOf
+
+
+// signature of what a step runs: its commands and the tools behind them
+string commandSig(const Step & st)
+{
+  hash_t h = HASH_INIT;
+  for (size_t c = 0; c < st.commands.size(); c++){
+    h = hashStr(st.commands[c], h);
+    string tool = toolOf(st.commands[c]);
+    if (! tool.empty())
+      h = hashHash(hashPath(tool), h);
+  }
+
+  ostringstream fan;
+  fan << st.fanout << " " << st.fanBank << " " << st.fanMerged;
+  return hexStr(hashStr(fan.str(), h));
+} // commandSig
+
+
+// signature of the current contents of the files a step declares
+string fileSig(const Step & st)
+{
+  hash_t h = HASH_INIT;
+  for (size_t r = 0; r < st.reads.size(); r++)
+    h = hashHash(hashPath(st.reads[r]), hashStr("<" + st.reads[r], h));
+  for (size_t w = 0; w < st.writes.size(); w++)
+    h = hashHash(hashPath(st.writes[w]), hashStr(">" + st.writes[w], h));
+  return hexStr(h);
+} // fileSig
+
+
+bool isTracked(const Step & st)
+{
+  return INCREMENTAL && ! (st.reads.empty() && st.writes.empty());
+} // isTracked
+
+
+// true if the step ran before with the same commands and left its files
+// just as they are now
+bool isUpToDate(const Step & st)
+{
+  map<int, string>::iterator m = manifest.find(st.num);
+  if (m == manifest.end() || m->second != st.commandSig + " " + fileSig(st))
+    return false;
+
+  for (size_t w = 0; w < st.writes.size(); w++)
+    if (access(st.writes[w].c_str(), F_OK) != 0)
+      return false;
+
+  return true;
+} // isUpToDate
+
+
+void readManifest()
+{
+  ifstream in((logBase() + ".manifest").c_str());
+  string line;
+  while (getline(in, line)){
+    istringstream fields(line);
+    string type;
+    fields >> type;
+    if (type == "S"){  // step number, command and file signatures
+      int step;
+      string cmd, files;
+      if (fields >> step >> cmd >> files)
+	manifest[step] = cmd + " " + files;
+    } else if (type == "F"){ // stamp (size and mtime), hash, path
+      string size, mtime, path;
+      FileSig sig;
+      if (fields >> size >> mtime >> hex >> sig.hash && getline(fields, path)){
+	sig.stamp = size + " " + mtime;
+	hashCache[path.substr(1)] = sig;
+      }
+    }
+  }
+} // readManifest
+
+
+void writeManifest()
+{
+  if (ECHOMODE)
+    return;
+
+  string name = logBase() + ".manifest";
+  ofstream out((name + ".tmp").c_str());
+  for (map<int, string>::iterator m = manifest.begin(); 
+       m != manifest.end(); m++)
+    out << "S " << m->first << " " << m->second << endl;
+  for (map<string, FileSig>::iterator f = hashCache.begin(); 
+       f != hashCache.end(); f++)
+    out << "F " << f->second.stamp << " " << hexStr(f->second.hash)
+	<< " " << f->first << endl;
+  out.close();
+
+  if (out.fail() || rename((name + ".tmp").c_str(), name.c_str()) != 0)
+    logFile << timeStr() << "Cannot write manifest " << name << endl;
+} // writeManifest
+
+
+// remembers the step as having left its files the way they are now
+void recordStep(const Step & st)
+{
+  if (isTracked(st))
+    manifest[st.num] = st.commandSig + " " + fileSig(st);
+} // recordStep
+
+
+// forks a job running the commands in order, its output going to its own log
+void launchJob(int s, int part, const vector<string> & commands)
+{
+  Job job;
+  ostringstream log;
+  log << logFileName << "." << steps[s].num;
+  if (part > 0)
+    log << "." << part;
+  job.step = s;
+  job.part = part;
+  job.log = log.str();
+
+  cout.flush();
+  pid_t process = fork();
+
+  if (process == -1){
+    logFile << timeStr() << "Could not fork!" << endl;
+    finish(1);
+  }
+
+  if (process == 0){ // child
+    INJOB = 1;
+    logFile.close();
+    logFile.open(job.log.c_str(), ios::out | ios::trunc);
+    if (! logFile.is_open()){
+      cerr << "Cannot open logfile " << job.log << endl;
+      finish(1);
+    }
+    logFile.setf(ios::unitbuf);
+
+    ostringstream num;
+    num << part;
+    for (size_t c = 0; c < commands.size(); c++){
+      string command = commands[c];
+      if (part > 0){
+	command = replaceAll(command, "$(PART)",
+			     partName(steps[s].fanBank, part));
+	command = replaceAll(command, "$(PARTNUM)", num.str());
+      }
+      doCommand(command);
+    }
+
+    finish(0);
+  }
+
+  jobs[process] = job;
+  steps[s].launched++;
+  steps[s].running++;
+} // launchJob
+
+
+// true once every step that step s waits for is done
+bool isReady(int s)
+{
+  for (int t = 0; t < s; t++)
+    if (steps[t].state != STEP_DONE &&
+	(! steps[s].afterSet ||
+	 steps[s].after.find(steps[t].num) != steps[s].after.end()))
+      return false;
+
+  return true;
+} // isReady
+
+
+// starts whatever jobs of step s can run now
+void launchStep(int s)
+{
+  Step & st = steps[s];
+
+  if (st.state == STEP_WAIT){
+    if (! isReady(s))
+      return;
+
+    ostringstream msg;
+    msg << "step " << st.num;
+    if (st.message.length() != 0)
+      msg << ": " << st.message;
+
+    if (isTracked(st)){
+      st.commandSig = commandSig(st);
+      if (isUpToDate(st)){
+	cout << "Skipping " << msg.str() << " (up to date)" << endl;
+	logFile << timeStr() << "Skipping " << msg.str() << " (up to date)" 
+		<< endl;
+	st.skipped = true;
+	st.state = STEP_DONE;
+	return;
+      }
+    }
+
+    cout << "Doing " << msg.str() << endl;
+    logFile << timeStr() << "Doing " << msg.str() << endl;
+
+    st.start = time(NULL);
+    st.wallStart = wallTime();
+    st.state = (st.fanout > 0) ? STEP_SPLIT : STEP_RUN;
+    st.launched = 0;
+  }
+
+  if (jobs.size() >= MAXJOBS)
+    return;
+
+  vector<string> commands;
+  switch (st.state){
+  case STEP_RUN:
+    if (st.launched == 0)
+      launchJob(s, 0, st.commands);
+    break;
+  case STEP_SPLIT:
+    if (st.launched == 0){
+      ostringstream cmd;
+      cmd << toolPath("partitionBank") << " -b " << st.fanBank
+	  << " -partitions " << st.fanout;
+      commands.push_back(removeParts(st.fanBank));
+      commands.push_back(cmd.str());
+      launchJob(s, 0, commands);
+    }
+    break;
+  case STEP_PARTS:
+    while (st.launched < st.numParts && jobs.size() < MAXJOBS)
+      launchJob(s, st.launched + 1, st.commands);
+    break;
+  case STEP_MERGE:
+    if (st.launched == 0){
+      ostringstream cmd;
+      cmd << toolPath("bank-combine") << " " << st.fanMerged;
+      for (int p = 1; p <= st.numParts; p++)
+	cmd << " " << partName(st.fanBank, p);
+      commands.push_back(cmd.str());
+      commands.push_back(removeParts(st.fanBank));
+      launchJob(s, 0, commands);
+    }
+    break;
+  }
+} // launchStep
+
+
+// moves step s on once all the jobs of its current state have finished
+void advanceStep(int s)
+{
+  Step & st = steps[s];
+
+  if (st.running > 0 ||
+      (st.state == STEP_PARTS && st.launched < st.numParts))
+    return;
+
+  st.launched = 0;
+  switch (st.state){
+  case STEP_SPLIT:
+    // partitionBank stops early when there are fewer layouts than partitions
+    st.numParts = 0;
+    while (st.numParts < st.fanout &&
+	   (ECHOMODE ||
+	    access(partName(st.fanBank, st.numParts + 1).c_str(), F_OK) == 0))
+      st.numParts++;
+    if (st.numParts == 0){
+      logFile << timeStr() << "No partitions of " << st.fanBank
+	      << " found for step " << st.num << endl;
+      cerr << "No partitions of " << st.fanBank
+	   << " found for step " << st.num << endl;
+      finish(1);
+    }
+    st.state = STEP_PARTS;
+    return;
+  case STEP_PARTS:
+    st.state = STEP_MERGE;
+    return;
+  default:
+    st.state = STEP_DONE;
+    st.wall = wallTime() - st.wallStart;
+    logFile << timeStr() << "Done step " << st.num << "! Elapsed time:" 
+	    << elapsed(time(NULL) - st.start) << endl;
+    if (isTracked(st) && ! ECHOMODE){
+      recordStep(st);
+      writeManifest();
+    }
+  }
+} // advanceStep
+
+
+// adds the resources used by a finished job to its step
+void addUsage(Step & st, const struct rusage & ru)
+{
+  struct rusage & u = st.usage;
+
+  timeradd(&u.ru_utime, &ru.ru_utime, &u.ru_utime);
+  timeradd(&u.ru_stime, &ru.ru_stime, &u.ru_stime);
+  if (ru.ru_maxrss > u.ru_maxrss)
+    u.ru_maxrss = ru.ru_maxrss;
+  u.ru_inblock += ru.ru_inblock;
+  u.ru_oublock += ru.ru_oublock;
+  u.ru_nvcsw += ru.ru_nvcsw;
+  u.ru_nivcsw += ru.ru_nivcsw;
+} // addUsage
+
+
+// counts the threads of the processes under each running job, keeping the
+// peak per step; rusage has no such figure so /proc is sampled instead
+void sampleThreads()
+{
+  DIR * proc = opendir("/proc");
+  if (proc == NULL)
+    return;
+
+  map<pid_t, pid_t> parent;
+  map<pid_t, int> threads;
+  struct dirent * ent;
+  char path[MAX_STRING+1];
+  char buf[1024];
+
+  while ((ent = readdir(proc)) != NULL){
+    pid_t pid = strtol(ent->d_name, NULL, 10);
+    if (pid <= 0)
+      continue;
+
+    snprintf(path, MAX_STRING, "/proc/%d/stat", (int) pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      continue;
+    int nread = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (nread <= 0)
+      continue;
+    buf[nread] = 0;
+
+    // the fields after the command name: state ppid ... num_threads (20th)
+    char * rest = strrchr(buf, ')');
+    int ppid, nthreads;
+    if (rest == NULL ||
+	sscanf(rest + 1, " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u"
+	       " %*u %*u %*d %*d %*d %*d %d", &ppid, &nthreads) != 2)
+      continue;
+    parent[pid] = ppid;
+    threads[pid] = nthreads;
+  }
+  closedir(proc);
+
+  map<int, int> stepThreads;
+  for (map<pid_t, int>::iterator t = threads.begin(); t != threads.end(); t++){
+    pid_t p = t->first;
+    for (int depth = 0; p > 1 && depth < MAX_STRING; depth++){
+      map<pid_t, Job>::iterator j = jobs.find(p);
+      if (j != jobs.end()){
+	stepThreads[j->second.step] += t->second;
+	break;
+      }
+      map<pid_t, pid_t>::iterator up = parent.find(p);
+      if (up == parent.end())
+	break;
+      p = up->second;
+    }
+  }
+
+  for (map<int, int>::iterator t = stepThreads.begin(); 
+       t != stepThreads.end(); t++)
+    if (t->second > steps[t->first].threads)
+      steps[t->first].threads = t->second;
+} // sampleThreads
+
+
+// runs the queued steps, as many jobs at once as allowed, until all are done
+void runSteps()
+{
+  bool failed = false;
+
+  while (true){
+    if (! failed)
+      for (size_t s = 0; s < steps.size() && jobs.size() < MAXJOBS; s++)
+	launchStep(s);
+
+    if (jobs.empty())
+      break;
+
+    int status;
+    struct rusage ru;
+    pid_t process;
+    useconds_t pause = 1000;  // short jobs should not wait a whole sample
+    while ((process = wait4(-1, & status, WNOHANG, & ru)) == 0){
+      sampleThreads();
+      usleep(pause);
+      if (pause < SAMPLE_USEC)
+	pause *= 2;
+    }
+    if (process == -1){
+      logFile << timeStr() << "Could not wait for jobs" << endl;
+      finish(1);
+    }
+
+    map<pid_t, Job>::iterator j = jobs.find(process);
+    if (j == jobs.end())
+      continue;
+    Job job = j->second;
+    jobs.erase(j);
+
+    // append the output of the job in one piece
+    ifstream jobLog(job.log.c_str());
+    if (jobLog.is_open() && jobLog.peek() != EOF)
+      logFile << jobLog.rdbuf();
+    jobLog.close();
+    unlink(job.log.c_str());
+
+    steps[job.step].running--;
+    addUsage(steps[job.step], ru);
+    if (WIFEXITED(status) == 0 || WEXITSTATUS(status) != 0){
+      // the job reported the failure, let the others finish
+      steps[job.step].failed = true;
+      steps[job.step].wall = wallTime() - steps[job.step].wallStart;
+      failed = true;
+      continue;
+    }
+    advanceStep(job.step);
+  }
+
+  if (failed)
+    finish(1);
+} // runSteps
+
+
+// substitutes the variables of a command of the step being read, as the
+// commands of runAmos have always been, and adds it to the step. A FANOUT
+// step keeps $(PART) and $(PARTNUM) until it runs each partition.
+void addCommand(const string & command)
+{
+  if (command.find("$(shell") != command.npos){
+    // the shell command may need the output of the steps before this one,
+    // which must not start with only part of its commands
+    Step st = steps.back();
+    steps.pop_back();
+    runSteps();
+    steps.push_back(st);
+  }
+
+  Step & st = steps.back();
+  string cmd = command;
+  if (st.fanout > 0){
+    variables["PART"] = "$(PART)";
+    variables["PARTNUM"] = "$(PARTNUM)";
+    cmd = substVars(cmd);
+    variables.erase("PART");
+    variables.erase("PARTNUM");
+  } else
+    cmd = substVars(cmd);
+  st.commands.push_back(cmd);
+} // addCommand
+
+
+// true if line is the directive name, alone or followed by blanks
+bool isDirective(const string & line, const string & name)
+{
+  return line.compare(0, name.length(), name) == 0 &&
+    (line.length() == name.length() || isspace(line[name.length()]));
+} // isDirective
+
+
+string jsonStr(const string & in)
+{
+  string out = "\"";
+  for (size_t i = 0; i < in.length(); i++){
+    if (in[i] == '"' || in[i] == '\\')
+      out += '\\';
+    if ((unsigned char) in[i] < ' ')
+      out += ' ';
+    else
+      out += in[i];
+  }
+  return out + "\"";
+} // jsonStr
+
+
+string stepStatus(const Step & st)
+{
+  if (st.failed)
+    return "failed";
+  if (st.skipped)
+    return "skipped";
+  if (st.state == STEP_DONE)
+    return "done";
+  if (st.state == STEP_WAIT)
+    return "not run";
+  return "incomplete";
+} // stepStatus
+
+
+// writes <log prefix>.json and .tsv with the resources used by each step
+void writeReport(int status)
+{
+  string base = logBase();
+
+  char started[MAX_STRING+1];
+  strftime(started, MAX_STRING, "%F %T", localtime(&allstart));
+
+  ofstream json((base + ".json").c_str());
+  ofstream tsv((base + ".tsv").c_str());
+  if (! json.is_open() || ! tsv.is_open()){
+    logFile << timeStr() << "Cannot write report " << base << ".json/.tsv" 
+	    << endl;
+    return;
+  }
+  json.setf(ios::fixed);
+  json.precision(3);
+  tsv.setf(ios::fixed);
+  tsv.precision(3);
+
+  json << "{\n"
+       << "  \"config\": " << jsonStr(confFile) << ",\n"
+       << "  \"prefix\": " << jsonStr(variables["PREFIX"]) << ",\n"
+       << "  \"started\": " << jsonStr(started) << ",\n"
+       << "  \"jobs\": " << MAXJOBS << ",\n"
+       << "  \"status\": " << status << ",\n"
+       << "  \"wall\": " << wallTime() - allwall << ",\n"
+       << "  \"steps\": [";
+  tsv << "step\tstatus\twall\tuser\tsys\tmaxrss_kb\tinblock\toublock"
+      << "\tnvcsw\tnivcsw\tthreads\tmessage\n";
+
+  for (size_t s = 0; s < steps.size(); s++){
+    const Step & st = steps[s];
+    const struct rusage & u = st.usage;
+    double user = u.ru_utime.tv_sec + u.ru_utime.tv_usec / 1e6;
+    double sys = u.ru_stime.tv_sec + u.ru_stime.tv_usec / 1e6;
+
+    json << (s == 0 ? "\n" : ",\n")
+	 << "    {\"step\": " << st.num
+	 << ", \"message\": " << jsonStr(st.message)
+	 << ", \"status\": " << jsonStr(stepStatus(st))
+	 << ", \"wall\": " << st.wall
+	 << ", \"user\": " << user
+	 << ", \"sys\": " << sys
+	 << ", \"maxrss_kb\": " << u.ru_maxrss
+	 << ", \"inblock\": " << u.ru_inblock
+	 << ", \"oublock\": " << u.ru_oublock
+	 << ", \"nvcsw\": " << u.ru_nvcsw
+	 << ", \"nivcsw\": " << u.ru_nivcsw
+	 << ", \"threads\": " << st.threads << "}";
+
+    string message = st.message;
+    for (size_t i = 0; i < message.length(); i++)
+      if (message[i] == '\t')
+	message[i] = ' ';
+    tsv << st.num << "\t" << stepStatus(st) << "\t" << st.wall
+	<< "\t" << user << "\t" << sys << "\t" << u.ru_maxrss
+	<< "\t" << u.ru_inblock << "\t" << u.ru_oublock
+	<< "\t" << u.ru_nvcsw << "\t" << u.ru_nivcsw
+	<< "\t" << st.threads << "\t" << message << "\n";
+  }
+  json << "\n  ]\n}\n";
+} // writeReport
+
+
 
 //--------------------------------------------------------
 int main(int argc, char ** argv)
@@ -567,9 +1372,6 @@ int main(int argc, char ** argv)
     confFile = globals["conffile"];
 
 
-  vector<pair<string, int> > steps; //steps that will be executed
-  vector<string> commands; // commands that will be executed
-
   ifstream conf(confFile.c_str());
   if (! conf.is_open()){
     cerr << "Could not open config file " << confFile << endl;
@@ -593,6 +1395,9 @@ int main(int argc, char ** argv)
 
   logFile.setf(ios::unitbuf);  // make sure buffer flushes on endls
 
+  if (INCREMENTAL)
+    readManifest();
+
   if (globals.find("start") != globals.end() &&
       globals.find("end") != globals.end()){
 
@@ -612,10 +1417,15 @@ int main(int argc, char ** argv)
   int currstep = -1;
   int step;
   int noscan;// where scanf stops
-  time_t start;
   bool noop = false;
+  bool afterSet = false;   // AFTER seen for the next step
+  set<int> after;
+  int fanout = 0;          // FANOUT seen for the next step
+  string fanBank, fanMerged;
+  vector<string> reads, writes; // READS and WRITES seen for the next step
 
   allstart = time(NULL);
+  allwall = wallTime();
 
 
   char * temp;
@@ -673,17 +1483,69 @@ int main(int argc, char ** argv)
       continue;
     } 
 
+    if (! multiline && isDirective(line, "AFTER")){
+      // the next step waits only for these
+      istringstream deps(line.substr(5));
+      int dep;
+      afterSet = true;
+      after.clear();
+      while (deps >> dep)
+	after.insert(dep);
+      if (! deps.eof()){
+	logFile << timeStr() << "Cannot parse AFTER at line " << lineno 
+		<< " in " << confFile << endl;
+	cerr << "Cannot parse AFTER at line " << lineno 
+	     << " in " << confFile << endl;
+	finish(1);
+      }
+      continue;
+    }
+
+    if (! multiline && (isDirective(line, "READS") ||
+			isDirective(line, "WRITES"))){
+      // files the next step reads or writes, for -incremental; not named
+      // INPUTS and OUTPUTS since the INPUTS variable is what -ocd checks
+      bool isRead = (line[0] == 'R');
+      string files = line.substr(isRead ? 5 : 6);
+      files = substVars(files);
+      istringstream in(files);
+      string file;
+      while (in >> file)
+	(isRead ? reads : writes).push_back(file);
+      continue;
+    }
+
+    if (! multiline && isDirective(line, "FANOUT")){
+      // the next step runs once per partition of a bank
+      char bank[MAX_STRING+1];
+      char merged[MAX_STRING+1];
+      int nf = sscanf(line.c_str(), "FANOUT %d %s %s", &fanout, bank, merged);
+      if (nf < 2 || fanout < 1){
+	logFile << timeStr() << "Cannot parse FANOUT at line " << lineno 
+		<< " in " << confFile << endl;
+	cerr << "Cannot parse FANOUT at line " << lineno 
+	     << " in " << confFile << endl;
+	finish(1);
+      }
+      fanBank = string(bank);
+      fanBank = substVars(fanBank);
+      if (nf == 3){
+	fanMerged = string(merged);
+	fanMerged = substVars(fanMerged);
+      } else
+	fanMerged = fanBank + "_merged.bnk";
+      continue;
+    }
+
     if (multiline){ // part of a multi-line command
       if (line.length() == 1 && line[0] == '.'){ // end multiline
 	multiline = false;
-	noop = false;
-	if (continuation){
-	  doCommand(outline);
+	if (continuation && ! noop){
+	  addCommand(outline);
 	}
+	noop = false;
 	continuation = false;
 	outline = "";
-	logFile << timeStr() << "Done! Elapsed time:" 
-		<< elapsed(time(NULL) - start) << endl;
 	continue;
       }
 
@@ -693,11 +1555,11 @@ int main(int argc, char ** argv)
 	  continuation = true;
 	} else if (continuation){
 	  outline += line;
-	  doCommand(outline);
+	  addCommand(outline);
 	  outline = "";
 	  continuation = false;
 	} else 
-	  doCommand(line);
+	  addCommand(line);
       }
 
       continue;
@@ -722,29 +1584,41 @@ int main(int argc, char ** argv)
 	noop = true;  
       
       if (! noop) {
-	ostringstream msg;
-	msg << "step " << step;
-	if (message.length() != 0){
-	  msg << ": " << message;
-	  message = "";
-	}
-	//	steps.push_back(pair<string, int> (msg.str(), commands.size()));
-	cout << "Doing " << msg.str() << endl;
-	logFile << timeStr() << "Doing " << msg.str() << endl;
+	Step st;
+	st.num = step;
+	st.message = message;
+	st.afterSet = afterSet;
+	st.after = after;
+	st.fanout = fanout;
+	st.fanBank = fanBank;
+	st.fanMerged = fanMerged;
+	st.reads = reads;
+	st.writes = writes;
+	st.skipped = false;
+	st.state = STEP_WAIT;
+	st.launched = 0;
+	st.running = 0;
+	st.numParts = 0;
+	st.start = 0;
+	st.wallStart = st.wall = 0;
+	memset(&st.usage, 0, sizeof(st.usage));
+	st.threads = 0;
+	st.failed = false;
+	steps.push_back(st);
+	message = "";
       }
+      afterSet = false;
+      after.clear();
+      fanout = 0;
+      reads.clear();
+      writes.clear();
       
       if (line.substr(noscan).length() == 0) {// multiline command
 	multiline = true;
-	start = time(NULL);
 	continue;
       } else { 
-	if (! noop){
-	  //	  commands.push_back(line.substr(noscan));
-	  start = time(NULL);	  
-	  doCommand(line.substr(noscan));
-	  logFile << timeStr() << "Done! Elapsed time:" 
-		  << elapsed(time(NULL) - start) << endl;
-	}
+	if (! noop)
+	  addCommand(line.substr(noscan));
 	noop = false;
       }
       
@@ -755,6 +1629,9 @@ int main(int argc, char ** argv)
     char c; 
     if (sscanf(line.c_str(), "%[a-zA-Z0-9_-] %c %n", varname, &c, &noscan) >= 2 && c == '='){
       //      cout << line << " is variable definition \n"; 
+      // a shell command may need the output of the steps so far
+      if (line.find("$(shell") != line.npos)
+	runSteps();
       processDefn(line); // variable definition
       continue;
     }
@@ -766,23 +1643,14 @@ int main(int argc, char ** argv)
     finish(1);
   } // while each line in configuration file
 
+  runSteps();
 
-//   for (int vi = 0; vi < steps.size(); vi++){
-//     int lastcmd;
-//     start = time(NULL);
-//     cout << "Doing " << steps[vi].first << endl;
-//     logFile << timeStr() << "Doing " << steps[vi].first << endl;
-//     if (vi == steps.size() - 1)
-//       lastcmd = commands.size();
-//     else
-//       lastcmd = steps[vi + 1].second;
-    
-//     for (int ci = steps[vi].second; ci < lastcmd; ci++)
-//       doCommand(commands[ci]);
-
-//     logFile << timeStr() << "Done! Elapsed time:" 
-// 	    << elapsed(time(NULL) - start) << endl;
-//   }
+  // the steps' files are now the way the whole run left them
+  if (INCREMENTAL && ! ECHOMODE){
+    for (size_t s = 0; s < steps.size(); s++)
+      recordStep(steps[s]);
+    writeManifest();
+  }
 
   if (globals.find("clean") != globals.end())
     cleanFiles();
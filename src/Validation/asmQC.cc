@@ -4,6 +4,7 @@
 // regions where mate-pair information indicates a problem
 
 #include "foundation_AMOS.hh"
+#include "CEStatSweep.hh"
 
 #include <getopt.h>
 #include <map>
@@ -11,6 +12,7 @@
 #include <list>
 #include <vector>
 #include <string>
+#include <sstream>
 #include <math.h>
 #include <functional>
 #include <stdlib.h>
@@ -447,200 +449,65 @@ void getCvg(list<list<AnnotatedFragment>::iterator>::iterator begin,
 } // getCvg
 
 
-// computes mean and standard deviation of array of tiles
-void getMeanSD(vector<pair<Pos_t, Pos_t> >::iterator beg, vector<pair<Pos_t, Pos_t> >::iterator end, 
-	       Size_t &mea, DoubleSD_t &sd)
+// C/E statistic of one library along one contig or scaffold
+struct CEReport
 {
-  int n = 0;
-  Size_t sum = 0;
-  DoubleSD_t var = 0;
-
-  for (vector<pair<Pos_t, Pos_t> >::iterator vi = beg; vi != end; vi++){
-    n++;
-    //    cout << "Adding " << vi->second - vi->first << " " << vi->first << ", " << vi->second << endl;
-    sum += vi->second - vi->first;
-  }
-  if (n == 0) { return;}
-  mea = sum / n;
-  //  cout << "N " << n << endl;
-  //  cout << "Mean " << mea << endl;
-  for (vector<pair<Pos_t, Pos_t> >::iterator vi = beg; vi != end; vi++)
-    var += (vi->second - vi->first - mea) * (vi->second - vi->first - mea);
-  
-  //  cout << "Var " << var << endl;
-  if (n > 1) { 
-    sd = var / (n - 1);
-    sd = (DoubleSD_t) sqrt((double)sd);
-  } else {
-    sd = 0;
-  }
-  //  cout << "SD " << sd << endl;
-}
-
-// compares two pairs by first item (less than)
-struct LessByFirst : public binary_function<pair<Pos_t, Pos_t>, pair<Pos_t, Pos_t>, bool> {
-  bool operator () (pair<Pos_t, Pos_t> x, pair<Pos_t, Pos_t> y)
-  {
-    return (x.first < y.first);
-  }
-};
-
-// compares two pairs by second item (greater than)
-struct GtBySecond : public binary_function<pair<Pos_t, Pos_t>, pair<Pos_t, Pos_t>, bool> {
-  bool operator () (pair<Pos_t, Pos_t> x, pair<Pos_t, Pos_t> y)
-  {
-    return (x.second > y.second);
-  }
+  ID_t id;                              // contig or scaffold
+  ID_t libid;                           // library
+  Size_t mean;                          // global mean size of library
+  DoubleSD_t stdev;                     // global standard deviation
+  CEStatSweep sweep;                    // inserts of the library
+  list<pair<Pos_t, Pos_t> > interest;   // regions with anomalous C/E stat
+  list<bool> stretch;                   // is the region stretched or compressed
+  string plot;                          // lines for the ceplot file
 };
 
-// computes regions with anomalous C/E stat
-void getCEstat(list<list<AnnotatedFragment>::iterator>::iterator begin,
-	       list<list<AnnotatedFragment>::iterator>::iterator end,
-	       hash_map<ID_t, Range_t, hash<ID_t>, equal_to<ID_t> > & posmap,
-	       ID_t libid, pair<Size_t, DoubleSD_t> & libifo, float num_sd, 
-	       list<pair<Pos_t, Pos_t> > & interest, 
-	       list<bool> & stretch,
-	       ofstream & ceplotFile)
+// collects the inserts of a library that are used to compute the C/E stat
+void getCEinserts(list<list<AnnotatedFragment>::iterator>::iterator begin,
+		  list<list<AnnotatedFragment>::iterator>::iterator end,
+		  hash_map<ID_t, Range_t, hash<ID_t>, equal_to<ID_t> > & posmap,
+		  CEReport & report)
 {
-  vector<pair<Pos_t, Pos_t> > starts, ends;
-  Pos_t pos, st;
-  Size_t mea;         // sum of sizes of inserts
-  DoubleSD_t sderr;         // standard error for inserts
-  Size_t mean;        // global mean size of library
-  DoubleSD_t stdev;         // global standard deviation
-  bool over = false;  // is error on the longer or shorter side
-  bool inbad = false; // are we in a bad regions
-
-  interest.clear();
-  stretch.clear();
-
-  // get parameters for global distribution
-  mean = libifo.first;
-  stdev = libifo.second;
-  cout << "in CESTAT libid=" << libid << " mea=" << mean << " stdev=" << stdev << endl;
-  
   for (list<list<AnnotatedFragment>::iterator>::iterator mi = begin; mi != end; mi++){
-      Pos_t left, right;
-      
-      if ((*mi)->getLibrary() != libid) // only do the selected library
-	continue;
-
-
-      if ((*mi)->status == MP_GOOD || (*mi)->status == MP_LONG || (*mi)->status == MP_SHORT){
-	cout << "Got insert " << (((*mi)->getMatePair()).first) << endl; 
-
-	left = posmap[((*mi)->getMatePair()).first].getBegin(); // use end of reads
-	right = posmap[((*mi)->getMatePair()).second].getBegin(); 
-	cout << left << ", " << right << endl;
-	if (abs (mean - (*mi)->size) > MAX_DEVIATION * stdev){ // skip inserts that are too long or too short
-	  cout << "too far" << mean << " - " << (*mi)->size << " vs " << MAX_DEVIATION * stdev << endl;;
-	  continue;
-	}
-	if (left < right)
-	  starts.push_back(pair<Pos_t, Pos_t>(left, right));
-	else 
-	  starts.push_back(pair<Pos_t, Pos_t>(right, left));
-      } 
-  }// for each mate
-
-  if (starts.size() < 3){
-    return;
-  }
+    if ((*mi)->getLibrary() != report.libid) // only do the selected library
+      continue;
 
-  cout << "got " << starts.size() << " elements\n";
-
-  int inends = 0;
-  sort(starts.begin(), starts.end(), LessByFirst());
-  for (vector<pair<Pos_t, Pos_t> >::iterator si = starts.begin(); si != starts.end(); si++){
-    if (ends.size() == 0 || si->first <= ends[0].second) { // reached beginning of range
-      cout << "got begin " << ++inends << endl;
-      cout << si->first << ", " << si->second << endl;
-      ends.push_back(*si);
-      push_heap(ends.begin(), ends.end(), GtBySecond());
-      pos = si->first;
-    } else { // reached end of range
-      cout << "got end " << --inends << endl;
-      pos = ends[0].second;
-      pop_heap(ends.begin(), ends.end(), GtBySecond());
-      ends.pop_back();
-    }
-    getMeanSD(ends.begin(), ends.end(), mea, sderr);
+    if ((*mi)->status == MP_GOOD || (*mi)->status == MP_LONG || (*mi)->status == MP_SHORT){
+      if (abs (report.mean - (*mi)->size) > MAX_DEVIATION * report.stdev) // skip inserts that are too long or too short
+	continue;
 
-    if (globals.find("ceplot") != globals.end()){
-      ceplotFile << pos << "\t" << ((stdev != 0) ? (mea - mean) * sqrt((double)ends.size()) / stdev : 0 ) << "\t" << ends.size() << endl;
+      report.sweep.addInsert(posmap[((*mi)->getMatePair()).first].getBegin(), // use end of reads
+			     posmap[((*mi)->getMatePair()).second].getBegin());
     }
+  }// for each mate
+} // getCEinserts
 
-    if (ends.size() > MIN_CE_OBS && abs(mea - mean) > num_sd * stdev / sqrt((double)ends.size())){ // too far off
-      //      cerr << "CE " << libid << " pos= " << pos << " skew= " << (mea - mean) * sqrt((double)ends.size()) / sderr << " nobs= " << ends.size() << endl;
-      if (mea > mean) {
-	if (inbad && over == false){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = true;
-      } else {
-	if (inbad && over == true){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = false;
-      }
-      if (! inbad){      // if not already in a bad region, we are now
-	inbad = true;
-	st = pos;        // start of bad region is current position
-      }
-    } else if (inbad) { // bad region ended
-      inbad = false;
-      interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-      stretch.push_back(over);
-    }
-  } // for each start
-
-  cout << "Done with starts" << endl;
-  while (ends.size() > 0){
-    pos = ends[0].second;
-    pop_heap(ends.begin(), ends.end(), GtBySecond());
-    ends.pop_back();
-    if (ends.size()== 0){
-      cout << "Done with ends\n";
-      break;
+// computes regions with anomalous C/E stat, one report per thread at a time
+void getCEstat(vector<CEReport> & reports, float num_sd, bool ceplot)
+{
+#ifdef AMOS_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < (int) reports.size(); i++){
+    CEReport & r = reports[i];
+
+    if (r.sweep.size() < 3){
+      r.sweep.clear();
+      continue;
     }
 
-    getMeanSD(ends.begin(), ends.end(), mea, sderr);
+    const vector<CEPoint> & points = r.sweep.sweep();
 
-    if (globals.find("ceplot") != globals.end()){
-      ceplotFile << pos << "\t" << ((stdev != 0) ? (mea - mean) * sqrt((double)ends.size()) / stdev : 0 ) << "\t" << ends.size() << endl;
+    if (ceplot){
+      ostringstream plot;
+      for (vector<CEPoint>::const_iterator pi = points.begin(); pi != points.end(); pi++)
+	plot << pi->m_pos << "\t" << pi->zscore(r.mean, r.stdev) << "\t" << pi->m_n << endl;
+      r.plot = plot.str();
     }
 
-    if (ends.size() > MIN_CE_OBS && abs(mea - mean) > num_sd * stdev / sqrt((double)ends.size())){ // too far off
-      cerr << "CE " << libid << " pos= " << pos << " skew= " << (mea - mean) * sqrt((double)ends.size()) / stdev << " nobs= " << ends.size() << endl;
-      if (mea > mean) {
-	if (inbad && over == false){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = true;
-      } else {
-	if (inbad && over == true){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = false;
-      }
-      if (! inbad){      // if not already in a bad region, we are now
-	inbad = true;
-	st = pos;        // start of bad region is current position
-      }
-    } else if (inbad) { // bad region ended
-      inbad = false;
-      interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-      stretch.push_back(over);
-    }
-  } // for each end
+    r.sweep.findRegions(r.mean, r.stdev, true, num_sd, MIN_CE_OBS, r.interest, r.stretch);
+    r.sweep.clear();
+  }
 } // getCEstat
 
 
@@ -1346,6 +1213,44 @@ int main(int argc, char **argv)
   // First we'll handle scaffolds, then the contigs that don't belong to scaffolds
   //*****************************************************************************
 
+  // the C/E statistics of all contigs and scaffolds are computed up front,
+  // in parallel, and reported in order below
+  vector<CEReport> ctgCE, scfCE;
+  if (cestat) {
+    CEReport report;
+    ctgCE.reserve(ctgIDs.size() * libIDs.size());
+    scfCE.reserve(scfIDs.size() * libIDs.size());
+
+    for (set<ID_t>::iterator ctg = ctgIDs.begin(); ctg != ctgIDs.end(); ctg++) {
+      if (byscaff && ctg2scaff[*ctg] != 0)
+	continue;
+      for (set<ID_t>::iterator li = libIDs.begin(); li != libIDs.end(); li++){
+	report.id = *ctg;
+	report.libid = *li;
+	report.mean = NewLib2size[*li].first;
+	report.stdev = NewLib2size[*li].second;
+	ctgCE.push_back(report);
+	getCEinserts(ctg2frag[*ctg].begin(), ctg2frag[*ctg].end(), rd2posn, ctgCE.back());
+      }
+    }
+
+    for (set<ID_t>::iterator scf = scfIDs.begin(); scf != scfIDs.end(); scf++) {
+      for (set<ID_t>::iterator li = libIDs.begin(); li != libIDs.end(); li++){
+	report.id = *scf;
+	report.libid = *li;
+	report.mean = NewLib2size[*li].first;
+	report.stdev = NewLib2size[*li].second;
+	scfCE.push_back(report);
+	getCEinserts(scf2frag[*scf].begin(), scf2frag[*scf].end(), rd2scaff, scfCE.back());
+      }
+    }
+
+    getCEstat(ctgCE, NUM_SD, globals.find("ceplot") != globals.end());
+    getCEstat(scfCE, NUM_SD, globals.find("ceplot") != globals.end());
+  }
+  vector<CEReport>::iterator ctgce = ctgCE.begin();
+  vector<CEReport>::iterator scfce = scfCE.begin();
+
   for (set<ID_t>::iterator ctg = ctgIDs.begin(); ctg != ctgIDs.end(); ctg++) {
     
     list<pair<Pos_t, Pos_t> > ranges;  // ranges we are interested in
@@ -1388,13 +1293,13 @@ int main(int argc, char **argv)
     if (cestat) {
       // calculate C/E statistics
       for (set<ID_t>::iterator li = libIDs.begin(); li != libIDs.end(); li++){
-	pair<Pos_t, DoubleSD_t> libsize = NewLib2size[*li];
-	list<bool> stretch;
-	
-	if (globals.find("ceplot") != globals.end())
-	  ceplotFile << ">c" << *ctg << " " << ctgname[*ctg] << " l" << *li << " " << lib2name[*li] << endl;
+	list<bool> stretch = ctgce->stretch;
+	interest = ctgce->interest;
 
-	getCEstat(ctg2frag[*ctg].begin(), ctg2frag[*ctg].end(), rd2posn, *li, libsize, NUM_SD, interest, stretch, ceplotFile);
+	if (globals.find("ceplot") != globals.end())
+	  ceplotFile << ">c" << *ctg << " " << ctgname[*ctg] << " l" << *li << " " << lib2name[*li] << endl
+		     << ctgce->plot;
+	ctgce++;
 	
 	// report interesting ranges
 	if (interest.size() > 0){
@@ -1642,13 +1547,13 @@ int main(int argc, char **argv)
     if (cestat) {
       // calculate C/E statistics
       for (set<ID_t>::iterator li = libIDs.begin(); li != libIDs.end(); li++){
-	pair<Pos_t, DoubleSD_t> libsize = NewLib2size[*li];
-	list<bool> stretch;
+	list<bool> stretch = scfce->stretch;
+	interest = scfce->interest;
 
 	if (globals.find("ceplot") != globals.end())
-	  ceplotFile << ">s" << *scf << " " << scaffname[*scf] << " l" << *li << " " << lib2name[*li] << endl;
-
-	getCEstat(scf2frag[*scf].begin(), scf2frag[*scf].end(), rd2scaff, *li, libsize, NUM_SD, interest, stretch, ceplotFile);
+	  ceplotFile << ">s" << *scf << " " << scaffname[*scf] << " l" << *li << " " << lib2name[*li] << endl
+		     << scfce->plot;
+	scfce++;
 	
 	// report interesting ranges
 	if (interest.size() > 0){
@@ -20,6 +20,7 @@
 #include "DataStore.hh"
 #include "Insert.hh"
 #include "CoverageStats.hh"
+#include "CEStatSweep.hh"
 
 using namespace std;
 using namespace AMOS;
@@ -175,19 +176,6 @@ struct insert
   long r;
 };
 
-bool sortl(const struct insert & i, const struct insert & j)
-{
-  return i.l < j.l;
-}
-
-struct sortr
-{
-  bool operator() (const struct insert & i, const struct insert & j)
-  {
-    return i.r > j.r;
-  }
-};
-
 double Z(double sum, int n)
 {
   if (n == 0) { return 0; }
@@ -204,9 +192,7 @@ void printZ(const string & label, long pos, double sum, int n)
 
 void computeCE(const string & id, vector<insert> & inserts)
 {
-  sort(inserts.begin(), inserts.end(), sortl);
-
-  priority_queue<insert, vector<insert>, sortr> ends;
+  CEStatSweep sweep(true);
 
   double sum = 0;
   int n = inserts.size();
@@ -234,51 +220,31 @@ void computeCE(const string & id, vector<insert> & inserts)
   }
 
 
-  sum = 0;
-
-  cout << ">" << id << " ce" << endl;
-  printZ(id, 1, sum, 0);
-
   for (int i = 0; i < n; i++)
   {
-    while ((!ends.empty()) && (ends.top().r <= inserts[i].l))
-    {
-      insert e = ends.top();
-
-      printZ(id, e.r, sum, ends.size());
-
-      ends.pop();
-      sum -= e.dist();
-
-      printZ(id, e.r, sum, ends.size());
-    }
+    sweep.addInsert(inserts[i].l, inserts[i].r);
+  }
 
-    printZ(id, inserts[i].l, sum, ends.size());
-    //cout << inserts[i].l << "\t" << inserts[i].r << "\t" << inserts[i].dist() << endl;
+  cout << ">" << id << " ce" << endl;
+  printZ(id, 1, 0, 0);
 
-    ends.push(inserts[i]);
-    sum += inserts[i].dist();
+  // print the value just before and just after each insert start or end
+  const vector<CEPoint> & points = sweep.sweep();
 
-    printZ(id, inserts[i].l, sum, ends.size());
-  }
+  sum = 0;
+  n = 0;
 
-  while (!ends.empty())
+  for (vector<CEPoint>::const_iterator pi = points.begin(); pi != points.end(); pi++)
   {
-    insert e = ends.top();
-    printZ(id, e.r, sum, ends.size());
+    printZ(id, pi->m_pos, sum, n);
 
-    ends.pop();
-    sum -= e.dist();
+    sum = pi->m_sum;
+    n = pi->m_n;
 
-    printZ(id, e.r, sum, ends.size());
+    printZ(id, pi->m_pos, sum, n);
   }
 
   inserts.clear();
-
-  if (sum != 0)
-  {
-    cerr << "ERROR: sum != 0" << endl;
-  }
 }
 
 
@@ -1,143 +1,488 @@
 #include "foundation_AMOS.hh"
 #include "amp.hh"
-#include "fasta.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <queue>
+#include <map>
+#include <unistd.h>
+
+#ifdef AMOS_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 
 using namespace AMOS;
 using namespace std;
 
 
+int OPT_Threads = 1;
+bool OPT_Forward = false;   // only report duplicates on the same strand
+int OPT_Prefix = 0;         // near duplicates: same first n bases
+int OPT_EndWindow = 0;      // near duplicates: same minimizers at both ends
+long OPT_MemMB = 512;       // key buffer size before spilling a run to disk
+string OPT_TmpDir;
+
+// k-mer size of the end minimizers
+const int MINIMIZER_K = 15;
+
+// Reads are loaded in batches of this many per thread and hashed in parallel
+const int BATCH_PER_THREAD = 4096;
 
-long hashstring(const string & s)
+
+// 128 bit hash of a read, or of its near duplicate signature. Reads with the
+// same key are reported as duplicates, collisions of unrelated reads are
+// vanishingly rare so the reads are not compared base by base. With -p a read
+// has a key for each strand, and reads sharing either key are grouped.
+struct ReadKey
 {
-  long retval = 0;
-  int len = s.length();
+  uint64_t hi, lo;
+  ID_t iid;
+
+  bool operator < (const ReadKey & o) const
+  {
+    if (hi != o.hi) { return hi < o.hi; }
+    if (lo != o.lo) { return lo < o.lo; }
+    return iid < o.iid;
+  }
+
+  bool sameKey(const ReadKey & o) const
+  {
+    return hi == o.hi && lo == o.lo;
+  }
+};
+
+
+// A sorted run of keys, either spilled to a temporary file or the last one
+// still in memory
+struct KeyRun
+{
+  FILE * fp;
+  const vector<ReadKey> * mem;
+  size_t pos;
+  ReadKey cur;
+
+  bool next()
+  {
+    if (fp) { return fread(&cur, sizeof(cur), 1, fp) == 1; }
+    if (pos < mem->size()) { cur = (*mem)[pos++]; return true; }
+    return false;
+  }
+};
+
+
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k)
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+
+// MurmurHash3 x64 128
+void hash128(const char * data, int len, uint64_t & h1, uint64_t & h2)
+{
+  const uint64_t c1 = 0x87c37b91114253d5ULL;
+  const uint64_t c2 = 0x4cf5ad432745937fULL;
+  int nblocks = len / 16;
+
+  h1 = h2 = 0;
+
+  for (int i = 0; i < nblocks; i++)
+  {
+    uint64_t k1, k2;
+    memcpy(&k1, data + i*16, 8);
+    memcpy(&k2, data + i*16 + 8, 8);
+
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = rotl64(h1, 27); h1 += h2; h1 = h1*5 + 0x52dce729;
+
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = rotl64(h2, 31); h2 += h1; h2 = h2*5 + 0x38495ab5;
+  }
+
+  const unsigned char * tail = (const unsigned char *) (data + nblocks*16);
+  uint64_t k1 = 0, k2 = 0;
+
+  switch (len & 15)
+  {
+    case 15: k2 ^= ((uint64_t) tail[14]) << 48;
+    case 14: k2 ^= ((uint64_t) tail[13]) << 40;
+    case 13: k2 ^= ((uint64_t) tail[12]) << 32;
+    case 12: k2 ^= ((uint64_t) tail[11]) << 24;
+    case 11: k2 ^= ((uint64_t) tail[10]) << 16;
+    case 10: k2 ^= ((uint64_t) tail[ 9]) << 8;
+    case  9: k2 ^= ((uint64_t) tail[ 8]);
+             k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+
+    case  8: k1 ^= ((uint64_t) tail[ 7]) << 56;
+    case  7: k1 ^= ((uint64_t) tail[ 6]) << 48;
+    case  6: k1 ^= ((uint64_t) tail[ 5]) << 40;
+    case  5: k1 ^= ((uint64_t) tail[ 4]) << 32;
+    case  4: k1 ^= ((uint64_t) tail[ 3]) << 24;
+    case  3: k1 ^= ((uint64_t) tail[ 2]) << 16;
+    case  2: k1 ^= ((uint64_t) tail[ 1]) << 8;
+    case  1: k1 ^= ((uint64_t) tail[ 0]);
+             k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+  };
+
+  h1 ^= len; h2 ^= len;
+  h1 += h2; h2 += h1;
+  h1 = fmix64(h1); h2 = fmix64(h2);
+  h1 += h2; h2 += h1;
+}
+
+
+
+// Upper case ACGT, anything else counts as an A as it always has. The
+// reverse strand complements before the ambiguous bases are mapped so that a
+// read and its reverse complement get the same pair of strings.
+void normalize(const string & seq, string & fwd, string & rev)
+{
+  int len = seq.length();
+  fwd.resize(len);
+  rev.resize(len);
 
   for (int i = 0; i < len; i++)
   {
-    int j;
-    switch (toupper(s[i]))
+    char f = 'A', r = 'A';
+    switch (toupper(seq[i]))
     {
-      case 'C': j = 1; break;
-      case 'T': j = 2; break;
-      case 'G': j = 3; break;
-      default: j = 0; break;
+      case 'A': f = 'A'; r = 'T'; break;
+      case 'C': f = 'C'; r = 'G'; break;
+      case 'G': f = 'G'; r = 'C'; break;
+      case 'T': f = 'T'; r = 'A'; break;
     };
 
-    retval += j << ((i * 2) % 63);
+    fwd[i] = f;
+    rev[len-1-i] = r;
+  }
+}
+
+
+// Smallest hashed k-mer of s[start, end)
+uint64_t minimizer(const string & s, int start, int end)
+{
+  const uint64_t mask = (1ULL << (2*MINIMIZER_K)) - 1;
+  uint64_t kmer = 0;
+  uint64_t best = ~0ULL;
+
+  for (int i = start; i < end; i++)
+  {
+    uint64_t b = 0;
+    switch (s[i])
+    {
+      case 'C': b = 1; break;
+      case 'G': b = 2; break;
+      case 'T': b = 3; break;
+    };
+
+    kmer = ((kmer << 2) | b) & mask;
+    if (i - start + 1 >= MINIMIZER_K)
+    {
+      best = min(best, fmix64(kmer));
+    }
+  }
+
+  return best;
+}
+
+
+// Hashes the part of a normalized strand that decides whether two reads are
+// duplicates
+void hashStrand(const string & s, uint64_t & h1, uint64_t & h2)
+{
+  int len = s.length();
+
+  if (OPT_EndWindow > 0 && len >= MINIMIZER_K)
+  {
+    int w = min(OPT_EndWindow, len);
+    uint64_t ends[2];
+    ends[0] = minimizer(s, 0, w);
+    ends[1] = minimizer(s, len - w, len);
+    hash128((const char *) ends, sizeof(ends), h1, h2);
+  }
+  else if (OPT_Prefix > 0)
+  {
+    hash128(s.data(), min(OPT_Prefix, len), h1, h2);
+  }
+  else
+  {
+    hash128(s.data(), len, h1, h2);
   }
+}
+
+
+// Keys of a read, returns how many. The keys of its two strands are
+// combined into the smaller one when the whole read is hashed, since a
+// duplicate on the other strand has the two swapped. A prefix only covers
+// one end of the read though, so with -p each strand keeps its own key:
+// a duplicate on the same strand shares the first, one on the other strand
+// has the first as its second.
+int readKeys(const string & seq, ID_t iid, ReadKey * keys)
+{
+  string fwd, rev;
+  normalize(seq, fwd, rev);
+
+  hashStrand(fwd, keys[0].hi, keys[0].lo);
+  keys[0].iid = iid;
+
+  if (OPT_Forward) { return 1; }
+
+  hashStrand(rev, keys[1].hi, keys[1].lo);
+  keys[1].iid = iid;
+
+  if (OPT_Prefix > 0 && OPT_EndWindow == 0) { return 2; }
 
-  return retval;
+  if (keys[1] < keys[0]) { keys[0] = keys[1]; }
+  return 1;
+}
+
+
+// Groups the reads sharing keys, mapping each read to a representative
+ID_t findGroup(map<ID_t, ID_t> & groups, ID_t iid)
+{
+  map<ID_t, ID_t>::iterator gi = groups.find(iid);
+  if (gi == groups.end()) { return groups[iid] = iid; }
+  if (gi->second == iid) { return iid; }
+  return gi->second = findGroup(groups, gi->second);
+}
+
+void joinGroups(map<ID_t, ID_t> & groups, ID_t a, ID_t b)
+{
+  a = findGroup(groups, a);
+  b = findGroup(groups, b);
+  if (a != b) { groups[max(a, b)] = min(a, b); }
+}
+
+
+// Sorts the buffered keys and writes them to an unlinked temporary file
+FILE * spillRun(vector<ReadKey> & keys)
+{
+  sort(keys.begin(), keys.end());
+
+  string path = OPT_TmpDir + "/find-duplicate-reads.XXXXXX";
+  vector<char> tmpl(path.begin(), path.end());
+  tmpl.push_back('\0');
+
+  int fd = mkstemp(&tmpl[0]);
+  FILE * fp = (fd == -1) ? NULL : fdopen(fd, "w+b");
+  if (fp == NULL)
+    AMOS_THROW_IO("Could not create temporary file in " + OPT_TmpDir);
+  unlink(&tmpl[0]);
+
+  if (fwrite(&keys[0], sizeof(ReadKey), keys.size(), fp) != keys.size())
+    AMOS_THROW_IO("Could not write temporary file in " + OPT_TmpDir);
+  rewind(fp);
+
+  keys.clear();
+  return fp;
+}
+
+
+
+void printHelp(const char * s)
+{
+  cerr << "Usage: " << s << " [options] bankname" << endl
+       << endl
+       << "Reports reads with identical sequences, on either strand unless -f" << endl
+       << "is given. Each output line lists the eids of a set of duplicates." << endl
+       << "-p and -e report near duplicates, such as PCR duplicates that only" << endl
+       << "differ by sequencing errors." << endl
+       << endl
+       << "  -f       Only report duplicates on the same strand" << endl
+       << "  -p n     Reads are duplicates if their first n bases agree, or the" << endl
+       << "           first n of one are the reverse complement of the last n of" << endl
+       << "           the other" << endl
+       << "  -e n     Reads are duplicates if the minimizers of their first and" << endl
+       << "           last n bases agree" << endl
+       << "  -j n     Number of threads (default 1)" << endl
+       << "  -m MB    Memory for sorting before spilling to disk (default 512)" << endl
+       << "  -T dir   Directory for the spilled runs (default $TMPDIR or /tmp)" << endl
+       << "  -h       Display help information" << endl;
 }
 
 
 
 int main(int argc, char ** argv)
 {
-  if (argc != 2)
+  const char * tmpdir = getenv("TMPDIR");
+  OPT_TmpDir = tmpdir ? tmpdir : "/tmp";
+
+  int ch;
+  while ((ch = getopt(argc, argv, "fp:e:j:m:T:h")) != EOF)
   {
-    cerr << "Usage: find-duplicate-reads bankname" << endl;
-    return EXIT_FAILURE;
+    switch (ch)
+    {
+      case 'f': OPT_Forward = true; break;
+      case 'p': OPT_Prefix = atoi(optarg); break;
+      case 'e': OPT_EndWindow = atoi(optarg); break;
+      case 'j':
+        OPT_Threads = max(1, atoi(optarg));
+#ifndef AMOS_HAVE_OPENMP
+        if (OPT_Threads > 1)
+        {
+          cerr << "WARNING: built without OpenMP, -j ignored" << endl;
+        }
+        OPT_Threads = 1;
+#endif
+        break;
+      case 'm': OPT_MemMB = max(1L, atol(optarg)); break;
+      case 'T': OPT_TmpDir = optarg; break;
+      case 'h': printHelp(argv[0]); return EXIT_SUCCESS;
+      default: printHelp(argv[0]); return EXIT_FAILURE;
+    }
   }
 
-  Bank_t red_bank(Read_t::NCODE);
-  string bank_name = argv[1];
+  if (optind != argc - 1)
+  {
+    printHelp(argv[0]);
+    return EXIT_FAILURE;
+  }
 
-  int verbose = 0;
+  BankStream_t red_bank(Read_t::NCODE);
+  string bank_name = argv[optind];
 
   cerr << "Processing " << bank_name << " at " << Date() << endl;
 
+  vector<FILE *> spilled;
 
   try
   {
     red_bank.open(bank_name, B_READ);
 
-    multimap<long, ID_t> hash2read;
+    size_t maxkeys = max((size_t) 1,
+                         (size_t) OPT_MemMB * 1024 * 1024 / sizeof(ReadKey));
+    vector<ReadKey> keys;
+    keys.reserve(min(maxkeys, (size_t) red_bank.getSize()));
 
-    const IDMap_t & readmap = red_bank.getIDMap();
-    IDMap_t::const_iterator r;
+    int batchsize = BATCH_PER_THREAD * OPT_Threads;
+    vector<string> seqs(batchsize);
+    vector<ID_t> iids(batchsize);
+    vector<ReadKey> batch(2 * batchsize);
+    vector<int> nkeys(batchsize);
 
+    Read_t red;
     int count = 0;
-    for (r = readmap.begin(); r!= readmap.end(); r++)
+    bool more = true;
+
+    // One pass over the reads in bank order, hashing a batch at a time
+    while (more)
     {
-      Read_t red;
-      red_bank.fetch(r->iid, red);
+      int n = 0;
+      while (n < batchsize && (more = (red_bank >> red)))
+      {
+        seqs[n] = red.getSeqString();
+        iids[n] = red.getIID();
+        n++;
+      }
 
-      string seq = red.getSeqString();
-      long hash = hashstring(seq);
+#ifdef AMOS_HAVE_OPENMP
+      #pragma omp parallel for schedule(static) num_threads(OPT_Threads)
+#endif
+      for (int i = 0; i < n; i++)
+      {
+        nkeys[i] = readKeys(seqs[i], iids[i], &batch[2*i]);
+      }
 
-      hash2read.insert(make_pair(hash, r->iid));
-      count++;
-    }
+      for (int i = 0; i < n; i++)
+      {
+        for (int k = 0; k < nkeys[i]; k++)
+        {
+          if (keys.size() == maxkeys) { spilled.push_back(spillRun(keys)); }
+          keys.push_back(batch[2*i + k]);
+        }
+      }
 
-    cerr << "Loaded " << count << " reads." << endl;
+      count += n;
+    }
 
-    count = 0;
+    cerr << "Loaded " << count << " reads";
+    if (!spilled.empty()) { cerr << ", spilled " << spilled.size() << " runs"; }
+    cerr << "." << endl;
 
+    sort(keys.begin(), keys.end());
 
-    multimap<long, ID_t>::const_iterator h1;
-    multimap<long, ID_t>::const_iterator h2;
+    // Merge the runs, the duplicates of a read are adjacent in key order
+    vector<KeyRun> runs(spilled.size() + 1);
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+      runs[r].fp = (r < spilled.size()) ? spilled[r] : NULL;
+      runs[r].mem = &keys;
+      runs[r].pos = 0;
+    }
 
-    for (h1 = hash2read.begin(); h1 != hash2read.end(); h1++)
+    priority_queue<pair<ReadKey, int>, vector<pair<ReadKey, int> >,
+                   greater<pair<ReadKey, int> > > heap;
+    for (size_t r = 0; r < runs.size(); r++)
     {
-      Read_t r1;
-      red_bank.fetch(h1->second, r1);
-      string seq1 = r1.getSeqString();
+      if (runs[r].next()) { heap.push(make_pair(runs[r].cur, (int) r)); }
+    }
 
-      int l = seq1.length();
+    // Reads sharing a key are joined, only the reads with duplicates are
+    // kept in memory
+    map<ID_t, ID_t> joined;
+    bool started = false;
+    ReadKey first = ReadKey();
 
-      int dups = 0;
+    while (!heap.empty())
+    {
+      ReadKey key = heap.top().first;
+      int r = heap.top().second;
+      heap.pop();
+      if (runs[r].next()) { heap.push(make_pair(runs[r].cur, r)); }
 
-      h2 = h1;
-      h2++;
-      for (; ((h2 != hash2read.end()) && (h1->first == h2->first)); h2++)
+      if (started && first.sameKey(key))
       {
-        Read_t r2;
-        red_bank.fetch(h2->second, r2);
-
-        string seq2 = r2.getSeqString();
-        count++;
+        if (key.iid != first.iid) { joinGroups(joined, first.iid, key.iid); }
+      }
+      else
+      {
+        first = key;
+        started = true;
+      }
+    }
 
-        if (l == seq2.length())
-        {
+    // One line per group, in IID order
+    map<ID_t, vector<ID_t> > members;
+    for (map<ID_t, ID_t>::iterator gi = joined.begin(); gi != joined.end(); gi++)
+    {
+      members[findGroup(joined, gi->first)].push_back(gi->first);
+    }
 
-          bool match = true;
-          for (int i = 0; i < l; i++)
-          {
-            char s1 = toupper(seq1[i]);
-            char s2 = toupper(seq2[i]);
-
-            if (s1 == 'N') { s1 = 'A'; }
-            if (s2 == 'N') { s2 = 'A'; }
-
-            if (s1 != s2)
-            {
-              match = false;
-              break;
-            }
-          }
-
-          if (match)
-          {
-            dups++;
-
-            if (dups == 1) { cout << r1.getEID(); }
-            cout << "\t" << r2.getEID();
-          }
-        }
+    int dups = 0;
+    for (map<ID_t, vector<ID_t> >::iterator mi = members.begin();
+         mi != members.end(); mi++)
+    {
+      for (size_t m = 0; m < mi->second.size(); m++)
+      {
+        cout << (m ? "\t" : "") << red_bank.lookupEID(mi->second[m]);
       }
-
-      if (dups) { cout << endl; }
+      cout << endl;
+      dups += mi->second.size() - 1;
     }
 
-    cerr << "Made " << count << " comparisons" << endl;
+    cerr << "Found " << dups << " duplicates of " << members.size() << " reads" << endl;
   }
   catch (Exception_t & e)
   {
     cerr << "ERROR: -- Fatal AMOS Exception --\n" << e;
+    for (size_t r = 0; r < spilled.size(); r++) { fclose(spilled[r]); }
     return EXIT_FAILURE;
   }
 
+  for (size_t r = 0; r < spilled.size(); r++) { fclose(spilled[r]); }
+
   cerr << "End: " << Date() << endl;
 
   return EXIT_SUCCESS;
@@ -4,6 +4,7 @@
 // regions where mate-pair information indicates a problem
 
 #include "foundation_AMOS.hh"
+#include "CEStatSweep.hh"
 
 #include <getopt.h>
 #include <map>
@@ -359,52 +360,6 @@ void getCvg(list<list<AnnotatedFragment>::iterator>::iterator begin,
 } // getCvg
 
 
-// computes mean and standard deviation of array of tiles
-void getMeanSD(vector<pair<Pos_t, Pos_t> >::iterator beg, vector<pair<Pos_t, Pos_t> >::iterator end, 
-	       Size_t &mea, SD_t &sd)
-{
-  int n = 0;
-  Size_t sum = 0;
-  SD_t var = 0;
-
-  for (vector<pair<Pos_t, Pos_t> >::iterator vi = beg; vi != end; vi++){
-    n++;
-    //    cout << "Adding " << vi->second - vi->first << " " << vi->first << ", " << vi->second << endl;
-    sum += vi->second - vi->first;
-  }
-  if (n == 0) { return;}
-  mea = sum / n;
-  //  cout << "N " << n << endl;
-  //  cout << "Mean " << mea << endl;
-  for (vector<pair<Pos_t, Pos_t> >::iterator vi = beg; vi != end; vi++)
-    var += (vi->second - vi->first - mea) * (vi->second - vi->first - mea);
-  
-  //  cout << "Var " << var << endl;
-  if (n > 1) { 
-    sd = var / (n - 1);
-    sd = (SD_t) sqrt((double)sd);
-  } else {
-    sd = 0;
-  }
-  //  cout << "SD " << sd << endl;
-}
-
-// compares two pairs by first item (less than)
-struct LessByFirst : public binary_function<pair<Pos_t, Pos_t>, pair<Pos_t, Pos_t>, bool> {
-  bool operator () (pair<Pos_t, Pos_t> x, pair<Pos_t, Pos_t> y)
-  {
-    return (x.first < y.first);
-  }
-};
-
-// compares two pairs by second item (greater than)
-struct GtBySecond : public binary_function<pair<Pos_t, Pos_t>, pair<Pos_t, Pos_t>, bool> {
-  bool operator () (pair<Pos_t, Pos_t> x, pair<Pos_t, Pos_t> y)
-  {
-    return (x.second > y.second);
-  }
-};
-
 // computes regions with anomalous C/E stat
 void getCEstat(list<list<AnnotatedFragment>::iterator>::iterator begin,
 	       list<list<AnnotatedFragment>::iterator>::iterator end,
@@ -414,27 +369,19 @@ void getCEstat(list<list<AnnotatedFragment>::iterator>::iterator begin,
 	       list<bool> & stretch,
 	       ofstream & ceplotFile)
 {
-  vector<pair<Pos_t, Pos_t> > starts, ends;
-  Pos_t pos, st;
-  Size_t mea;         // sum of sizes of inserts
-  SD_t sderr;         // standard error for inserts
+  CEStatSweep sweep;
   Size_t mean;        // global mean size of library
   SD_t stdev;         // global standard deviation
-  bool over = false;  // is error on the longer or shorter side
-  bool inbad = false; // are we in a bad regions
+  bool ztest = (globals.find("ztest") != globals.end()); // use library stdev as sderr
 
   interest.clear();
   stretch.clear();
 
-  //  cout << "in CESTAT libid=" << libid << endl;
-
   // get parameters for global distribution
   mean = libifo.first;
   stdev = libifo.second;
   
   for (list<list<AnnotatedFragment>::iterator>::iterator mi = begin; mi != end; mi++){
-      Pos_t left, right;
-      
       if ((*mi)->getLibrary() != libid) // only do the selected library
 	continue;
   
@@ -442,119 +389,25 @@ void getCEstat(list<list<AnnotatedFragment>::iterator>::iterator begin,
 	if (abs (mean - (*mi)->size) > MAX_DEVIATION * stdev) // skip inserts that are too long or too short
 	  continue;
 
-	left = posmap[((*mi)->getMatePair()).first].getBegin(); // use end of reads
-	right = posmap[((*mi)->getMatePair()).second].getBegin(); 
-	if (left < right)
-	  starts.push_back(pair<Pos_t, Pos_t>(left, right));
-	else 
-	  starts.push_back(pair<Pos_t, Pos_t>(right, left));
+	sweep.addInsert(posmap[((*mi)->getMatePair()).first].getBegin(), // use end of reads
+			posmap[((*mi)->getMatePair()).second].getBegin());
       } 
   }// for each mate
 
-  if (starts.size() < MIN_CE_OBS){
+  if (sweep.size() < MIN_CE_OBS){
     return;
   }
 
-  //  cout << "got " << starts.size() << " elements\n";
-
-  //  int inends = 0;
-  sort(starts.begin(), starts.end(), LessByFirst());
-  for (vector<pair<Pos_t, Pos_t> >::iterator si = starts.begin(); si != starts.end(); si++){
-    if (ends.size() == 0 || si->first <= ends[0].second) { // reached beginning of range
-      //     cout << "got begin " << ++inends << endl;
-      //    cout << si->first << ", " << si->second << endl;
-      ends.push_back(*si);
-      push_heap(ends.begin(), ends.end(), GtBySecond());
-      pos = si->first;
-    } else { // reached end of range
-      //   cout << "got end " << --inends << endl;
-      pos = ends[0].second;
-      pop_heap(ends.begin(), ends.end(), GtBySecond());
-      ends.pop_back();
-    }
-
-    getMeanSD(ends.begin(), ends.end(), mea, sderr);
-    if (globals.find("ztest") != globals.end()) // use library stdev as sderr
-      sderr = stdev;
-
-    if (globals.find("ceplot") != globals.end()){
-      ceplotFile << pos << "\t" << mea << " " << mean << " " << sderr << " " << ((sderr != 0) ? (mea - mean) * sqrt((double)ends.size()) / sderr : 0 ) << "\t" << ends.size() << endl;
-    }
+  const vector<CEPoint> & points = sweep.sweep();
 
-
-    if (ends.size() > MIN_CE_OBS && abs(mea - mean) > num_sd * sderr / sqrt((double)ends.size())){ // too far off
-      //      cerr << "CE " << libid << " pos= " << pos << " skew= " << (mea - mean) * sqrt((double)ends.size()) / sderr << " nobs= " << ends.size() << endl;
-      if (mea > mean) {
-	if (inbad && over == false){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = true;
-      } else {
-	if (inbad && over == true){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = false;
-      }
-      if (! inbad){      // if not already in a bad region, we are now
-	inbad = true;
-	st = pos;        // start of bad region is current position
-      }
-    } else if (inbad) { // bad region ended
-      inbad = false;
-      interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-      stretch.push_back(over);
-    }
-  } // for each start
-
-  cerr << "Done with starts" << endl;
-  while (ends.size() > 0){
-    pos = ends[0].second;
-    pop_heap(ends.begin(), ends.end(), GtBySecond());
-    ends.pop_back();
-    if (ends.size()== 0){
-      cerr << "Done with ends\n";
-      break;
-    }
-
-    getMeanSD(ends.begin(), ends.end(), mea, sderr);
-    if (globals.find("ztest") != globals.end()) // use library stdev as sderr
-      sderr = stdev;
-
-    if (globals.find("ceplot") != globals.end()){
-      ceplotFile << pos << "\t" << mea << " " << mean << " " << sderr << " " << ((sderr != 0) ? (mea - mean) * sqrt((double)ends.size()) / sderr : 0 ) << "\t" << ends.size() << endl;
+  if (globals.find("ceplot") != globals.end()){
+    for (vector<CEPoint>::const_iterator pi = points.begin(); pi != points.end(); pi++){
+      double sderr = ztest ? stdev : pi->stdev();
+      ceplotFile << pi->m_pos << "\t" << (Size_t) pi->mean() << " " << mean << " " << sderr << " " << pi->zscore(mean, sderr) << "\t" << pi->m_n << endl;
     }
+  }
 
-    if (ends.size() > MIN_CE_OBS && abs(mea - mean) > num_sd * sderr / sqrt((double)ends.size())){ // too far off
-      //      cerr << "CE " << libid << " pos= " << pos << " skew= " << (mea - mean) * sqrt((double)ends.size()) / sderr << " nobs= " << ends.size() << endl;
-      if (mea > mean) {
-	if (inbad && over == false){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = true;
-      } else {
-	if (inbad && over == true){ // switched type of bad region
-	  interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-	  stretch.push_back(over);
-	  st = pos;
-	}
-	over = false;
-      }
-      if (! inbad){      // if not already in a bad region, we are now
-	inbad = true;
-	st = pos;        // start of bad region is current position
-      }
-    } else if (inbad) { // bad region ended
-      inbad = false;
-      interest.push_back(pair<Pos_t, Pos_t> (st, pos));
-      stretch.push_back(over);
-    }
-  } // for each end
+  sweep.findRegions(mean, stdev, ztest, num_sd, MIN_CE_OBS, interest, stretch);
 } // getCEstat
 
 
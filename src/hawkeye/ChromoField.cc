@@ -34,9 +34,9 @@ ChromoField::ChromoField(RenderSeq_t * read,
   m_hscale = 2.0;
 
   m_read = read;
-  if (!m_read->m_trace) { return; }
+  if (!m_read->m_trace.get()) { return; }
 
-  Read * m_trace = (Read *) m_read->m_trace;
+  Read * m_trace = (Read *) m_read->m_trace.get();
 
   int vscale=24;
   int tickwidth = 2;
@@ -300,7 +300,7 @@ int ChromoField::getWindowPos(int gindex)
     if (m_read->m_rc)
     {
       gseqpos = m_read->m_pos.size() - gseqpos;
-      Read * m_trace = (Read *) m_read->m_trace;
+      Read * m_trace = (Read *) m_read->m_trace.get();
       retval = (int)((m_trace->NPoints-m_read->m_pos[gseqpos])* m_hscale);
     }
     else
@@ -4,6 +4,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <stdio.h>
 
 #include "ChromoStore.hh"
 
@@ -31,10 +32,13 @@ ChromoStore::ChromoStore()
   m_tracecmd          = "curl \"http://www.ncbi.nlm.nih.gov/Traces/trace.fcgi?cmd=java&val=%EID%\" -s -o %TRACECACHE%/%EID%";
   m_tracecmdpath      = "%TRACECACHE%/%EID%";
   m_tracecmdenabled   = 0;
+  m_maxcachedtraces   = 256;
 }
 
 ChromoStore::~ChromoStore()
 {
+  clearCache();
+
   if (m_tracecachecreated)
   {
     cerr << "Cleaning tracecache directory: " << m_tracecache << endl;
@@ -103,8 +107,50 @@ extern "C"
   #include "Read.h"
 }
 
-char * ChromoStore::fetchTrace(const AMOS::Read_t & read, 
-                             std::vector<int16_t> & positions )
+TraceHandle::TraceHandle(char * trace)
+  : m_shared(NULL)
+{
+  if (trace)
+  {
+    m_shared = new Shared;
+    m_shared->m_trace = trace;
+    m_shared->m_count = 1;
+  }
+}
+
+TraceHandle::TraceHandle(const TraceHandle & other)
+  : m_shared(other.m_shared)
+{
+  if (m_shared) { m_shared->m_count++; }
+}
+
+TraceHandle::~TraceHandle()
+{
+  release();
+}
+
+TraceHandle & TraceHandle::operator=(const TraceHandle & other)
+{
+  Shared * shared = other.m_shared;
+  if (shared) { shared->m_count++; }
+  release();
+  m_shared = shared;
+  return *this;
+}
+
+void TraceHandle::release()
+{
+  if (m_shared && --m_shared->m_count == 0)
+  {
+    read_deallocate((Read *) m_shared->m_trace);
+    delete m_shared;
+  }
+
+  m_shared = NULL;
+}
+
+TraceHandle ChromoStore::fetchTrace(const AMOS::Read_t & read, 
+                                    std::vector<int16_t> & positions )
 {
   string eid = read.getEID();
 
@@ -113,6 +159,30 @@ char * ChromoStore::fetchTrace(const AMOS::Read_t & read,
   string iid(iidarr);
 
   Read * trace = NULL;
+  TraceHandle handle;
+
+  map<AMOS::ID_t, TraceList::iterator>::iterator ti = m_cachedindex.find(read.getIID());
+  if (ti != m_cachedindex.end())
+  {
+    m_cached.splice(m_cached.begin(), m_cached, ti->second);
+    handle = ti->second->second;
+    trace = (Read *) handle.get();
+  }
+
+  const char * data;
+  size_t size;
+
+  if (!trace && m_archive.find(read.getIID(), eid, data, size))
+  {
+    FILE * fp = fmemopen((void *) data, size, "rb");
+    if (fp)
+    {
+      trace = fread_reading(fp, (char *) eid.c_str(), TT_ZTR);
+      fclose(fp);
+    }
+
+    if (trace) { handle = cacheTrace(read.getIID(), (char *) trace); }
+  }
 
   string path;
 
@@ -129,6 +199,7 @@ char * ChromoStore::fetchTrace(const AMOS::Read_t & read,
       closedir(dir);
       path += "/" + eid;
       trace = read_reading((char *)path.c_str(), TT_ANY);
+      if (trace) { handle = cacheTrace(read.getIID(), (char *) trace); }
     }
   }
 
@@ -151,6 +222,7 @@ char * ChromoStore::fetchTrace(const AMOS::Read_t & read,
     if (!retval)
     {
       trace = read_reading((char *)path.c_str(), TT_ANY);
+      if (trace) { handle = cacheTrace(read.getIID(), (char *) trace); }
     }
   }
 
@@ -163,7 +235,44 @@ char * ChromoStore::fetchTrace(const AMOS::Read_t & read,
     }
   }
 
-  return (char *) trace;
+  return handle;
+}
+
+TraceHandle ChromoStore::cacheTrace(AMOS::ID_t iid, char * trace)
+{
+  while (!m_cached.empty() && m_cachedindex.size() >= m_maxcachedtraces)
+  {
+    m_cachedindex.erase(m_cached.back().first);
+    m_cached.pop_back();
+  }
+
+  m_cached.push_front(make_pair(iid, TraceHandle(trace)));
+  m_cachedindex[iid] = m_cached.begin();
+
+  return m_cached.front().second;
+}
+
+void ChromoStore::clearCache()
+{
+  m_cached.clear();
+  m_cachedindex.clear();
 }
 
+void ChromoStore::setBank(const string & bank)
+{
+  clearCache();
+  m_archive.close();
 
+  if (TraceArchive::exists(bank))
+  {
+    try
+    {
+      m_archive.open(bank);
+      cerr << "Using " << m_archive.getSize() << " traces of the trace archive" << endl;
+    }
+    catch (AMOS::Exception_t & e)
+    {
+      cerr << "Ignoring trace archive: " << e.what() << endl;
+    }
+  }
+}
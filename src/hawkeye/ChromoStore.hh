@@ -2,18 +2,53 @@
 #define CHROMO_STORE_HH_ 1
 
 #include "foundation_AMOS.hh"
+#include "TraceArchive.hh"
 #include <string>
 #include <map>
+#include <list>
 #include <vector>
 
 
+// A decoded trace shared by the ChromoStore cache and the RenderSeq_t that
+// display it. Copies share the trace, the last one to let go frees it. The
+// count is not atomic, hawkeye only touches traces from the GUI thread.
+class TraceHandle
+{
+public:
+  TraceHandle() : m_shared(NULL) { }
+  explicit TraceHandle(char * trace);
+  TraceHandle(const TraceHandle & other);
+  ~TraceHandle();
+
+  TraceHandle & operator=(const TraceHandle & other);
+
+  // The Read of io_lib, NULL if there is no trace
+  char * get() const { return m_shared ? m_shared->m_trace : NULL; }
+
+private:
+  struct Shared
+  {
+    char * m_trace;
+    int m_count;
+  };
+
+  void release();
+
+  Shared * m_shared;
+};
+
+
 class ChromoStore 
 {
 public:
   static ChromoStore * Instance();
   ~ChromoStore();
 
-  char * fetchTrace(const AMOS::Read_t & read, std::vector<int16_t> & positions);
+  // Returns the trace of read, shared with the cache
+  TraceHandle fetchTrace(const AMOS::Read_t & read, std::vector<int16_t> & positions);
+
+  // Switches to the traces of a bank, from its trace archive if it has one
+  void setBank(const std::string & bank);
 
 
   std::vector <std::string> m_tracepaths;
@@ -22,6 +57,7 @@ public:
   std::string m_tracecmdpath;
   std::string m_tracedb;
   bool m_tracecmdenabled;
+  unsigned int m_maxcachedtraces;
 
 
 
@@ -37,8 +73,18 @@ private:
                                  const std::string & eid,
                                  const std::string & iid);
 
+  TraceHandle cacheTrace(AMOS::ID_t iid, char * trace);
+  void clearCache();
+
   bool m_tracecachecreated;
 
+  TraceArchive m_archive;
+
+  // Decoded traces, most recently used first
+  typedef std::list<std::pair<AMOS::ID_t, TraceHandle> > TraceList;
+  TraceList m_cached;
+  std::map<AMOS::ID_t, TraceList::iterator> m_cachedindex;
+
   
 };
 
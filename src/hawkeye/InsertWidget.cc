@@ -1,6 +1,7 @@
 #include "InsertWidget.hh"
 
 #include <set>
+#include <cmath>
 
 #include <qlayout.h>
 #include <qlabel.h>
@@ -151,6 +152,11 @@ InsertWidget::InsertWidget(DataStore * datastore,
   m_insertCL = NULL;
   m_readCL = NULL;
 
+  m_pyramidLevel = -1;
+  m_pyramidBegin = 0;
+  m_pyramidEnd = 0;
+  m_pyramidPending = false;
+
   m_overviewtop = 0;
   m_overviewbottom = 1;
 
@@ -433,6 +439,22 @@ void InsertWidget::updateVisibleRange()
   hrange->setRange((int)(real.x()), (int)(real.x()+real.width()));
   vrange->setRange((int)(real.y()), (int)(real.y()+real.height()));
   m_updatingScrollBars = false;
+
+  if (m_pyramidLevel >= 0 && !m_pyramidPending)
+  {
+    // Fetch the coverage again once the zoom calls for another level or the
+    // view leaves the range that was fetched
+    double binsize = 1.0 / (m_hscale * m_ifield->worldMatrix().m11());
+    int left  = (int)(real.x() / m_hscale) - m_hoffset;
+    int right = (int)((real.x() + real.width()) / m_hscale) - m_hoffset;
+
+    if (m_pyramid.getLevel(binsize) != m_pyramidLevel ||
+        left < m_pyramidBegin || right > m_pyramidEnd)
+    {
+      m_pyramidPending = true;
+      QTimer::singleShot(0, this, SLOT(refreshPyramidCoverage()));
+    }
+  }
 }
 
 
@@ -756,6 +778,12 @@ void InsertWidget::computeCoverage()
   if (m_insertCL)  { delete m_insertCL;  }
   if (m_readCL)    { delete m_readCL;  }
 
+  m_insertCL = NULL;
+  m_readCL = NULL;
+  m_libStats.clear();
+
+  if (loadPyramidCoverage()) { return; }
+
   // coverage will change at each endpoint of each (happy) insert
   m_insertCL = new CoverageStats((2+m_inserts.size())*4, 0, Distribution_t());
   m_insertCL->addEndpoints(leftmost, leftmost);
@@ -838,6 +866,136 @@ void InsertWidget::computeCoverage()
 }
 
 
+// Turns the bins of a pyramid track into the points of a CoverageStats, with
+// the C/E statistic scaled to the plot the way finalizeCE does
+static void addPyramidBins(const vector<CoveragePyramid::Bin> & bins,
+                           Pos_t first, int binsize, Pos_t last,
+                           CoverageStats & stats, bool cestat, int vheight)
+{
+  int half = vheight / 2;
+
+  for (size_t i = 0; i < bins.size(); i++)
+  {
+    Pos_t s = first + (Pos_t) i * binsize;
+    Pos_t e = min(last, s + binsize - 1);
+    double val = bins[i].m_mean;
+    int y = (int) val;
+
+    if (cestat)
+    {
+      y = max(-half, min(half, (int)(val*8))) + half;
+      stats.m_cestat[stats.m_curpos] = val;
+      stats.m_cestat[stats.m_curpos+1] = val;
+    }
+
+    stats.addPoint(s, y);
+    stats.addPoint(e, y);
+  }
+}
+
+
+bool InsertWidget::loadPyramidCoverage()
+{
+  m_pyramidLevel = -1;
+
+  bool scaffold = m_paintScaffold && (m_currentScaffold != AMOS::NULL_ID);
+  NCode_t type = scaffold ? Scaffold_t::NCODE : Contig_t::NCODE;
+  ID_t iid = scaffold ? (ID_t) m_scaffoldId : m_datastore->m_contig.getIID();
+
+  try
+  {
+    if (!m_pyramid.isOpen() || m_pyramid.getType() != type)
+    {
+      m_pyramid.close();
+      if (!CoveragePyramid::isCurrent(m_datastore->m_bankname, type)) { return false; }
+      m_pyramid.open(m_datastore->m_bankname, type);
+      cerr << "Using coverage pyramid of " << m_datastore->m_bankname << endl;
+    }
+  }
+  catch (Exception_t & e)
+  {
+    cerr << "Coverage pyramid not available:\n" << e;
+    m_pyramid.close();
+    return false;
+  }
+
+  // The insert and C/E tracks were computed with the pyramid's happy
+  // distance. The mates are connected when the coverage is computed either
+  // way, disconnectMates only runs after computeCoverage.
+  if (m_pyramid.getHappyDistance() != Insert::MAXSTDEV) { return false; }
+
+  Pos_t ibegin, iend, rbegin, rend;
+  CoveragePyramid::Bin isum, rsum;
+
+  if (!m_pyramid.getSummary(iid, CoveragePyramid::INSERT_TRACK, ibegin, iend, isum) ||
+      !m_pyramid.getSummary(iid, CoveragePyramid::READ_TRACK, rbegin, rend, rsum))
+  {
+    return false;
+  }
+
+  // One bin per screen pixel
+  double binsize = 1.0 / (m_hscale * m_ifield->worldMatrix().m11());
+  m_pyramidLevel = m_pyramid.getLevel(binsize);
+
+  QRect rc = QRect(m_ifield->contentsX(),    m_ifield->contentsY(),
+                   m_ifield->visibleWidth(), m_ifield->visibleHeight() );
+  QRect real = m_ifield->inverseWorldMatrix().mapRect(rc);
+
+  int left  = (int)(real.x() / m_hscale) - m_hoffset;
+  int width = (int)(real.width() / m_hscale) + 1;
+  m_pyramidBegin = left - width;
+  m_pyramidEnd   = left + 2 * width;
+
+  vector<CoveragePyramid::Bin> bins;
+  Pos_t first;
+  int cestatsheight = 100;
+
+  vector<int> tracks;
+  m_pyramid.getTracks(iid, tracks);
+
+  for (vector<int>::const_iterator t = tracks.begin(); t != tracks.end(); t++)
+  {
+    int level = m_pyramidLevel;
+    int n = m_pyramid.fetch(iid, *t, level, m_pyramidBegin, m_pyramidEnd, bins, first);
+    int bs = m_pyramid.getBinSize(level);
+
+    Pos_t tbegin, tend;
+    CoveragePyramid::Bin tsum;
+    m_pyramid.getSummary(iid, *t, tbegin, tend, tsum);
+
+    if (*t == CoveragePyramid::READ_TRACK || *t == CoveragePyramid::INSERT_TRACK)
+    {
+      CoverageStats * stats = new CoverageStats(2*n+2, 0, Distribution_t());
+      addPyramidBins(bins, first, bs, tend, *stats, false, 0);
+      stats->m_maxdepth = (int) ceil(tsum.m_max);
+
+      if (*t == CoveragePyramid::READ_TRACK) { m_readCL = stats; }
+      else                                   { m_insertCL = stats; }
+    }
+    else
+    {
+      LibStats::iterator li = m_libStats.insert(make_pair((ID_t) *t,
+              CoverageStats(2*n+2, *t, m_datastore->getLibrarySize(*t)))).first;
+      addPyramidBins(bins, first, bs, tend, li->second, true, cestatsheight);
+    }
+  }
+
+  m_width = iend + m_hoffset + 1;
+  m_meaninsertcoverage = isum.m_mean;
+  m_meanreadcoverage = rsum.m_mean;
+
+  return true;
+}
+
+
+void InsertWidget::refreshPyramidCoverage()
+{
+  m_pyramidPending = false;
+  computeCoverage();
+  paintCanvas();
+}
+
+
 void InsertWidget::disconnectMates()
 {
   int last = m_inserts.size();
@@ -15,6 +15,7 @@
 #include "Insert.hh"
 #include "RangeScrollBar.hh"
 #include "CoverageStats.hh"
+#include "CoveragePyramid.hh"
 
 #include <map>
 
@@ -49,6 +50,7 @@ public slots:
   void centerView(int);
 
   void refreshWidget();
+  void refreshPyramidCoverage();
 
   void showAll();
   void setTilingVisibleRange(int, int, int);
@@ -218,6 +220,18 @@ private:
   typedef map<AMOS::ID_t, CoverageStats> LibStats;
   LibStats m_libStats;
 
+  // Coverage of the view from the bank's coverage pyramid, when it has a
+  // current one: the level matching the zoom over the visible range and a
+  // screen width either side. This only replaces the coverage sweep, the
+  // reads and inserts are still loaded by initializeTiling and
+  // computeInsertHappiness to draw them
+  bool loadPyramidCoverage();
+  CoveragePyramid m_pyramid;
+  int m_pyramidLevel;          // level on display, -1 if not from the pyramid
+  int m_pyramidBegin;
+  int m_pyramidEnd;
+  bool m_pyramidPending;
+
 
   RangeScrollBar_t * hrange;
   RangeScrollBar_t * vrange;
@@ -193,6 +193,8 @@ void LaunchPad::setBankname(std::string bankname)
     EventTime_t total;
     if (!m_datastore->openBank(bankname))
     {
+      ChromoStore::Instance()->setBank(bankname);
+
       EventTime_t timer;
       ProgressDots_t dots(10,10);
       cerr << "Initialize Display ";
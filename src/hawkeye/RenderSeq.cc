@@ -3,12 +3,16 @@
 #include "DataStore.hh"
 #include "ChromoStore.hh"
 
+extern "C"
+{
+#include <Read.h>
+}
+
 using namespace std;
 using namespace AMOS;
 
 RenderSeq_t::RenderSeq_t()
 {
-  m_trace = NULL;
   m_displayTrace = false;
   m_displaystart = 0;
   m_displayend = 0;
@@ -262,7 +266,7 @@ bool RenderSeq_t::hasOverlap(Pos_t rangeStart, // 0-based exact offset of range
 
 void RenderSeq_t::loadTrace()
 {
-  if (m_trace) { return; }
+  if (m_trace.get()) { return; }
 
   ChromoStore * chromostore = ChromoStore::Instance();
 
@@ -272,7 +276,7 @@ void RenderSeq_t::loadTrace()
   
   cerr << " load trace" << endl;
   m_trace = chromostore->fetchTrace(m_read, m_pos);
-  if (!m_trace) { cerr << "Trace Not Found" << endl; return; }
+  if (!m_trace.get()) { cerr << "Trace Not Found" << endl; return; }
   if (m_pos.empty()) { cerr << "Trace Positions Not Available" << endl; return; }
 
   if (m_rc)
@@ -283,7 +287,7 @@ void RenderSeq_t::loadTrace()
     vector<int16_t>::iterator p;
     for (p = m_pos.begin(); p != m_pos.end(); p++)
     {
-      *p = m_trace->NPoints - *p;
+      *p = ((Read *) m_trace.get())->NPoints - *p;
     }
 #endif
   }
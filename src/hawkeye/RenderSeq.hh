@@ -6,6 +6,7 @@
 #include "foundation_AMOS.hh"
 #include "amp.hh"
 #include "fasta.hh"
+#include "ChromoStore.hh"
 
 class DataStore;
 
@@ -57,7 +58,7 @@ public:
   AMOS::Read_t m_read;
   AMOS::Tile_t * m_tile;
 
-  char * m_trace;
+  TraceHandle m_trace;      // shared with the ChromoStore cache and copies
   bool m_displayTrace;
 
   static bool hasOverlap(AMOS::Pos_t rangeStart, // 0-based exact offset of range
@@ -599,10 +599,10 @@ void TilingField::paintEvent( QPaintEvent * paintevent )
         { 
           int baseline = ldcov + m_traceheight;
           
-          if (ri->m_trace)
+          if (ri->m_trace.get())
           {
             unsigned short * trace = NULL;
-            Read * chromotrace = (Read *) ri->m_trace;
+            Read * chromotrace = (Read *) ri->m_trace.get();
 
             for (int channel = 0; channel < 4; channel++)
             {